@@ -0,0 +1,104 @@
+/*
+ *  CSRAbstraction.cpp
+ *  hog2
+ *
+ *  A read-only snapshot of a MapAbstraction in flat arrays.
+ *
+ */
+
+#include "CSRAbstraction.h"
+
+using namespace GraphAbstractionConstants;
+
+const uint32_t CSRAbstraction::kNoNode;
+
+CSRAbstraction::CSRAbstraction(MapAbstraction *a)
+{
+	coordinateScale = a->GetMap()->GetCoordinateScale();
+	levels.resize(a->getNumAbstractGraphs());
+	for (unsigned int l = 0; l < levels.size(); l++)
+	{
+		Graph *g = a->GetAbstractGraph(l);
+		Level &level = levels[l];
+		uint32_t numNodes = g->GetNumNodes();
+		level.first.resize(numNodes+1);
+		level.parent.resize(numNodes);
+		level.firstChild.resize(numNodes+1);
+		level.x.resize(numNodes);
+		level.y.resize(numNodes);
+		level.targets.reserve(2*g->GetNumEdges());
+		level.weights.reserve(2*g->GetNumEdges());
+		for (uint32_t n = 0; n < numNodes; n++)
+		{
+			node *next = g->GetNode(n);
+			level.first[n] = level.targets.size();
+			edge_iterator ei = next->getEdgeIter();
+			for (edge *e = next->edgeIterNext(ei); e; e = next->edgeIterNext(ei))
+			{
+				level.targets.push_back((e->getFrom() == n)?e->getTo():e->getFrom());
+				level.weights.push_back(e->GetWeight());
+			}
+			
+			level.parent[n] = kNoNode;
+			if ((l+1 < levels.size()) && (next->GetLabelL(kParent) >= 0))
+				level.parent[n] = next->GetLabelL(kParent);
+			level.firstChild[n] = level.children.size();
+			if (l > 0)
+			{
+				for (int x = 0; x < next->GetLabelL(kNumAbstractedNodes); x++)
+					level.children.push_back(next->GetLabelL(kFirstData+x));
+			}
+			
+			recVec loc = a->GetNodeLoc(next);
+			level.x[n] = loc.x;
+			level.y[n] = loc.y;
+		}
+		level.first[numNodes] = level.targets.size();
+		level.firstChild[numNodes] = level.children.size();
+	}
+}
+
+bool CSRAbstraction::HasEdge(int level, uint32_t from, uint32_t to) const
+{
+	const Level &l = levels[level];
+	for (uint32_t e = l.first[from]; e < l.first[from+1]; e++)
+		if (l.targets[e] == to)
+			return true;
+	return false;
+}
+
+double CSRAbstraction::HCost(int level, uint32_t a, uint32_t b) const
+{
+	const Level &l = levels[level];
+	double dx = fabs(l.x[a]-l.x[b]);
+	double dy = fabs(l.y[a]-l.y[b]);
+	const double root2m1 = ROOT_TWO-1;
+	if (dx < dy)
+		return (root2m1*dx+dy)*coordinateScale;
+	return (root2m1*dy+dx)*coordinateScale;
+}
+
+bool CSRAbstraction::Pathable(uint32_t a, uint32_t b) const
+{
+	for (int l = 0; (l+1 < (int)levels.size()) && (a != b); l++)
+	{
+		a = levels[l].parent[a];
+		b = levels[l].parent[b];
+		if ((a == kNoNode) || (b == kNoNode))
+			return false;
+	}
+	return (a == b);
+}
+
+uint64_t CSRAbstraction::GetMemoryUsage() const
+{
+	uint64_t total = 0;
+	for (unsigned int l = 0; l < levels.size(); l++)
+	{
+		const Level &level = levels[l];
+		total += sizeof(uint32_t)*(level.first.size()+level.targets.size()+level.parent.size()+
+								   level.firstChild.size()+level.children.size());
+		total += sizeof(double)*(level.weights.size()+level.x.size()+level.y.size());
+	}
+	return total;
+}
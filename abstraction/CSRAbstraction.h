@@ -0,0 +1,66 @@
+/*
+ *  CSRAbstraction.h
+ *  hog2
+ *
+ *  A read-only snapshot of a MapAbstraction in flat arrays.
+ *
+ *  Each level keeps its edges in compressed sparse row form, in the order
+ *  the Graph iterates them, along with parent and child indices and the
+ *  location used by the heuristic. Node numbers are the same as in the
+ *  Graphs. Searches over the snapshot need no node/edge objects or label
+ *  lookups, and the whole hierarchy takes a fraction of the memory.
+ *
+ *  The snapshot doesn't follow later changes to the abstraction; build a
+ *  new one after repairing it. Edge capacities are not kept.
+ *
+ */
+
+#ifndef CSRABSTRACTION_H
+#define CSRABSTRACTION_H
+
+#include <stdint.h>
+#include <vector>
+#include "MapAbstraction.h"
+
+class CSRAbstraction {
+public:
+	CSRAbstraction(MapAbstraction *a);
+
+	int GetNumLevels() const { return (int)levels.size(); }
+	uint32_t GetNumNodes(int level) const { return (uint32_t)levels[level].parent.size(); }
+	/** Number of undirected edges at this level */
+	uint32_t GetNumEdges(int level) const { return levels[level].targets.size()/2; }
+
+	/** Edges of n (in both directions) are GetFirstEdge(n) up to GetFirstEdge(n+1) */
+	uint32_t GetFirstEdge(int level, uint32_t n) const { return levels[level].first[n]; }
+	uint32_t GetTarget(int level, uint32_t e) const { return levels[level].targets[e]; }
+	double GetWeight(int level, uint32_t e) const { return levels[level].weights[e]; }
+	bool HasEdge(int level, uint32_t from, uint32_t to) const;
+
+	/** kNoNode at the top level */
+	uint32_t GetParent(int level, uint32_t n) const { return levels[level].parent[n]; }
+	/** Children of n (at level-1) are GetChild(level, x) for x in GetFirstChild(n) up to GetFirstChild(n+1) */
+	uint32_t GetFirstChild(int level, uint32_t n) const { return levels[level].firstChild[n]; }
+	uint32_t GetChild(int level, uint32_t x) const { return levels[level].children[x]; }
+
+	/** Same as MapAbstraction::h */
+	double HCost(int level, uint32_t a, uint32_t b) const;
+	/** True if a and b (at level 0) share a top level parent */
+	bool Pathable(uint32_t a, uint32_t b) const;
+
+	uint64_t GetMemoryUsage() const;
+
+	static const uint32_t kNoNode = 0xFFFFFFFF;
+private:
+	struct Level {
+		std::vector<uint32_t> first, targets;
+		std::vector<double> weights;
+		std::vector<uint32_t> parent;
+		std::vector<uint32_t> firstChild, children;
+		std::vector<double> x, y;
+	};
+	std::vector<Level> levels;
+	double coordinateScale;
+};
+
+#endif
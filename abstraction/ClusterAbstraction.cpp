@@ -26,9 +26,11 @@
 
 #include "ClusterAbstraction.h"
 #include "GenericAStar.h"
+#include "Timer.h"
 #include <cfloat>
 #include <cmath>
 #include <limits>
+#include <algorithm>
 
 using namespace GraphAbstractionConstants;
 
@@ -60,15 +62,14 @@ public:
 		return heuristic(node1, node2);
 	}
 
+	// the corridor is kept sorted instead of being marked in node labels, so
+	// that searches in different clusters can run at the same time
 	void setCorridor(std::vector<node *> &corr)
 	{
 		corridor = corr;
+		std::sort(corridor.begin(), corridor.end());
 		if (corr.size() > 0)
-		{
 			corridorLevel = aMap->GetAbstractionLevel(corr[0]);
-			for (unsigned int x = 0; x < corridor.size(); x++)
-				corridor[x]->SetLabelL(kTemporaryLabel, x);
-		}
 	}
 	
 	bool inCorridor(uint32_t nodeID)
@@ -77,13 +78,7 @@ public:
 			return true;
 		node *n = aMap->GetAbstractGraph(level)->GetNode(nodeID);
 		node *parent = aMap->GetNthParent(n, corridorLevel);
-		if (parent)
-		{
-			unsigned int loc = parent->GetLabelL(kTemporaryLabel);
-			if ((loc < corridor.size()) && (corridor[loc] == parent))
-				return true;
-		}
-		return false;
+		return (parent && std::binary_search(corridor.begin(), corridor.end(), parent));
 	}
 private:
 	GraphAbstraction *aMap;
@@ -103,33 +98,41 @@ void Cluster::AddNode(int n)
 	nodes.push_back(n);
 }
 
+/**
+* Replace an entrance's node number after it changed in the abstract Graph
+ */
+void Cluster::renameNode(int oldNum, int newNum)
+{
+	for (unsigned int i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i] == oldNum)
+		{
+			nodes[i] = newNum;
+			return;
+		}
+	}
+}
+
 /**
 * create a cluster abstraction for the given map. Clusters are square, 
  * with height = width = clustersize. 
  */ 
-ClusterAbstraction::ClusterAbstraction(Map *map, int _clusterSize)
-:MapAbstraction(map),clusterSize(_clusterSize)
+ClusterAbstraction::ClusterAbstraction(Map *map, int _clusterSize, int _numThreads)
+:MapAbstraction(map),clusterSize(_clusterSize),numThreads(std::max(_numThreads, 1))
 {
+	Timer t;
+	t.StartTimer();
 	abstractions.push_back(GetMapGraph(map));
 	createClustersAndEntrances();
 	linkEntrancesAndClusters();
 	createAbstractGraph();
+	buildTime = t.EndTimer();
 }
 
 ClusterAbstraction::~ClusterAbstraction()
 {
-	Graph* g = abstractions[1];
-	edge_iterator ei = g->getEdgeIter();
-	edge* e = g->edgeIterNext(ei);
-	while(e)
-	{
-		path* p = temp[e];
-		temp.erase(e);
-		delete p;
-		
-		//	ei = g->getEdgeIter();
-		e = g->edgeIterNext(ei);
-	}
+	for (clusterUtil::PathLookupTable::iterator it = paths.begin(); it != paths.end(); it++)
+		delete it->second;
 	paths.clear();
 }
 
@@ -198,8 +201,11 @@ void ClusterAbstraction::createAbstractGraph()
 	Graph *g = abstractions[1];
 	
 	addAbsNodes(g);
-	setUpParents(g);
-	computeClusterPaths(g);
+	std::vector<int> all;
+	for (unsigned int i=0; i<clusters.size(); i++)
+		all.push_back(i);
+	setUpParents(g, all);
+	computeClusterPaths(g, all);
 	
 	// 	std::cout<<"1st level of abstraction\n";
 	// 	g->Print(std::cout);
@@ -363,13 +369,13 @@ void ClusterAbstraction::createVertEntrances(int start, int end, int meridian, i
 /** 
 * from original HPA* abstiling.cpp
 */ 
-void ClusterAbstraction::linkEntrancesAndClusters()
+void ClusterAbstraction::linkEntrancesAndClusters(unsigned int first)
 {
 	if (verbose) std::cout<<"linking entrances and clusters\n";
 	
 	int cluster1Id;
 	int cluster2Id;
-	for (unsigned int i = 0; i < entrances.size(); i++)
+	for (unsigned int i = first; i < entrances.size(); i++)
 	{
 		
 		Entrance &entrance = entrances[i];
@@ -402,9 +408,9 @@ void ClusterAbstraction::linkEntrancesAndClusters()
 } 
 
 /**
-* Add a node for cluster for each entrance
+* Add a node for cluster for each entrance, starting with entrance first
  */ 
-void ClusterAbstraction::addAbsNodes(Graph* g)
+void ClusterAbstraction::addAbsNodes(Graph* g, unsigned int first)
 {
 	Map* map = MapAbstraction::GetMap();
 	if (verbose) std::cout<<"adding abstract nodes\n";
@@ -415,7 +421,7 @@ void ClusterAbstraction::addAbsNodes(Graph* g)
 	double r;
 	int num=-1;
 	
-	for (unsigned int i=0; i<entrances.size(); i++)
+	for (unsigned int i=first; i<entrances.size(); i++)
 	{
 		
 		Entrance &entrance = entrances[i];
@@ -534,96 +540,146 @@ void ClusterAbstraction::addAbsNodes(Graph* g)
 }
 
 /*
- * Compute the paths inside each cluster. For each pair of entrances inside a cluster, find out if 
+ * Compute the paths inside the given clusters. For each pair of entrances inside a cluster, find out if 
  * there is a path that only uses nodes inside the cluster. If there is, add an edge to the abstract
  * Graph with the path distance as its weight and cache the path in the hash map.  
  * 
- * can make this more efficient?
+ * The searches run in parallel; the edges are added afterwards in cluster order.
  */
-void ClusterAbstraction::computeClusterPaths(Graph* g)
-{//int total=0;
-	Map* map = MapAbstraction::GetMap();
+void ClusterAbstraction::computeClusterPaths(Graph* g, const std::vector<int>& which)
+{
 	if (verbose) std::cout<<"computing cluster paths\n";
-	for (unsigned int i=0; i<clusters.size(); i++)
+	runOnClusters(which, &ClusterAbstraction::findClusterPaths);
+	for (unsigned int i=0; i<which.size(); i++)
 	{
-		Cluster& c = clusters[i];
-		
-		std::vector<node*> corridor; 
-		for (int l=0; l<c.GetNumNodes(); l++)
+		Cluster& c = clusters[which[i]];
+		for (unsigned int j=0; j<c.entrancePaths.size(); j++)
 		{
-			corridor.push_back(g->GetNode(c.getIthNodeNum(l)));
+			clusterUtil::EntrancePath& ep = c.entrancePaths[j];
+			edge* newedge = new edge(ep.from, ep.to, ep.length);
+			g->AddEdge(newedge);
+			paths[newedge] = ep.p;
 		}
-		for (unsigned int j=0; j < c.parents.size(); j++)
-			corridor.push_back(c.parents[j]);
-		
-		//int num = 0;
-		for (int j=0; j<c.GetNumNodes(); j++)
-		{
-			for (int k=j+1; k<c.GetNumNodes();k++)
-			{
-				
-				// find bottom level nodes
-				node* absStart = g->GetNode(c.getIthNodeNum(j));
-				node* absGoal = g->GetNode(c.getIthNodeNum(k));
-				
-				// find start/end coordinates (same in abstract and bottom level)
-				double startx = absStart->GetLabelF(kXCoordinate);	
-				double starty = absStart->GetLabelF(kYCoordinate);
-				double startz = absStart->GetLabelF(kZCoordinate);
-				
-				double goalx = absGoal->GetLabelF(kXCoordinate);
-				double goaly = absGoal->GetLabelF(kYCoordinate);
-				double goalz = absGoal->GetLabelF(kZCoordinate);
-				
-				point3d s(startx,starty,startz);
-				point3d gl(goalx,goaly,goalz);
-				
-				int px;
-				int py;
-				
-				map->GetPointFromCoordinate(s,px,py);
-				
-				node* start = GetNodeFromMap(px,py);
-				
-				map->GetPointFromCoordinate(gl,px,py);
-				
-				node* goal = GetNodeFromMap(px,py);
-				
-				int startnum = c.getIthNodeNum(j);
-				int goalnum = c.getIthNodeNum(k);
-				
-				//find path
-//				corridorAStar astar;
-//				astar.setCorridor(&corridor);
-//				path* p = astar.GetPath(static_cast<MapAbstraction*>(this), start, goal);
+		c.entrancePaths.clear();
+	}
+}
 
-				GenericAStar astar;
-				ClusterSearchEnvironment cse(this, GetAbstractionLevel(start));
-				cse.setCorridor(corridor);
-				std::vector<uint32_t> resultPath;
-				astar.GetPath(&cse, start->GetNum(), goal->GetNum(),
-											resultPath);
-				path *p = 0;
-				for (unsigned int x = 0; x < resultPath.size(); x++)
-					p = new path(GetAbstractGraph(start)->GetNode(resultPath[x]), p);
+/**
+* Find the paths between each pair of entrances of one cluster. Only reads the
+ * Graphs, so it can run in several clusters at once.
+ */
+void ClusterAbstraction::findClusterPaths(Cluster& c)
+{
+	Map* map = MapAbstraction::GetMap();
+	Graph* g = abstractions[1];
+	
+	std::vector<node*> corridor; 
+	for (int l=0; l<c.GetNumNodes(); l++)
+	{
+		corridor.push_back(g->GetNode(c.getIthNodeNum(l)));
+	}
+	for (unsigned int j=0; j < c.parents.size(); j++)
+		corridor.push_back(c.parents[j]);
+	
+	c.entrancePaths.clear();
+	ClusterSearchEnvironment cse(this, 0);
+	cse.setCorridor(corridor);
+	for (int j=0; j<c.GetNumNodes(); j++)
+	{
+		for (int k=j+1; k<c.GetNumNodes();k++)
+		{
+			
+			// find bottom level nodes
+			node* absStart = g->GetNode(c.getIthNodeNum(j));
+			node* absGoal = g->GetNode(c.getIthNodeNum(k));
+			
+			// find start/end coordinates (same in abstract and bottom level)
+			double startx = absStart->GetLabelF(kXCoordinate);	
+			double starty = absStart->GetLabelF(kYCoordinate);
+			double startz = absStart->GetLabelF(kZCoordinate);
+			
+			double goalx = absGoal->GetLabelF(kXCoordinate);
+			double goaly = absGoal->GetLabelF(kYCoordinate);
+			double goalz = absGoal->GetLabelF(kZCoordinate);
+			
+			point3d s(startx,starty,startz);
+			point3d gl(goalx,goaly,goalz);
+			
+			int px;
+			int py;
+			
+			map->GetPointFromCoordinate(s,px,py);
+			
+			node* start = GetNodeFromMap(px,py);
+			
+			map->GetPointFromCoordinate(gl,px,py);
+			
+			node* goal = GetNodeFromMap(px,py);
+			
+			//find path
+			GenericAStar astar;
+			std::vector<uint32_t> resultPath;
+			astar.GetPath(&cse, start->GetNum(), goal->GetNum(),
+										resultPath);
+			path *p = 0;
+			for (unsigned int x = 0; x < resultPath.size(); x++)
+				p = new path(abstractions[0]->GetNode(resultPath[x]), p);
 
-				if (p!=0)
-				{
-					//get its length
-					double dist = distance(p); 
-					
-					//create edge
-					edge* newedge = new edge(startnum, goalnum, dist);
-					g->AddEdge(newedge);
-					
-					//store path
-					paths[newedge] = p;
-				}
+			if (p!=0)
+			{
+				clusterUtil::EntrancePath ep;
+				ep.from = c.getIthNodeNum(j);
+				ep.to = c.getIthNodeNum(k);
+				ep.length = distance(p);
+				ep.p = p;
+				c.entrancePaths.push_back(ep);
 			}
 		}
 	}
 }
 
+/**
+* Run task on each of the given clusters, spread over numThreads threads. Tasks
+ * may only change the cluster they are given.
+ */
+void ClusterAbstraction::runOnClusters(const std::vector<int>& which, void (ClusterAbstraction::*task)(Cluster&))
+{
+	if ((numThreads == 1) || (which.size() < 2))
+	{
+		for (unsigned int i=0; i<which.size(); i++)
+			(this->*task)(clusters[which[i]]);
+		return;
+	}
+	int count = std::min((int)which.size(), numThreads);
+	SharedQueue<std::pair<uint64_t, uint64_t> > workQueue(count*20);
+	std::vector<std::thread*> threads(count);
+	for (int x = 0; x < count; x++)
+		threads[x] = new std::thread(&ClusterAbstraction::clusterWorker, this, &workQueue, &which, task);
+	for (uint64_t x = 0; x < which.size(); x++)
+		workQueue.WaitAdd({x, x+1});
+	for (int x = 0; x < count; x++)
+		workQueue.WaitAdd({0, 0});
+	for (int x = 0; x < count; x++)
+	{
+		threads[x]->join();
+		delete threads[x];
+	}
+}
+
+void ClusterAbstraction::clusterWorker(SharedQueue<std::pair<uint64_t, uint64_t> > *work, const std::vector<int> *which,
+                                       void (ClusterAbstraction::*task)(Cluster&))
+{
+	std::pair<uint64_t, uint64_t> item;
+	while (true)
+	{
+		work->WaitRemove(item);
+		if (item.first == item.second)
+			break;
+		for (uint64_t x = item.first; x < item.second; x++)
+			(this->*task)(clusters[(*which)[x]]);
+	}
+}
+
 /**
 * given a cluster row and column (NOT map row/column), return the cluster's ID.
  */
@@ -705,239 +761,182 @@ int ClusterAbstraction::getClusterIdFromNode(node* n)
  * Connected components that cannot reach any entrance nodes will be assigned their own
  * parent node. 
  *
+ * While searching, all of a cluster's map nodes belong to a dummy parent, so
+ * that the corridor keeps the searches inside the cluster. The dummies are
+ * added first, the searches run in parallel, and the parents are then set in
+ * cluster order.
+ *
  * Connected component code borrowed from MapSectorAbstraction.cpp
  */
-void ClusterAbstraction::setUpParents(Graph* g)
+void ClusterAbstraction::setUpParents(Graph* g, const std::vector<int>& which)
 {
-	
-	
 	if (verbose)	std::cout<<"Setting up parents\n";
 	Map* map = MapAbstraction::GetMap();
 	
-	std::vector<node*> dummies; 
-	int numOrigNodes = g->GetNumNodes();
-	
-	// create ALL DUMMY PARENTS first
-	for (unsigned int i=0; i<clusters.size(); i++)
+	for (unsigned int i=0; i<which.size(); i++)
 	{
-		
-		Cluster& c = clusters[i];
-		
+		Cluster& c = clusters[which[i]];
 		node* dummyParent = new node("");
 		dummyParent->SetLabelL(kAbstractionLevel, 1);
 		dummyParent->SetLabelL(kNumAbstractedNodes, 0); // number of abstracted nodes
 		dummyParent->SetLabelL(kParent, -1); 
 		dummyParent->SetLabelF(kXCoordinate, kUnknownPosition);
 		dummyParent->SetLabelL(kNodeBlocked, 0);
-		
-		
 		g->AddNode(dummyParent);
-		dummies.push_back(dummyParent);
+		c.dummyParent = dummyParent;
 		
 		for (int x=c.getHOrig(); x<c.getHOrig()+c.getWidth(); x++)
 		{
-			
 			for (int y=c.getVOrig(); y<c.getVOrig()+c.GetHeight(); y++)
 			{
-				
 				if (map->GetNodeNum(x,y) >= 0)
-				{
-					node* n = GetNodeFromMap(x,y);
-					buildNodeIntoParent(n, dummyParent);
-				}
+					buildNodeIntoParent(GetNodeFromMap(x,y), dummyParent);
 			}
 		}
 	}
 	
-	int numNodesAfter = g->GetNumNodes();
+	runOnClusters(which, &ClusterAbstraction::findClosestEntrances);
 	
-	for (unsigned int i=0; i<clusters.size(); i++)
+	for (unsigned int i=0; i<which.size(); i++)
 	{
-		
-		Cluster& c = clusters[i];
-		//Create the corridor
-		std::vector<node*> corridor; 
-		corridor.push_back(dummies[i]);
-		
-		for (int l=0; l<c.GetNumNodes(); l++)
+		Cluster& c = clusters[which[i]];
+		// closest[] lists the dummy's children in order
+		for (unsigned int j=0; j<c.closest.size(); j++)
 		{
-			corridor.push_back(g->GetNode(c.getIthNodeNum(l)));
+			if (c.closest[j])
+				buildNodeIntoParent(abstractions[0]->GetNode(c.dummyParent->GetLabelL(kFirstData+j)), c.closest[j]);
 		}
-		
-//		corridorAStar astar;
-//		astar.setCorridor(&corridor);	
-		
-		// 		std::cout<<"corridor has: "<<std::endl;
-		// 		for (unsigned int bla = 0; bla<corridor.size(); bla++)
-		// 			std::cout<<corridor[bla]<<" ("<<corridor[bla]->GetLabelL(kNumAbstractedNodes)<<") ";
-		// 		std::cout<<std::endl;
-		
-		//Find parent for each node 
+		c.closest.clear();
+	}
+	
+	// nothing has been added since the dummies, so removing them from the
+	// last one down renumbers nothing
+	for (int i=which.size()-1; i>=0; i--)
+	{
+		node* dummyParent = clusters[which[i]].dummyParent;
+		assert(dummyParent->GetNum() == (unsigned int)g->GetNumNodes()-1);
+		for (int j=0; j<dummyParent->GetLabelL(kNumAbstractedNodes); j++)
+		{
+			node* child = abstractions[0]->GetNode(dummyParent->GetLabelL(kFirstData+j));
+			if (child->GetLabelL(kParent) == (long)dummyParent->GetNum())
+				child->SetLabelL(kParent, -1);
+		}
+		g->RemoveNode(dummyParent);
+		delete dummyParent;
+		clusters[which[i]].dummyParent = 0;
+	}
+	
+	//finish by giving not-yet-abstracted nodes a parent
+	for (unsigned int i=0; i<which.size(); i++)
+	{
+		Cluster& c = clusters[which[i]];
 		for (int x=c.getHOrig(); x<c.getHOrig()+c.getWidth(); x++)
 		{
 			for (int y=c.getVOrig(); y<c.getVOrig()+c.GetHeight(); y++)
 			{
-				if (map->GetNodeNum(x,y) >= 0)
+				node* next = GetNodeFromMap(x,y);
+				// if it isn't abstracted, do a bfs according to the cluster and abstract these nodes together
+				if (next && (next->GetLabelL(kParent) == -1))
 				{
-					node* mnode = GetNodeFromMap(x,y);
-					
-					// reset minimum 
-					double minDist = DBL_MAX;
-					node* entrance = 0;
-					
-					//for every abstract (entrance node) in this cluster
-					for (int k=0; k<c.GetNumNodes(); k++)
-					{
-						//get the entrance
-						int nodenum = c.getIthNodeNum(k);
-						
-						node* n = g->GetNode(nodenum);						
-						node* low = getLowLevelNode(n);	
-						
-						if (low==mnode)
-						{
-							entrance = n;
-							break;
-						}
-						
-						//See if there's a path within this cluster
-//						astar.setCorridor(&corridor);
-//						path* p = astar.GetPath(static_cast<MapAbstraction*>(this),low,mnode);
-						GenericAStar astar;
-						ClusterSearchEnvironment cse(this, GetAbstractionLevel(low));
-						cse.setCorridor(corridor);
-						std::vector<uint32_t> resultPath;
-						astar.GetPath(&cse, low->GetNum(), mnode->GetNum(),
-													resultPath);
-						path *p = 0;
-						for (unsigned int t = 0; t < resultPath.size(); t++)
-							p = new path(GetAbstractGraph(low)->GetNode(resultPath[t]), p);
-						
-						if (p!=0)
-						{
-							// 								std::cout<<"corridor has: "<<std::endl;
-							// 								for (unsigned int bla = 0; bla<corridor.size(); bla++)
-							// 									std::cout<<corridor[bla]<<" ("<<corridor[bla]->GetLabelL(kNumAbstractedNodes)<<") ";
-							// 								std::cout<<std::endl;
-							// 							}
-							
-							// find distance to this point 
-							point3d s(n->GetLabelF(kXCoordinate),n->GetLabelF(kYCoordinate),-1);
-							int px;
-							int py;
-							map->GetPointFromCoordinate(s,px,py);
-							
-							// calculate the distance to this entrance
-							
-							double dist = distance(p);
-							
-							if (dist<minDist)
-							{
-								
-								minDist=dist;  
-								entrance=n;
-								
-							}
-							delete p;
-					}
+					node *parent;
+					g->AddNode(parent = new node("??"));
+					parent->SetLabelL(kAbstractionLevel, next->GetLabelL(kAbstractionLevel)+1); // level in abstraction tree
+					parent->SetLabelL(kNumAbstractedNodes, 0); // number of abstracted nodes
+					parent->SetLabelL(kParent, -1); // parent of this node in abstraction hierarchy
+					parent->SetLabelF(kXCoordinate, kUnknownPosition);
+					parent->SetLabelL(kNodeBlocked, 0);
+					c.addParent(parent);
+					abstractionBFS(next, parent, c.getId());
 				}
-					
-					//std::cout<<entrance<<std::endl;
-					if (entrance)
-					{
-						
-						point3d s(entrance->GetLabelF(kXCoordinate),entrance->GetLabelF(kYCoordinate),-1);
-						int px;
-						int py;
-						map->GetPointFromCoordinate(s,px,py);
-						buildNodeIntoParent(mnode, entrance);
-					}
-					//					else
-					//std::cout<<" no parent\n";
-			}//end if (not out of bounds)
-		}    
+			}
+		}
 	}
 }
-// 	for (unsigned int i=0;i<dummies.size(); i++){
-// 		// make sure no node has a dummy for a parent
-// 		for (int j=0; j<dummies[i]->GetLabelL(kNumAbstractedNodes); j++){
-// 			node* child = abstractions[0]->GetNode(dummies[i]->GetLabelL(kFirstData+j));
-// 			if (dummies[i]->GetNum()==5289)
-// 				std::cout<<"going to check\n";
-// 			if (child->GetLabelL(kParent) == dummies[i]->GetNum()){
-// 				if (dummies[i]->GetNum()==5289)
-// 					std::cout<<"removing "<<child->GetNum()<<std::endl;
-// 				child->SetLabelL(kParent,-1);
-// 			}
-// 		}
-
-// 		g->RemoveNode(dummies[i]);
-// 		delete dummies[i];
-// 	}
 
-//finish by giving not-yet-abstracted nodes a parent
-
-node_iterator ni = abstractions[0]->getNodeIter();
-for (node *next = abstractions[0]->nodeIterNext(ni); next;
-		 next = abstractions[0]->nodeIterNext(ni))
+/**
+* Find the closest reachable entrance of each map node in one cluster, or 0 if
+ * none can be reached. Only reads the Graphs, so it can run in several
+ * clusters at once.
+ */
+void ClusterAbstraction::findClosestEntrances(Cluster& c)
 {
-	// if it isn't abstracted, do a bfs according to the cluster and abstract these nodes together
-	if ((next->GetLabelL(kParent) == -1) || ((next->GetLabelL(kParent) >= numOrigNodes) && next->GetLabelL(kParent) < numNodesAfter))
+	Graph* g = abstractions[1];
+	node* dummyParent = c.dummyParent;
+	
+	//Create the corridor
+	std::vector<node*> corridor; 
+	corridor.push_back(dummyParent);
+	for (int l=0; l<c.GetNumNodes(); l++)
 	{
-		node *parent;
-		g->AddNode(parent = new node("??"));
-		parent->SetLabelL(kAbstractionLevel, next->GetLabelL(kAbstractionLevel)+1); // level in abstraction tree
-		parent->SetLabelL(kNumAbstractedNodes, 0); // number of abstracted nodes
-		parent->SetLabelL(kParent, -1); // parent of this node in abstraction hierarchy
-		parent->SetLabelF(kXCoordinate, kUnknownPosition);
-		parent->SetLabelL(kNodeBlocked, 0);
-		abstractionBFS(next, parent, getClusterIdFromNode(next),numOrigNodes,numNodesAfter);
+		corridor.push_back(g->GetNode(c.getIthNodeNum(l)));
 	}
-}
-for (unsigned int i=dummies.size()-1;i>0; --i)
-{
+	ClusterSearchEnvironment cse(this, 0);
+	cse.setCorridor(corridor);
 	
-	
-	int num = dummies[i]->GetNum();
-	
-	
-	g->RemoveNode(dummies[i]);
-	node* n = g->GetNode(num); 
-	
-	if (n)
+	//Find parent for each node 
+	c.closest.resize(0);
+	for (int i=0; i<dummyParent->GetLabelL(kNumAbstractedNodes); i++)
 	{
+		node* mnode = abstractions[0]->GetNode(dummyParent->GetLabelL(kFirstData+i));
+		
+		// reset minimum 
+		double minDist = DBL_MAX;
+		node* entrance = 0;
 		
-		//update children
-		int numnodes = n->GetLabelL(kNumAbstractedNodes);
-		for (int j=0; j<numnodes; j++)
+		//for every abstract (entrance node) in this cluster
+		for (int k=0; k<c.GetNumNodes(); k++)
 		{
+			//get the entrance
+			int nodenum = c.getIthNodeNum(k);
+			
+			node* n = g->GetNode(nodenum);						
+			node* low = getLowLevelNode(n);	
 			
-			(abstractions[0]->GetNode(n->GetLabelL(kFirstData+j)))->SetLabelL(kParent, num);
+			if (low==mnode)
+			{
+				entrance = n;
+				break;
+			}
+			
+			//See if there's a path within this cluster
+			GenericAStar astar;
+			std::vector<uint32_t> resultPath;
+			astar.GetPath(&cse, low->GetNum(), mnode->GetNum(),
+										resultPath);
+			path *p = 0;
+			for (unsigned int t = 0; t < resultPath.size(); t++)
+				p = new path(abstractions[0]->GetNode(resultPath[t]), p);
+			if (p!=0)
+			{
+				// calculate the distance to this entrance
+				double dist = distance(p);
+				
+				if (dist<minDist)
+				{
+					minDist=dist;  
+					entrance=n;
+				}
+				delete p;
+			}
 		}
+		c.closest.push_back(entrance);
 	}
-	
-	delete dummies[i];
-}
 }
 
 /**
 * 'borrowed' from MapSectorAbstraction.cpp
  */
-void ClusterAbstraction::abstractionBFS(node *which, node *parent, int cluster, int numOrigNodes, int numNodesAfter)
+void ClusterAbstraction::abstractionBFS(node *which, node *parent, int cluster)
 {
-	if ((which == 0) || (getClusterIdFromNode(which) != cluster) ||
-			((which->GetLabelL(kParent) < numOrigNodes) && (which->GetLabelL(kParent>=0))) ||
-			((which->GetLabelL(kParent) >= numNodesAfter) && (which->GetLabelL(kParent)>=0)))
+	if ((which == 0) || (which->GetLabelL(kParent) != -1) || (getClusterIdFromNode(which) != cluster))
 		return;
 	
 	buildNodeIntoParent(which, parent);
 	
-	getCluster(cluster).addParent(parent);
-	
 	neighbor_iterator ni = which->getNeighborIter();
 	for (long tmp = which->nodeNeighborNext(ni); tmp != -1; tmp = which->nodeNeighborNext(ni))
 	{
-		abstractionBFS(abstractions[0]->GetNode(tmp), parent, cluster,numOrigNodes,numNodesAfter);
+		abstractionBFS(abstractions[0]->GetNode(tmp), parent, cluster);
 	}
 }
 
@@ -993,6 +992,133 @@ void ClusterAbstraction::connectedBFS(node *which, node *parent)
 	}
 }
 
+/**
+* Remove a cluster's nodes from the abstract Graph, along with their edges and
+ * cached paths. The cluster's map nodes are left without a parent.
+ */
+void ClusterAbstraction::removeClusterNodes(Cluster& c)
+{
+	Graph* g = abstractions[1];
+	std::vector<node*> owned;
+	for (int l=0; l<c.GetNumNodes(); l++)
+		owned.push_back(g->GetNode(c.getIthNodeNum(l)));
+	for (unsigned int l=0; l<c.parents.size(); l++)
+		owned.push_back(c.parents[l]);
+	c.clearNodes();
+	
+	for (unsigned int i=0; i<owned.size(); i++)
+	{
+		node* n = owned[i];
+		for (int j=0; j<n->GetLabelL(kNumAbstractedNodes); j++)
+		{
+			node* child = abstractions[0]->GetNode(n->GetLabelL(kFirstData+j));
+			if (child && (child->GetLabelL(kParent) == (long)n->GetNum()))
+				child->SetLabelL(kParent, -1);
+		}
+		
+		std::vector<edge*> edges;
+		edge_iterator ei = n->getEdgeIter();
+		for (edge* e = n->edgeIterNext(ei); e; e = n->edgeIterNext(ei))
+			edges.push_back(e);
+		for (unsigned int j=0; j<edges.size(); j++)
+		{
+			clusterUtil::PathLookupTable::iterator it = paths.find(edges[j]);
+			if (it != paths.end())
+			{
+				delete it->second;
+				paths.erase(it);
+			}
+			g->RemoveEdge(edges[j]);
+			delete edges[j];
+		}
+		
+		unsigned int oldID;
+		node* moved = g->RemoveNode(n, oldID);
+		if (moved)
+		{
+			RenameNodeInAbstraction(moved, oldID);
+			// entrance nodes are listed by number in their cluster
+			if (moved->GetLabelF(kXCoordinate) != kUnknownPosition)
+				getCluster(getClusterIdFromNode(moved)).renameNode(oldID, moved->GetNum());
+		}
+		delete n;
+	}
+}
+
+/**
+* Apply the tiles queued by TileChanged. Changing a tile can only change the
+ * map edges around it, so the clusters that overlap the 3x3 block around each
+ * tile are rebuilt: all of their abstract nodes are removed, the entrances on
+ * their borders are found again, and their parents and paths are recomputed.
+ * Clusters next to them keep their nodes; the entrances they share with a
+ * rebuilt cluster are found in the same places and reuse them.
+ */
+void ClusterAbstraction::RepairAbstraction()
+{
+	revision++;
+	if (changedTiles.size() == 0)
+		return;
+	Timer t;
+	t.StartTimer();
+	Map* map = MapAbstraction::GetMap();
+	Graph* g = abstractions[1];
+	
+	std::vector<bool> dirty(clusters.size(), false);
+	std::vector<node*> orphans;
+	for (unsigned int i=0; i<changedTiles.size(); i++)
+	{
+		long x = changedTiles[i].first, y = changedTiles[i].second;
+		if ((x < 0) || (y < 0) || (x >= map->GetMapWidth()) || (y >= map->GetMapHeight()))
+			continue;
+		RepairMapGraph(x, y, orphans);
+		for (long cx = std::max(x-1, 0l); cx <= std::min(x+1, map->GetMapWidth()-1); cx++)
+			for (long cy = std::max(y-1, 0l); cy <= std::min(y+1, map->GetMapHeight()-1); cy++)
+				dirty[getClusterIdFromCoord(cy, cx)] = true;
+	}
+	changedTiles.clear();
+	
+	for (unsigned int i=0; i<clusters.size(); i++)
+		if (dirty[i])
+			removeClusterNodes(clusters[i]);
+	
+	// entrances are found again on every border of a dirty cluster
+	unsigned int kept = 0;
+	for (unsigned int i=0; i<entrances.size(); i++)
+	{
+		if (!dirty[entrances[i].getCluster1Id()] && !dirty[entrances[i].getCluster2Id()])
+			entrances[kept++] = entrances[i];
+	}
+	entrances.erase(entrances.begin()+kept, entrances.end());
+	for (unsigned int i=0; i<clusters.size(); i++)
+	{
+		Cluster& c = clusters[i];
+		int row = i/columns, col = i%columns;
+		if ((row > 0) && (dirty[i] || dirty[i-columns]))
+			createHorizEntrances(c.getHOrig(), c.getHOrig()+c.getWidth()-1, c.getVOrig()-1, row-1, col);
+		if ((col > 0) && (dirty[i] || dirty[i-1]))
+			createVertEntrances(c.getVOrig(), c.getVOrig()+c.GetHeight()-1, c.getHOrig()-1, row, col-1);
+	}
+	linkEntrancesAndClusters(kept);
+	addAbsNodes(g, kept);
+	
+	std::vector<int> rebuilt;
+	for (unsigned int i=0; i<clusters.size(); i++)
+		if (dirty[i])
+			rebuilt.push_back(i);
+	setUpParents(g, rebuilt);
+	computeClusterPaths(g, rebuilt);
+	
+	// components can merge or split anywhere, so the (small) connectivity
+	// Graph is rebuilt
+	delete abstractions.back();
+	abstractions.pop_back();
+	node_iterator ni = g->getNodeIter();
+	for (node *next = g->nodeIterNext(ni); next; next = g->nodeIterNext(ni))
+		next->SetLabelL(kParent, -1);
+	createConnectivityGraph();
+	repairTime = t.EndTimer();
+}
+
 /**
 * Check if there is a path between two nodes
  */
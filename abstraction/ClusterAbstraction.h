@@ -28,11 +28,13 @@
 #define CLUSTERABSTRACTION_H
 
 #include <vector>
+#include <thread>
 #include <ext/hash_map>
 
 #include "MapAbstraction.h"
 #include "Graph.h" 
 #include "Path.h"
+#include "SharedQueue.h"
 
 typedef enum{HORIZONTAL,VERTICAL} Orientation;
 
@@ -41,33 +43,44 @@ const int MAX_ENTRANCE_WIDTH = 6;
 /*
  * Set up hash map to cache paths. These are used to easily find a map-level path 
  * from an abstract path. Paths are hashed by pointers to the abstract edges. 
+ * (Not by edge number, which changes when other edges are removed in repair.)
  */ 
 namespace clusterUtil {
 
 	struct EdgeEqual {
 		bool operator()(const edge* e1, const edge* e2) const
-		{return e1->getEdgeNum() == e2->getEdgeNum();}
+		{return e1 == e2;}
 	};
 
 	struct EdgeHash {
 		size_t operator()(const edge *e) const
-		{ return (size_t)(e->getEdgeNum()); }
+		{ return (size_t)e/sizeof(edge); }
 	};
       
   typedef __gnu_cxx::hash_map<edge*,path*,
 															clusterUtil::EdgeHash, 
 															clusterUtil::EdgeEqual > PathLookupTable;
+
+	// a path between two entrances of a cluster, before its edge is added
+	struct EntrancePath {
+		int from, to;
+		double length;
+		path *p;
+	};
 }
 
 class Cluster {
 public:
   Cluster(int id, int row, int col, int horizOrigin, int vertOrigin,int width, int height)
-    :m_id(id),m_row(row),m_column(col),
+    :dummyParent(0),m_id(id),m_row(row),m_column(col),
      m_horizOrigin(horizOrigin),m_vertOrigin(vertOrigin),
      m_width(width),m_height(height)
   {}
 
   void AddNode(int);
+  void renameNode(int oldNum, int newNum);
+  void clearNodes() { nodes.clear(); parents.clear(); }
+  int getId() const { return m_id; }
   int getIthNodeNum(int i) const { return nodes[i];}
   int GetNumNodes() const { return nodes.size(); }
   int getHOrig() const { return m_horizOrigin; }
@@ -78,6 +91,11 @@ public:
 	std::vector<node*>&  getParents() { return parents; } 
 	std::vector<node*> parents; // each connected component gets its own parent
 
+	// results of the searches run by the worker threads
+	node* dummyParent; // parent of all map nodes while searching
+	std::vector<node*> closest; // closest entrance of each map node, column by column
+	std::vector<clusterUtil::EntrancePath> entrancePaths;
+
 private:
   int m_id;
   int m_row; // abstract row of this cluster (e.g., 1 for the second clusters horizontally)
@@ -133,13 +151,25 @@ private:
 /** 
  * Cluster abstraction for HPA* algorithm as described in (Botea,Mueller,Schaeffer 2004). 
  * Source code based on HPA* code found at http://www.cs.ualberta.ca/~adib/Home/Download/hpa.tgz
+ *
+ * RepairAbstraction applies the tiles queued with TileChanged. Only the
+ * clusters next to a changed tile are rebuilt: their entrances, the parents
+ * of their map nodes and their intra-cluster paths. The connectivity level
+ * is small and is rebuilt in full. Don't repair while start/goal nodes are
+ * inserted.
+ *
+ * The searches that assign parents to map nodes and find the paths between
+ * entrances only read the map Graph, so clusters are handed out to
+ * numThreads threads. Each thread stores its results with the cluster, and
+ * they are added to the abstract Graph afterwards in cluster order, so the
+ * abstraction is the same for any number of threads.
  */
 class ClusterAbstraction : public MapAbstraction {
 public:
-  ClusterAbstraction(Map *map, int _clusterSize);
+  ClusterAbstraction(Map *map, int _clusterSize, int numThreads = std::thread::hardware_concurrency());
   ~ClusterAbstraction();
 	MapAbstraction* Clone(Map* map)
-	{ return new ClusterAbstraction(map, clusterSize); }
+	{ return new ClusterAbstraction(map, clusterSize, numThreads); }
 
 	int getClusterSize() { return clusterSize; };  
   bool Pathable(node* start, node* goal);
@@ -149,7 +179,7 @@ public:
   void RemoveEdge(edge*, unsigned int) {}
   void AddNode(node*) {}
   void AddEdge(edge*, unsigned int) {}
-  void RepairAbstraction() {}
+  void RepairAbstraction();
 	node* insertNode(node* n, int& expanded, int& touched); 
 	path* getCachedPath(edge* e);
 	node* getLowLevelNode(node* abstract);
@@ -169,15 +199,18 @@ private:
   void addCluster(Cluster c);
   void createHorizEntrances(int, int, int, int, int);
   void createVertEntrances(int, int, int, int, int);
-  void linkEntrancesAndClusters();
-  void addAbsNodes(Graph* g);
-  void computeClusterPaths(Graph* g);
+  void linkEntrancesAndClusters(unsigned int first = 0);
+  void addAbsNodes(Graph* g, unsigned int first = 0);
+  void computeClusterPaths(Graph* g, const std::vector<int>& which);
+  void findClusterPaths(Cluster& c);
+  void removeClusterNodes(Cluster& c);
   void addEntrance(Entrance e);
   int getClusterId(int row, int col) const;
 
   Cluster& getCluster(int id);
 
   int clusterSize;
+  int numThreads;
   int rows; //rows of clusters
   int columns; //columns of clusters
 
@@ -187,10 +220,14 @@ private:
   clusterUtil::PathLookupTable temp;
 		std::vector<path*> newPaths;
   int nodeExists(const Cluster& c,double x,double y, Graph* g);
-  void setUpParents(Graph* g);
+  void setUpParents(Graph* g, const std::vector<int>& which);
+  void findClosestEntrances(Cluster& c);
+  void runOnClusters(const std::vector<int>& which, void (ClusterAbstraction::*task)(Cluster&));
+  void clusterWorker(SharedQueue<std::pair<uint64_t, uint64_t> > *work, const std::vector<int> *which,
+                     void (ClusterAbstraction::*task)(Cluster&));
 
 	void buildNodeIntoParent(node *n, node *parent);
-	void abstractionBFS(node *which, node *parent, int cluster,int numOrigNodes,int numNodesAfter);
+	void abstractionBFS(node *which, node *parent, int cluster);
 	void createConnectivityGraph();
 	void connectedBFS(node *which, node *parent);
 };
@@ -27,7 +27,9 @@
 
 
 #include "GraphAbstraction.h"
+#include "MMapUtil.h"
 #include <math.h>
+#include <string.h>
 #include <cassert>
 
 using namespace GraphAbstractionConstants;
@@ -42,6 +44,42 @@ enum {
 
 const static int verbose = kQuiet;//kRepairGraph;
 
+namespace {
+	// Saved hierarchies are a header followed by each level: a LevelHeader,
+	// then the label start of each node (plus one past the end), the node
+	// labels, the same two arrays for edges, and the two ends of each edge.
+	// Every array starts 8-byte aligned, so a mapped file can be read in
+	// place. Labels are the raw 8 bytes of their labelValue.
+	struct HierarchyHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t numLevels;
+		uint64_t hash;
+	};
+	
+	struct LevelHeader {
+		uint64_t numNodes, numEdges;
+		uint64_t numNodeLabels, numEdgeLabels;
+	};
+	
+	const char kMagic[8] = {'H', 'O', 'G', 'A', 'B', 'S', 'T', 'R'};
+	const uint32_t kVersion = 1;
+	
+	uint64_t LabelBits(labelValue v)
+	{
+		uint64_t bits = 0;
+		memcpy(&bits, &v, sizeof(v));
+		return bits;
+	}
+	
+	labelValue LabelFromBits(uint64_t bits)
+	{
+		labelValue v;
+		memcpy(&v, &bits, sizeof(v));
+		return v;
+	}
+}
+
 GraphAbstraction::~GraphAbstraction()
 { 
 
@@ -350,3 +388,164 @@ node* GraphAbstraction::GetRandomGroundNodeFromNode(node *n)
 		n = GetNthChild(n, random()%GetNumChildren(n));
 	return n;
 }
+
+bool GraphAbstraction::SaveHierarchy(const char *filename, uint64_t hash) const
+{
+	FILE *f = fopen(filename, "w");
+	if (f == 0)
+	{
+		printf("Error: unable to open '%s' for writing\n", filename);
+		return false;
+	}
+	HierarchyHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kMagic, 8);
+	header.version = kVersion;
+	header.numLevels = (uint32_t)abstractions.size();
+	header.hash = hash;
+	bool ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+	
+	std::vector<uint64_t> nodeStart, nodeLabels, edgeStart, edgeLabels;
+	std::vector<uint32_t> ends;
+	for (unsigned int l = 0; ok && l < abstractions.size(); l++)
+	{
+		Graph *g = abstractions[l];
+		nodeStart.resize(0);
+		nodeLabels.resize(0);
+		edgeStart.resize(0);
+		edgeLabels.resize(0);
+		ends.resize(0);
+		for (int x = 0; x < g->GetNumNodes(); x++)
+		{
+			node *n = g->GetNode(x);
+			nodeStart.push_back(nodeLabels.size());
+			for (unsigned int y = 0; y < n->GetNumLabels(); y++)
+			{
+				labelValue v;
+				v.lval = n->GetLabelL(y);
+				nodeLabels.push_back(LabelBits(v));
+			}
+		}
+		nodeStart.push_back(nodeLabels.size());
+		for (int x = 0; x < g->GetNumEdges(); x++)
+		{
+			edge *e = g->GetEdge(x);
+			edgeStart.push_back(edgeLabels.size());
+			for (unsigned int y = 0; y < e->GetNumLabels(); y++)
+			{
+				labelValue v;
+				v.lval = e->GetLabelL(y);
+				edgeLabels.push_back(LabelBits(v));
+			}
+			ends.push_back(e->getFrom());
+			ends.push_back(e->getTo());
+		}
+		edgeStart.push_back(edgeLabels.size());
+		
+		LevelHeader level;
+		level.numNodes = nodeStart.size()-1;
+		level.numEdges = edgeStart.size()-1;
+		level.numNodeLabels = nodeLabels.size();
+		level.numEdgeLabels = edgeLabels.size();
+		ok = (fwrite(&level, sizeof(level), 1, f) == 1) &&
+		(fwrite(&nodeStart[0], sizeof(uint64_t), nodeStart.size(), f) == nodeStart.size()) &&
+		(nodeLabels.size() == 0 || fwrite(&nodeLabels[0], sizeof(uint64_t), nodeLabels.size(), f) == nodeLabels.size()) &&
+		(fwrite(&edgeStart[0], sizeof(uint64_t), edgeStart.size(), f) == edgeStart.size()) &&
+		(edgeLabels.size() == 0 || fwrite(&edgeLabels[0], sizeof(uint64_t), edgeLabels.size(), f) == edgeLabels.size()) &&
+		(ends.size() == 0 || fwrite(&ends[0], sizeof(uint32_t), ends.size(), f) == ends.size());
+	}
+	fclose(f);
+	if (!ok)
+		printf("Error writing abstraction to '%s'\n", filename);
+	return ok;
+}
+
+bool GraphAbstraction::LoadHierarchy(const char *filename, uint64_t hash)
+{
+	FILE *f = fopen(filename, "r");
+	if (f == 0)
+		return false;
+	fclose(f);
+	
+	uint64_t memSize;
+	int fd;
+	uint8_t *mem = GetReadOnlyMMAP(filename, memSize, fd);
+	if (mem == 0)
+		return false;
+	HierarchyHeader header;
+	bool ok = memSize >= sizeof(header);
+	if (ok)
+	{
+		memcpy(&header, mem, sizeof(header));
+		ok = (memcmp(header.magic, kMagic, 8) == 0) && (header.version == kVersion) && (header.hash == hash);
+	}
+	std::vector<Graph *> levels;
+	uint64_t offset = sizeof(header);
+	for (uint32_t l = 0; ok && l < header.numLevels; l++)
+	{
+		LevelHeader level;
+		ok = (offset+sizeof(level) <= memSize);
+		if (!ok)
+			break;
+		memcpy(&level, mem+offset, sizeof(level));
+		offset += sizeof(level);
+		const uint64_t *nodeStart = (const uint64_t *)(mem+offset);
+		const uint64_t *nodeLabels = nodeStart+level.numNodes+1;
+		const uint64_t *edgeStart = nodeLabels+level.numNodeLabels;
+		const uint64_t *edgeLabels = edgeStart+level.numEdges+1;
+		const uint32_t *ends = (const uint32_t *)(edgeLabels+level.numEdgeLabels);
+		// guard against sizes that overflow before multiplying them out
+		ok = (level.numNodes < memSize) && (level.numEdges < memSize) &&
+		(level.numNodeLabels < memSize) && (level.numEdgeLabels < memSize);
+		if (ok)
+		{
+			offset += sizeof(uint64_t)*(level.numNodes+1+level.numNodeLabels+level.numEdges+1+level.numEdgeLabels);
+			offset += sizeof(uint32_t)*2*level.numEdges;
+			ok = (offset <= memSize) && (nodeStart[level.numNodes] == level.numNodeLabels) &&
+			(edgeStart[level.numEdges] == level.numEdgeLabels);
+		}
+		if (!ok)
+			break;
+		
+		Graph *g = new Graph();
+		levels.push_back(g);
+		for (uint64_t x = 0; ok && x < level.numNodes; x++)
+		{
+			ok = (nodeStart[x] <= nodeStart[x+1]) && (nodeStart[x+1] <= level.numNodeLabels);
+			if (!ok)
+				break;
+			node *n = new node("");
+			g->AddNode(n);
+			for (uint64_t y = nodeStart[x]; y < nodeStart[x+1]; y++)
+				n->SetLabelL(y-nodeStart[x], LabelFromBits(nodeLabels[y]).lval);
+		}
+		for (uint64_t x = 0; ok && x < level.numEdges; x++)
+		{
+			ok = (edgeStart[x] < edgeStart[x+1]) && (edgeStart[x+1] <= level.numEdgeLabels) &&
+			(ends[2*x] < level.numNodes) && (ends[2*x+1] < level.numNodes);
+			if (!ok)
+				break;
+			edge *e = new edge(ends[2*x], ends[2*x+1], LabelFromBits(edgeLabels[edgeStart[x]]).fval);
+			for (uint64_t y = edgeStart[x]+1; y < edgeStart[x+1]; y++)
+				e->SetLabelL(y-edgeStart[x], LabelFromBits(edgeLabels[y]).lval);
+			g->AddEdge(e);
+		}
+	}
+	ok = ok && (offset == memSize);
+	CloseMMap(mem, memSize, fd);
+	if (!ok)
+	{
+		printf("Error: '%s' is not an abstraction saved for this domain\n", filename);
+		for (unsigned int x = 0; x < levels.size(); x++)
+			delete levels[x];
+		return false;
+	}
+	while (abstractions.size() > 0)
+	{
+		delete abstractions.back();
+		abstractions.pop_back();
+	}
+	abstractions.swap(levels);
+	revision++;
+	return true;
+}
@@ -30,6 +30,7 @@
 #include "GLUtil.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 
 #ifndef GRAPHABSTRACTION_H
 #define GRAPHABSTRACTION_H
@@ -78,7 +79,7 @@ namespace GraphAbstractionConstants {
 
 class GraphAbstraction {
 public:
-	GraphAbstraction() :abstractions() {}
+	GraphAbstraction() :abstractions(), revision(0) {}
 	virtual ~GraphAbstraction();
 	
 	// basic Graph functions
@@ -112,8 +113,9 @@ public:
 	virtual void VerifyHierarchy() = 0;
 	/// rebuild hierarchy from original domain */
 	// virtual void rebuild() = 0;
-	/// get current revision of hierarchy -- indicates if changes have been made */
-	//virtual int GetRevision() = 0;
+	/** get current revision of hierarchy -- indicates if changes have been made.
+		Advanced by RepairAbstraction, AddNode, RemoveNode and LoadHierarchy. */
+	uint64_t GetRevision() const { return revision; }
 	void ClearMarkedNodes();
 	
 	// hierarchical modifications
@@ -134,8 +136,15 @@ public:
 	
 	virtual void OpenGLDraw() const {}
 	virtual recVec GetNodeLoc(node *) const { recVec v; v.x = v.y = v.z = 0; return v; }
+
+	/** Write every level with all node and edge labels; hash identifies the domain it was built from */
+	bool SaveHierarchy(const char *filename, uint64_t hash) const;
 protected:
+	/** Replace the levels with ones saved by SaveHierarchy; false if the file is missing, from another version or hash */
+	bool LoadHierarchy(const char *filename, uint64_t hash);
+
 	std::vector<Graph *> abstractions;
+	uint64_t revision;
 private:
 	int ComputeWidth(node *n);
 	int WidthBFS(node *child, node *parent);
@@ -1185,6 +1185,7 @@ void LoadedCliqueAbstraction::removeNodeFromRepairQ(node *n)
 void LoadedCliqueAbstraction::RemoveNode(node *n)
 {
 	if (n == 0) return;
+	revision++;
 	if (verbose&kRepairGraph)
 		cout << "REM: Removing " << *n << endl;
 	removeNodeFromRepairQ(n);
@@ -1250,6 +1251,7 @@ void LoadedCliqueAbstraction::RemoveNode(node *n)
 
 void LoadedCliqueAbstraction::RepairAbstraction()
 {
+	revision++;
 	// actually want to sort items...based on abstraction level, doing
 	// lowest abstraction level first
 	while (modifiedNodeQ.size() > 0)
@@ -0,0 +1,120 @@
+/*
+ *  LoadedMapAbstraction.cpp
+ *  hog2
+ *
+ *  A map abstraction read back from a file written by MapAbstraction::Save.
+ *
+ */
+
+#include "LoadedMapAbstraction.h"
+#include "Timer.h"
+
+using namespace GraphAbstractionConstants;
+
+bool LoadedMapAbstraction::Load(const char *filename)
+{
+	Timer t;
+	t.StartTimer();
+	if (!MapAbstraction::Load(filename))
+		return false;
+	fileName = filename;
+	BuildConnectivityGroups();
+	buildTime = t.EndTimer();
+	return true;
+}
+
+MapAbstraction *LoadedMapAbstraction::Clone(Map *_m)
+{
+	LoadedMapAbstraction *a = new LoadedMapAbstraction(_m);
+	a->Load(fileName.c_str());
+	return a;
+}
+
+/**
+* Label the connected components of every level. Any level can be the
+ * last one on a parent chain, and the top level may still have edges
+ * (as in MapFlatAbstraction), so a node without a parent isn't
+ * necessarily cut off from the others.
+ */
+void LoadedMapAbstraction::BuildConnectivityGroups()
+{
+	groups.resize(abstractions.size());
+	for (unsigned int l = 0; l < abstractions.size(); l++)
+	{
+		Graph *g = abstractions[l];
+		groups[l].assign(g->GetNumNodes(), -1);
+		int nextNum = 0;
+		node_iterator ni = g->getNodeIter();
+		for (node *iter = g->nodeIterNext(ni); iter; iter = g->nodeIterNext(ni))
+		{
+			if (groups[l][iter->GetNum()] != -1)
+				continue;
+			std::vector<unsigned int> stack;
+			stack.push_back(iter->GetNum());
+			groups[l][iter->GetNum()] = nextNum;
+			while (stack.size() > 0)
+			{
+				unsigned int next = stack.back();
+				stack.pop_back();
+				neighbor_iterator n = g->GetNode(next)->getNeighborIter();
+				for (int val = g->GetNode(next)->nodeNeighborNext(n); val != -1; val = g->GetNode(next)->nodeNeighborNext(n))
+				{
+					if (groups[l][val] == -1)
+					{
+						groups[l][val] = nextNum;
+						stack.push_back(val);
+					}
+				}
+			}
+			nextNum++;
+		}
+	}
+}
+
+/**
+* Follow both parent chains up together; once either runs out, the two
+ * nodes are connected if they are in the same component of that level.
+ */
+bool LoadedMapAbstraction::Pathable(node *from, node *to)
+{
+	if ((!from) || (!to) || (from->GetLabelL(kAbstractionLevel) != to->GetLabelL(kAbstractionLevel)))
+		return false;
+	while (from != to)
+	{
+		long level = from->GetLabelL(kAbstractionLevel);
+		node *fromParent = 0, *toParent = 0;
+		if (level+1 < (long)abstractions.size())
+		{
+			fromParent = abstractions[level+1]->GetNode(from->GetLabelL(kParent));
+			toParent = abstractions[level+1]->GetNode(to->GetLabelL(kParent));
+		}
+		if ((!fromParent) || (!toParent))
+			return (groups[level][from->GetNum()] == groups[level][to->GetNum()]);
+		from = fromParent;
+		to = toParent;
+	}
+	return true;
+}
+
+/**
+* Check that every node is listed as a child of its parent.
+ */
+void LoadedMapAbstraction::VerifyHierarchy()
+{
+	for (unsigned int l = 0; l+1 < abstractions.size(); l++)
+	{
+		node_iterator ni = abstractions[l]->getNodeIter();
+		for (node *n = abstractions[l]->nodeIterNext(ni); n; n = abstractions[l]->nodeIterNext(ni))
+		{
+			node *parent = abstractions[l+1]->GetNode(n->GetLabelL(kParent));
+			if (parent == 0)
+				continue;
+			bool found = false;
+			for (int x = 0; x < parent->GetLabelL(kNumAbstractedNodes); x++)
+				if (parent->GetLabelL(kFirstData+x) == (long)n->GetNum())
+					found = true;
+			if (!found)
+				printf("Error: node %d at level %d is not a child of its parent %d\n", n->GetNum(), l, parent->GetNum());
+		}
+	}
+}
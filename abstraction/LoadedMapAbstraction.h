@@ -0,0 +1,47 @@
+/*
+ *  LoadedMapAbstraction.h
+ *  hog2
+ *
+ *  A map abstraction read back from a file written by MapAbstraction::Save.
+ *
+ *  Any MapAbstraction (clique, cluster, sector, flat) can be saved once and
+ *  loaded in its place: all levels, labels, parent/child links and the map
+ *  tile to node numbering are restored, so searches that only use the
+ *  GraphAbstraction interface see the same hierarchy. State kept outside
+ *  the Graphs, such as the cached paths of ClusterAbstraction, is not
+ *  saved. The file records the map's hash and is rejected for any other
+ *  map. The hierarchy is read-only; changes to it are ignored.
+ *
+ */
+
+#include "MapAbstraction.h"
+#include <string>
+#include <vector>
+
+#ifndef LOADEDMAPABSTRACTION_H
+#define LOADEDMAPABSTRACTION_H
+
+class LoadedMapAbstraction : public MapAbstraction {
+public:
+	LoadedMapAbstraction(Map *_m) :MapAbstraction(_m) {}
+	/** Returns false, leaving the abstraction unchanged, if the file is missing or not saved for this map */
+	bool Load(const char *filename);
+	/** Loads the same file for the new map */
+	virtual MapAbstraction *Clone(Map *_m);
+
+	virtual bool Pathable(node *from, node *to);
+	virtual void VerifyHierarchy();
+	virtual void RemoveNode(node *) {}
+	virtual void RemoveEdge(edge *, unsigned int) {}
+	virtual void AddNode(node *) {}
+	virtual void AddEdge(edge *, unsigned int) {}
+	virtual void RepairAbstraction() { changedTiles.clear(); }
+private:
+	void BuildConnectivityGroups();
+
+	std::string fileName;
+	/** groups[level][node] is the connected component of the node in that level */
+	std::vector<std::vector<int> > groups;
+};
+
+#endif
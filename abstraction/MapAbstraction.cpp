@@ -31,6 +31,7 @@ using namespace GraphAbstractionConstants;
 
 MapAbstraction::~MapAbstraction()
 { 
+	m->RemoveChangeListener(this);
 	delete m;
 }
 
@@ -314,6 +315,179 @@ double MapAbstraction::OctileDistance(double x1, double y1, double x2, double y2
 	return answer;
 }
 
+void MapAbstraction::SetRepairOnMapChange(bool repair)
+{
+	if (repair)
+		m->AddChangeListener(this);
+	else
+		m->RemoveChangeListener(this);
+}
+
+/**
+ * Brings the map graph up to date after the terrain of (x, y) changed.
+ *
+ * Only edges between tiles of the 3x3 block around (x, y) can depend on the
+ * tile, so those are removed and added again with AddMapEdges. The tile
+ * gains a node if it is no longer out of bounds and loses it otherwise;
+ * parents that lose a child this way are added to orphans. Node numbers
+ * that change are updated in the map and in the abstraction above. Split
+ * tiles are not supported.
+ */
+void MapAbstraction::RepairMapGraph(long x, long y, std::vector<node *> &orphans)
+{
+	Graph *g = abstractions[0];
+	long minx = std::max(x-1, 0l), maxx = std::min(x+1, m->GetMapWidth()-1);
+	long miny = std::max(y-1, 0l), maxy = std::min(y+1, m->GetMapHeight()-1);
+	assert(m->GetSplit(x, y) == kNoSplit);
+
+	std::vector<edge *> stale;
+	for (long tx = minx; tx <= maxx; tx++)
+	{
+		for (long ty = miny; ty <= maxy; ty++)
+		{
+			node *n = GetNodeFromMap(tx, ty);
+			if (n == 0)
+				continue;
+			edge_iterator ei = n->getEdgeIter();
+			for (edge *e = n->edgeIterNext(ei); e; e = n->edgeIterNext(ei))
+			{
+				if (e->getFrom() != n->GetNum())
+					continue;
+				node *to = g->GetNode(e->getTo());
+				if ((abs(to->GetLabelL(kFirstData)-x) <= 1) && (abs(to->GetLabelL(kFirstData+1)-y) <= 1))
+					stale.push_back(e);
+			}
+		}
+	}
+	for (unsigned int t = 0; t < stale.size(); t++)
+	{
+		g->RemoveEdge(stale[t]);
+		delete stale[t];
+	}
+
+	node *n = GetNodeFromMap(x, y);
+	bool open = (m->GetTerrainType(x, y) != kOutOfBounds);
+	if (n && !open)
+	{
+		if ((abstractions.size() > 1) && (n->GetLabelL(kParent) != -1))
+		{
+			node *parent = abstractions[1]->GetNode(n->GetLabelL(kParent));
+			int last = parent->GetLabelL(kNumAbstractedNodes)-1;
+			for (int t = 0; t <= last; t++)
+			{
+				if (parent->GetLabelL(kFirstData+t) == (long)n->GetNum())
+				{
+					parent->SetLabelL(kFirstData+t, parent->GetLabelL(kFirstData+last));
+					parent->SetLabelL(kNumAbstractedNodes, last);
+					break;
+				}
+			}
+			orphans.push_back(parent);
+		}
+		unsigned int oldID;
+		node *moved = g->RemoveNode(n, oldID);
+		if (moved)
+		{
+			m->SetNodeNum(moved->GetNum(), moved->GetLabelL(kFirstData), moved->GetLabelL(kFirstData+1));
+			RenameNodeInAbstraction(moved, oldID);
+		}
+		m->SetNodeNum(kNoGraphNode, x, y);
+		delete n;
+	}
+	else if (!n && open)
+	{
+		char name[32];
+		sprintf(name, "(%ld, %ld)", x, y);
+		m->SetNodeNum(g->AddNode(n = new node(name)), x, y);
+		n->SetLabelL(kAbstractionLevel, 0); // level in abstraction tree
+		n->SetLabelL(kNumAbstractedNodes, 1); // number of abstracted nodes
+		n->SetLabelL(kParent, -1); // parent of this node in abstraction hierarchy
+		n->SetLabelF(kXCoordinate, kUnknownPosition);
+		n->SetLabelL(kNodeBlocked, 0);
+		n->SetLabelL(kFirstData, x);
+		n->SetLabelL(kFirstData+1, y);
+		n->SetLabelL(kFirstData+2, kNone);
+	}
+
+	// AddMapEdges also adds edges leaving the block, which are still in the graph
+	int first = g->GetNumEdges();
+	for (long tx = minx; tx <= maxx; tx++)
+		for (long ty = miny; ty <= maxy; ty++)
+			AddMapEdges(m, g, tx, ty);
+	for (int t = g->GetNumEdges()-1; t >= first; t--)
+	{
+		edge *e = g->GetEdge(t);
+		node *from = g->GetNode(e->getFrom());
+		node *to = g->GetNode(e->getTo());
+		if ((abs(from->GetLabelL(kFirstData)-x) > 1) || (abs(from->GetLabelL(kFirstData+1)-y) > 1) ||
+				(abs(to->GetLabelL(kFirstData)-x) > 1) || (abs(to->GetLabelL(kFirstData+1)-y) > 1))
+		{
+			g->RemoveEdge(e);
+			delete e;
+		}
+	}
+}
+
+/**
+ * Fixes the references to a node whose number changed from oldID when
+ * another node was removed from its graph.
+ */
+void MapAbstraction::RenameNodeInAbstraction(node *which, unsigned int oldID)
+{
+	unsigned int absLevel = which->GetLabelL(kAbstractionLevel);
+	if (absLevel > 0)
+	{
+		for (int x = 0; x < which->GetLabelL(kNumAbstractedNodes); x++)
+			abstractions[absLevel-1]->GetNode(which->GetLabelL(kFirstData+x))->SetLabelL(kParent, which->GetNum());
+	}
+	if ((absLevel+1 < abstractions.size()) && (which->GetLabelL(kParent) != -1))
+	{
+		node *parent = abstractions[absLevel+1]->GetNode(which->GetLabelL(kParent));
+		for (int x = 0; x < parent->GetLabelL(kNumAbstractedNodes); x++)
+		{
+			if (parent->GetLabelL(kFirstData+x) == (long)oldID)
+			{
+				parent->SetLabelL(kFirstData+x, which->GetNum());
+				break;
+			}
+		}
+	}
+}
+
+/** Writes every level with the map's hash, so the file can't be loaded for another map */
+bool MapAbstraction::Save(const char *filename) const
+{
+	return SaveHierarchy(filename, m->GetMapHash());
+}
+
+/** Reads the levels back and renumbers the map tiles to their level 0 nodes */
+bool MapAbstraction::Load(const char *filename)
+{
+	if (!LoadHierarchy(filename, m->GetMapHash()))
+		return false;
+	for (int y = 0; y < m->GetMapHeight(); y++)
+	{
+		for (int x = 0; x < m->GetMapWidth(); x++)
+		{
+			m->GetTile(x, y).tile1.node = kNoGraphNode;
+			m->GetTile(x, y).tile2.node = kNoGraphNode;
+		}
+	}
+	if (abstractions.size() == 0)
+		return true;
+	node_iterator ni = abstractions[0]->getNodeIter();
+	for (node *n = abstractions[0]->nodeIterNext(ni); n; n = abstractions[0]->nodeIterNext(ni))
+	{
+		Tile &t = m->GetTile(n->GetLabelL(kFirstData), n->GetLabelL(kFirstData+1));
+		tCorner c = (tCorner)n->GetLabelL(kFirstData+2);
+		if ((c == kTopRight) || (c == kBottomRight))
+			t.tile2.node = n->GetNum();
+		else
+			t.tile1.node = n->GetNum();
+	}
+	return true;
+}
+
 
 
 
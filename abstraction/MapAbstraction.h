@@ -30,6 +30,7 @@
 #include "GLUtil.h"
 #include "MapProvider.h"
 #include <stdlib.h>
+#include <vector>
 
 #ifndef MAPABSTRACTION_H
 #define MAPABSTRACTION_H
@@ -37,11 +38,16 @@
 /**
 * This class is designed as an interface to be added onto any type of GraphAbstraction
  * to support a few extra functionalities that mapabstractions should have.
+ *
+ * Abstractions that support incremental repair (ClusterAbstraction and
+ * MapSectorAbstraction) take changed tiles through TileChanged, either
+ * directly or from the map itself after SetRepairOnMapChange(true), and
+ * bring the hierarchy up to date in the next RepairAbstraction call.
  */
 
-class MapAbstraction : public GraphAbstraction, public MapProvider {
+class MapAbstraction : public GraphAbstraction, public MapProvider, public MapChangeListener {
 public:
-	MapAbstraction(Map *_m) :m(_m), levelDraw(0) {}
+	MapAbstraction(Map *_m) :buildTime(0), repairTime(0), m(_m), levelDraw(0) {}
 	virtual ~MapAbstraction();
 	/** return a new abstraction map of the same type as this map abstraction */
 	virtual MapAbstraction *Clone(Map *) = 0;
@@ -64,6 +70,26 @@ public:
 	void ToggleDrawAbstraction(int which);
 	void ClearMarkedNodes();
 	recVec GetNodeLoc(node *n) const;
+
+	/** Register with the map so that terrain changes are queued for RepairAbstraction */
+	void SetRepairOnMapChange(bool repair);
+	/** Queue a tile whose terrain changed; applied by the next RepairAbstraction call */
+	virtual void TileChanged(Map *, long x, long y) { changedTiles.push_back(std::pair<long, long>(x, y)); }
+	/** Seconds taken to build the abstraction, if the abstraction records it */
+	double GetBuildTime() const { return buildTime; }
+	/** Seconds taken by the last RepairAbstraction call, if the abstraction records it */
+	double GetRepairTime() const { return repairTime; }
+
+	/** Save the hierarchy for LoadedMapAbstraction; tied to the current map contents */
+	bool Save(const char *filename) const;
+protected:
+	/** Load a saved hierarchy and point the map tiles at its level 0 nodes */
+	bool Load(const char *filename);
+	void RepairMapGraph(long x, long y, std::vector<node *> &orphans);
+	void RenameNodeInAbstraction(node *which, unsigned int oldID);
+
+	std::vector<std::pair<long, long> > changedTiles;
+	double buildTime, repairTime;
 private:
 		
 	void DrawLevelConnections(node *n) const;
@@ -1053,6 +1053,7 @@ void MapCliqueAbstraction::removeNodeFromRepairQ(node *n)
 void MapCliqueAbstraction::RemoveNode(node *n)
 {
 	if (n == 0) return;
+	revision++;
 	if (verbose&kRepairGraph)
 		cout << "REM: Removing " << *n << endl;
 	removeNodeFromRepairQ(n);
@@ -1124,6 +1125,7 @@ void MapCliqueAbstraction::RemoveNode(node *n)
 
 void MapCliqueAbstraction::RepairAbstraction()
 {
+	revision++;
 	// actually want to sort items...based on abstraction level, doing
 	// lowest abstraction level first
 	while (modifiedNodeQ.size() > 0)
@@ -90,6 +90,7 @@ void MapFlatAbstraction::VerifyHierarchy()
 
 void MapFlatAbstraction::RemoveNode(node *n)
 {
+	revision++;
 	unsigned int oldID;
 	abstractions[0]->RemoveNode(n, oldID);
 }
@@ -101,6 +102,7 @@ void MapFlatAbstraction::RemoveEdge(edge *e, unsigned int)
 
 void MapFlatAbstraction::AddNode(node *n)
 {
+	revision++;
 //	n->SetLabelL(kAbstractionLevel, 0); // level in abstraction tree
 //	n->SetLabelL(kNumAbstractedNodes, 1); // number of abstracted nodes
 //	n->SetLabelL(kParent, -1); // parent of this node in abstraction hierarchy
@@ -119,5 +121,6 @@ void MapFlatAbstraction::AddEdge(edge *e, unsigned int)
 
 void MapFlatAbstraction::RepairAbstraction()
 {
+	revision++;
 	groupsValid = false;
 }
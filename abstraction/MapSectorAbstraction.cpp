@@ -27,6 +27,8 @@
 
 #include "MapSectorAbstraction.h"
 #include "Graph.h"
+#include "Timer.h"
+#include <algorithm>
 
 using namespace GraphAbstractionConstants;
 
@@ -37,14 +39,20 @@ MapSectorAbstraction::MapSectorAbstraction(Map *_m, int _sectorSize, int _sector
 {
 	assert(_sectorSize>1);
 	assert(_sectorMultiplier>1);
+	Timer t;
+	t.StartTimer();
 	buildAbstraction();
+	buildTime = t.EndTimer();
 }
 
 MapSectorAbstraction::MapSectorAbstraction(Map *_m, int _sectorSize)
 :MapAbstraction(_m), sectorSize(_sectorSize), sectorMultiplier(_sectorSize)
 {
 	assert(_sectorSize>1);
+	Timer t;
+	t.StartTimer();
 	buildAbstraction();
+	buildTime = t.EndTimer();
 }
 
 MapSectorAbstraction::~MapSectorAbstraction()
@@ -106,6 +114,196 @@ void MapSectorAbstraction::AddEdge(edge *, unsigned int)
 operations can be stacked followed by a single RepairAbstraction call. */
 void MapSectorAbstraction::RepairAbstraction()
 {
+	revision++;
+	if (changedTiles.size() == 0)
+		return;
+	Timer t;
+	t.StartTimer();
+	Map *map = GetMap();
+	std::vector<node *> changed, orphans;
+	for (unsigned int x = 0; x < changedTiles.size(); x++)
+	{
+		if ((changedTiles[x].first < 0) || (changedTiles[x].first >= map->GetMapWidth()) ||
+				(changedTiles[x].second < 0) || (changedTiles[x].second >= map->GetMapHeight()))
+			continue;
+		RepairMapGraph(changedTiles[x].first, changedTiles[x].second, orphans);
+	}
+	// later tiles can remove nodes, so the nodes whose edges changed are
+	// collected once the map graph is done
+	for (unsigned int x = 0; x < changedTiles.size(); x++)
+	{
+		for (long cx = changedTiles[x].first-1; cx <= changedTiles[x].first+1; cx++)
+		{
+			for (long cy = changedTiles[x].second-1; cy <= changedTiles[x].second+1; cy++)
+			{
+				node *n = GetNodeFromMap(cx, cy);
+				if (n)
+					changed.push_back(n);
+			}
+		}
+	}
+	changedTiles.clear();
+
+	for (unsigned int level = 0; level+1 < abstractions.size(); level++)
+		repairLevel(level, changed, orphans);
+
+	// as in buildAbstraction, the hierarchy ends at the first level without edges
+	for (unsigned int level = 0; level+1 < abstractions.size(); level++)
+	{
+		if (abstractions[level]->GetNumEdges() == 0)
+		{
+			while (abstractions.size() > level+1)
+			{
+				delete abstractions.back();
+				abstractions.pop_back();
+			}
+			node_iterator ni = abstractions[level]->getNodeIter();
+			for (node *next = abstractions[level]->nodeIterNext(ni); next;
+					 next = abstractions[level]->nodeIterNext(ni))
+				next->SetLabelL(kParent, -1);
+			break;
+		}
+	}
+	while (abstractions.back()->GetNumEdges() > 0)
+	{
+		Graph *g = new Graph();
+		addNodes(g);
+		addEdges(g);
+		abstractions.push_back(g);
+	}
+	repairTime = t.EndTimer();
+}
+
+/**
+ * Rebuilds the parents at level+1 of the changed nodes and of the orphans
+ * (parents that lost a child). Nodes that aren't connected to a changed node
+ * keep their components, so no other parent needs to change. On return,
+ * changed and orphans hold the same for the next level: the new parents and
+ * the neighbors of removed parents, and the parents of removed parents.
+ */
+void MapSectorAbstraction::repairLevel(unsigned int level, std::vector<node *> &changed, std::vector<node *> &orphans)
+{
+	Graph *g = abstractions[level];
+	Graph *pg = abstractions[level+1];
+
+	std::vector<node *> rebuild(orphans);
+	for (unsigned int x = 0; x < changed.size(); x++)
+		if (changed[x]->GetLabelL(kParent) != -1)
+			rebuild.push_back(pg->GetNode(changed[x]->GetLabelL(kParent)));
+	std::sort(rebuild.begin(), rebuild.end());
+	rebuild.erase(std::unique(rebuild.begin(), rebuild.end()), rebuild.end());
+
+	std::vector<node *> regroup(changed);
+	changed.resize(0);
+	orphans.resize(0);
+	for (unsigned int x = 0; x < rebuild.size(); x++)
+	{
+		node *p = rebuild[x];
+		for (int y = 0; y < p->GetLabelL(kNumAbstractedNodes); y++)
+		{
+			node *child = g->GetNode(p->GetLabelL(kFirstData+y));
+			child->SetLabelL(kParent, -1);
+			regroup.push_back(child);
+		}
+		neighbor_iterator ni = p->getNeighborIter();
+		for (long tmp = p->nodeNeighborNext(ni); tmp != -1; tmp = p->nodeNeighborNext(ni))
+		{
+			node *neighbor = pg->GetNode(tmp);
+			if (!std::binary_search(rebuild.begin(), rebuild.end(), neighbor))
+				changed.push_back(neighbor);
+		}
+		if ((level+2 < abstractions.size()) && (p->GetLabelL(kParent) != -1))
+		{
+			node *parent = abstractions[level+2]->GetNode(p->GetLabelL(kParent));
+			int last = parent->GetLabelL(kNumAbstractedNodes)-1;
+			for (int y = 0; y <= last; y++)
+			{
+				if (parent->GetLabelL(kFirstData+y) == (long)p->GetNum())
+				{
+					parent->SetLabelL(kFirstData+y, parent->GetLabelL(kFirstData+last));
+					parent->SetLabelL(kNumAbstractedNodes, last);
+					break;
+				}
+			}
+			parent->SetLabelF(kXCoordinate, kUnknownPosition);
+			orphans.push_back(parent);
+		}
+		deleteNode(p);
+	}
+
+	std::vector<node *> added;
+	for (unsigned int x = 0; x < regroup.size(); x++)
+	{
+		if (regroup[x]->GetLabelL(kParent) != -1)
+			continue;
+		node *parent;
+		pg->AddNode(parent = new node("??"));
+		parent->SetLabelL(kAbstractionLevel, level+1); // level in abstraction tree
+		parent->SetLabelL(kNumAbstractedNodes, 0); // number of abstracted nodes
+		parent->SetLabelL(kParent, -1); // parent of this node in abstraction hierarchy
+		parent->SetLabelF(kXCoordinate, kUnknownPosition);
+		parent->SetLabelL(kNodeBlocked, 0);
+		abstractionBFS(regroup[x], parent, getQuadrant(regroup[x]));
+		added.push_back(parent);
+		changed.push_back(parent);
+	}
+
+	std::sort(added.begin(), added.end());
+	for (unsigned int x = 0; x < added.size(); x++)
+	{
+		node *p = added[x];
+		for (int y = 0; y < p->GetLabelL(kNumAbstractedNodes); y++)
+		{
+			node *child = g->GetNode(p->GetLabelL(kFirstData+y));
+			edge_iterator ei = child->getEdgeIter();
+			for (edge *e = child->edgeIterNext(ei); e; e = child->edgeIterNext(ei))
+			{
+				bool outgoing = (e->getFrom() == child->GetNum());
+				node *other = pg->GetNode(g->GetNode(outgoing?e->getTo():e->getFrom())->GetLabelL(kParent));
+				if (other == p)
+					continue;
+				// edges between two new parents are seen from both ends
+				if (std::binary_search(added.begin(), added.end(), other))
+				{
+					if (!outgoing)
+						continue;
+				}
+				else {
+					changed.push_back(other);
+				}
+				int from = outgoing?p->GetNum():other->GetNum();
+				int to = outgoing?other->GetNum():p->GetNum();
+				edge *f = pg->FindEdge(from, to);
+				if (f == 0)
+				{
+					f = new edge(from, to, h(pg->GetNode(from), pg->GetNode(to)));
+					f->SetLabelL(kEdgeCapacity, 1);
+					pg->AddEdge(f);
+				}
+				else f->SetLabelL(kEdgeCapacity, f->GetLabelL(kEdgeCapacity)+1);
+			}
+		}
+	}
+}
+
+/** Removes n and its edges from its graph, fixing any node renumbered by the removal */
+void MapSectorAbstraction::deleteNode(node *n)
+{
+	Graph *g = abstractions[GetAbstractionLevel(n)];
+	std::vector<edge *> edges;
+	edge_iterator ei = n->getEdgeIter();
+	for (edge *e = n->edgeIterNext(ei); e; e = n->edgeIterNext(ei))
+		edges.push_back(e);
+	for (unsigned int x = 0; x < edges.size(); x++)
+	{
+		g->RemoveEdge(edges[x]);
+		delete edges[x];
+	}
+	unsigned int oldID;
+	node *moved = g->RemoveNode(n, oldID);
+	if (moved)
+		RenameNodeInAbstraction(moved, oldID);
+	delete n;
 }
 
 void MapSectorAbstraction::buildAbstraction()
@@ -173,7 +371,7 @@ void MapSectorAbstraction::abstractionBFS(node *which, node *parent, int quadran
 	neighbor_iterator ni = which->getNeighborIter();
 	for (long tmp = which->nodeNeighborNext(ni); tmp != -1; tmp = which->nodeNeighborNext(ni))
 	{
-		abstractionBFS(abstractions.back()->GetNode(tmp), parent, quadrant);
+		abstractionBFS(abstractions[GetAbstractionLevel(which)]->GetNode(tmp), parent, quadrant);
 	}
 }
 
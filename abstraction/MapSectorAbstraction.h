@@ -30,6 +30,14 @@
 #ifndef MAPSectorABSTRACTION_H
 #define MAPSectorABSTRACTION_H
 
+/**
+ * Abstracts each connected component of a sector into one node, with
+ * sectors growing by sectorMultiplier at each level.
+ *
+ * RepairAbstraction applies the tiles queued with TileChanged level by level:
+ * only the parents of nodes whose edges changed are removed and rebuilt, and
+ * their own parents are rebuilt at the next level.
+ */
 class MapSectorAbstraction : public MapAbstraction {
 public:
 	/** Creat a SectorAbstraction of the map. The sector size must be greater than 1 */
@@ -61,6 +69,8 @@ private:
 	void buildNodeIntoParent(node *n, node *parent);
 	void abstractionBFS(node *which, node *parent, int quadrant);
 	int getQuadrant(node *which);
+	void repairLevel(unsigned int level, std::vector<node *> &changed, std::vector<node *> &orphans);
+	void deleteNode(node *n);
 	
 	void addEdges(Graph *g);
 	void addNodes(Graph *g);
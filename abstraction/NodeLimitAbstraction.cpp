@@ -94,6 +94,7 @@ void NodeLimitAbstraction::AddEdge(edge *, unsigned int)
 operations can be stacked followed by a single RepairAbstraction call. */
 void NodeLimitAbstraction::RepairAbstraction()
 {
+	revision++;
 }
 
 void NodeLimitAbstraction::buildAbstraction()
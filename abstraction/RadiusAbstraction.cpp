@@ -95,6 +95,7 @@ void RadiusAbstraction::AddEdge(edge *, unsigned int)
 operations can be stacked followed by a single RepairAbstraction call. */
 void RadiusAbstraction::RepairAbstraction()
 {
+	revision++;
 }
 
 void RadiusAbstraction::buildAbstraction()
@@ -0,0 +1,99 @@
+/*
+ *  AbstractPathCache.cpp
+ *  hog2
+ *
+ *  Abstract paths shared between searches on one GraphAbstraction.
+ *
+ */
+
+#include "AbstractPathCache.h"
+
+AbstractPathCache::AbstractPathCache(GraphAbstraction *a, unsigned int maxEntries)
+:aMap(a), maxEntries(std::max(maxEntries, 1u)), revision(a->GetRevision())
+{
+	hits = misses = evictions = invalidations = 0;
+	loggedHits = loggedMisses = loggedEvictions = loggedInvalidations = 0;
+}
+
+/** Call with the lock held */
+void AbstractPathCache::Validate()
+{
+	if (revision == aMap->GetRevision())
+		return;
+	revision = aMap->GetRevision();
+	if (entries.size() > 0)
+		invalidations++;
+	entries.clear();
+	index.clear();
+}
+
+bool AbstractPathCache::Lookup(int level, unsigned int from, unsigned int to, std::vector<unsigned int> &thePath)
+{
+	std::lock_guard<std::mutex> l(lock);
+	Validate();
+	Key k = {level, from, to};
+	auto i = index.find(k);
+	if (i == index.end())
+	{
+		misses++;
+		return false;
+	}
+	hits++;
+	entries.splice(entries.begin(), entries, i->second);
+	thePath = i->second->path;
+	return true;
+}
+
+void AbstractPathCache::Add(int level, unsigned int from, unsigned int to, const std::vector<unsigned int> &thePath)
+{
+	std::lock_guard<std::mutex> l(lock);
+	Validate();
+	Key k = {level, from, to};
+	auto i = index.find(k);
+	if (i != index.end())
+	{
+		// another thread found the same path first
+		entries.splice(entries.begin(), entries, i->second);
+		return;
+	}
+	entries.push_front(Entry());
+	entries.front().key = k;
+	entries.front().path = thePath;
+	index[k] = entries.begin();
+	if (entries.size() > maxEntries)
+	{
+		index.erase(entries.back().key);
+		entries.pop_back();
+		evictions++;
+	}
+}
+
+void AbstractPathCache::Clear()
+{
+	std::lock_guard<std::mutex> l(lock);
+	entries.clear();
+	index.clear();
+}
+
+unsigned int AbstractPathCache::GetNumEntries() const
+{
+	std::lock_guard<std::mutex> l(lock);
+	return entries.size();
+}
+
+void AbstractPathCache::LogStats(StatCollection *stats, const char *owner)
+{
+	std::lock_guard<std::mutex> l(lock);
+	if (hits != loggedHits)
+		stats->SumStat("pathCacheHits", owner, (long)(hits-loggedHits));
+	if (misses != loggedMisses)
+		stats->SumStat("pathCacheMisses", owner, (long)(misses-loggedMisses));
+	if (evictions != loggedEvictions)
+		stats->SumStat("pathCacheEvictions", owner, (long)(evictions-loggedEvictions));
+	if (invalidations != loggedInvalidations)
+		stats->SumStat("pathCacheInvalidations", owner, (long)(invalidations-loggedInvalidations));
+	loggedHits = hits;
+	loggedMisses = misses;
+	loggedEvictions = evictions;
+	loggedInvalidations = invalidations;
+}
@@ -0,0 +1,71 @@
+/*
+ *  AbstractPathCache.h
+ *  hog2
+ *
+ *  Abstract paths shared between searches on one GraphAbstraction.
+ *
+ *  Paths are keyed by (abstraction level, start node, goal node) and
+ *  evicted least-recently-used first once there are more than the
+ *  maximum number of entries. The cache remembers the abstraction's
+ *  revision and empties itself when RepairAbstraction has changed it.
+ *  All calls take a lock, so units searching in different threads can
+ *  share one cache.
+ *
+ */
+
+#ifndef ABSTRACTPATHCACHE_H
+#define ABSTRACTPATHCACHE_H
+
+#include <stdint.h>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include "GraphAbstraction.h"
+#include "StatCollection.h"
+
+class AbstractPathCache {
+public:
+	AbstractPathCache(GraphAbstraction *a, unsigned int maxEntries = 4096);
+	GraphAbstraction *GetAbstraction() const { return aMap; }
+
+	/** Fills thePath with the node numbers of the cached path; false if there is none */
+	bool Lookup(int level, unsigned int from, unsigned int to, std::vector<unsigned int> &thePath);
+	void Add(int level, unsigned int from, unsigned int to, const std::vector<unsigned int> &thePath);
+	void Clear();
+
+	unsigned int GetNumEntries() const;
+	uint64_t GetHits() const { std::lock_guard<std::mutex> l(lock); return hits; }
+	uint64_t GetMisses() const { std::lock_guard<std::mutex> l(lock); return misses; }
+	uint64_t GetEvictions() const { std::lock_guard<std::mutex> l(lock); return evictions; }
+	uint64_t GetInvalidations() const { std::lock_guard<std::mutex> l(lock); return invalidations; }
+	/** Sums the counters since the last call into stats, under owner; only the cache's owner should call it */
+	void LogStats(StatCollection *stats, const char *owner);
+private:
+	struct Key {
+		int level;
+		unsigned int from, to;
+		bool operator==(const Key &k) const { return level == k.level && from == k.from && to == k.to; }
+	};
+	struct KeyHash {
+		size_t operator()(const Key &k) const
+		{ return std::hash<uint64_t>()(((uint64_t)k.from<<32)^((uint64_t)k.level<<24)^k.to); }
+	};
+	struct Entry {
+		Key key;
+		std::vector<unsigned int> path;
+	};
+	void Validate();
+
+	GraphAbstraction *aMap;
+	unsigned int maxEntries;
+	uint64_t revision;
+	// most recently used first
+	std::list<Entry> entries;
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+	mutable std::mutex lock;
+	uint64_t hits, misses, evictions, invalidations;
+	uint64_t loggedHits, loggedMisses, loggedEvictions, loggedInvalidations;
+};
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ *  BatchRefinement.cpp
+ *  hog2
+ *
+ *  Refines many independent path queries at once on a pool of threads.
+ *
+ */
+
+#include "BatchRefinement.h"
+
+BatchRefinement::BatchRefinement(AlgorithmFactory makeAlgorithm, int numThreads)
+:pending(0), prepared(0), preparedRevision(0), nodesExpanded(0), nodesTouched(0)
+{
+	numThreads = std::max(numThreads, 1);
+	for (int x = 0; x < numThreads; x++)
+		algorithms.push_back(makeAlgorithm());
+	for (int x = 0; x < numThreads; x++)
+		threads.push_back(new std::thread(&BatchRefinement::Worker, this, x));
+}
+
+BatchRefinement::~BatchRefinement()
+{
+	for (unsigned int x = 0; x < threads.size(); x++)
+		work.WaitAdd(0);
+	for (unsigned int x = 0; x < threads.size(); x++)
+	{
+		threads[x]->join();
+		delete threads[x];
+		delete algorithms[x];
+	}
+}
+
+std::future<path *> BatchRefinement::Add(GraphAbstraction *aMap, node *from, node *to)
+{
+	Query *q = new Query;
+	q->aMap = aMap;
+	q->from = from;
+	q->to = to;
+	std::future<path *> result = q->result.get_future();
+	Enqueue(q);
+	return result;
+}
+
+void BatchRefinement::Add(GraphAbstraction *aMap, node *from, node *to, Callback done)
+{
+	Query *q = new Query;
+	q->aMap = aMap;
+	q->from = from;
+	q->to = to;
+	q->done = done;
+	Enqueue(q);
+}
+
+void BatchRefinement::Wait()
+{
+	std::unique_lock<std::mutex> l(lock);
+	finished.wait(l, [this] { return pending == 0; });
+}
+
+void BatchRefinement::Enqueue(Query *q)
+{
+	{
+		std::unique_lock<std::mutex> l(lock);
+		if ((q->aMap != prepared) || (q->aMap->GetRevision() != preparedRevision))
+		{
+			// nothing can be running on the old abstraction while it changes
+			finished.wait(l, [this] { return pending == 0; });
+			Prepare(q->aMap);
+		}
+		pending++;
+	}
+	work.WaitAdd(q);
+}
+
+/** Computes every node location, so the workers never write node labels */
+void BatchRefinement::Prepare(GraphAbstraction *aMap)
+{
+	for (unsigned int x = 0; x < aMap->getNumAbstractGraphs(); x++)
+	{
+		Graph *g = aMap->GetAbstractGraph(x);
+		node_iterator ni = g->getNodeIter();
+		for (node *n = g->nodeIterNext(ni); n; n = g->nodeIterNext(ni))
+			aMap->GetNodeLoc(n);
+	}
+	prepared = aMap;
+	preparedRevision = aMap->GetRevision();
+}
+
+void BatchRefinement::Worker(int id)
+{
+	SearchAlgorithm *alg = algorithms[id];
+	while (true)
+	{
+		Query *q;
+		work.WaitRemove(q);
+		if (q == 0)
+			break;
+		path *p = alg->GetPath(q->aMap, q->from, q->to);
+		nodesExpanded += alg->GetNodesExpanded();
+		nodesTouched += alg->GetNodesTouched();
+		if (q->done)
+			q->done(p);
+		else
+			q->result.set_value(p);
+		delete q;
+
+		std::lock_guard<std::mutex> l(lock);
+		if (--pending == 0)
+			finished.notify_all();
+	}
+}
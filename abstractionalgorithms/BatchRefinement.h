@@ -0,0 +1,77 @@
+/*
+ *  BatchRefinement.h
+ *  hog2
+ *
+ *  Refines many independent path queries at once on a pool of threads.
+ *
+ *  Every thread owns a search algorithm made by the factory passed to the
+ *  constructor, so the open lists and refinement graphs of IRDijkstra or
+ *  CFOptimalRefinement (or any other SearchAlgorithm) are per-thread
+ *  scratch space, reused from one query to the next. A finished path is
+ *  returned through a future, or passed to a callback on the worker
+ *  thread; either way the caller owns it.
+ *
+ *  The abstraction is only read by the workers, so it must not be
+ *  repaired until Wait() returns. MapAbstraction fills in node locations
+ *  lazily, so they are all computed before the first query on an
+ *  abstraction (and again after it has been repaired).
+ *
+ */
+
+#ifndef BATCHREFINEMENT_H
+#define BATCHREFINEMENT_H
+
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <future>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "SearchAlgorithm.h"
+#include "SharedQueue.h"
+
+class BatchRefinement {
+public:
+	typedef std::function<SearchAlgorithm *()> AlgorithmFactory;
+	typedef std::function<void (path *)> Callback;
+
+	BatchRefinement(AlgorithmFactory makeAlgorithm, int numThreads = std::thread::hardware_concurrency());
+	~BatchRefinement();
+	BatchRefinement(const BatchRefinement &) = delete;
+	BatchRefinement &operator=(const BatchRefinement &) = delete;
+
+	std::future<path *> Add(GraphAbstraction *aMap, node *from, node *to);
+	/** done is called on a worker thread with the path (0 if there is none) */
+	void Add(GraphAbstraction *aMap, node *from, node *to, Callback done);
+	/** Blocks until every query added so far has finished */
+	void Wait();
+
+	int GetNumThreads() const { return (int)threads.size(); }
+	const char *GetName() const { return algorithms[0]->GetName(); }
+	uint64_t GetNodesExpanded() const { return nodesExpanded; }
+	uint64_t GetNodesTouched() const { return nodesTouched; }
+private:
+	struct Query {
+		GraphAbstraction *aMap;
+		node *from, *to;
+		std::promise<path *> result;
+		Callback done;
+	};
+	void Enqueue(Query *q);
+	void Prepare(GraphAbstraction *aMap);
+	void Worker(int id);
+
+	std::vector<SearchAlgorithm *> algorithms;
+	std::vector<std::thread *> threads;
+	SharedQueue<Query *> work;
+	std::mutex lock;
+	std::condition_variable finished;
+	uint64_t pending;
+	GraphAbstraction *prepared;
+	uint64_t preparedRevision;
+	std::atomic<uint64_t> nodesExpanded, nodesTouched;
+};
+
+#endif
@@ -20,6 +20,7 @@ CFOptimalRefinement::CFOptimalRefinement()
 
 CFOptimalRefinement::~CFOptimalRefinement()
 {
+	delete g;
 }
 
 const char *CFOptimalRefinement::GetName()
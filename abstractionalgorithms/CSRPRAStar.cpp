@@ -0,0 +1,327 @@
+/*
+ *  CSRPRAStar.cpp
+ *  hog2
+ *
+ *  PRA* over a CSRAbstraction.
+ *
+ */
+
+#include <math.h>
+#include <algorithm>
+#include "FPUtil.h"
+#include "CSRPRAStar.h"
+
+// same value praStar gives nodes when they are first opened
+static const double kUnopened = MAXINT;
+
+CSRPRAStar::CSRPRAStar(const CSRAbstraction *a)
+:SearchAlgorithm(), abs(a)
+{
+	partialLimit = -1;
+	fixedPlanLevel = -1;
+	sprintf(algName,"CSRPRA*(%d)", partialLimit);
+	expandSearchRadius = true; planFromMiddle = true;
+	
+	uint32_t maxNodes = 0;
+	for (int l = 0; l < abs->GetNumLevels(); l++)
+		maxNodes = std::max(maxNodes, abs->GetNumNodes(l));
+	cost.resize(maxNodes);
+	pred.resize(maxNodes);
+	heapIndex.resize(maxNodes);
+	openStamp.resize(maxNodes, 0);
+	closedStamp.resize(maxNodes, 0);
+	eligibleStamp.resize(maxNodes, 0);
+	heap.reserve(maxNodes);
+	generation = 0;
+}
+
+uint64_t CSRPRAStar::GetMemoryUsage() const
+{
+	return sizeof(double)*cost.capacity()+sizeof(uint32_t)*(pred.capacity()+heapIndex.capacity()+
+		openStamp.capacity()+closedStamp.capacity()+eligibleStamp.capacity()+heap.capacity());
+}
+
+path *CSRPRAStar::GetPath(GraphAbstraction *aMap, node *from, node *to, reservationProvider *)
+{
+	nodesExpanded = 0;
+	nodesTouched = 0;
+	if ((from == 0) || (to == 0))
+		return 0;
+	std::vector<uint32_t> thePath;
+	GetPath(from->GetNum(), to->GetNum(), thePath);
+	path *p = 0;
+	for (int x = (int)thePath.size()-1; x >= 0; x--)
+		p = new path(aMap->GetAbstractGraph(0)->GetNode(thePath[x]), p);
+	return p;
+}
+
+void CSRPRAStar::GetPath(uint32_t from, uint32_t to, std::vector<uint32_t> &thePath)
+{
+	lengths.resize(0);
+	thePath.resize(0);
+	nodesExpanded = 0;
+	nodesTouched = 0;
+	if ((from == to) || !abs->Pathable(from, to))
+		return;
+	if (abs->HasEdge(0, from, to))
+	{
+		thePath.push_back(from);
+		thePath.push_back(to);
+		return;
+	}
+	
+	// the chains of parents, up to the first level where they meet or are neighbors
+	std::vector<uint32_t> fromChain, toChain;
+	while (!abs->HasEdge(fromChain.size(), from, to) && (from != to))
+	{
+		fromChain.push_back(from);
+		toChain.push_back(to);
+		from = abs->GetParent(fromChain.size()-1, from);
+		to = abs->GetParent(toChain.size()-1, to);
+	}
+	fromChain.push_back(from);
+	toChain.push_back(to);
+	
+	// the path found at the level above; abstractPath is empty before the first search
+	abstractPath.resize(0);
+	if (fixedPlanLevel != -1)
+	{
+		while (((int)fromChain.size() > 1) && ((int)toChain.size() > fixedPlanLevel + 1))
+		{
+			toChain.pop_back();
+			fromChain.pop_back();
+		}
+	}
+	else if (planFromMiddle)
+	{
+		unsigned int previousSize = fromChain.size();
+		int minNode = (int)(2*sqrt(abs->GetNumNodes(0)));
+		while ((fromChain.size() > 2) && ((fromChain.size() > (previousSize)/2) ||
+										  ((int)abs->GetNumNodes(fromChain.size()) < minNode)))
+		{
+			toChain.pop_back();
+			fromChain.pop_back();
+		}
+	}
+	else {
+		abstractPath.push_back(fromChain.back());
+		abstractPath.push_back(toChain.back());
+		toChain.pop_back();
+		fromChain.pop_back();
+	}
+	
+	lengths.resize(fromChain.size());
+	bool restricted = (abstractPath.size() > 0);
+	do {
+		int level = fromChain.size()-1;
+		uint32_t destParent = CSRAbstraction::kNoNode;
+		uint32_t dest = toChain.back();
+		from = fromChain.back();
+		to = toChain.back();
+		toChain.pop_back();
+		fromChain.pop_back();
+		
+		nextGeneration();
+		if (restricted)
+		{
+			// cut path down to size of partial path limit
+			if (partialLimit > 0)
+			{
+				unsigned int last = std::min((unsigned int)partialLimit, (unsigned int)abstractPath.size()-1);
+				if ((last+1 < abstractPath.size()) || (abstractPath[last] != abs->GetParent(level, to)))
+				{
+					destParent = abstractPath[last];
+					uint32_t target = (last+1 < abstractPath.size())?abstractPath[last+1]:abstractPath[last];
+					dest = abs->GetChild(level+1, abs->GetFirstChild(level+1, target));
+					abstractPath.resize(last+1);
+				}
+			}
+			
+			// find eligible nodes for lower level expansions
+			for (unsigned int x = 0; x < abstractPath.size(); x++)
+			{
+				uint32_t n = abstractPath[x];
+				if (expandSearchRadius)
+				{
+					for (uint32_t e = abs->GetFirstEdge(level+1, n); e < abs->GetFirstEdge(level+1, n+1); e++)
+						eligibleStamp[abs->GetTarget(level+1, e)] = generation;
+				}
+				eligibleStamp[n] = generation;
+			}
+		}
+		getAbstractPath(level, from, destParent, dest, abstractPath);
+		if (abstractPath.size() == 0)
+			return;
+		lengths[fromChain.size()] = abstractPath.size();
+		restricted = true;
+	} while (fromChain.size() > 0);
+	thePath.swap(abstractPath);
+}
+
+void CSRPRAStar::getAbstractPath(int level, uint32_t source, uint32_t destParent, uint32_t dest,
+								 std::vector<uint32_t> &thePath)
+{
+	bool restricted = (thePath.size() > 0);
+	thePath.resize(0);
+	uint32_t current = astar(level, source, destParent, dest, restricted);
+	if (current == source)
+		return;
+	for (; current != CSRAbstraction::kNoNode; current = pred[current])
+		thePath.push_back(current);
+	std::reverse(thePath.begin(), thePath.end());
+}
+
+void CSRPRAStar::nextGeneration()
+{
+	generation++;
+	if (generation == 0)
+	{
+		std::fill(openStamp.begin(), openStamp.end(), 0);
+		std::fill(closedStamp.begin(), closedStamp.end(), 0);
+		std::fill(eligibleStamp.begin(), eligibleStamp.end(), 0);
+		generation = 1;
+	}
+}
+
+uint32_t CSRPRAStar::astar(int level, uint32_t source, uint32_t destParent, uint32_t dest, bool restricted)
+{
+	uint32_t currBest = CSRAbstraction::kNoNode;
+	bool expandedAnything = false;
+	uint32_t openNode = source;
+	uint32_t n = source;
+	heap.resize(0);
+	
+	cost[source] = abs->HCost(level, source, dest);
+	pred[source] = CSRAbstraction::kNoNode;
+	while (1)
+	{
+		nodesExpanded++;
+		closedStamp[n] = generation;
+		
+		for (uint32_t e = abs->GetFirstEdge(level, n); e < abs->GetFirstEdge(level, n+1); e++)
+		{
+			nodesTouched++;
+			uint32_t which = abs->GetTarget(level, e);
+			if (openStamp[which] == generation)
+			{
+				relaxEdge(level, openNode, which, abs->GetWeight(level, e), dest);
+			}
+			else if (closedStamp[which] != generation)
+			{
+				// having no eligible parents means we can search anywhere
+				if (!restricted || (eligibleStamp[abs->GetParent(level, which)] == generation))
+				{
+					cost[which] = kUnopened;
+					pred[which] = CSRAbstraction::kNoNode;
+					heapAdd(which);
+					relaxEdge(level, openNode, which, abs->GetWeight(level, e), dest);
+				}
+			}
+		}
+		
+		if (heap.size() == 0)
+			break;
+		n = heapRemove();
+		expandedAnything = true;
+		
+		openNode = n;
+		if (openNode == dest)
+			break;
+		
+		if (currBest != CSRAbstraction::kNoNode)
+		{
+			if (abs->GetParent(level, currBest) == abs->GetParent(level, n))
+			{
+				// take the node with the best h() value instead of the first
+				// explored node by A* in the abstraction
+				if (cost[currBest] > cost[n])
+					currBest = n;
+			}
+			else if ((destParent != CSRAbstraction::kNoNode) && (abs->GetParent(level, n) == destParent))
+			{
+				currBest = n;
+				break;
+			}
+		} else {
+			currBest = n;
+			if ((destParent != CSRAbstraction::kNoNode) && (abs->GetParent(level, n) == destParent))
+				break;
+		}
+	}
+	
+	if (!expandedAnything)
+		return source;
+	if ((currBest != CSRAbstraction::kNoNode) && (openNode != dest))
+		dest = currBest;
+	return dest;
+}
+
+void CSRPRAStar::relaxEdge(int level, uint32_t from, uint32_t to, double weight, uint32_t dest)
+{
+	double newCost = cost[from]-abs->HCost(level, from, dest)+abs->HCost(level, to, dest)+weight;
+	if (fless(newCost, cost[to]))
+	{
+		cost[to] = newCost;
+		heapifyUp(heapIndex[to]);
+		pred[to] = from;
+	}
+}
+
+// the heap works exactly like Heap, so that ties are broken the same way as in praStar
+
+void CSRPRAStar::heapAdd(uint32_t n)
+{
+	openStamp[n] = generation;
+	heapIndex[n] = heap.size();
+	heap.push_back(n);
+	heapifyUp(heapIndex[n]);
+}
+
+uint32_t CSRPRAStar::heapRemove()
+{
+	uint32_t ans = heap[0];
+	openStamp[ans] = 0;
+	heap[0] = heap.back();
+	heapIndex[heap[0]] = 0;
+	heap.pop_back();
+	heapifyDown(0);
+	return ans;
+}
+
+void CSRPRAStar::heapifyUp(uint32_t index)
+{
+	while (index != 0)
+	{
+		uint32_t parent = (index-1)/2;
+		if (!fgreater(cost[heap[parent]], cost[heap[index]]))
+			return;
+		std::swap(heap[parent], heap[index]);
+		heapIndex[heap[parent]] = parent;
+		heapIndex[heap[index]] = index;
+		index = parent;
+	}
+}
+
+void CSRPRAStar::heapifyDown(uint32_t index)
+{
+	while (true)
+	{
+		uint32_t child1 = index*2+1;
+		uint32_t child2 = index*2+2;
+		uint32_t which;
+		if (child1 >= heap.size())
+			return;
+		else if (child2 >= heap.size())
+			which = child1;
+		else if (fless(cost[heap[child1]], cost[heap[child2]]))
+			which = child1;
+		else
+			which = child2;
+		if (!fless(cost[heap[which]], cost[heap[index]]))
+			return;
+		std::swap(heap[which], heap[index]);
+		heapIndex[heap[which]] = which;
+		heapIndex[heap[index]] = index;
+		index = which;
+	}
+}
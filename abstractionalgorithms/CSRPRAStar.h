@@ -0,0 +1,72 @@
+/*
+ *  CSRPRAStar.h
+ *  hog2
+ *
+ *  PRA* over a CSRAbstraction.
+ *
+ *  The search is the same as praStar (without the path cache): plan at an
+ *  abstract level, then refine one level at a time, searching only in the
+ *  parents (and, with expandSearchRadius, their neighbors) of the previous
+ *  level's path. Ties are broken the same way, so both return the same
+ *  paths. Costs, predecessors and the open list are flat arrays sized to
+ *  the largest level when the search is created, and a generation counter
+ *  marks open, closed and eligible nodes, so nothing is allocated or
+ *  cleared per query.
+ *
+ */
+
+#ifndef CSRPRASTAR_H
+#define CSRPRASTAR_H
+
+#include <vector>
+#include "SearchAlgorithm.h"
+#include "CSRAbstraction.h"
+
+class CSRPRAStar : public SearchAlgorithm {
+public:
+	CSRPRAStar(const CSRAbstraction *a);
+	virtual ~CSRPRAStar() {}
+	/** aMap must be the abstraction the CSRAbstraction was built from */
+	virtual path *GetPath(GraphAbstraction *aMap, node *from, node *to, reservationProvider *rp = 0);
+	/** Path between two level 0 nodes; empty if there is none */
+	void GetPath(uint32_t from, uint32_t to, std::vector<uint32_t> &thePath);
+	virtual const char *GetName() { return algName; }
+
+	void setPartialPathLimit(int limit) { partialLimit = limit;
+		sprintf(algName,"CSRPRA*(%d)",partialLimit); }
+	int getPartialPathLimit() { return partialLimit; }
+	void setPlanFromMiddle(bool _planFromMiddle) { planFromMiddle = _planFromMiddle; }
+	void setExpandSearchRadius(bool _expandSearchRadius) { expandSearchRadius = _expandSearchRadius; }
+	/** Set a fixed level for abstraction in planning. -1 to return to dynamic level selection */
+	void setFixedPlanLevel(int p) { fixedPlanLevel = p; }
+	void getAbstractPathLengths(std::vector<int> &len) { len = lengths; }
+	uint64_t GetMemoryUsage() const;
+private:
+	void getAbstractPath(int level, uint32_t source, uint32_t destParent, uint32_t dest,
+						 std::vector<uint32_t> &thePath);
+	uint32_t astar(int level, uint32_t source, uint32_t destParent, uint32_t dest, bool restricted);
+	void relaxEdge(int level, uint32_t from, uint32_t to, double weight, uint32_t dest);
+	void nextGeneration();
+	void heapAdd(uint32_t n);
+	uint32_t heapRemove();
+	void heapifyUp(uint32_t index);
+	void heapifyDown(uint32_t index);
+
+	const CSRAbstraction *abs;
+	int partialLimit;
+	int fixedPlanLevel;
+	char algName[30];
+	bool expandSearchRadius;
+	bool planFromMiddle;
+	std::vector<int> lengths;
+
+	// per-node search state, sized to the largest level
+	std::vector<double> cost;
+	std::vector<uint32_t> pred, heapIndex;
+	std::vector<uint32_t> openStamp, closedStamp, eligibleStamp;
+	std::vector<uint32_t> heap;
+	uint32_t generation;
+	std::vector<uint32_t> eligible, abstractPath;
+};
+
+#endif
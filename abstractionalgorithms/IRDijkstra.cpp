@@ -20,6 +20,7 @@ IRDijkstra::IRDijkstra()
 
 IRDijkstra::~IRDijkstra()
 {
+	delete g;
 }
 
 const char *IRDijkstra::GetName()
@@ -200,7 +201,7 @@ path *IRDijkstra::ExtractAndRefinePath()
 		}
 	}
 	if (done)
-		return p;
+		return GetRealPath(p);
 
 	std::vector<node*> nodes;
 	GetAllSolutionNodes(gGoal, nodes);
@@ -449,6 +450,20 @@ void IRDijkstra::RefineNode(node *gNode)
 	g->RemoveNode(gNode);
 }
 
+/*
+ * The solution runs from the goal back to the start through nodes of g,
+ * which is rebuilt by the next search; returns the corresponding nodes
+ * of the abstraction from the start to the goal instead.
+ */
+path *IRDijkstra::GetRealPath(path *gPath) const
+{
+	path *p = 0;
+	for (path *i = gPath; i; i = i->next)
+		p = new path(GetRealNode(i->n), p);
+	delete gPath;
+	return p;
+}
+
 node *IRDijkstra::GetRealNode(node *gNode) const
 {
 	return absGraph->GetAbstractGraph(gNode->GetLabelL(kAbstractionLevel))->GetNode(gNode->GetLabelL(kCorrespondingNode));
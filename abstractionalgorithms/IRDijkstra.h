@@ -84,6 +84,7 @@ private:
 //	void MakeNeighborsOpen(node *gNode);
 	void RefineNode(node *gNode);
 	node *GetRealNode(node *gNode) const;
+	path *GetRealPath(path *gPath) const;
 	bool ShouldAddEdge(node *aLowerNode, node *aHigherNode);
 
 	void GetAllSolutionNodes(node *goal, std::vector<node*> &nodes);
@@ -38,6 +38,7 @@ praStar::praStar()
 	sprintf(algName,"PRA*(%d)", partialLimit);
 	expandSearchRadius = true; planFromMiddle = true;
 	cache = 0;
+	sharedCache = 0;
 }
 
 void praStar::setCache(path **p)
@@ -225,7 +226,7 @@ path *praStar::GetPath(GraphAbstraction *aMap, node *from, node *to, reservation
 		}
 		if ((lastPath == 0) && (cache))
 		{
-			lastPath = getAbstractPath(map->GetAbstractGraph((unsigned int)from->
+			lastPath = findAbstractPath(map->GetAbstractGraph((unsigned int)from->
 																											 GetLabelL(kAbstractionLevel)),
 																 from->GetNum(), destParent, eligibleNodeParents,
 																 kTemporaryLabel, dest);
@@ -235,7 +236,7 @@ path *praStar::GetPath(GraphAbstraction *aMap, node *from, node *to, reservation
 		else {
 			if ((cache && ((*cache) != lastPath)) || (!cache))
 				delete lastPath;
-			lastPath = getAbstractPath(map->GetAbstractGraph((unsigned int)from->
+			lastPath = findAbstractPath(map->GetAbstractGraph((unsigned int)from->
 																											 GetLabelL(kAbstractionLevel)),
 																 from->GetNum(), destParent, eligibleNodeParents,
 																 kTemporaryLabel, dest);
@@ -246,6 +247,35 @@ path *praStar::GetPath(GraphAbstraction *aMap, node *from, node *to, reservation
 	return lastPath;
 }
 
+/**
+ * Unrestricted searches only depend on the graph and their endpoints, so
+ * their paths can come from (and go into) the shared cache.
+ */
+path *praStar::findAbstractPath(Graph *g, unsigned int source, unsigned int destParent,
+																std::vector<unsigned int> &eligibleNodeParents, int LABEL,
+																unsigned int dest)
+{
+	int level = g->GetNode(source)->GetLabelL(kAbstractionLevel);
+	if ((sharedCache == 0) || (sharedCache->GetAbstraction() != map) ||
+			(eligibleNodeParents.size() != 0) || ((rp != 0) && (level == 0)))
+		return getAbstractPath(g, source, destParent, eligibleNodeParents, LABEL, dest);
+	
+	std::vector<unsigned int> nodes;
+	if (sharedCache->Lookup(level, source, dest, nodes))
+	{
+		path *p = 0;
+		for (int x = (int)nodes.size()-1; x >= 0; x--)
+			p = new path(g->GetNode(nodes[x]), p);
+		return p;
+	}
+	path *p = getAbstractPath(g, source, destParent, eligibleNodeParents, LABEL, dest);
+	for (path *trav = p; trav; trav = trav->next)
+		nodes.push_back(trav->n->GetNum());
+	if (nodes.size() > 0)
+		sharedCache->Add(level, source, dest, nodes);
+	return p;
+}
+
 path *praStar::getAbstractPath(Graph *g, unsigned int source, unsigned int destParent,
 															 std::vector<unsigned int> &eligibleNodeParents, int LABEL,
 															 unsigned int dest)
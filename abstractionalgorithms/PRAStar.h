@@ -30,6 +30,7 @@
 #include <iostream>
 #include "SearchAlgorithm.h"
 #include "Heap.h"
+#include "AbstractPathCache.h"
 
 /**
  * The pra* search algorithm which does partial pathfinding using abstraction.
@@ -49,10 +50,15 @@ public:
 	void setExpandSearchRadius(bool _expandSearchRadius) { expandSearchRadius = _expandSearchRadius; }
 	void setUseSmoothing(bool _smoothing) { smoothing = _smoothing; }
 	void setCache(path **p);
+	/** Share the first (unrestricted) abstract path of each search with other searches on the same abstraction; the owner of the cache logs its stats */
+	void setSharedCache(AbstractPathCache *c) { sharedCache = c; }
 	/** Set a fixed level for abstraction in planning. -1 to return to dynamic level selection */
 	void setFixedPlanLevel(int p) { fixedPlanLevel = p; }
 	void getAbstractPathLengths(std::vector<int> &len) { len = lengths; }
 protected:
+	path *findAbstractPath(Graph *g, unsigned int source, unsigned int destParent,
+			std::vector<unsigned int> &eligibleNodeParents, int LABEL,
+			unsigned int dest);
 
   path *getAbstractPath(Graph *g, unsigned int source, unsigned int destParent,
 			std::vector<unsigned int> &eligibleNodeParents, int LABEL,
@@ -67,6 +73,7 @@ protected:
 	path *smoothPath(path *p);
 	
 	path **cache;
+	AbstractPathCache *sharedCache;
   int partialLimit;
 	int fixedPlanLevel;
   char algName[30];
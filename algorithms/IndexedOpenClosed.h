@@ -0,0 +1,123 @@
+/*
+ *  IndexedOpenClosed.h
+ *  hog2
+ *
+ *  Open and closed lists for A* or Dijkstra over states numbered 0..n-1.
+ *
+ *  Search data is kept in a table indexed by state and reused from one
+ *  search to the next. A generation counter marks which entries belong to
+ *  the current search, so starting a search doesn't have to clear the
+ *  table. The open list is a binary heap with lazy deletion: when the cost
+ *  of an open state decreases it is pushed again, and Pop skips the stale
+ *  entry. Ties in f-cost go to the larger g-cost.
+ *
+ *  Extra per-state data, set by the caller when Relax succeeds, can be
+ *  added through the data template parameter.
+ *
+ */
+
+#ifndef INDEXEDOPENCLOSED_H
+#define INDEXEDOPENCLOSED_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include "FPUtil.h"
+
+struct IndexedOpenClosedNoData {};
+
+template <class data = IndexedOpenClosedNoData>
+class IndexedOpenClosed {
+public:
+	struct Cell : public data {
+		Cell() :stamp(0) {}
+		double g;
+		uint32_t parent;
+		uint32_t stamp;
+		bool closed;
+	};
+
+	IndexedOpenClosed() :generation(0) {}
+	/** Starts a new search over states 0..size-1 with an empty open list */
+	void Reset(size_t size);
+	/** True if the current search has generated which */
+	bool Reached(uint32_t which) const
+	{ return (which < cells.size()) && (cells[which].stamp == generation); }
+	bool Closed(uint32_t which) const { return Reached(which) && cells[which].closed; }
+	/** Opens which with cost g, or lowers its cost; false if it is closed or g is no better */
+	bool Relax(uint32_t which, double g, double h, uint32_t parent);
+	/** Removes the best open state and returns false if there is none; the state isn't closed */
+	bool Pop(uint32_t &which);
+	void Close(uint32_t which) { cells[which].closed = true; }
+	/** The data of a state; only meaningful if it has been reached */
+	Cell &Lookup(uint32_t which) { return cells[which]; }
+	const Cell &Lookat(uint32_t which) const { return cells[which]; }
+	size_t OpenSize() const { return open.size(); }
+	uint64_t GetMemoryUsage() const
+	{ return cells.capacity()*sizeof(Cell)+open.capacity()*sizeof(OpenEntry); }
+private:
+	struct OpenEntry {
+		double f, g;
+		uint32_t index;
+		bool operator<(const OpenEntry &o) const
+		{ return (f > o.f) || ((f == o.f) && (g < o.g)); }
+	};
+	std::vector<Cell> cells;
+	std::vector<OpenEntry> open;
+	uint32_t generation;
+};
+
+template <class data>
+void IndexedOpenClosed<data>::Reset(size_t size)
+{
+	open.resize(0);
+	// new entries start with stamp 0, which is never current
+	if (cells.size() < size)
+		cells.resize(size);
+	generation++;
+	if (generation == 0)
+	{
+		for (unsigned int x = 0; x < cells.size(); x++)
+			cells[x].stamp = 0;
+		generation = 1;
+	}
+}
+
+template <class data>
+bool IndexedOpenClosed<data>::Relax(uint32_t which, double g, double h, uint32_t parent)
+{
+	Cell &c = cells[which];
+	if (c.stamp == generation)
+	{
+		if (c.closed || !fless(g, c.g))
+			return false;
+	}
+	else {
+		c.stamp = generation;
+		c.closed = false;
+	}
+	c.g = g;
+	c.parent = parent;
+	open.push_back({g+h, g, which});
+	std::push_heap(open.begin(), open.end());
+	return true;
+}
+
+template <class data>
+bool IndexedOpenClosed<data>::Pop(uint32_t &which)
+{
+	while (open.size() > 0)
+	{
+		OpenEntry next = open[0];
+		std::pop_heap(open.begin(), open.end());
+		open.pop_back();
+		const Cell &c = cells[next.index];
+		if (c.closed || fgreater(next.g, c.g))
+			continue;
+		which = next.index;
+		return true;
+	}
+	return false;
+}
+
+#endif
@@ -230,6 +230,7 @@ void InstallHandlers()
 	InstallCommandLineHandler(MyCLHandler, "-memory", "-memory <map> <sectors>", "Measures the memory used by a particular map.");
 	InstallCommandLineHandler(MyCLHandler, "-cut", "-cut <map> <sectors>", "put a 100 cell gash across the middle of the map");
 	InstallCommandLineHandler(MyCLHandler, "-speed", "-speed <map> <sectors>", "Measures the speed of successor generation on a particular map.");
+	InstallCommandLineHandler(MyCLHandler, "-tables", "-tables <map> <sectors> <threads>", "Compares paths using the sector distance tables with A*, before and after a cut across the map.");
 
 	InstallWindowHandler(MyWindowHandler);
 	
@@ -655,6 +656,67 @@ int MyCLHandler(char *argument[], int maxNumArgs)
 		exit(0);
 		return 3;
 	}
+	else if (strcmp(argument[0], "-tables" ) == 0 )
+	{
+		if (maxNumArgs <= 3) exit(0);
+		Map map(argument[1]);
+		Map3DGrid m3g(&map, atoi(argument[2]));
+		int threads = atoi(argument[3]);
+		Timer t;
+		t.StartTimer();
+		m3g.UpdateDistanceTables(threads);
+		printf("Build time: %1.6f (%d threads) table bytes: %d\n", t.EndTimer(), threads, m3g.GetDistanceTableBytesUsed());
+
+		TemplateAStar<state3d, action3d, Map3DGrid> astar;
+		std::vector<state3d> points, p1, p2;
+		state3d s;
+		for (int x = 0; x < map.GetMapWidth(); x++)
+			for (int y = 0; y < map.GetMapHeight(); y++)
+				if (m3g.FindNearState(x, y, 0, s) != -1)
+					points.push_back(s);
+		for (int pass = 0; pass < 2; pass++)
+		{
+			if (pass == 1)
+			{
+				t.StartTimer();
+				for (int x = 1; x < 100; x++)
+				{
+					bool doRepair = ((map.GetMapWidth()/2-50+x)%gSectorSize)==(gSectorSize-1);
+					m3g.RemovePoint(map.GetMapWidth()/2-50+x, map.GetMapHeight()/2, 0, doRepair);
+				}
+				m3g.UpdateDistanceTables(threads);
+				printf("Cut and update time: %1.6f\n", t.EndTimer());
+			}
+			srandom(34);
+			double astarTime = 0, tableTime = 0;
+			uint64_t astarNodes = 0, tableNodes = 0;
+			int mismatches = 0;
+			for (int x = 0; x < 1000; x++)
+			{
+				state3d from = points[random()%points.size()];
+				state3d to = points[random()%points.size()];
+				if (from == to)
+					continue;
+				t.StartTimer();
+				astar.GetPath(&m3g, from, to, p1);
+				astarTime += t.EndTimer();
+				astarNodes += astar.GetNodesExpanded();
+				t.StartTimer();
+				double cost = m3g.GetPath(from, to, p2);
+				tableTime += t.EndTimer();
+				tableNodes += m3g.GetNodesExpanded();
+				double astarCost = (p1.size() > 0)?0:-1;
+				for (unsigned int y = 1; y < p1.size(); y++)
+					astarCost += m3g.GCost(p1[y-1], p1[y]);
+				if (!fequal(cost, astarCost))
+					mismatches++;
+			}
+			printf("%s: A* %1.6f (%llu nodes) tables %1.6f (%llu nodes) mismatches %d\n", (pass == 0)?"Initial":"Cut",
+				   astarTime, astarNodes, tableTime, tableNodes, mismatches);
+		}
+		exit(0);
+		return 4;
+	}
 	return 2; //ignore typos
 }
 
@@ -46,6 +46,8 @@
 #include "MapOverlay.h"
 #include "JPS.h"
 #include "CanonicalDijkstra.h"
+#include "BitboardJPS.h"
+#include "JPSPlus.h"
 
 bool mouseTracking = false;
 bool runningSearch1 = false;
@@ -69,6 +71,7 @@ void WeightedCanAStarExperiments(char *scenario, double weight);
 void WeightedAStarExperiments(char *scenario, double weight);
 void DijkstraExperiments(char *scenario);
 void JPSExperiments(char *scenario, double weight, uint32_t jump);
+void BitboardJPSExperiments(char *scenario);
 void OpenGridExperiments(int width);
 void ComputeReach();
 
@@ -267,6 +270,7 @@ void InstallHandlers()
 	InstallCommandLineHandler(MyCLHandler, "-wcanastar", "-wcanastar <scenario> <weight>", "Run weighted A* experiments on scenario with given weight.");
 	InstallCommandLineHandler(MyCLHandler, "-dijkstra", "-dijkstra <scenario> <weight>", "Run Dijkstra experiments on scenario.");
 	InstallCommandLineHandler(MyCLHandler, "-jps", "-jps <scenario> <weight> <jump distance>", "Run JPS experiments on scenario.");
+	InstallCommandLineHandler(MyCLHandler, "-bjps", "-bjps <scenario>", "Compare A*, gJPS, bitboard JPS and JPS+ on scenario.");
 	InstallCommandLineHandler(MyCLHandler, "-open", "-open <size>", "Run JPS on open grid of given size.");
 
 	InstallWindowHandler(MyWindowHandler);
@@ -1241,6 +1245,13 @@ int MyCLHandler(char *argument[], int maxNumArgs)
 		JPSExperiments(argument[1], atof(argument[2]), atoi(argument[3]));
 		return 3;
 	}
+	if (strcmp( argument[0], "-bjps" ) == 0 )
+	{
+		if (maxNumArgs <= 1)
+			return 0;
+		BitboardJPSExperiments(argument[1]);
+		return 2;
+	}
 	if (strcmp( argument[0], "-open" ) == 0 )
 	{
 		if (maxNumArgs <= 1)
@@ -2048,6 +2059,54 @@ void JPSExperiments(char *scenario, double weight, uint32_t jump)
 	exit(0);
 }
 
+// Prints, for each problem, the time and path length of A*, gJPS, bitboard JPS and JPS+.
+// gJPS (CanonicalDijkstra) has no goal test, so its cost is read from the closed list.
+void BitboardJPSExperiments(char *scenario)
+{
+	ScenarioLoader s(scenario);
+	Map *m = new Map(s.GetNthExperiment(0).GetMapName());
+	MapEnvironment *me = new MapEnvironment(m);
+	TemplateAStar<xyLoc, tDirection, MapEnvironment> astar;
+	CanonicalDijkstra gjps;
+	BitboardJPS bjps(m);
+	Timer t;
+	t.StartTimer();
+	JPSPlus jpsPlus(m);
+	printf("JPS+ table built in %f\n", t.EndTimer());
+	double astarTime = 0, gjpsTime = 0, bjpsTime = 0, jpsPlusTime = 0;
+	for (int x = 0; x < s.GetNumExperiments(); x++)
+	{
+		xyLoc start, goal;
+		start.x = s.GetNthExperiment(x).GetStartX();
+		start.y = s.GetNthExperiment(x).GetStartY();
+		goal.x = s.GetNthExperiment(x).GetGoalX();
+		goal.y = s.GetNthExperiment(x).GetGoalY();
+		
+		if (s.GetNthExperiment(x).GetBucket() > 0)
+		{
+			double a, g, b, p;
+			t.StartTimer();
+			astar.GetPath(me, start, goal, path);
+			astarTime += a = t.EndTimer();
+			double astarLength = me->GetPathLength(path);
+			t.StartTimer();
+			gjps.GetPath(me, start, goal, path);
+			gjpsTime += g = t.EndTimer();
+			t.StartTimer();
+			bjps.GetPath(me, start, goal, path);
+			bjpsTime += b = t.EndTimer();
+			double bjpsLength = me->GetPathLength(path);
+			t.StartTimer();
+			jpsPlus.GetPath(me, start, goal, path);
+			jpsPlusTime += p = t.EndTimer();
+			printf("%f %f %f %f %f %f %f %f %f\n", s.GetNthExperiment(x).GetDistance(),
+				   a, astarLength, g, gjps.GetClosedGCost(goal), b, bjpsLength, p, me->GetPathLength(path));
+		}
+	}
+	printf("Total: A* %f gJPS %f BitboardJPS %f JPS+ %f\n", astarTime, gjpsTime, bjpsTime, jpsPlusTime);
+	exit(0);
+}
+
 void OpenGridExperiments(int width)
 {
 	Map *m = new Map(width, width);
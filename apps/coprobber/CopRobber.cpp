@@ -6,6 +6,7 @@
 #include <string.h>
 #include <time.h>
 #include <cstdio>
+#include <thread>
 #include "Minimax.h"
 #include "Minimax_optimized.h"
 #include "MapCliqueAbstraction.h"
@@ -31,6 +32,7 @@
 #include "DSDijkstra.h"
 #include "DSRMAStar.h"
 #include "DSDijkstra_MemOptim.h"
+#include "TwoCopsRetrograde.h"
 #include "DSCover.h"
 #include "DSHeuristicGreedy.h"
 #include "DSMinimax.h"
@@ -1980,7 +1982,7 @@ void compute_experiment_allstate( int argc, char* argv[] ) {
 
 	if( argc < 5 ) {
 		printf( "Syntax: <num_cops> [<problem_file>] <algorithm> <result file>\n" );
-		printf( "where <algorithm> = dijkstra|markov\n" );
+		printf( "where <algorithm> = dijkstra|retrograde|markov_null|markov_single|markov_cummulative|markov_alternating|markov_retrograde\n" );
 		exit(1);
 	}
 
@@ -2043,10 +2045,46 @@ void compute_experiment_allstate( int argc, char* argv[] ) {
 				(clock_end-clock_start)/1000, nodesExpanded, nodesTouched );
 			fflush( result_file );
 		}
+		if( strcmp( algorithm, "retrograde" ) == 0 ) {
+			// same values as dijkstra, computed by the parallel retrograde analysis
+			int numThreads = std::thread::hardware_concurrency();
+			unsigned int nodesExpanded = 0;
+			unsigned int nodesTouched = 0;
+			switch(num_cops) {
+				case 1: {
+					DSDijkstra_MemOptim *d = new DSDijkstra_MemOptim( env, 1 );
+					clock_start = clock();
+					d->retrograde( numThreads );
+					clock_end = clock();
+					nodesExpanded = d->nodesExpanded;
+					nodesTouched  = d->nodesTouched;
+					delete d;
+				}
+				break;
+				case 2: {
+					TwoCopsRetrograde *d = new TwoCopsRetrograde( env, numThreads );
+					clock_start = clock();
+					d->retrograde();
+					clock_end = clock();
+					nodesExpanded = (unsigned int)d->nodesExpanded;
+					nodesTouched  = (unsigned int)d->nodesTouched;
+					delete d;
+				}
+				break;
+				default:
+					fprintf( stderr, "ERROR: number of cops not supported, only 1 and 2\n" );
+					exit( 1 ); break;
+			}
+			// write out the statistics
+			fprintf( result_file, "%d %d %u %lu %u %u\n", i, j, numNodes,
+				(clock_end-clock_start)/1000, nodesExpanded, nodesTouched );
+			fflush( result_file );
+		}
 		if( strcmp( algorithm, "markov_null" ) == 0 ||
 		    strcmp( algorithm, "markov_single" ) == 0 ||
 		    strcmp( algorithm, "markov_cummulative" ) == 0 ||
-		    strcmp( algorithm, "markov_alternating" ) == 0 ) {
+		    strcmp( algorithm, "markov_alternating" ) == 0 ||
+		    strcmp( algorithm, "markov_retrograde" ) == 0 ) {
 			double precision = 0.1;
 			double gamma = 1.0;
 			double *V = NULL;
@@ -2061,6 +2099,8 @@ void compute_experiment_allstate( int argc, char* argv[] ) {
 				game->Init_With( 2 );
 			else if( strcmp( algorithm, "markov_alternating" ) == 0 )
 				game->Init_With( 3 );
+			else if( strcmp( algorithm, "markov_retrograde" ) == 0 )
+				game->Init_With( 4, std::thread::hardware_concurrency() );
 
 			clock_start = clock();
 			game->GetExpectedStateRewards( 0, gamma, 0.01, precision, V, iter );
@@ -2111,8 +2151,10 @@ void compute_experiment_markov( int argc, char* argv[] ) {
 		printf( "  2 - initialize with forward heuristic (accumulative distance metric\n" );
 		printf( "  3 - solve the alternating game and initialize with that\n" );
 		printf( "  4 - use multilevel markov game\n" );
+		printf( "  5 - use multilevel markov game, initialized with the retrograde analysis\n" );
+		printf( "      of the alternating game on the highest level\n" );
 		printf( "when using init methods 0-3 specify a solution_file\n" );
-		printf( "when using init method 4 specify how many iterations should be performed on each level\n" );
+		printf( "when using init methods 4-5 specify how many iterations should be performed on each level\n" );
 		exit(1);
 	}
 
@@ -2158,6 +2200,8 @@ void compute_experiment_markov( int argc, char* argv[] ) {
 		} else {
 			// using the multilevel markov game
 			MultilevelCopRobberGame *mlgame = new MultilevelCopRobberGame( mca, num_cops, simultaneous, true );
+			if( init_param == 5 )
+				mlgame->Init_With( 4, std::thread::hardware_concurrency() );
 			double **V = NULL;
 			unsigned int *num_iterations = NULL;
 			std::cout << "number of abstraction levels: " << mlgame->NumLevels() << std::endl;
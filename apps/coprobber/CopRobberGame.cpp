@@ -10,13 +10,14 @@ CopRobberGame::CopRobberGame( GraphEnvironment *_genv, unsigned int _num_cops, b
 	genv(_genv),
 	init_with(0),
 	num_nodes(genv->GetGraph()->GetNumNodes()),
-	dsdijkstra( NULL ), twocopsdijkstra( NULL )
+	dsdijkstra( NULL ), twocopsdijkstra( NULL ), retrograde( NULL )
 {
 }
 
 CopRobberGame::~CopRobberGame() {
 	if( dsdijkstra != NULL ) delete dsdijkstra;
 	if( twocopsdijkstra != NULL ) delete twocopsdijkstra;
+	if( retrograde != NULL ) delete retrograde;
 };
 
 unsigned int CopRobberGame::GetNumPlayers() const {
@@ -234,6 +235,9 @@ double CopRobberGame::InitState( CRState s ) {
 			}
 			break;
 		}
+		case 4:
+			// positions the robber can escape from get UINT_MAX, as in case 3
+			return (double)retrograde->Value( s, true ); break;
 		default:
 			fprintf( stderr, "ERROR: type of initialization not supported\n" );
 			exit( 1 );
@@ -242,7 +246,7 @@ double CopRobberGame::InitState( CRState s ) {
 	return 0.;
 }
 
-void CopRobberGame::Init_With( int with ) {
+void CopRobberGame::Init_With( int with, int numThreads ) {
 	init_with = with;
 
 	// solve the game
@@ -261,6 +265,14 @@ void CopRobberGame::Init_With( int with ) {
 				fprintf( stderr, "ERROR: more than 2 cops for initialization are currently not supported\n" );
 		}
 	}
+	if( with == 4 && retrograde == NULL ) {
+		// the retrograde analysis needs the moves of the alternating game
+		bool sim = simultaneous;
+		simultaneous = false;
+		retrograde = new MarkovGameRetrograde<graphState,graphMove>( this, 0, numThreads );
+		retrograde->retrograde();
+		simultaneous = sim;
+	}
 
 	return;
 }
@@ -4,6 +4,7 @@
 #include "MarkovGame.h"
 #include "DSDijkstra_MemOptim.h"
 #include "TwoCopsDijkstra.h"
+#include "MarkovGameRetrograde.h"
 
 #ifndef COPROBBERGAME_H
 #define COPROBBERGAME_H
@@ -39,8 +40,10 @@ class CopRobberGame:
 	// with == 1 => use single agent heuristic
 	// with == 2 => use cummulative heuristic
 	// with == 3 => use alternating game values for initialization
+	// with == 4 => same as 3 but computed for this game by the parallel
+	//              retrograde analysis on numThreads threads
 	// default is 0
-	virtual void Init_With( int with = 0 );
+	virtual void Init_With( int with = 0, int numThreads = 1 );
 
 	virtual unsigned int GetNumStates() const;
 
@@ -63,6 +66,7 @@ class CopRobberGame:
 	// variables that we need for initialization with the values of the alternating game
 	DSDijkstra_MemOptim *dsdijkstra;
 	TwoCopsDijkstra *twocopsdijkstra;
+	MarkovGameRetrograde<graphState,graphMove> *retrograde;
 };
 
 
@@ -1,6 +1,7 @@
 #define __STDC_LIMIT_MACROS
 #include <stdint.h>
 #include "DSDijkstra_MemOptim.h"
+#include "CopRobberGame.h"
 
 /*------------------------------------------------------------------------------
 | Hashing
@@ -182,6 +183,35 @@ float DSDijkstra_MemOptim::Value( CRState &pos, bool minFirst ) {
 	}
 };
 
+void DSDijkstra_MemOptim::retrograde( int numThreads ) {
+	if( dscrenv->GetCopSpeed() != 1 ) {
+		fprintf( stderr, "ERROR: retrograde analysis only supports cop speed 1, using dsdijkstra\n" );
+		dsdijkstra();
+		return;
+	}
+
+	// the alternating game with one cop uses the same state numbers as CRHash_MemOptim
+	CopRobberGame game( env, 1, false, dscrenv->GetPlayersCanpass() );
+	MarkovGameRetrograde<graphState,graphMove> solver( &game, 0, numThreads );
+	solver.retrograde();
+
+	min_cost.assign( numnodes*numnodes, FLT_MAX );
+	max_cost.assign( numnodes*numnodes, FLT_MAX );
+	max_max_cost = 0.;
+	for( unsigned int num = 0; num < numnodes*numnodes; num++ ) {
+		unsigned int v = solver.Value( num, true );
+		if( v != solver.kUnknown ) min_cost[num] = (float)v;
+		v = solver.Value( num, false );
+		if( v != solver.kUnknown ) {
+			max_cost[num] = (float)v;
+			if( max_cost[num] > max_max_cost ) max_max_cost = max_cost[num];
+		}
+	}
+	nodesExpanded = (unsigned int)solver.nodesExpanded;
+	nodesTouched  = (unsigned int)solver.nodesTouched;
+	return;
+}
+
 // this implementation only supports cop_speed = 2 because I was to lazy to implement
 // an entire Dijkstra algorithm here
 //
@@ -35,6 +35,10 @@ class DSDijkstra_MemOptim {
 	~DSDijkstra_MemOptim();
 
 	void dsdijkstra();
+	// computes the same values with the parallel retrograde analysis
+	// (MarkovGameRetrograde) on numThreads threads
+	// note: only supported for cop_speed = 1, otherwise dsdijkstra() is used
+	void retrograde( int numThreads = 1 );
 
 	void WriteValuesToDisk( const char* filename );
 	void ReadValuesFromDisk( const char* filename );
@@ -0,0 +1,364 @@
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <float.h>
+#include <limits.h>
+#include "MarkovGame.h"
+#include "SharedQueue.h"
+#include "Timer.h"
+
+#ifndef MARKOVGAMERETROGRADE_H
+#define MARKOVGAMERETROGRADE_H
+
+/*
+	Parallel retrograde analysis for alternating two-team Markov games
+
+	The solver works on any MarkovGame that enumerates its states through
+	GetNumStates/GetStateByNumber/GetNumberByState, e.g. CopRobberGame or
+	the games of MultilevelCopRobberGame::GetMarkovGame. One player
+	(the robber, player 0 by default) maximizes the number of half moves
+	until a goal state is reached, all other players (the cops) move
+	together and minimize it. Moves are generated with the same rules as
+	MarkovGame::GetExpectedStateRewardsAlternatingActionGame:
+	GetPossibleOpponentActions for the cops and GetPossiblePlayerActions
+	for the robber, filtered by the occupancy interface.
+
+	Every state exists twice, with the cops to move (min position, number
+	num) and with the robber to move (max position, number num+GetNumStates()).
+	The analysis is level-synchronous:
+	- the predecessor lists are built once, in parallel, with atomic
+	  in-degree counters as insert cursors
+	- each position gets an atomic counter: the number of successors
+	  for max positions, 1 for min positions
+	- all positions solved in level v form the frontier. The frontier is
+	  split into chunks that are processed by a pool of threads; every
+	  predecessor's counter is decremented and the thread that brings it
+	  to 0 solves the predecessor with value v+1. Thus min positions get
+	  solved by their first solved successor, max positions by their last
+	  one, and no locks are needed
+
+	note: the game must not be simultaneous, and GetPossiblePlayerActions,
+	  GetPossibleOpponentActions, GetStateByNumber, GetNumberByState,
+	  ApplyAction and GoalTest must be safe to call from several threads
+	  (they are for CopRobberGame)
+*/
+template<class state, class action>
+class MarkovGameRetrograde {
+
+	public:
+
+	typedef typename MultiAgentEnvironment<state,action>::MAState MAState;
+	typedef typename MultiAgentEnvironment<state,action>::MAMove MAMove;
+	typedef typename MultiAgentEnvironment<state,action>::SAAction SAAction;
+	typedef uint64_t Position;
+	static const unsigned int kUnknown = UINT_MAX;
+
+	// constructor
+	MarkovGameRetrograde( MarkovGame<state,action> *game, unsigned int player = 0, int numThreads = 1 );
+
+	void retrograde();
+
+	// number of half moves until the goal is reached with optimal play;
+	// UINT_MAX if the maximizing player can avoid the goal forever
+	unsigned int Value( MAState &s, bool minFirst );
+	unsigned int Value( unsigned int num, bool minFirst ) { return values[minFirst?num:num+numstates]; };
+
+	// writes the values into an array indexed by state number (allocated
+	// if V is NULL), e.g. to initialize MarkovGame::GetExpectedStateRewards;
+	// states the maximizing player escapes from get escapeValue
+	void GetValues( double* &V, bool minFirst, double escapeValue = DBL_MAX );
+
+	uint64_t GetMemoryUsage();
+
+	uint64_t nodesExpanded, nodesTouched;
+
+	protected:
+
+	static const Position kChunkSize = 4096;
+
+	MarkovGame<state,action> *game;
+	unsigned int player;
+	int threads;
+	Position numstates;
+
+	void GetSuccessors( Position pos, std::vector<Position> &successors );
+
+	void build_predecessors();
+	void count_worker( SharedQueue<Position> *work, SharedQueue<uint64_t> *results );
+	void predecessor_worker( SharedQueue<Position> *work );
+	void layer_worker( unsigned int layer, const std::vector<Position> *frontier, std::vector<Position> *next,
+		SharedQueue<Position> *work, SharedQueue<uint64_t> *results );
+
+	// predecessors of position p are predecessors[predecessorStart[p]..predecessorStart[p+1])
+	std::vector<uint64_t> predecessorStart;
+	std::vector<Position> predecessors;
+	std::vector<std::atomic<uint64_t> > cursor;
+	// remaining successors until a position gets solved
+	std::vector<std::atomic<uint32_t> > remaining;
+	// values in half moves; only written by the thread that solves a position
+	std::vector<unsigned int> values;
+};
+
+/*------------------------------------------------------------------------------
+| Implementation
+------------------------------------------------------------------------------*/
+template<class state, class action>
+const unsigned int MarkovGameRetrograde<state,action>::kUnknown;
+template<class state, class action>
+const typename MarkovGameRetrograde<state,action>::Position MarkovGameRetrograde<state,action>::kChunkSize;
+
+template<class state, class action>
+MarkovGameRetrograde<state,action>::MarkovGameRetrograde( MarkovGame<state,action> *_game, unsigned int _player, int numThreads ):
+	game(_game), player(_player), threads(numThreads), numstates(_game->GetNumStates())
+{ };
+
+template<class state, class action>
+void MarkovGameRetrograde<state,action>::GetSuccessors( Position pos, std::vector<Position> &successors ) {
+	successors.clear();
+	MAState s = game->GetStateByNumber( (unsigned int)(pos % numstates) ), temp;
+
+	// no moves once the game is over
+	if( game->GoalTest( s, s ) ) return;
+
+	if( pos < numstates ) {
+		// the opponents move, the player stands still
+		std::vector<MAMove> moves;
+		game->GetPossibleOpponentActions( player, s, moves );
+		for( unsigned int i = 0; i < moves.size(); i++ ) {
+			temp = s;
+			game->ApplyAction( temp, moves[i] );
+			successors.push_back( numstates + game->GetNumberByState( temp ) );
+		}
+	} else {
+		// the player moves, the opponents stand still
+		std::vector<SAAction> actions;
+		MAMove move( s.size(), SAAction() );
+		game->GetPossiblePlayerActions( player, s, actions );
+		for( unsigned int i = 0; i < actions.size(); i++ ) {
+			move[player] = actions[i];
+			temp = s;
+			game->ApplyAction( temp, move );
+			if( game->GetOccupancyInfo()->CanMove( s, temp ) )
+				successors.push_back( game->GetNumberByState( temp ) );
+		}
+	}
+
+	// several moves can lead to the same state (e.g. cops swapping places)
+	std::sort( successors.begin(), successors.end() );
+	successors.erase( std::unique( successors.begin(), successors.end() ), successors.end() );
+};
+
+
+/*------------------------------------------------------------------------------
+| Predecessor lists
+------------------------------------------------------------------------------*/
+template<class state, class action>
+void MarkovGameRetrograde<state,action>::build_predecessors() {
+	Position numpositions = 2*numstates;
+	std::vector<std::thread*> workers( threads );
+	SharedQueue<uint64_t> resultQueue;
+
+	std::vector<std::atomic<uint64_t> >( numpositions ).swap( cursor );
+	std::vector<std::atomic<uint32_t> >( numpositions ).swap( remaining );
+
+	// first pass: count successors and predecessors
+	{
+		SharedQueue<Position> workQueue( threads*20 );
+		for( int x = 0; x < threads; x++ )
+			workers[x] = new std::thread( &MarkovGameRetrograde<state,action>::count_worker, this, &workQueue, &resultQueue );
+		for( Position c = 0; c < numpositions; c += kChunkSize )
+			workQueue.WaitAdd( c );
+		// numpositions is never a valid chunk, so it tells the workers to stop
+		for( int x = 0; x < threads; x++ )
+			workQueue.WaitAdd( numpositions );
+		for( int x = 0; x < threads; x++ ) {
+			workers[x]->join();
+			delete workers[x];
+		}
+	}
+
+	// turn the predecessor counts into insert cursors
+	predecessorStart.resize( numpositions + 1 );
+	uint64_t total = 0;
+	for( Position p = 0; p < numpositions; p++ ) {
+		predecessorStart[p] = total;
+		total += cursor[p].load( std::memory_order_relaxed );
+		cursor[p].store( predecessorStart[p], std::memory_order_relaxed );
+	}
+	predecessorStart[numpositions] = total;
+	predecessors.resize( total );
+
+	// second pass: fill in the predecessors
+	{
+		SharedQueue<Position> workQueue( threads*20 );
+		for( int x = 0; x < threads; x++ )
+			workers[x] = new std::thread( &MarkovGameRetrograde<state,action>::predecessor_worker, this, &workQueue );
+		for( Position c = 0; c < numpositions; c += kChunkSize )
+			workQueue.WaitAdd( c );
+		for( int x = 0; x < threads; x++ )
+			workQueue.WaitAdd( numpositions );
+		for( int x = 0; x < threads; x++ ) {
+			workers[x]->join();
+			delete workers[x];
+		}
+	}
+
+	uint64_t val;
+	while( resultQueue.Remove( val ) )
+		nodesExpanded += val;
+	nodesTouched += total;
+	std::vector<std::atomic<uint64_t> >().swap( cursor );
+};
+
+template<class state, class action>
+void MarkovGameRetrograde<state,action>::count_worker( SharedQueue<Position> *work, SharedQueue<uint64_t> *results ) {
+	Position chunk, end = 2*numstates;
+	std::vector<Position> successors;
+	uint64_t expanded = 0;
+
+	while( true ) {
+		work->WaitRemove( chunk );
+		if( chunk == end ) break;
+
+		for( Position p = chunk; p < std::min( chunk + kChunkSize, end ); p++ ) {
+			GetSuccessors( p, successors );
+			expanded++;
+			if( p < numstates )
+				remaining[p].store( successors.empty()?0:1, std::memory_order_relaxed );
+			else
+				remaining[p].store( successors.size(), std::memory_order_relaxed );
+			for( unsigned int i = 0; i < successors.size(); i++ )
+				cursor[successors[i]].fetch_add( 1, std::memory_order_relaxed );
+		}
+	}
+	results->Add( expanded );
+};
+
+template<class state, class action>
+void MarkovGameRetrograde<state,action>::predecessor_worker( SharedQueue<Position> *work ) {
+	Position chunk, end = 2*numstates;
+	std::vector<Position> successors;
+
+	while( true ) {
+		work->WaitRemove( chunk );
+		if( chunk == end ) break;
+
+		for( Position p = chunk; p < std::min( chunk + kChunkSize, end ); p++ ) {
+			GetSuccessors( p, successors );
+			for( unsigned int i = 0; i < successors.size(); i++ )
+				predecessors[cursor[successors[i]].fetch_add( 1, std::memory_order_relaxed )] = p;
+		}
+	}
+};
+
+
+/*------------------------------------------------------------------------------
+| Retrograde analysis
+------------------------------------------------------------------------------*/
+template<class state, class action>
+void MarkovGameRetrograde<state,action>::retrograde() {
+	nodesExpanded = 0; nodesTouched = 0;
+	Timer t;
+	t.StartTimer();
+
+	build_predecessors();
+
+	// goal states have value 0 for both players to move
+	std::vector<Position> frontier, next;
+	values.assign( 2*numstates, kUnknown );
+	for( Position num = 0; num < numstates; num++ ) {
+		MAState s = game->GetStateByNumber( (unsigned int)num );
+		if( game->GoalTest( s, s ) ) {
+			values[num] = 0;
+			values[num+numstates] = 0;
+			frontier.push_back( num );
+			frontier.push_back( num+numstates );
+		}
+	}
+
+	std::vector<std::vector<Position> > nextFrontiers( threads );
+	for( unsigned int layer = 0; !frontier.empty(); layer++ ) {
+		SharedQueue<Position> workQueue( threads*20 );
+		SharedQueue<uint64_t> resultQueue;
+		std::vector<std::thread*> workers( threads );
+
+		for( int x = 0; x < threads; x++ ) {
+			nextFrontiers[x].clear();
+			workers[x] = new std::thread( &MarkovGameRetrograde<state,action>::layer_worker, this, layer,
+				&frontier, &nextFrontiers[x], &workQueue, &resultQueue );
+		}
+		for( Position c = 0; c < frontier.size(); c += kChunkSize )
+			workQueue.WaitAdd( c );
+		// the size of the frontier is never a valid chunk, so it tells the workers to stop
+		for( int x = 0; x < threads; x++ )
+			workQueue.WaitAdd( frontier.size() );
+		for( int x = 0; x < threads; x++ ) {
+			workers[x]->join();
+			delete workers[x];
+		}
+
+		uint64_t val;
+		while( resultQueue.Remove( val ) )
+			nodesTouched += val;
+		next.clear();
+		for( int x = 0; x < threads; x++ )
+			next.insert( next.end(), nextFrontiers[x].begin(), nextFrontiers[x].end() );
+		frontier.swap( next );
+	}
+
+	printf( "Retrograde analysis on %llu positions took %1.2fs\n", (unsigned long long)(2*numstates), t.EndTimer() );
+	return;
+};
+
+template<class state, class action>
+void MarkovGameRetrograde<state,action>::layer_worker( unsigned int layer, const std::vector<Position> *frontier,
+	std::vector<Position> *next, SharedQueue<Position> *work, SharedQueue<uint64_t> *results ) {
+	Position chunk, end = frontier->size();
+	uint64_t touched = 0;
+
+	while( true ) {
+		work->WaitRemove( chunk );
+		if( chunk == end ) break;
+
+		for( Position i = chunk; i < std::min( chunk + kChunkSize, end ); i++ ) {
+			Position pos = (*frontier)[i];
+			for( uint64_t j = predecessorStart[pos]; j < predecessorStart[pos+1]; j++ ) {
+				Position pred = predecessors[j];
+				touched++;
+				// only one thread can see the counter drop from 1 to 0
+				if( remaining[pred].fetch_sub( 1, std::memory_order_relaxed ) == 1 ) {
+					values[pred] = layer+1;
+					next->push_back( pred );
+				}
+			}
+		}
+	}
+	results->Add( touched );
+};
+
+
+/*------------------------------------------------------------------------------
+| Access
+------------------------------------------------------------------------------*/
+template<class state, class action>
+unsigned int MarkovGameRetrograde<state,action>::Value( MAState &s, bool minFirst ) {
+	return Value( game->GetNumberByState( s ), minFirst );
+};
+
+template<class state, class action>
+void MarkovGameRetrograde<state,action>::GetValues( double* &V, bool minFirst, double escapeValue ) {
+	if( V == NULL ) V = new double[numstates];
+	for( Position num = 0; num < numstates; num++ ) {
+		unsigned int v = Value( (unsigned int)num, minFirst );
+		V[num] = ( v == kUnknown ) ? escapeValue : (double)v;
+	}
+};
+
+template<class state, class action>
+uint64_t MarkovGameRetrograde<state,action>::GetMemoryUsage() {
+	return predecessorStart.size()*sizeof(uint64_t) + predecessors.size()*sizeof(Position) +
+		remaining.size()*sizeof(uint32_t) + values.size()*sizeof(unsigned int);
+};
+
+#endif
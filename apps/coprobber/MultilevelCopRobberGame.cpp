@@ -4,7 +4,7 @@
 MultilevelCopRobberGame::MultilevelCopRobberGame( GraphAbstraction *_gabstraction, unsigned int _num_cops, bool simultaneous, bool _playerscanpass ):
 	MultilevelMarkovGame<graphState,graphMove>( simultaneous ),
 	gabstraction(_gabstraction), num_cops(_num_cops),
-	playerscanpass(_playerscanpass)
+	playerscanpass(_playerscanpass), init_with(0), init_threads(1)
 {
 	// assign some storage for the games
 	unsigned int i, levels = gabstraction->getNumAbstractGraphs();
@@ -46,6 +46,14 @@ MarkovGame<graphState,graphMove>* MultilevelCopRobberGame::GetMarkovGame( unsign
 	return crgames[level];
 }
 
+void MultilevelCopRobberGame::GetExpectedStateRewards( unsigned int player, double gamma, double epsilon, double precision, double** &V, unsigned int* &iter, unsigned int maxlevel, unsigned int maxiter ) {
+	// only the highest level is initialized through InitState
+	unsigned int top = std::min( maxlevel, NumLevels()-1 );
+	GetMarkovGame( top );
+	crgames[top]->Init_With( init_with, init_threads );
+	MultilevelMarkovGame<graphState,graphMove>::GetExpectedStateRewards( player, gamma, epsilon, precision, V, iter, maxlevel, maxiter );
+}
+
 CopRobberGame::CRState MultilevelCopRobberGame::GetParent( CRState s, unsigned int slevel ) {
 	CRState parent;
 	node *nparent;
@@ -43,6 +43,12 @@ class MultilevelCopRobberGame:
 	virtual unsigned int NumLevels();
 
 	virtual MarkovGame<graphState,graphMove>* GetMarkovGame( unsigned int level );
+
+	// initialization of the game on the highest level that is computed,
+	// see CopRobberGame::Init_With; the lower levels start with the values
+	// pushed down from the level above
+	void Init_With( int with = 0, int numThreads = 1 ) { init_with = with; init_threads = numThreads; };
+	virtual void GetExpectedStateRewards( unsigned int player, double gamma, double epsilon, double precision, double** &V, unsigned int* &iter, unsigned int maxlevel, unsigned int maxiter );
 	// the following functions assume that there can still be a parent/child
 	// so do not mess up with it by using an slevel that is too high/low!
 	virtual CRState GetParent( CRState s, unsigned int slevel );
@@ -53,6 +59,7 @@ class MultilevelCopRobberGame:
 		GraphAbstraction *gabstraction;
 		unsigned int num_cops;
 		bool playerscanpass;
+		int init_with, init_threads;
 
 	private:
 		// these variables are just holds of pointers to avoid memory leaks
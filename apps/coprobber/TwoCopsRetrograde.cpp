@@ -0,0 +1,321 @@
+#include "TwoCopsRetrograde.h"
+#include <math.h>
+#include <thread>
+#include "Timer.h"
+
+/*------------------------------------------------------------------------------
+| Constructor
+------------------------------------------------------------------------------*/
+TwoCopsRetrograde::TwoCopsRetrograde( GraphEnvironment *_env, int numThreads ):
+	env(_env), numnodes( env->GetGraph()->GetNumNodes() ), threads( numThreads )
+{
+	numpositions = (Position)numnodes * (numnodes + 1) / 2 * numnodes;
+
+	// copy the graph into flat adjacency lists so that the workers
+	// don't have to go through the graph
+	std::vector<graphState> neighbors;
+	adjacencyStart.resize( numnodes + 1 );
+	for( unsigned int i = 0; i < numnodes; i++ ) {
+		adjacencyStart[i] = adjacency.size();
+		env->GetSuccessors( i, neighbors );
+		adjacency.insert( adjacency.end(), neighbors.begin(), neighbors.end() );
+	}
+	adjacencyStart[numnodes] = adjacency.size();
+};
+
+
+/*------------------------------------------------------------------------------
+| Hashing
+------------------------------------------------------------------------------*/
+TwoCopsRetrograde::Position TwoCopsRetrograde::CRHash( const CRState &s ) const {
+	// sanity check of order
+	assert( s[1] <= s[2] );
+	Position n = numnodes, c1 = s[1];
+	return( s[0] * n*(n+1)/2 + c1*(c1+1)/2 + c1*(n-c1-1) + s[2] );
+};
+
+void TwoCopsRetrograde::Hash_To_CRState( Position hash, CRState &s ) const {
+	Position n = numnodes;
+	s[0] = hash / (n*(n+1)/2);
+	Position h = hash % (n*(n+1)/2);
+
+	Position c1 = (Position) floor( n + 0.5 - sqrt( (n+0.5)*(n+0.5) - 2. * h ) );
+	// guard against rounding errors for large graphs
+	while( c1 > 0 && c1*(c1+1)/2 + c1*(n-c1-1) > h ) c1--;
+	while( (c1+1)*(c1+2)/2 + (c1+1)*(n-c1-2) + (c1+1) <= h ) c1++;
+	s[1] = c1;
+	s[2] = h - c1*(c1+1)/2 - c1*(n-c1-1);
+	return;
+};
+
+/*------------------------------------------------------------------------------
+| Neighbor generation
+------------------------------------------------------------------------------*/
+void TwoCopsRetrograde::GetCopNeighbors( Position pos, std::vector<Position> &neighbors ) const {
+	neighbors.clear();
+	CRState crpos, next;
+	Hash_To_CRState( pos, crpos );
+	next[0] = crpos[0];
+
+	// each cop either moves or passes, but not both pass
+	// (index -1 stands for passing)
+	for( int i1 = (int)adjacencyStart[crpos[1]]-1; i1 < (int)adjacencyStart[crpos[1]+1]; i1++ ) {
+		for( int i2 = (int)adjacencyStart[crpos[2]]-1; i2 < (int)adjacencyStart[crpos[2]+1]; i2++ ) {
+			if( i1 < (int)adjacencyStart[crpos[1]] && i2 < (int)adjacencyStart[crpos[2]] ) continue;
+			next[1] = ( i1 < (int)adjacencyStart[crpos[1]] ) ? crpos[1] : adjacency[i1];
+			next[2] = ( i2 < (int)adjacencyStart[crpos[2]] ) ? crpos[2] : adjacency[i2];
+			SortCops( next );
+			neighbors.push_back( CRHash( next ) );
+		}
+	}
+};
+
+void TwoCopsRetrograde::GetRobberNeighbors( Position pos, std::vector<Position> &neighbors ) const {
+	neighbors.clear();
+	CRState crpos;
+	Hash_To_CRState( pos, crpos );
+
+	// the robber can pass
+	neighbors.push_back( pos );
+	graphState r = crpos[0];
+	for( unsigned int i = adjacencyStart[r]; i < adjacencyStart[r+1]; i++ ) {
+		crpos[0] = adjacency[i];
+		neighbors.push_back( CRHash( crpos ) );
+	}
+};
+
+
+/*------------------------------------------------------------------------------
+| Retrograde analysis
+------------------------------------------------------------------------------*/
+void TwoCopsRetrograde::retrograde() {
+	nodesExpanded = 0; nodesTouched = 0;
+	Timer t;
+	t.StartTimer();
+
+	min_cost.Resize( numpositions );
+	max_cost.Resize( numpositions );
+	min_cost.FillMax();
+	max_cost.FillMax();
+
+	// chunks that contain positions whose successors changed in the last layer
+	std::vector<bool> copChunks( (numpositions + kChunkSize - 1) / kChunkSize );
+	std::vector<bool> robberChunks( copChunks.size() );
+
+	initialize_end_states( copChunks, robberChunks );
+
+	for( unsigned int layer = 1; ; layer++ ) {
+		if( layer >= kUnknown ) {
+			fprintf( stderr, "ERROR: capture times exceed %u half moves\n", kUnknown-1 );
+			exit( 1 );
+		}
+		uint64_t solved = process_layer( layer, copChunks, robberChunks );
+		if( solved == 0 ) break;
+	}
+	printf( "Retrograde analysis on %llu positions took %1.2fs\n", (unsigned long long)numpositions, t.EndTimer() );
+	return;
+};
+
+// positions where the robber sits on one of the cops have value 0
+void TwoCopsRetrograde::initialize_end_states( std::vector<bool> &copChunks, std::vector<bool> &robberChunks ) {
+	CRState crpos;
+	std::vector<Position> neighbors;
+
+	for( unsigned int i = 0; i < numnodes; i++ ) {
+		for( unsigned int j = i; j < numnodes; j++ ) {
+			// the robber is under cop1 or cop2
+			for( int which = 0; which < ((i==j)?1:2); which++ ) {
+				crpos[0] = (which==0)?i:j;
+				crpos[1] = i;
+				crpos[2] = j;
+				Position pos = CRHash( crpos );
+				min_cost.Set( pos, 0 );
+				max_cost.Set( pos, 0 );
+				nodesExpanded++;
+
+				GetRobberNeighbors( pos, neighbors );
+				for( unsigned int x = 0; x < neighbors.size(); x++ )
+					robberChunks[neighbors[x]/kChunkSize] = true;
+				GetCopNeighbors( pos, neighbors );
+				for( unsigned int x = 0; x < neighbors.size(); x++ )
+					copChunks[neighbors[x]/kChunkSize] = true;
+				nodesTouched += neighbors.size();
+			}
+		}
+	}
+};
+
+// finds all positions with value layer; returns how many were found
+uint64_t TwoCopsRetrograde::process_layer( unsigned int layer, std::vector<bool> &copChunks, std::vector<bool> &robberChunks ) {
+	SharedQueue<Position> workQueue( threads*20 );
+	SharedQueue<uint64_t> resultQueue;
+	std::mutex lock;
+	std::vector<bool> nextCopChunks( copChunks.size() ), nextRobberChunks( robberChunks.size() );
+	std::vector<std::thread*> workers( threads );
+
+	for( int x = 0; x < threads; x++ ) {
+		workers[x] = new std::thread( &TwoCopsRetrograde::layer_worker, this, layer,
+			&copChunks, &robberChunks, &nextCopChunks, &nextRobberChunks,
+			&workQueue, &resultQueue, &lock );
+	}
+	for( Position c = 0; c < copChunks.size(); c++ ) {
+		if( copChunks[c] || robberChunks[c] )
+			workQueue.WaitAdd( c );
+	}
+	// numpositions is never a valid chunk, so it tells the workers to stop
+	for( int x = 0; x < threads; x++ )
+		workQueue.WaitAdd( numpositions );
+	for( int x = 0; x < threads; x++ ) {
+		workers[x]->join();
+		delete workers[x];
+	}
+
+	uint64_t total = 0, val;
+	while( resultQueue.Remove( val ) )
+		total += val;
+	copChunks.swap( nextCopChunks );
+	robberChunks.swap( nextRobberChunks );
+	return total;
+};
+
+/*
+	Cop to move (min_cost): the position has value layer if some cop move
+	reaches a robber-to-move position with value layer-1.
+	Robber to move (max_cost): the position has value layer if every robber
+	move reaches a solved cop-to-move position with value below layer.
+	Both rules only read values from earlier layers, and each table is only
+	read in the rule for the other one, so the result doesn't depend on the
+	order in which chunks are processed.
+*/
+void TwoCopsRetrograde::layer_worker( unsigned int layer, std::vector<bool> *copChunks, std::vector<bool> *robberChunks,
+	std::vector<bool> *nextCopChunks, std::vector<bool> *nextRobberChunks,
+	SharedQueue<Position> *work, SharedQueue<uint64_t> *results, std::mutex *lock ) {
+
+	std::vector<Position> neighbors;
+	// chunks to mark for the next layer
+	std::vector<Position> copCache, robberCache;
+	uint64_t count = 0, expanded = 0, touched = 0;
+	Position c;
+
+	while( true ) {
+		work->WaitRemove( c );
+		if( c == numpositions ) break;
+
+		Position end = std::min( numpositions, (c+1)*kChunkSize );
+		bool doCop = (*copChunks)[c], doRobber = (*robberChunks)[c];
+		for( Position pos = c*kChunkSize; pos < end; pos++ ) {
+
+			if( doCop && min_cost.Get( pos ) == kUnknown ) {
+				GetCopNeighbors( pos, neighbors );
+				expanded++;
+				for( unsigned int x = 0; x < neighbors.size(); x++ ) {
+					touched++;
+					if( max_cost.Get( neighbors[x] ) == layer-1 ) {
+						min_cost.Set( pos, layer );
+						count++;
+						// the robber moves that lead here need to be checked next
+						GetRobberNeighbors( pos, neighbors );
+						for( unsigned int y = 0; y < neighbors.size(); y++ )
+							robberCache.push_back( neighbors[y]/kChunkSize );
+						break;
+					}
+				}
+			}
+
+			if( doRobber && max_cost.Get( pos ) == kUnknown ) {
+				GetRobberNeighbors( pos, neighbors );
+				expanded++;
+				bool solved = true;
+				for( unsigned int x = 0; x < neighbors.size(); x++ ) {
+					touched++;
+					if( min_cost.Get( neighbors[x] ) >= layer ) {
+						solved = false;
+						break;
+					}
+				}
+				if( solved ) {
+					max_cost.Set( pos, layer );
+					count++;
+					// the cop moves that lead here need to be checked next
+					GetCopNeighbors( pos, neighbors );
+					for( unsigned int y = 0; y < neighbors.size(); y++ )
+						copCache.push_back( neighbors[y]/kChunkSize );
+				}
+			}
+		}
+
+		// write out the chunks for the next layer
+		lock->lock();
+		for( unsigned int x = 0; x < copCache.size(); x++ )
+			(*nextCopChunks)[copCache[x]] = true;
+		for( unsigned int x = 0; x < robberCache.size(); x++ )
+			(*nextRobberChunks)[robberCache[x]] = true;
+		lock->unlock();
+		copCache.resize( 0 );
+		robberCache.resize( 0 );
+	}
+
+	results->Add( count );
+	lock->lock();
+	nodesExpanded += expanded;
+	nodesTouched += touched;
+	lock->unlock();
+};
+
+
+/*------------------------------------------------------------------------------
+| Cop win? and access to the computed values
+------------------------------------------------------------------------------*/
+bool TwoCopsRetrograde::is_two_cop_win() {
+	// in case the values haven't been computed yet
+	if( min_cost.Size() == 0 ) retrograde();
+
+	for( Position pos = 0; pos < numpositions; pos++ ) {
+		if( min_cost.Get( pos ) == kUnknown )
+			return false;
+	}
+	return true;
+};
+
+unsigned int TwoCopsRetrograde::Value( graphState r, graphState c1, graphState c2 ) {
+	assert( min_cost.Size() == numpositions );
+	CRState pos = { r, c1, c2 };
+	SortCops( pos );
+	unsigned int v = min_cost.Get( CRHash( pos ) );
+	return (v == kUnknown)?UINT_MAX:v;
+};
+
+unsigned int TwoCopsRetrograde::RobberValue( graphState r, graphState c1, graphState c2 ) {
+	assert( max_cost.Size() == numpositions );
+	CRState pos = { r, c1, c2 };
+	SortCops( pos );
+	unsigned int v = max_cost.Get( CRHash( pos ) );
+	return (v == kUnknown)?UINT_MAX:v;
+};
+
+/*------------------------------------------------------------------------------
+| Input / Output
+------------------------------------------------------------------------------*/
+// both tables are written back to back in the NBitArray format
+bool TwoCopsRetrograde::WriteValuesToDisk( const char* filename ) {
+	FILE *fhandler = fopen( filename, "wb" );
+	if( fhandler == NULL ) {
+		std::cerr << "ERROR: could not open file " << filename << " for writing." << std::endl;
+		return false;
+	}
+	bool success = min_cost.Write( fhandler ) && max_cost.Write( fhandler );
+	fclose( fhandler );
+	return success;
+};
+
+bool TwoCopsRetrograde::ReadValuesFromDisk( const char* filename ) {
+	if( !min_cost.MMap( filename ) )
+		return false;
+	if( !max_cost.MMap( filename, min_cost.GetFileSize() ) )
+		return false;
+	if( min_cost.Size() != numpositions || max_cost.Size() != numpositions ) {
+		std::cerr << "ERROR: input file does not have the same amount of states as the map requires." << std::endl;
+		return false;
+	}
+	return true;
+};
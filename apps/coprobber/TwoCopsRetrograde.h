@@ -0,0 +1,93 @@
+#include <vector>
+#include <mutex>
+#include "GraphEnvironment.h"
+#include "NBitArray.h"
+#include "SharedQueue.h"
+
+#ifndef TWOCOPSRETROGRADE_H
+#define TWOCOPSRETROGRADE_H
+
+/*
+	Retrograde analysis for one robber and two cops
+
+	This computes the same values as TwoCopsDijkstra (including its move
+	rules: each agent may pass, but the cops never pass together), but is
+	designed for graphs where TwoCopsDijkstra runs out of memory:
+
+	- values are stored as 8-bit capture times (in half moves) in
+	  NBitArray tables instead of std::vector<unsigned int>,
+	  which cuts memory by a factor of four
+	- instead of a queue, all positions that get value v are found in
+	  layer v by scanning the positions whose successors changed in
+	  layer v-1. Positions are processed in chunks by a pool of threads;
+	  each chunk owns whole words of the tables, so no locking is needed
+	- values can be written to disk and memory mapped back in, so the
+	  tables are used directly from the file without decoding
+
+	note: capture times must be below 255 half moves; the graph must be
+	  undirected
+*/
+class TwoCopsRetrograde {
+
+	public:
+
+	typedef uint64_t Position;
+	static const unsigned int kUnknown = 255;
+
+	// constructor
+	TwoCopsRetrograde( GraphEnvironment *env, int numThreads = 1 );
+
+	void retrograde();
+	// returns whether the graph is 2-cop-win or not
+	bool is_two_cop_win();
+
+	// writes the values in the NBitArray format that ReadValuesFromDisk maps
+	bool WriteValuesToDisk( const char* filename );
+	bool ReadValuesFromDisk( const char* filename );
+
+	// value if the cops move first; UINT_MAX if the robber can escape
+	unsigned int Value( graphState r, graphState c1, graphState c2 );
+	// value if the robber moves first; UINT_MAX if the robber can escape
+	unsigned int RobberValue( graphState r, graphState c1, graphState c2 );
+
+	uint64_t GetMemoryUsage() { return min_cost.GetFileSize() + max_cost.GetFileSize(); }
+
+	uint64_t nodesExpanded, nodesTouched;
+
+	protected:
+
+	typedef graphState CRState[3];
+	static const Position kChunkSize = 4096; // a multiple of 64, so chunks own whole words
+
+	// variables
+	GraphEnvironment *env;
+	unsigned int numnodes;
+	Position numpositions;
+	int threads;
+	// flat adjacency lists of the graph
+	std::vector<unsigned int> adjacencyStart;
+	std::vector<graphState> adjacency;
+
+	// hash functions as in TwoCopsDijkstra, but 64 bit
+	Position CRHash( const CRState &s ) const;
+	void Hash_To_CRState( Position hash, CRState &s ) const;
+	void SortCops( CRState &s ) const { if( s[1] > s[2] ) { graphState t = s[1]; s[1] = s[2]; s[2] = t; } }
+
+	// all positions reachable by a cop move or robber move. Since the graph
+	// is undirected these are also the positions the move could have come from
+	void GetCopNeighbors( Position pos, std::vector<Position> &neighbors ) const;
+	void GetRobberNeighbors( Position pos, std::vector<Position> &neighbors ) const;
+
+	void initialize_end_states( std::vector<bool> &copChunks, std::vector<bool> &robberChunks );
+	uint64_t process_layer( unsigned int layer, std::vector<bool> &copChunks, std::vector<bool> &robberChunks );
+	void layer_worker( unsigned int layer, std::vector<bool> *copChunks, std::vector<bool> *robberChunks,
+		std::vector<bool> *nextCopChunks, std::vector<bool> *nextRobberChunks,
+		SharedQueue<Position> *work, SharedQueue<uint64_t> *results, std::mutex *lock );
+
+	// closed lists; kUnknown marks positions that are not (yet) solved
+	typedef NBitArray<8> ClosedList;
+	ClosedList min_cost, max_cost;
+
+};
+
+#endif
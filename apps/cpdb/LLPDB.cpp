@@ -38,7 +38,8 @@
 #include "ScenarioLoader.h"
 #include "AStarDelay.h"
 #include "MNPuzzle.h"
-#include "FloydWarshall.h"
+#include "MapCPD.h"
+#include "DeltaStepping.h"
 #include "BidirectionalGraphEnvironment.h"
 #include "UnitCostBidirectionalBFS.h"
 #include "MapGenerators.h"
@@ -70,6 +71,7 @@ void TestAPSP();
 void TestSmallMap();
 void RunSmallTest(int windowID);
 void ExportMapAsGraph(const char *mapName, const char *graphName);
+void CPDExperiments(const char *scenario, const char *cpdFile);
 
 void RunTest(ScenarioLoader *sl, GraphHeuristic *gcheur, Map *map, float minDist, float maxDist,
 			 std::vector<int> &nodes, std::vector<float> &hcosts, std::vector<float> &time,
@@ -152,6 +154,7 @@ void InstallHandlers()
 	
 	InstallCommandLineHandler(MyCLHandler, "-map", "-map filename", "Selects the default map to be loaded.");
 	InstallCommandLineHandler(MyCLHandler, "-convert", "-convert map graph", "Converts a map to a graph");
+	InstallCommandLineHandler(MyCLHandler, "-cpd", "-cpd scenario cpdFile", "Compares A* to a first-move CPD on a scenario; builds the CPD if cpdFile doesn't exist");
 	
 	InstallWindowHandler(MyWindowHandler);
 	
@@ -268,6 +271,13 @@ int MyCLHandler(char *argument[], int maxNumArgs)
 		ExportMapAsGraph(argument[1], argument[2]);
 		exit(0);
 	}
+	else if (strcmp(argument[0], "-cpd") == 0)
+	{
+		if (maxNumArgs <= 2)
+			return 0;
+		CPDExperiments(argument[1], argument[2]);
+		exit(0);
+	}
 	return 0;
 }
 
@@ -1386,7 +1396,11 @@ void TestAPSP()
 			MakeMaze(m);
 			Graph *g = GetGraph(m);
 			
-			FloydWarshall(g, lengths);
+			// mazes are sparse, so one search per source beats FloydWarshall
+			DeltaStepping ds(g, false);
+			DistanceMatrix apsp;
+			ds.GetAllPairs(apsp);
+			apsp.CopyTo(lengths, 1e10);
 			double mVal = 0;
 			for (unsigned x = 0; x < lengths.size(); x++)
 			{
@@ -1697,3 +1711,38 @@ void ExportMapAsGraph(const char *mapName, const char *graphName)
 //	printf("GenericAStar: %fs elapsed\n", t.GetElapsedTime());
 //	printf("%d nodes, %f distance\n", totalNodes, totalLength);
 //}
+
+void CPDExperiments(const char *scenario, const char *cpdFile)
+{
+	ScenarioLoader sl(scenario);
+	Map *m = new Map(sl.GetNthExperiment(0).GetMapName());
+	MapEnvironment *me = new MapEnvironment(m);
+	TemplateAStar<xyLoc, tDirection, MapEnvironment> astar;
+	MapCPD cpd(m);
+	if (!cpd.Load(cpdFile))
+	{
+		cpd.Build();
+		cpd.Save(cpdFile);
+	}
+	printf("CPD: %llu nodes, %llu runs, %llu bytes\n", (unsigned long long)cpd.GetNumNodes(), (unsigned long long)cpd.GetNumRuns(),
+		   (unsigned long long)cpd.GetMemoryUsage());
+
+	std::vector<xyLoc> astarPath, cpdPath;
+	Timer t;
+	double astarTime = 0, cpdTime = 0;
+	for (int x = 0; x < sl.GetNumExperiments(); x++)
+	{
+		xyLoc start(sl.GetNthExperiment(x).GetStartX(), sl.GetNthExperiment(x).GetStartY());
+		xyLoc goal(sl.GetNthExperiment(x).GetGoalX(), sl.GetNthExperiment(x).GetGoalY());
+		double a, c;
+		t.StartTimer();
+		astar.GetPath(me, start, goal, astarPath);
+		astarTime += a = t.EndTimer();
+		t.StartTimer();
+		cpd.GetPath(start, goal, cpdPath);
+		cpdTime += c = t.EndTimer();
+		printf("%d %f %f %f %f %f\n", x, sl.GetNthExperiment(x).GetDistance(),
+			   a, me->GetPathLength(astarPath), c, me->GetPathLength(cpdPath));
+	}
+	printf("Total: A* %f CPD %f\n", astarTime, cpdTime);
+}
@@ -32,6 +32,7 @@
 #include "IDAStar.h"
 #include "Timer.h"
 #include "Fling.h"
+#include "FlingSolver.h"
 #include "BFS.h"
 #include <fstream>
 #include <iostream>
@@ -818,40 +819,32 @@ void SolveAndSaveInstance(unsigned long , tKeyboardModifier , char)
 
 const int THREADS = 16;
 #include "BitVector.h"
-std::vector<BitVector*> table;
+// solvability tables are built and looked up by the solver; the tables of
+// uniquely solvable boards are built here on top of them
+FlingSolver solver;
 std::vector<BitVector*> unique;
-//std::vector<std::vector<BitVector*> > table;
 int currSize = 2;
 pthread_mutex_t writeLock = PTHREAD_MUTEX_INITIALIZER;
-int64_t solvable;
 int64_t uniqueSolvable;
 
 void *ThreadedWorker(void *arg)
 {
 	int id = (long)arg;
-	int64_t solved = 0;
 	int64_t uniqueSolved = 0;
 	FlingBoard currState, tmp;
-	std::vector<FlingBoard> succ;
 	std::vector<FlingMove> acts;
 
-	std::vector<int64_t> buffer;
 	std::vector<int64_t> uniqueBuffer;
-	buffer.reserve(4*1024+100);
 	uniqueBuffer.reserve(4*1024+100);
 	for (int64_t val = id; val < f.getMaxSinglePlayerRank(56, currSize); val+=THREADS)
 	{
 		f.unrankPlayer(val, currSize, currState);
-		//f.GetSuccessors(currState, succ);
 		f.GetActions(currState, acts);
 		if (currSize == 2)
 		{
 			if (acts.size() > 0)
 			{
-				buffer.push_back(val);
 				uniqueBuffer.push_back(val);
-				//table[currSize][val] = true;
-				solved++;
 				uniqueSolved++;
 			}
 		}
@@ -861,41 +854,25 @@ void *ThreadedWorker(void *arg)
 			for (int x = 0; x < acts.size(); x++)
 			{
 				f.GetNextState(currState, acts[x], tmp);
-				uint64_t rank = f.rankPlayer(tmp);
-				if (table[tmp.locs.size()]->Get(rank))
+				if (solver.IsSolvable(tmp))
 				{
 					cnt++;
 				}
-				if (unique[tmp.locs.size()]->Get(rank))
+				if (unique[tmp.locs.size()]->Get(f.rankPlayer(tmp)))
 				{
 					uniqueCnt++;
 				}
 			}
-			if (cnt > 0) {
-				buffer.push_back(val);
-				solved++;
-			}
 			if (cnt == 1 && uniqueCnt == 1)
 			{
 				uniqueBuffer.push_back(val);
 				uniqueSolved++;
-//				pthread_mutex_lock (&writeLock);
-//				std::cout << currState << std::endl;
-//				std::cout << acts.size() << " moves; ";
-//				std::cout << cnt << " lead to solvable states; ";
-//				std::cout << uniqueCnt << " of these are unique\n";
-//				pthread_mutex_unlock(&writeLock);
 			}
 		}
 		// flush buffer
-		if (buffer.size() > 4*1024)
+		if (uniqueBuffer.size() > 4*1024)
 		{
 			pthread_mutex_lock (&writeLock);
-			while (buffer.size() > 0)
-			{
-				table[currSize]->Set(buffer.back(), true);// = true;
-				buffer.pop_back();
-			}
 			while (uniqueBuffer.size() > 0)
 			{
 				unique[currSize]->Set(uniqueBuffer.back(), true);// = true;
@@ -906,11 +883,6 @@ void *ThreadedWorker(void *arg)
 	}
 
 	pthread_mutex_lock (&writeLock);
-	while (buffer.size() > 0)
-	{
-		table[currSize]->Set(buffer.back(), true);
-		buffer.pop_back();
-	}
 	while (uniqueBuffer.size() > 0)
 	{
 		unique[currSize]->Set(uniqueBuffer.back(), true);// = true;
@@ -920,7 +892,6 @@ void *ThreadedWorker(void *arg)
 		}
 		uniqueBuffer.pop_back();
 	}
-	solvable += solved;
 	uniqueSolvable += uniqueSolved;
 	pthread_mutex_unlock(&writeLock);
 
@@ -981,19 +952,20 @@ void ExtractUniqueStates(int depth)
 
 void BuildTables(unsigned long , tKeyboardModifier, char)
 {
-	table.resize(currSize+1);
+	if (currSize > Fling::kMaxPieces)
+	{
+		printf("Error: Fling can only rank boards with up to %d pieces\n", Fling::kMaxPieces);
+		return;
+	}
+	solver.BuildTables(currSize, THREADS);
+
 	unique.resize(currSize+1);
-	std::cout << "Starting work on board with " << currSize << " pieces. ";
+	std::cout << "Finding uniquely solvable boards with " << currSize << " pieces. ";
 	std::cout << f.getMaxSinglePlayerRank(56, currSize) << " entries." << std::endl;
-
 	char fname[255];
-	sprintf(fname, "fling-%d.dat", currSize);
-	table[currSize] = new BitVector(f.getMaxSinglePlayerRank(56, currSize), fname, true);
 	sprintf(fname, "fling-unique-%d.dat", currSize);
 	unique[currSize] = new BitVector(f.getMaxSinglePlayerRank(56, currSize), fname, true);
-	//table[currSize].resize(f.getMaxSinglePlayerRank(56, currSize));
 
-	solvable = 0;
 	uniqueSolvable = 0;
 	Timer t;
 	t.StartTimer();
@@ -1010,48 +982,19 @@ void BuildTables(unsigned long , tKeyboardModifier, char)
 			printf("Unknown error joining with thread %d\n", x);
 		}
 	}
-	double perc = solvable;
-	perc /= (double)f.getMaxSinglePlayerRank(56, currSize);
-	printf("%lld are solvable (%3.1f%%)\n", solvable, 100*perc);
-
-	perc = uniqueSolvable;
+	double perc = uniqueSolvable;
 	perc /= (double)f.getMaxSinglePlayerRank(56, currSize);
 	printf("%lld are uniquely solvable (%3.1f%%)\n%3.2f sec elapsed\n", uniqueSolvable, 100*perc, t.EndTimer());
 	fflush(stdout);
-//	char fname[255];
-//	sprintf(fname, "/Users/nathanst/fling-%d.dat", currSize);
-	//t.StartTimer();
-	//WriteData(table[currSize], fname);
-	//printf("%3.2f sec writing data to disk\n", t.EndTimer());
-	//std::cout << solvable << " are solvable " << std::setprecision(3) << perc << std::endl;
-	//std::cout << t.EndTimer() << " elapsed" << std::endl;
 	currSize++;
 }
 
 void ReadTables(unsigned long , tKeyboardModifier, char)
 {
-	table.resize(0); // clear old data
-//	table.resize(9);
-
 	Timer t;
-	for (int x = 2; x <= 10; x++)
-	{
-		table.resize(x+1);
-		std::cout << "Loading board with " << x << " pieces. ";
-		std::cout << f.getMaxSinglePlayerRank(56, x) << " entries." << std::endl;
-		//table[x] = new BitVector(f.getMaxSinglePlayerRank(56, x));
-		//table[x].resize(f.getMaxSinglePlayerRank(56, x));
-
-		char fname[255];
-		sprintf(fname, "/Users/nathanst/hog2/apps/fling/fling-%d.dat", x);
-		t.StartTimer();
-		table[x] = new BitVector(f.getMaxSinglePlayerRank(56, x), fname, false);
-//		if (ReadData(table[x], fname) != true)
-//		{
-//			printf("Error reading data\n");
-//		}
-		printf("%3.2f sec reading data from disk\n", t.EndTimer());
-	}
+	t.StartTimer();
+	int loaded = solver.LoadTables(10);
+	printf("Loaded tables with up to %d pieces; %3.2f sec elapsed\n", loaded, t.EndTimer());
 }
 
 std::unordered_map<uint64_t,bool> visitedStates;
@@ -1061,17 +1004,8 @@ bool IsSolvable(FlingBoard &theState)
 {
 	if (theState.locs.size() == 1)
 		return true;
-	if (useTable && theState.locs.size() < table.size())
-	{
-		// lookup
-		//return (table[theState.locs.size()][f.rankPlayer(theState)]);
-		if (table[theState.locs.size()] != 0)
-			return (table[theState.locs.size()]->Get(f.rankPlayer(theState)));
-		else {
-			printf("Table size %d is null\n", theState.locs.size());
-			return true;
-		}
-	}
+	if (useTable && solver.CanLookup(theState))
+		return solver.IsSolvable(theState);
 	// in hash table
 	if (visitedStates.find(f.rankPlayer(theState)) != visitedStates.end())
 	{
@@ -35,6 +35,7 @@
 #include "TemplateAStar.h"
 #include "GraphEnvironment.h"
 #include "MapSectorAbstraction.h"
+#include "ClusterAbstraction.h"
 #include "GraphRefinementEnvironment.h"
 #include "ScenarioLoader.h"
 #include "BFS.h"
@@ -43,6 +44,20 @@
 #include "MapGenerators.h"
 #include "FPUtil.h"
 #include "CanonicalGrid.h"
+#include "TemplateFringeSearch.h"
+#include "MapCliqueAbstraction.h"
+#include "PRAStar.h"
+#include "MinimalSectorAbstraction.h"
+#include "MapCorridorAStar.h"
+#include "CorridorAStar.h"
+#include "MapThetaStar.h"
+#include "CSRAbstraction.h"
+#include "CSRPRAStar.h"
+#include "SearchUnit.h"
+#include "IRDijkstra.h"
+#include "BatchRefinement.h"
+#include "MapFlatAbstraction.h"
+#include "LoadedMapAbstraction.h"
 
 bool mouseTracking = false;
 bool runningSearch1 = false;
@@ -83,6 +98,129 @@ Map *ReduceMap(Map *inputMap);
 void MeasureHighwayDimension(Map *m, int depth);
 void EstimateDimension(Map *m);
 void EstimateLongPath(Map *m);
+void MeasureRepairTime(const char *mapName, int clusterSize, int changes);
+void MeasureClusterBuildTime(const char *mapName, int clusterSize, int threads, int maxSize);
+void MeasureFringeSearch(const char *scenario);
+void MeasurePathCache(const char *mapName, int numUnits, int numGroups);
+void MeasureMinimalSector(const char *scenario, int sectorSize);
+void MeasureMapCorridor(const char *scenario, int level);
+void MeasureCSRPRAStar(const char *mapName, int numQueries);
+void MeasureThetaStar(const char *scenario);
+void MeasureBatchRefinement(const char *mapName, int numUnits, int numThreads);
+void MeasureSavedAbstraction(const char *mapName, const char *fileName, int numQueries);
+
+/** Counts nodes and edges of each level that differ in their labels or endpoints */
+int CountLabelMismatches(GraphAbstraction *a, GraphAbstraction *b)
+{
+	int mismatches = 0;
+	for (unsigned int l = 0; l < a->getNumAbstractGraphs(); l++)
+	{
+		Graph *g1 = a->GetAbstractGraph(l), *g2 = b->GetAbstractGraph(l);
+		for (int x = 0; x < g1->GetNumNodes(); x++)
+		{
+			node *n1 = g1->GetNode(x), *n2 = g2->GetNode(x);
+			bool same = (n1->GetNumLabels() == n2->GetNumLabels());
+			for (unsigned int y = 0; same && y < n1->GetNumLabels(); y++)
+				same = (n1->GetLabelL(y) == n2->GetLabelL(y));
+			if (!same)
+				mismatches++;
+		}
+		for (int x = 0; x < g1->GetNumEdges(); x++)
+		{
+			edge *e1 = g1->GetEdge(x), *e2 = g2->GetEdge(x);
+			bool same = (e1->getFrom() == e2->getFrom()) && (e1->getTo() == e2->getTo()) &&
+			(e1->GetNumLabels() == e2->GetNumLabels());
+			for (unsigned int y = 0; same && y < e1->GetNumLabels(); y++)
+				same = (e1->GetLabelL(y) == e2->GetLabelL(y));
+			if (!same)
+				mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+/**
+ * Saves each kind of map abstraction, loads it into a LoadedMapAbstraction
+ * and checks that the levels, labels and Pathable answers match the
+ * original. A map with one tile changed and a truncated copy of the file
+ * must both be rejected by Load.
+ */
+void MeasureSavedAbstraction(const char *mapName, const char *fileName, int numQueries)
+{
+	const char *names[] = {"clique", "cluster", "sector", "flat"};
+	printf("map\tabstraction\tlevels\tbuild\tload\tspeedup\tlevel-mismatches\tlabel-mismatches\tpathable-mismatches\tother-map-rejected\ttruncated-rejected\n");
+	for (int which = 0; which < 4; which++)
+	{
+		Map *map = new Map(mapName);
+		Timer t;
+		t.StartTimer();
+		MapAbstraction *a;
+		if (which == 0)
+			a = new MapCliqueAbstraction(map);
+		else if (which == 1)
+			a = new ClusterAbstraction(map, 16);
+		else if (which == 2)
+			a = new MapSectorAbstraction(map, 8, 2);
+		else
+			a = new MapFlatAbstraction(map);
+		double buildTime = t.EndTimer();
+		if (!a->Save(fileName))
+			exit(1);
+
+		LoadedMapAbstraction loaded(new Map(mapName));
+		t.StartTimer();
+		bool success = loaded.Load(fileName);
+		double loadTime = t.EndTimer();
+		if (!success)
+		{
+			printf("Error: unable to load '%s'\n", fileName);
+			exit(1);
+		}
+		int levelMismatches = 0, labelMismatches = 0, pathableMismatches = 0;
+		if (loaded.getNumAbstractGraphs() != a->getNumAbstractGraphs())
+			levelMismatches++;
+		for (unsigned int l = 0; levelMismatches == 0 && l < a->getNumAbstractGraphs(); l++)
+			if ((loaded.GetAbstractGraph(l)->GetNumNodes() != a->GetAbstractGraph(l)->GetNumNodes()) ||
+				(loaded.GetAbstractGraph(l)->GetNumEdges() != a->GetAbstractGraph(l)->GetNumEdges()))
+				levelMismatches++;
+		if (levelMismatches == 0)
+			labelMismatches = CountLabelMismatches(a, &loaded);
+		Graph *g = a->GetAbstractGraph(0);
+		srandom(1);
+		for (int x = 0; levelMismatches == 0 && x < numQueries; x++)
+		{
+			node *from = g->GetRandomNode(), *to = g->GetRandomNode();
+			if (a->Pathable(from, to) != loaded.Pathable(loaded.GetAbstractGraph(0)->GetNode(from->GetNum()),
+														  loaded.GetAbstractGraph(0)->GetNode(to->GetNum())))
+				pathableMismatches++;
+		}
+
+		// the same file for a map with one tile blocked
+		Map *other = new Map(mapName);
+		int tx, ty;
+		a->GetTileFromNode(g->GetNode(0), tx, ty);
+		other->SetTerrainType(tx, ty, kOutOfBounds);
+		LoadedMapAbstraction otherMap(other);
+		bool otherRejected = !otherMap.Load(fileName);
+
+		std::vector<char> bytes;
+		FILE *f = fopen(fileName, "r");
+		for (int c = fgetc(f); c != EOF; c = fgetc(f))
+			bytes.push_back(c);
+		fclose(f);
+		f = fopen(fileName, "w");
+		fwrite(&bytes[0], 1, bytes.size()-8, f);
+		fclose(f);
+		LoadedMapAbstraction truncated(new Map(mapName));
+		bool truncatedRejected = !truncated.Load(fileName);
+		remove(fileName);
+
+		printf("%s\t%s\t%d\t%f\t%f\t%f\t%d\t%d\t%d\t%d\t%d\n", mapName, names[which], (int)a->getNumAbstractGraphs(),
+			   buildTime, loadTime, buildTime/loadTime, levelMismatches, labelMismatches, pathableMismatches,
+			   otherRejected, truncatedRejected);
+		delete a;
+	}
+}
 
 void testHeuristic(char *problems);
 
@@ -185,6 +323,16 @@ void InstallHandlers()
 	InstallCommandLineHandler(MyCLHandler, "-estimateDimension", "-estimateDimension map", "Estimate the dimension.");
 	InstallCommandLineHandler(MyCLHandler, "-estimateLongPath", "-estimateLongPath map", "Estimate the longest path in the map.");
 	InstallCommandLineHandler(MyCLHandler, "-testHeuristic", "-testHeuristic scenario", "measure the ratio of the heuristic to the optimal dist");
+	InstallCommandLineHandler(MyCLHandler, "-repairTime", "-repairTime map clusterSize changes", "Compare repairing cluster and sector abstractions after single tile changes with rebuilding them.");
+	InstallCommandLineHandler(MyCLHandler, "-clusterBuildTime", "-clusterBuildTime map clusterSize threads maxSize", "Time building the cluster abstraction with 1 and with threads threads, scaling map from 256 up to maxSize.");
+	InstallCommandLineHandler(MyCLHandler, "-pathCache", "-pathCache map units groups", "Time units in groups moving with PRA*(4) between shared regions, with and without a shared abstract path cache.");
+	InstallCommandLineHandler(MyCLHandler, "-minimalSector", "-minimalSector scenario sectorSize", "Compare memory and path latency of MinimalSectorAbstraction with MapSectorAbstraction and PRA* on a scenario (sectorSize <= 16).");
+	InstallCommandLineHandler(MyCLHandler, "-mapCorridor", "-mapCorridor scenario level", "Compare corridorAStar with MapCorridorAStar refining abstract paths from level level of a clique abstraction on a scenario.");
+	InstallCommandLineHandler(MyCLHandler, "-csrPRA", "-csrPRA map queries", "Compare praStar with CSRPRAStar on random queries over a clique abstraction: mismatched paths, time, expansions and memory.");
+	InstallCommandLineHandler(MyCLHandler, "-thetaStar", "-thetaStar scenario", "Compare path length and time of A* with Theta* and Lazy Theta* any-angle paths on a scenario.");
+	InstallCommandLineHandler(MyCLHandler, "-batchRefinement", "-batchRefinement map units threads", "Time units planning with IRDijkstra one at a time and on a shared BatchRefinement with threads threads, and check that they end in the same places.");
+	InstallCommandLineHandler(MyCLHandler, "-savedAbstraction", "-savedAbstraction map file queries", "Save clique, cluster, sector and flat abstractions of a map to file (removed afterwards), load them back and compare levels, labels and Pathable on random queries; checks that other maps and truncated files are rejected.");
+	InstallCommandLineHandler(MyCLHandler, "-fringeSearch", "-fringeSearch scenario", "Compare TemplateFringeSearch with TemplateAStar on a scenario, on MapEnvironment and CanonicalGrid.");
 
 	InstallWindowHandler(MyWindowHandler);
 	
@@ -773,6 +921,86 @@ int MyCLHandler(char *argument[], int maxNumArgs)
 		testHeuristic(argument[1]);
 		exit(0);
 	}
+	else if (strcmp( argument[0], "-repairTime" ) == 0)
+	{
+		if (maxNumArgs <= 3)
+			return 0;
+		MeasureRepairTime(argument[1], atoi(argument[2]), atoi(argument[3]));
+		exit(0);
+		return 4;
+	}
+	else if (strcmp( argument[0], "-clusterBuildTime" ) == 0)
+	{
+		if (maxNumArgs <= 4)
+			return 0;
+		MeasureClusterBuildTime(argument[1], atoi(argument[2]), atoi(argument[3]), atoi(argument[4]));
+		exit(0);
+		return 5;
+	}
+	else if (strcmp( argument[0], "-pathCache" ) == 0)
+	{
+		if (maxNumArgs <= 3)
+			return 0;
+		MeasurePathCache(argument[1], atoi(argument[2]), atoi(argument[3]));
+		exit(0);
+		return 4;
+	}
+	else if (strcmp( argument[0], "-minimalSector" ) == 0)
+	{
+		if (maxNumArgs <= 2)
+			return 0;
+		MeasureMinimalSector(argument[1], atoi(argument[2]));
+		exit(0);
+		return 3;
+	}
+	else if (strcmp( argument[0], "-mapCorridor" ) == 0)
+	{
+		if (maxNumArgs <= 2)
+			return 0;
+		MeasureMapCorridor(argument[1], atoi(argument[2]));
+		exit(0);
+		return 3;
+	}
+	else if (strcmp( argument[0], "-csrPRA" ) == 0)
+	{
+		if (maxNumArgs <= 2)
+			return 0;
+		MeasureCSRPRAStar(argument[1], atoi(argument[2]));
+		exit(0);
+		return 3;
+	}
+	else if (strcmp( argument[0], "-thetaStar" ) == 0)
+	{
+		if (maxNumArgs <= 1)
+			return 0;
+		MeasureThetaStar(argument[1]);
+		exit(0);
+		return 2;
+	}
+	else if (strcmp( argument[0], "-savedAbstraction" ) == 0)
+	{
+		if (maxNumArgs <= 3)
+			return 0;
+		MeasureSavedAbstraction(argument[1], argument[2], atoi(argument[3]));
+		exit(0);
+		return 4;
+	}
+	else if (strcmp( argument[0], "-batchRefinement" ) == 0)
+	{
+		if (maxNumArgs <= 3)
+			return 0;
+		MeasureBatchRefinement(argument[1], atoi(argument[2]), atoi(argument[3]));
+		exit(0);
+		return 4;
+	}
+	else if (strcmp( argument[0], "-fringeSearch" ) == 0)
+	{
+		if (maxNumArgs <= 1)
+			return 0;
+		MeasureFringeSearch(argument[1]);
+		exit(0);
+		return 2;
+	}
 	else if (strcmp( argument[0], "-estimateLongPath" ) == 0)
 	{
 		if (maxNumArgs <= 1)
@@ -1644,6 +1872,513 @@ double FindFarDist(Graph *g, node *n, graphState &from, graphState &to)
 	return gCost;
 }
 
+/**
+ * Toggles random tiles between ground and out of bounds, repairing a cluster
+ * and a sector abstraction after each change, and compares the average
+ * repair time with the time to build each abstraction from scratch.
+ */
+void MeasureRepairTime(const char *mapName, int clusterSize, int changes)
+{
+	Map *m1 = new Map(mapName);
+	Map *m2 = new Map(mapName);
+	ClusterAbstraction ca(m1, clusterSize);
+	MapSectorAbstraction msa(m2, clusterSize, 2);
+	ca.SetRepairOnMapChange(true);
+	msa.SetRepairOnMapChange(true);
+
+	double clusterRepair = 0, sectorRepair = 0;
+	for (int x = 0; x < changes; x++)
+	{
+		int tx, ty;
+		do {
+			tx = random()%m1->GetMapWidth();
+			ty = random()%m1->GetMapHeight();
+		} while ((m1->GetTerrainType(tx, ty) != kGround) && (m1->GetTerrainType(tx, ty) != kOutOfBounds));
+		tTerrain t = (m1->GetTerrainType(tx, ty) == kGround)?kOutOfBounds:kGround;
+		m1->SetTerrainType(tx, ty, t);
+		m2->SetTerrainType(tx, ty, t);
+		ca.RepairAbstraction();
+		msa.RepairAbstraction();
+		clusterRepair += ca.GetRepairTime();
+		sectorRepair += msa.GetRepairTime();
+	}
+	ClusterAbstraction caBuild(m1->Clone(), clusterSize);
+	MapSectorAbstraction msaBuild(m2->Clone(), clusterSize, 2);
+	printf("map\tabstraction\tchanges\trepair\tbuild\tspeedup\n");
+	printf("%s\tcluster\t%d\t%f\t%f\t%f\n", mapName, changes, clusterRepair/changes,
+		   caBuild.GetBuildTime(), caBuild.GetBuildTime()*changes/clusterRepair);
+	printf("%s\tsector\t%d\t%f\t%f\t%f\n", mapName, changes, sectorRepair/changes,
+		   msaBuild.GetBuildTime(), msaBuild.GetBuildTime()*changes/sectorRepair);
+}
+
+void MeasureClusterBuildTime(const char *mapName, int clusterSize, int threads, int maxSize)
+{
+	printf("map\tsize\tthreads\tserial\tparallel\tspeedup\n");
+	for (int size = 256; size <= maxSize; size *= 2)
+	{
+		Map *m = new Map(mapName);
+		m->Scale(size, size);
+		ClusterAbstraction serial(m->Clone(), clusterSize, 1);
+		ClusterAbstraction parallel(m, clusterSize, threads);
+		printf("%s\t%d\t%d\t%f\t%f\t%f\n", mapName, size, threads, serial.GetBuildTime(),
+			   parallel.GetBuildTime(), serial.GetBuildTime()/parallel.GetBuildTime());
+	}
+}
+
+template <class state, class action, class environment>
+void CompareFringeSearch(const char *envName, environment *e, ScenarioLoader &sl)
+{
+	TemplateAStar<state, action, environment> astar;
+	TemplateFringeSearch<state, action, environment> fringe;
+	std::vector<state> thePath;
+	double astarTime = 0, fringeTime = 0;
+	uint64_t astarNodes = 0, fringeNodes = 0;
+	int mismatches = 0;
+	for (int x = 0; x < sl.GetNumExperiments(); x++)
+	{
+		state from, to;
+		from.x = sl.GetNthExperiment(x).GetStartX();
+		from.y = sl.GetNthExperiment(x).GetStartY();
+		to.x = sl.GetNthExperiment(x).GetGoalX();
+		to.y = sl.GetNthExperiment(x).GetGoalY();
+		Timer t;
+		t.StartTimer();
+		astar.GetPath(e, from, to, thePath);
+		t.EndTimer();
+		astarTime += t.GetElapsedTime();
+		astarNodes += astar.GetNodesExpanded();
+		double astarLength = e->GetPathLength(thePath);
+		t.StartTimer();
+		fringe.GetPath(e, from, to, thePath);
+		t.EndTimer();
+		fringeTime += t.GetElapsedTime();
+		fringeNodes += fringe.GetNodesExpanded();
+		if (!fequal(astarLength, e->GetPathLength(thePath)))
+			mismatches++;
+	}
+	printf("%s\t%s\t%d\t%f\t%llu\t%f\t%llu\t%d\n", sl.GetNthExperiment(0).GetMapName(), envName,
+		   sl.GetNumExperiments(), astarTime, (unsigned long long)astarNodes, fringeTime, (unsigned long long)fringeNodes, mismatches);
+}
+
+void MeasureFringeSearch(const char *scenario)
+{
+	ScenarioLoader sl(scenario);
+	if (sl.GetNumExperiments() == 0)
+		return;
+	Map *map = new Map(sl.GetNthExperiment(0).GetMapName());
+	map->Scale(sl.GetNthExperiment(0).GetXScale(), sl.GetNthExperiment(0).GetYScale());
+	MapEnvironment me(map);
+	me.SetEightConnected();
+	CanonicalGrid::CanonicalGrid cg(map);
+	printf("map\tenv\tproblems\tastar\tastar-nodes\tfringe\tfringe-nodes\tmismatches\n");
+	CompareFringeSearch<xyLoc, tDirection, MapEnvironment>("MapEnvironment", &me, sl);
+	CompareFringeSearch<CanonicalGrid::xyLoc, CanonicalGrid::tDirection, CanonicalGrid::CanonicalGrid>("CanonicalGrid", &cg, sl);
+}
+
+/** Moves every unit along partial paths until all are at their goals; returns the total path length */
+double RunPathCacheUnits(MapAbstraction *aMap, AbstractPathCache *cache, const std::vector<node *> &starts,
+						 const std::vector<node *> &goals, double &time, uint64_t &nodes)
+{
+	praStar pra;
+	pra.setPartialPathLimit(4);
+	pra.setSharedCache(cache);
+	std::vector<node *> locs(starts);
+	double length = 0;
+	time = 0;
+	nodes = 0;
+	Timer t;
+	for (bool moving = true; moving; )
+	{
+		moving = false;
+		for (unsigned int x = 0; x < locs.size(); x++)
+		{
+			if (locs[x] == goals[x])
+				continue;
+			t.StartTimer();
+			class path *p = pra.GetPath(aMap, locs[x], goals[x]);
+			time += t.EndTimer();
+			nodes += pra.GetNodesExpanded();
+			if (p == 0)
+			{
+				locs[x] = goals[x];
+				continue;
+			}
+			length += aMap->distance(p);
+			locs[x] = p->tail()->n;
+			moving = true;
+			delete p;
+		}
+	}
+	return length;
+}
+
+void MeasurePathCache(const char *mapName, int numUnits, int numGroups)
+{
+	Map *map = new Map(mapName);
+	MapCliqueAbstraction aMap(map);
+	Graph *g = aMap.GetAbstractGraph(0);
+	srandom(1);
+	// each group starts around one node and heads to the area around another
+	int level = std::min(2, (int)aMap.getNumAbstractGraphs()-1);
+	std::vector<node *> starts, goals;
+	for (int x = 0; x < numGroups; x++)
+	{
+		node *from, *to;
+		do {
+			from = g->GetRandomNode();
+			to = g->GetRandomNode();
+		} while (!aMap.Pathable(from, to));
+		for (int y = x; y < numUnits; y += numGroups)
+		{
+			node *a = aMap.GetRandomGroundNodeFromNode(aMap.GetNthParent(from, level));
+			node *b = aMap.GetRandomGroundNodeFromNode(aMap.GetNthParent(to, level));
+			starts.push_back(a);
+			goals.push_back(b);
+		}
+	}
+	AbstractPathCache cache(&aMap);
+	StatCollection stats;
+	double uncachedTime, cachedTime;
+	uint64_t uncachedNodes, cachedNodes;
+	double uncachedLength = RunPathCacheUnits(&aMap, 0, starts, goals, uncachedTime, uncachedNodes);
+	double cachedLength = RunPathCacheUnits(&aMap, &cache, starts, goals, cachedTime, cachedNodes);
+	cache.LogStats(&stats, "PRA*(4)");
+	statValue hits, misses, evictions;
+	hits.lval = misses.lval = evictions.lval = 0;
+	stats.LookupStat("pathCacheHits", "PRA*(4)", hits);
+	stats.LookupStat("pathCacheMisses", "PRA*(4)", misses);
+	stats.LookupStat("pathCacheEvictions", "PRA*(4)", evictions);
+	printf("map\tunits\tgroups\tuncached\tuncached-nodes\tcached\tcached-nodes\thits\tmisses\tevictions\tsame-paths\n");
+	printf("%s\t%d\t%d\t%f\t%llu\t%f\t%llu\t%ld\t%ld\t%ld\t%s\n", mapName, (int)starts.size(), numGroups,
+		   uncachedTime, (unsigned long long)uncachedNodes, cachedTime, (unsigned long long)cachedNodes, hits.lval, misses.lval,
+		   evictions.lval, fequal(uncachedLength, cachedLength)?"yes":"no");
+}
+
+/** Approximate bytes used by the nodes, edges, labels and edge lists from level first up */
+uint64_t GetAbstractionBytes(GraphAbstraction *aMap, unsigned int first)
+{
+	uint64_t bytes = 0;
+	for (unsigned int x = first; x < aMap->getNumAbstractGraphs(); x++)
+	{
+		Graph *g = aMap->GetAbstractGraph(x);
+		node_iterator ni = g->getNodeIter();
+		for (node *n = g->nodeIterNext(ni); n; n = g->nodeIterNext(ni))
+			bytes += sizeof(node)+sizeof(node *)+n->GetNumLabels()*sizeof(labelValue);
+		edge_iterator ei = g->getEdgeIter();
+		// each edge is in the graph's list and in two lists at each end
+		for (edge *e = g->edgeIterNext(ei); e; e = g->edgeIterNext(ei))
+			bytes += sizeof(edge)+5*sizeof(edge *)+e->GetNumLabels()*sizeof(labelValue);
+	}
+	return bytes;
+}
+
+void MeasureMinimalSector(const char *scenario, int sectorSize)
+{
+	ScenarioLoader sl(scenario);
+	if (sl.GetNumExperiments() == 0)
+		return;
+	Map *map = new Map(sl.GetNthExperiment(0).GetMapName());
+	map->Scale(sl.GetNthExperiment(0).GetXScale(), sl.GetNthExperiment(0).GetYScale());
+	MinimalSectorAbstraction minimal(map, sectorSize);
+	MapSectorAbstraction sectors(map, sectorSize);
+	MapEnvironment me(map);
+	praStar pra;
+
+	double minimalTime = 0, praTime = 0;
+	double minimalLength = 0, praLength = 0, optimalLength = 0;
+	uint64_t minimalNodes = 0, praNodes = 0;
+	int failures = 0;
+	for (int x = 0; x < sl.GetNumExperiments(); x++)
+	{
+		xyLoc from, to;
+		from.x = sl.GetNthExperiment(x).GetStartX();
+		from.y = sl.GetNthExperiment(x).GetStartY();
+		to.x = sl.GetNthExperiment(x).GetGoalX();
+		to.y = sl.GetNthExperiment(x).GetGoalY();
+		Timer t;
+		t.StartTimer();
+		minimal.GetPath(from, to, path);
+		minimalTime += t.EndTimer();
+		minimalNodes += minimal.GetNodesExpanded();
+		t.StartTimer();
+		class path *p = pra.GetPath(&sectors, sectors.GetNodeFromMap(from.x, from.y), sectors.GetNodeFromMap(to.x, to.y));
+		praTime += t.EndTimer();
+		praNodes += pra.GetNodesExpanded();
+		if (path.size() == 0 || p == 0)
+		{
+			failures++;
+			delete p;
+			continue;
+		}
+		minimalLength += me.GetPathLength(path);
+		praLength += sectors.distance(p);
+		optimalLength += sl.GetNthExperiment(x).GetDistance();
+		delete p;
+	}
+
+	double cells = map->GetMapWidth()*map->GetMapHeight();
+	uint64_t sectorBytes = GetAbstractionBytes(&sectors, 0);
+	uint64_t sectorAbstractBytes = GetAbstractionBytes(&sectors, 1);
+	printf("map\tsectorSize\tabstraction\tbytes/cell\tabstract-bytes/cell\tcache-bytes/cell\n");
+	printf("%s\t%d\tMinimalSector\t%f\t%f\t%f\n", sl.GetNthExperiment(0).GetMapName(), sectorSize,
+		   (minimal.GetAbstractionBytesUsed()+minimal.GetCacheBytesUsed())/cells,
+		   minimal.GetAbstractionBytesUsed()/cells, minimal.GetCacheBytesUsed()/cells);
+	printf("%s\t%d\tMapSector\t%f\t%f\t%f\n", sl.GetNthExperiment(0).GetMapName(), sectorSize,
+		   sectorBytes/cells, sectorAbstractBytes/cells, 0.0);
+	printf("map\tproblems\tminimal\tminimal-nodes\tminimal-subopt\tpra\tpra-nodes\tpra-subopt\tfailures\n");
+	printf("%s\t%d\t%f\t%llu\t%f\t%f\t%llu\t%f\t%d\n", sl.GetNthExperiment(0).GetMapName(),
+		   sl.GetNumExperiments(), minimalTime, (unsigned long long)minimalNodes, minimalLength/optimalLength,
+		   praTime, (unsigned long long)praNodes, praLength/optimalLength, failures);
+}
+
+void MeasureMapCorridor(const char *scenario, int level)
+{
+	ScenarioLoader sl(scenario);
+	if (sl.GetNumExperiments() == 0)
+		return;
+	Map *map = new Map(sl.GetNthExperiment(0).GetMapName());
+	map->Scale(sl.GetNthExperiment(0).GetXScale(), sl.GetNthExperiment(0).GetYScale());
+	MapCliqueAbstraction aMap(map);
+	MapEnvironment me(map);
+	level = std::min(level, (int)aMap.getNumAbstractGraphs()-1);
+	corridorAStar cAStar;
+	MapCorridorAStar mca;
+
+	double graphTime = 0, gridTime = 0;
+	uint64_t graphNodes = 0, gridNodes = 0, corridorCells = 0, corridorArea = 0;
+	int problems = 0, same = 0, failures = 0;
+	std::vector<node *> corridor;
+	for (int x = 0; x < sl.GetNumExperiments(); x++)
+	{
+		xyLoc from, to;
+		from.x = sl.GetNthExperiment(x).GetStartX();
+		from.y = sl.GetNthExperiment(x).GetStartY();
+		to.x = sl.GetNthExperiment(x).GetGoalX();
+		to.y = sl.GetNthExperiment(x).GetGoalY();
+		node *start = aMap.GetNodeFromMap(from.x, from.y);
+		node *goal = aMap.GetNodeFromMap(to.x, to.y);
+		class path *abstractPath = cAStar.GetPath(&aMap, aMap.GetNthParent(start, level), aMap.GetNthParent(goal, level));
+		if (abstractPath == 0)
+			continue;
+		corridor.resize(0);
+		for (class path *p = abstractPath; p; p = p->next)
+			corridor.push_back(p->n);
+		problems++;
+
+		Timer t;
+		t.StartTimer();
+		cAStar.setCorridor(&corridor);
+		class path *p = cAStar.GetPath(&aMap, start, goal);
+		graphTime += t.EndTimer();
+		graphNodes += cAStar.GetNodesExpanded();
+
+		t.StartTimer();
+		mca.SetCorridor(&aMap, abstractPath);
+		mca.GetPath(&me, from, to, path);
+		gridTime += t.EndTimer();
+		gridNodes += mca.GetNodesExpanded();
+		corridorCells += mca.GetCorridorSize();
+		corridorArea += mca.GetCorridorArea();
+
+		if ((p == 0) || (path.size() == 0) || (p->tail()->n != goal))
+			failures++;
+		else if (fequal(aMap.distance(p), me.GetPathLength(path)))
+			same++;
+		delete p;
+		delete abstractPath;
+	}
+	printf("map\tlevel\tproblems\tcorridorAStar\tcorridorAStar-nodes\tMapCorridorAStar\tMapCorridorAStar-nodes\tcells\tarea\tsame-length\tfailures\n");
+	printf("%s\t%d\t%d\t%f\t%llu\t%f\t%llu\t%llu\t%llu\t%d\t%d\n", sl.GetNthExperiment(0).GetMapName(), level,
+		   problems, graphTime, (unsigned long long)graphNodes, gridTime, (unsigned long long)gridNodes, (unsigned long long)corridorCells, (unsigned long long)corridorArea,
+		   same, failures);
+}
+
+void MeasureCSRPRAStar(const char *mapName, int numQueries)
+{
+	Map *map = new Map(mapName);
+	MapCliqueAbstraction aMap(map);
+	Timer t;
+	t.StartTimer();
+	CSRAbstraction csr(&aMap);
+	double csrBuildTime = t.EndTimer();
+	Graph *g = aMap.GetAbstractGraph(0);
+	srandom(1);
+	std::vector<std::pair<node *, node *> > queries;
+	while ((int)queries.size() < numQueries)
+	{
+		node *from = g->GetRandomNode(), *to = g->GetRandomNode();
+		if ((from != to) && aMap.Pathable(from, to))
+			queries.push_back(std::pair<node *, node *>(from, to));
+	}
+
+	praStar pra;
+	CSRPRAStar csrPra(&csr);
+	std::vector<std::vector<uint32_t> > praPaths(queries.size());
+	double praTime = 0, csrTime = 0;
+	uint64_t praNodes = 0, csrNodes = 0;
+	for (unsigned int x = 0; x < queries.size(); x++)
+	{
+		t.StartTimer();
+		class path *p = pra.GetPath(&aMap, queries[x].first, queries[x].second);
+		praTime += t.EndTimer();
+		praNodes += pra.GetNodesExpanded();
+		for (class path *q = p; q; q = q->next)
+			praPaths[x].push_back(q->n->GetNum());
+		delete p;
+	}
+	int mismatches = 0;
+	std::vector<uint32_t> thePath;
+	for (unsigned int x = 0; x < queries.size(); x++)
+	{
+		t.StartTimer();
+		csrPra.GetPath(queries[x].first->GetNum(), queries[x].second->GetNum(), thePath);
+		csrTime += t.EndTimer();
+		csrNodes += csrPra.GetNodesExpanded();
+		if (thePath != praPaths[x])
+			mismatches++;
+	}
+	printf("map\tqueries\tpra\tpra-nodes\tcsr\tcsr-nodes\tmismatches\tgraph-bytes\tcsr-bytes\tcsr-build\n");
+	printf("%s\t%d\t%f\t%llu\t%f\t%llu\t%d\t%llu\t%llu\t%f\n", mapName, (int)queries.size(),
+		   praTime, (unsigned long long)praNodes, csrTime, (unsigned long long)csrNodes, mismatches,
+		   (unsigned long long)GetAbstractionBytes(&aMap, 0), (unsigned long long)csr.GetMemoryUsage(), csrBuildTime);
+}
+
+void MeasureThetaStar(const char *scenario)
+{
+	ScenarioLoader sl(scenario);
+	if (sl.GetNumExperiments() == 0)
+		return;
+	Map *map = new Map(sl.GetNthExperiment(0).GetMapName());
+	map->Scale(sl.GetNthExperiment(0).GetXScale(), sl.GetNthExperiment(0).GetYScale());
+	MapEnvironment me(map);
+	me.SetEightConnected();
+	TemplateAStar<xyLoc, tDirection, MapEnvironment> astar;
+	MapThetaStar theta(map);
+
+	printf("map\talgorithm\tproblems\ttime\tnodes\tlos-checks\tlength\tlength/astar\tfailures\n");
+	double astarTime = 0, astarLength = 0;
+	uint64_t astarNodes = 0;
+	int problems = 0;
+	for (int x = 0; x < sl.GetNumExperiments(); x++)
+	{
+		xyLoc from(sl.GetNthExperiment(x).GetStartX(), sl.GetNthExperiment(x).GetStartY());
+		xyLoc to(sl.GetNthExperiment(x).GetGoalX(), sl.GetNthExperiment(x).GetGoalY());
+		if (from == to)
+			continue;
+		Timer t;
+		t.StartTimer();
+		astar.GetPath(&me, from, to, path);
+		astarTime += t.EndTimer();
+		astarNodes += astar.GetNodesExpanded();
+		astarLength += me.GetPathLength(path);
+		problems++;
+	}
+	printf("%s\tA*\t%d\t%f\t%llu\t0\t%f\t1.000000\t0\n", sl.GetNthExperiment(0).GetMapName(), problems,
+		   astarTime, (unsigned long long)astarNodes, astarLength);
+
+	for (int lazy = 0; lazy < 2; lazy++)
+	{
+		theta.SetLazy(lazy);
+		double time = 0, length = 0;
+		uint64_t nodes = 0, checks = 0;
+		int failures = 0;
+		for (int x = 0; x < sl.GetNumExperiments(); x++)
+		{
+			xyLoc from(sl.GetNthExperiment(x).GetStartX(), sl.GetNthExperiment(x).GetStartY());
+			xyLoc to(sl.GetNthExperiment(x).GetGoalX(), sl.GetNthExperiment(x).GetGoalY());
+			if (from == to)
+				continue;
+			Timer t;
+			t.StartTimer();
+			theta.GetPath(from, to, path);
+			time += t.EndTimer();
+			nodes += theta.GetNodesExpanded();
+			checks += theta.GetLineOfSightChecks();
+			if ((path.size() == 0) || (path.back() != to))
+				failures++;
+			length += MapThetaStar::GetPathLength(path);
+		}
+		printf("%s\t%s\t%d\t%f\t%llu\t%llu\t%f\t%f\t%d\n", sl.GetNthExperiment(0).GetMapName(), lazy?"LazyTheta*":"Theta*",
+			   problems, time, (unsigned long long)nodes, (unsigned long long)checks, length, length/astarLength, failures);
+	}
+}
+
+/** Steps SearchUnits towards fixed targets until all arrive or maxSteps pass; returns the steps taken */
+int RunBatchRefinementUnits(MapAbstraction *aMap, BatchRefinement *batch, const std::vector<node *> &starts,
+							const std::vector<node *> &goals, int maxSteps, std::vector<xyLoc> &final, double &time)
+{
+	AbsMapEnvironment env(aMap);
+	UnitSimulation<xyLoc, tDirection, AbsMapEnvironment> sim(&env);
+	sim.SetStepType(kLockStep);
+	sim.SetLogStats(false);
+	std::vector<SearchUnit *> units;
+	for (unsigned int x = 0; x < starts.size(); x++)
+	{
+		int fromX, fromY, toX, toY;
+		aMap->GetTileFromNode(starts[x], fromX, fromY);
+		aMap->GetTileFromNode(goals[x], toX, toY);
+		// the targets have no target of their own, so they never move
+		SearchUnit *target = new SearchUnit(toX, toY, 0, 0);
+		SearchUnit *unit = new SearchUnit(fromX, fromY, target, new IRDijkstra());
+		unit->SetBatchRefinement(batch);
+		sim.AddUnit(target);
+		sim.AddUnit(unit);
+		units.push_back(unit);
+	}
+	Timer t;
+	t.StartTimer();
+	int steps = 0;
+	for (bool moving = true; moving && (steps < maxSteps); steps++)
+	{
+		sim.StepTime(1.0);
+		moving = false;
+		for (unsigned int x = 0; x < units.size(); x++)
+			if (!units[x]->Done())
+				moving = true;
+	}
+	time = t.EndTimer();
+	final.resize(0);
+	for (unsigned int x = 0; x < units.size(); x++)
+	{
+		xyLoc l;
+		units[x]->GetLocation(l);
+		final.push_back(l);
+	}
+	return steps;
+}
+
+void MeasureBatchRefinement(const char *mapName, int numUnits, int numThreads)
+{
+	Map *map = new Map(mapName);
+	MapCliqueAbstraction aMap(map);
+	Graph *g = aMap.GetAbstractGraph(0);
+	srandom(1);
+	std::vector<node *> starts, goals;
+	for (int x = 0; x < numUnits; x++)
+	{
+		node *from, *to;
+		do {
+			from = g->GetRandomNode();
+			to = g->GetRandomNode();
+		} while ((from == to) || !aMap.Pathable(from, to));
+		starts.push_back(from);
+		goals.push_back(to);
+	}
+	int maxSteps = 4*(map->GetMapWidth()+map->GetMapHeight());
+	std::vector<xyLoc> serialFinal, batchFinal;
+	double serialTime, batchTime;
+	int serialSteps = RunBatchRefinementUnits(&aMap, 0, starts, goals, maxSteps, serialFinal, serialTime);
+	BatchRefinement batch([]() -> SearchAlgorithm * { return new IRDijkstra(); }, numThreads);
+	int batchSteps = RunBatchRefinementUnits(&aMap, &batch, starts, goals, maxSteps, batchFinal, batchTime);
+	int same = 0;
+	for (unsigned int x = 0; x < serialFinal.size(); x++)
+		if (serialFinal[x] == batchFinal[x])
+			same++;
+	printf("map\tunits\tthreads\tserial\tserial-steps\tbatch\tbatch-steps\tbatch-nodes\tsame-locations\n");
+	printf("%s\t%d\t%d\t%f\t%d\t%f\t%d\t%llu\t%d\n", mapName, numUnits, batch.GetNumThreads(), serialTime, serialSteps,
+		   batchTime, batchSteps, (unsigned long long)batch.GetNodesExpanded(), same);
+}
+
 void testHeuristic(char *problems)
 {
 	TemplateAStar<xyLoc, tDirection, MapEnvironment> searcher;
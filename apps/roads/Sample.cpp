@@ -43,6 +43,7 @@
 #include "MapGenerators.h"
 #include "FPUtil.h"
 #include "CanonicalGrid.h"
+#include "ContractionHierarchy.h"
 
 bool screenShot = false;
 bool recording = false;
@@ -56,6 +57,7 @@ point3d lineStart, lineEnd;
 std::string graphFile, coordinatesFile;
 
 void LoadGraph();
+void CHExperiments(const char *hierarchyFile, int numQueries);
 
 GraphDistanceHeuristic *gdh = 0;
 GraphEnvironment *ge = 0;
@@ -95,6 +97,7 @@ void InstallHandlers()
 	
 	InstallCommandLineHandler(MyCLHandler, "-graph", "-graph <filename>", "Specifies file name for graph. Both graph and coordinates must be supplied.");
 	InstallCommandLineHandler(MyCLHandler, "-coord", "-coord <filename>", "Specifies file name for coordinates. Both graph and coordinates must be supplied.");
+	InstallCommandLineHandler(MyCLHandler, "-ch", "-ch <hierarchy> <queries>", "Builds (or loads) a contraction hierarchy for the graph and measures query throughput. -graph and -coord must come first.");
 
 	InstallWindowHandler(MyWindowHandler);
 
@@ -184,6 +187,13 @@ int MyCLHandler(char *argument[], int maxNumArgs)
 		coordinatesFile = argument[1];
 		return 2;
 	}
+	if (strcmp( argument[0], "-ch" ) == 0 )
+	{
+		if (maxNumArgs <= 2)
+			return 0;
+		CHExperiments(argument[1], atoi(argument[2]));
+		exit(0);
+	}
 	return 0;
 }
 
@@ -389,3 +399,65 @@ bool MyClickHandler(unsigned long windowID, int, int, point3d loc, tButtonType b
 	}
 	return false;
 }
+
+void CHExperiments(const char *hierarchyFile, int numQueries)
+{
+	if (graphFile.size() == 0 || coordinatesFile.size() == 0)
+	{
+		printf("Error: -graph and -coord must be given before -ch\n");
+		return;
+	}
+	LoadGraph();
+	Graph *g = ge->GetGraph();
+	ContractionHierarchy ch;
+	Timer t;
+	if (ch.Load(hierarchyFile, g, true))
+	{
+		printf("Loaded hierarchy from '%s'\n", hierarchyFile);
+	}
+	else {
+		ch.Build(g, true);
+		ch.Save(hierarchyFile);
+	}
+	printf("%llu upward edges (%llu shortcuts), %1.2fMB\n", (unsigned long long)ch.GetNumUpwardEdges(),
+		   (unsigned long long)ch.GetNumShortcuts(), ch.GetMemoryUsage()/1024.0/1024.0);
+
+	srandom(1);
+	std::vector<std::pair<graphState, graphState>> queries(numQueries);
+	for (auto &q : queries)
+		q = {g->GetRandomNode()->GetNum(), g->GetRandomNode()->GetNum()};
+
+	// check a few queries against A*
+	int errors = 0;
+	for (int x = 0; x < std::min(numQueries, 20); x++)
+	{
+		std::vector<graphState> path;
+		astar.GetPath(ge, queries[x].first, queries[x].second, path);
+		double chCost = ch.GetDistance(queries[x].first, queries[x].second);
+		double astarCost = (path.size() == 0)?DBL_MAX:ge->GetPathLength(path);
+		if (!fequal(chCost, astarCost))
+		{
+			printf("Error: %llu to %llu; CH %f, A* %f\n", (unsigned long long)queries[x].first,
+				   (unsigned long long)queries[x].second, chCost, astarCost);
+			errors++;
+		}
+	}
+
+	uint64_t expanded = 0;
+	t.StartTimer();
+	for (const auto &q : queries)
+	{
+		ch.GetDistance(q.first, q.second);
+		expanded += ch.GetNodesExpanded();
+	}
+	t.EndTimer();
+	printf("%d queries in %1.3fs: %1.0f queries/sec, %1.1f nodes expanded per query, %d errors\n",
+		   numQueries, t.GetElapsedTime(), numQueries/t.GetElapsedTime(), (double)expanded/numQueries, errors);
+
+	std::vector<graphState> path;
+	t.StartTimer();
+	for (const auto &q : queries)
+		ch.GetPath(q.first, q.second, path);
+	t.EndTimer();
+	printf("%d unpacked paths in %1.3fs: %1.0f queries/sec\n", numQueries, t.GetElapsedTime(), numQueries/t.GetElapsedTime());
+}
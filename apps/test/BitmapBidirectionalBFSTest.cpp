@@ -0,0 +1,136 @@
+//
+//  BitmapBidirectionalBFSTest.cpp
+//  hog2
+//
+//  Checks distances and paths from BitmapBidirectionalBFS against BFS on
+//  the 8-pancake puzzle, with one and several threads.
+//
+
+#include "BitmapBidirectionalBFSTest.h"
+#include <cassert>
+#include <deque>
+#include "BitmapBidirectionalBFS.h"
+#include "BFS.h"
+#include "PancakePuzzle.h"
+
+static const int kNumPancakes = 8;
+
+// BitmapBidirectionalBFS wants the rank first and the number of ranks
+class RankedPancakePuzzle : public PancakePuzzle {
+public:
+	RankedPancakePuzzle() :PancakePuzzle(kNumPancakes) {}
+	void GetStateFromHash(uint64_t hash, PancakePuzzleState &s) const
+	{
+		s = PancakePuzzleState(kNumPancakes);
+		PancakePuzzle::GetStateFromHash(s, hash);
+	}
+	uint64_t GetMaxHash() const
+	{
+		uint64_t count = 1;
+		for (int x = 2; x <= kNumPancakes; x++)
+			count *= x;
+		return count;
+	}
+};
+
+static bool IsNeighbor(RankedPancakePuzzle &env, const PancakePuzzleState &a, const PancakePuzzleState &b)
+{
+	std::vector<PancakePuzzleState> succ;
+	env.GetSuccessors(a, succ);
+	for (unsigned int x = 0; x < succ.size(); x++)
+		if (succ[x] == b)
+			return true;
+	return false;
+}
+
+/** Number of states at each depth from s */
+static void GetLayerSizes(RankedPancakePuzzle &env, const PancakePuzzleState &s, std::vector<uint64_t> &layers)
+{
+	std::vector<int> depth(env.GetMaxHash(), -1);
+	std::deque<uint64_t> q;
+	std::vector<PancakePuzzleState> succ;
+	PancakePuzzleState next;
+	layers.resize(0);
+	depth[env.GetStateHash(s)] = 0;
+	q.push_back(env.GetStateHash(s));
+	while (!q.empty())
+	{
+		uint64_t rank = q.front();
+		q.pop_front();
+		if ((int)layers.size() <= depth[rank])
+			layers.push_back(0);
+		layers[depth[rank]]++;
+		env.GetStateFromHash(rank, next);
+		env.GetSuccessors(next, succ);
+		for (unsigned int x = 0; x < succ.size(); x++)
+		{
+			uint64_t r = env.GetStateHash(succ[x]);
+			if (depth[r] == -1)
+			{
+				depth[r] = depth[rank]+1;
+				q.push_back(r);
+			}
+		}
+	}
+}
+
+/**
+ * Replays the choice of frontier made by the search. If every state is
+ * expanded once, the search expands exactly the layers chosen here.
+ */
+static uint64_t GetExpectedExpansions(const std::vector<uint64_t> &forward, const std::vector<uint64_t> &backward,
+									  int distance)
+{
+	uint64_t forwardSize = 1, backwardSize = 1, expanded = 0;
+	int forwardDepth = 0, backwardDepth = 0;
+	while (forwardDepth+backwardDepth < distance)
+	{
+		if (forwardSize <= backwardSize)
+		{
+			expanded += forward[forwardDepth++];
+			forwardSize = forward[forwardDepth];
+		}
+		else {
+			expanded += backward[backwardDepth++];
+			backwardSize = backward[backwardDepth];
+		}
+	}
+	return expanded;
+}
+
+void BitmapBidirectionalBFSTest()
+{
+	printf("[BitmapBidirectionalBFS test] Starting...\n");
+	RankedPancakePuzzle env;
+	BFS<PancakePuzzleState, PancakePuzzleAction> bfs;
+	std::vector<PancakePuzzleState> bfsPath, path;
+	std::vector<uint64_t> forwardLayers, backwardLayers;
+	uint64_t numStates = env.GetMaxHash();
+
+	srandom(26);
+	for (int threads = 1; threads <= 4; threads += 3)
+	{
+		BitmapBidirectionalBFS<PancakePuzzleState, PancakePuzzleAction, RankedPancakePuzzle> search(threads);
+		for (int x = 0; x < 20; x++)
+		{
+			PancakePuzzleState from, to;
+			env.GetStateFromHash(random()%numStates, from);
+			env.GetStateFromHash(random()%numStates, to);
+			bfs.GetPath(&env, from, to, bfsPath);
+			int distance = (int)bfsPath.size()-1;
+
+			assert(search.GetDistance(&env, from, to) == distance);
+			// no state is expanded twice by the same search
+			GetLayerSizes(env, from, forwardLayers);
+			GetLayerSizes(env, to, backwardLayers);
+			assert(search.GetNodesExpanded() == GetExpectedExpansions(forwardLayers, backwardLayers, distance));
+
+			search.GetPath(&env, from, to, path);
+			assert((int)path.size() == distance+1);
+			assert(path.front() == from && path.back() == to);
+			for (unsigned int y = 1; y < path.size(); y++)
+				assert(IsNeighbor(env, path[y-1], path[y]));
+		}
+	}
+	printf("[BitmapBidirectionalBFS test] Passed all tests\n");
+}
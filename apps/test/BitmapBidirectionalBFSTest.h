@@ -0,0 +1,12 @@
+//
+//  BitmapBidirectionalBFSTest.h
+//  hog2
+//
+
+#ifndef BitmapBidirectionalBFSTest_h
+#define BitmapBidirectionalBFSTest_h
+
+#include <stdio.h>
+void BitmapBidirectionalBFSTest();
+
+#endif /* BitmapBidirectionalBFSTest_h */
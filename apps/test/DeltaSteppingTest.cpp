@@ -0,0 +1,161 @@
+//
+//  DeltaSteppingTest.cpp
+//  hog2
+//
+//  Checks delta-stepping distances against Dijkstra for several deltas and
+//  thread counts, and its all-pairs distances against FloydWarshall.
+//
+
+#include "DeltaSteppingTest.h"
+#include <cassert>
+#include <queue>
+#include <float.h>
+#include "DeltaStepping.h"
+#include "FloydWarshall.h"
+#include "FPUtil.h"
+
+static Graph *GetRandomGraph(int numNodes, int numEdges, double maxWeight, unsigned int seed)
+{
+	srandom(seed);
+	Graph *g = new Graph();
+	for (int x = 0; x < numNodes; x++)
+		g->AddNode(new node(""));
+	for (int x = 0; x < numEdges; x++)
+	{
+		int from = random()%numNodes;
+		int to = random()%numNodes;
+		// FloydWarshall keeps only the last of several edges between two nodes
+		if (from == to || g->FindEdge(from, to))
+			continue;
+		// weights in [1, maxWeight], not all integral
+		g->AddEdge(new edge(from, to, 1+(random()%1000)*(maxWeight-1)/999.0));
+	}
+	return g;
+}
+
+static void GetDistances(Graph *g, bool directed, graphState from, std::vector<double> &dist)
+{
+	typedef std::pair<double, graphState> entry;
+	std::priority_queue<entry, std::vector<entry>, std::greater<entry> > open;
+	dist.assign(g->GetNumNodes(), DBL_MAX);
+	dist[from] = 0;
+	open.push({0, from});
+	while (!open.empty())
+	{
+		entry next = open.top();
+		open.pop();
+		if (next.first > dist[next.second])
+			continue;
+		node *n = g->GetNode(next.second);
+		edge_iterator ei = n->getEdgeIter();
+		for (edge *e = n->edgeIterNext(ei); e; e = n->edgeIterNext(ei))
+		{
+			if (directed && e->getFrom() != next.second)
+				continue;
+			graphState to = (e->getFrom() == next.second)?e->getTo():e->getFrom();
+			if (next.first+e->GetWeight() < dist[to])
+			{
+				dist[to] = next.first+e->GetWeight();
+				open.push({dist[to], to});
+			}
+		}
+	}
+}
+
+/** Returns the number of distances from the sampled sources that differ from Dijkstra */
+static int CountDifferences(Graph *g, DeltaStepping &ds)
+{
+	std::vector<double> expected, actual;
+	int errors = 0;
+	for (int from = 0; from < g->GetNumNodes(); from += 97)
+	{
+		GetDistances(g, true, from, expected);
+		ds.GetDistances(from, actual);
+		assert(actual.size() == expected.size());
+		for (unsigned int x = 0; x < expected.size(); x++)
+		{
+			if (expected[x] == DBL_MAX || actual[x] == DBL_MAX)
+			{
+				if (expected[x] != actual[x])
+					errors++;
+			}
+			else if (!fequal(expected[x], actual[x]))
+				errors++;
+		}
+	}
+	return errors;
+}
+
+void DeltaSteppingDistancesTest()
+{
+	printf("[delta-stepping test] Starting...\n");
+	// sparse enough that some nodes can't be reached
+	Graph *g = GetRandomGraph(2000, 5000, 100, 11);
+	const double deltas[] = {0, 1, 5, 50, 1000};
+	const int threads[] = {1, 4};
+	for (int t : threads)
+	{
+		for (double d : deltas)
+		{
+			DeltaStepping ds(g, true, d, t);
+			int errors = CountDifferences(g, ds);
+			if (errors != 0)
+			{
+				printf("[delta-stepping test] Error: %d distances differ (delta %f, %d threads)\n", errors, ds.GetDelta(), t);
+				exit(1);
+			}
+		}
+		// more buckets than kMaxBuckets; the delta has to be raised
+		DeltaStepping ds(g, true, 1e-6, t);
+		assert(ds.GetDelta() >= 100.0/DeltaStepping::kMaxBuckets);
+		int errors = CountDifferences(g, ds);
+		if (errors != 0)
+		{
+			printf("[delta-stepping test] Error: %d distances differ (tiny delta, %d threads)\n", errors, t);
+			exit(1);
+		}
+	}
+	printf("[delta-stepping test] Passed all tests\n");
+	delete g;
+}
+
+void DeltaSteppingAllPairsTest()
+{
+	printf("[all-pairs test] Starting...\n");
+	// FloydWarshall treats edges as undirected
+	Graph *g = GetRandomGraph(300, 700, 20, 13);
+	std::vector<std::vector<double> > expected, actual;
+	FloydWarshall(g, expected);
+	const int threads[] = {1, 4};
+	for (int t : threads)
+	{
+		DeltaStepping ds(g, false, 0, t);
+		DistanceMatrix m;
+		ds.GetAllPairs(m);
+		m.CopyTo(actual, 1e10);
+		int errors = 0;
+		for (int x = 0; x < g->GetNumNodes(); x++)
+		{
+			// FloydWarshall leaves the shortest cycle through x on the diagonal
+			if (actual[x][x] != 0)
+				errors++;
+			for (int y = 0; y < g->GetNumNodes(); y++)
+				if (x != y && !fequal(expected[x][y], actual[x][y]))
+					errors++;
+		}
+		if (errors != 0)
+		{
+			printf("[all-pairs test] Error: %d distances differ (%d threads)\n", errors, t);
+			exit(1);
+		}
+	}
+	printf("[all-pairs test] Passed all tests\n");
+	delete g;
+}
+
+void DeltaSteppingTest()
+{
+	DeltaSteppingDistancesTest();
+	DeltaSteppingAllPairsTest();
+	printf("Passed all tests successfully\n");
+}
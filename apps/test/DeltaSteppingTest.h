@@ -0,0 +1,12 @@
+//
+//  DeltaSteppingTest.h
+//  hog2
+//
+
+#ifndef DeltaSteppingTest_h
+#define DeltaSteppingTest_h
+
+#include <stdio.h>
+void DeltaSteppingTest();
+
+#endif /* DeltaSteppingTest_h */
@@ -0,0 +1,146 @@
+//
+//  DistanceTableTest.cpp
+//  hog2
+//
+//  Checks that differential heuristics read back from a DistanceTable
+//  never overestimate the true distances.
+//
+
+#include "DistanceTableTest.h"
+#include <cassert>
+#include <queue>
+#include <float.h>
+#include "GraphEnvironment.h"
+#include "FPUtil.h"
+
+static Graph *GetTestGraph(Map *&m)
+{
+	// octile costs, so most distances aren't multiples of the scale
+	m = new Map(40, 40);
+	srandom(7);
+	for (int y = 0; y < 40; y++)
+		for (int x = 0; x < 40; x++)
+			if (random()%5 == 0)
+				m->SetTerrainType(x, y, kTrees);
+	return GraphSearchConstants::GetEightConnectedGraph(m, false);
+}
+
+static void GetDistances(Graph *g, graphState from, std::vector<double> &dist)
+{
+	typedef std::pair<double, graphState> entry;
+	std::priority_queue<entry, std::vector<entry>, std::greater<entry> > open;
+	dist.assign(g->GetNumNodes(), DBL_MAX);
+	dist[from] = 0;
+	open.push({0, from});
+	while (!open.empty())
+	{
+		entry next = open.top();
+		open.pop();
+		if (next.first > dist[next.second])
+			continue;
+		node *n = g->GetNode(next.second);
+		edge_iterator ei = n->getEdgeIter();
+		for (edge *e = n->edgeIterNext(ei); e; e = n->edgeIterNext(ei))
+		{
+			graphState to = (e->getFrom() == next.second)?e->getTo():e->getFrom();
+			if (next.first+e->GetWeight() < dist[to])
+			{
+				dist[to] = next.first+e->GetWeight();
+				open.push({dist[to], to});
+			}
+		}
+	}
+}
+
+/** Returns the number of pairs where h overestimates the distance */
+static int CountOverestimates(Graph *g, const GraphDistanceHeuristic &h)
+{
+	std::vector<double> dist;
+	int errors = 0;
+	for (int from = 0; from < g->GetNumNodes(); from += 7)
+	{
+		GetDistances(g, from, dist);
+		for (int to = 0; to < g->GetNumNodes(); to++)
+			if (dist[to] != DBL_MAX && fgreater(h.HCost(from, to), dist[to]))
+				errors++;
+	}
+	return errors;
+}
+
+void LoadedHeuristicTest()
+{
+	printf("[loaded heuristic test] Starting...\n");
+	const char *file = "distancetable-test.dat";
+	Map *m;
+	Graph *g = GetTestGraph(m);
+	GraphDistanceHeuristic h(g);
+	h.SetPlacement(kFarPlacement);
+	for (int x = 0; x < 6; x++)
+		h.AddHeuristic();
+	assert(CountOverestimates(g, h) == 0);
+	bool success = h.SaveHeuristics(file, 1.0);
+	assert(success);
+
+	GraphDistanceHeuristic loaded(g);
+	success = loaded.LoadHeuristics(file);
+	assert(success);
+	assert(loaded.GetNumHeuristics() == 6);
+	int errors = CountOverestimates(g, loaded);
+	remove(file);
+	if (errors != 0)
+	{
+		printf("[loaded heuristic test] Error: %d overestimates\n", errors);
+		exit(1);
+	}
+	printf("[loaded heuristic test] Passed all tests\n");
+	delete g;
+	delete m;
+}
+
+void PackedHeuristicTest()
+{
+	printf("[packed heuristic test] Starting...\n");
+	const char *file = "distancetable-packed-test.dat";
+	Map *m;
+	Graph *g = GetTestGraph(m);
+	GraphDistanceHeuristic h(g);
+	h.SetPlacement(kFarPlacement);
+	h.BuildHeuristics(4, 2);
+	// added to the packed heuristics, not ignored
+	h.AddHeuristic();
+	assert(h.GetNumHeuristics() == 5);
+	assert(CountOverestimates(g, h) == 0);
+	bool success = h.SaveHeuristics(file);
+	assert(success);
+
+	GraphDistanceHeuristic loaded(g);
+	success = loaded.LoadHeuristics(file);
+	assert(success);
+	assert(loaded.GetNumHeuristics() == 5);
+	int errors = CountOverestimates(g, loaded);
+	int different = 0;
+	std::vector<double> dist;
+	for (int from = 0; from < g->GetNumNodes(); from += 13)
+	{
+		GetDistances(g, from, dist);
+		for (int to = 0; to < g->GetNumNodes(); to++)
+			if (dist[to] != DBL_MAX && !fequal(h.HCost(from, to), loaded.HCost(from, to)))
+				different++;
+	}
+	remove(file);
+	if (errors != 0 || different != 0)
+	{
+		printf("[packed heuristic test] Error: %d overestimates, %d values differ after loading\n", errors, different);
+		exit(1);
+	}
+	printf("[packed heuristic test] Passed all tests\n");
+	delete g;
+	delete m;
+}
+
+void DistanceTableTest()
+{
+	LoadedHeuristicTest();
+	PackedHeuristicTest();
+	printf("Passed all tests successfully\n");
+}
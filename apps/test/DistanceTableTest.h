@@ -0,0 +1,12 @@
+//
+//  DistanceTableTest.h
+//  hog2
+//
+
+#ifndef DistanceTableTest_h
+#define DistanceTableTest_h
+
+#include <stdio.h>
+void DistanceTableTest();
+
+#endif /* DistanceTableTest_h */
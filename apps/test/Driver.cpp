@@ -1,9 +1,15 @@
 #include "NBitVectorTest.h"
 #include "PDBRankingTest.h"
+#include "DistanceTableTest.h"
+#include "BitmapBidirectionalBFSTest.h"
+#include "DeltaSteppingTest.h"
 
 int main(void)
 {
 	//TestNBitVector();
 
 	PDBRankingTest();
+	DistanceTableTest();
+	BitmapBidirectionalBFSTest();
+	DeltaSteppingTest();
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 //
 
 #include "NBitVectorTest.h"
+#include <cassert>
 #include "NBitArray.h"
 #include "Timer.h"
 #include "FourBitArray.h"
@@ -132,6 +133,88 @@ void CorrectnessTest()
 	printf("[%d bit test] Passed all tests [%1.3f]\n", numBits, t.EndTimer());
 }
 
+template <int numBits>
+void MMapTest()
+{
+	printf("[%d bit mmap test] Starting...\n", numBits);
+	const int arraySize = 1000003;
+	const char *file = "nbitarray-mmap-test.dat";
+	NBitArray<numBits> bitArray(arraySize);
+	bitArray.Clear();
+	for (int y = 0; y < arraySize; y++)
+		bitArray.Set(y, y*7);
+	FILE *f = fopen(file, "w+b");
+	assert(f != 0);
+	// write twice to test mapping at an offset
+	bitArray.Write(f);
+	bitArray.Write(f);
+	fclose(f);
+
+	NBitArray<numBits> mapped, mappedOffset;
+	bool success = mapped.MMap(file);
+	assert(success);
+	success = mappedOffset.MMap(file, bitArray.GetFileSize());
+	assert(success);
+	assert(mapped.Size() == arraySize);
+	assert(mappedOffset.Size() == arraySize);
+	for (int y = 0; y < arraySize; y++)
+	{
+		assert(mapped.Get(y) == bitArray.Get(y));
+		assert(mappedOffset.Get(y) == bitArray.Get(y));
+	}
+	remove(file);
+	printf("[%d bit mmap test] Passed all tests\n", numBits);
+}
+
+/** Overwrites the two header words of an array written at the start of file */
+static void WriteHeader(const char *file, uint64_t entries, uint64_t memorySize)
+{
+	FILE *f = fopen(file, "r+b");
+	assert(f != 0);
+	uint64_t header[2] = {entries, memorySize};
+	size_t written = fwrite(header, sizeof(uint64_t), 2, f);
+	assert(written == 2);
+	fclose(f);
+}
+
+template <int numBits>
+void MMapCorruptTest()
+{
+	printf("[%d bit corrupt mmap test] Starting...\n", numBits);
+	const int arraySize = 1000;
+	const char *file = "nbitarray-corrupt-test.dat";
+	NBitArray<numBits> bitArray(arraySize);
+	bitArray.Clear();
+	bool success = bitArray.Write(file);
+	assert(success);
+	uint64_t memorySize = (arraySize*numBits+63)/64;
+
+	NBitArray<numBits> mapped;
+	success = mapped.MMap(file);
+	assert(success);
+	success = mapped.MMap(file, bitArray.GetFileSize());
+	assert(!success);
+	success = mapped.MMap(file, bitArray.GetFileSize()+64);
+	assert(!success);
+	success = mapped.MMap(file, 8);
+	assert(!success);
+	// memorySize*8 wraps around to 0
+	WriteHeader(file, arraySize, 1ull<<61);
+	success = mapped.MMap(file);
+	assert(!success);
+	WriteHeader(file, arraySize, memorySize+1);
+	success = mapped.MMap(file);
+	assert(!success);
+	WriteHeader(file, memorySize*64/numBits+1, memorySize);
+	success = mapped.MMap(file);
+	assert(!success);
+	WriteHeader(file, memorySize*64/numBits, memorySize);
+	success = mapped.MMap(file);
+	assert(success);
+	remove(file);
+	printf("[%d bit corrupt mmap test] Passed all tests\n", numBits);
+}
+
 void TestNBitVector()
 {
 	TimingTest();
@@ -200,5 +283,12 @@ void TestNBitVector()
 	CorrectnessTest<62>();
 	CorrectnessTest<63>();
 	CorrectnessTest<64>();
+	MMapTest<1>();
+	MMapTest<5>();
+	MMapTest<8>();
+	MMapTest<64>();
+	MMapCorruptTest<1>();
+	MMapCorruptTest<5>();
+	MMapCorruptTest<64>();
 	printf("Passed all tests successfully\n");
 }
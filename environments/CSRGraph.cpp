@@ -0,0 +1,224 @@
+/*
+ *  CSRGraph.cpp
+ *  hog2
+ *
+ *  An immutable graph in compressed sparse row (CSR) form.
+ *
+ */
+
+#include "CSRGraph.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <float.h>
+#include "GraphEnvironment.h"
+
+const uint64_t CSRGraph::kNoEdge;
+
+CSRGraph::CSRGraph()
+:minWeight(0)
+{
+}
+
+void CSRGraph::BuildFromArcs(uint32_t numNodes, std::vector<arc> &arcs)
+{
+	// counting sort by source, then sort each node's edges by target
+	first.assign(numNodes+1, 0);
+	for (const arc &a : arcs)
+		first[a.from+1]++;
+	for (uint32_t x = 0; x < numNodes; x++)
+		first[x+1] += first[x];
+	std::vector<uint64_t> next(first.begin(), first.end()-1);
+	targets.resize(arcs.size());
+	weights.resize(arcs.size());
+	for (const arc &a : arcs)
+	{
+		uint64_t e = next[a.from]++;
+		targets[e] = a.to;
+		weights[e] = a.weight;
+	}
+	std::vector<arc>().swap(arcs);
+
+	// merge parallel edges, keeping the cheapest
+	std::vector<std::pair<uint32_t, double> > edges;
+	uint64_t write = 0;
+	minWeight = DBL_MAX;
+	for (uint32_t n = 0; n < numNodes; n++)
+	{
+		edges.resize(0);
+		for (uint64_t e = first[n]; e < first[n+1]; e++)
+			edges.push_back({targets[e], weights[e]});
+		std::sort(edges.begin(), edges.end());
+		first[n] = write;
+		for (uint64_t x = 0; x < edges.size(); x++)
+		{
+			if (x > 0 && edges[x].first == edges[x-1].first)
+				continue;
+			targets[write] = edges[x].first;
+			weights[write] = edges[x].second;
+			minWeight = std::min(minWeight, edges[x].second);
+			write++;
+		}
+	}
+	first[numNodes] = write;
+	targets.resize(write);
+	targets.shrink_to_fit();
+	weights.resize(write);
+	weights.shrink_to_fit();
+	if (write == 0)
+		minWeight = 0;
+}
+
+void CSRGraph::Build(Graph *g, bool directed)
+{
+	std::vector<arc> arcs;
+	arcs.reserve(directed?g->GetNumEdges():2*g->GetNumEdges());
+	for (int x = 0; x < g->GetNumEdges(); x++)
+	{
+		edge *e = g->GetEdge(x);
+		arcs.push_back({e->getFrom(), e->getTo(), e->GetWeight()});
+		if (!directed)
+			arcs.push_back({e->getTo(), e->getFrom(), e->GetWeight()});
+	}
+	BuildFromArcs(g->GetNumNodes(), arcs);
+
+	xs.resize(0);
+	ys.resize(0);
+	if (g->GetNumNodes() > 0 && g->GetNode(0)->GetLabelF(GraphSearchConstants::kYCoordinate) != MAXINT)
+	{
+		xs.resize(g->GetNumNodes());
+		ys.resize(g->GetNumNodes());
+		for (int x = 0; x < g->GetNumNodes(); x++)
+		{
+			xs[x] = g->GetNode(x)->GetLabelF(GraphSearchConstants::kXCoordinate);
+			ys[x] = g->GetNode(x)->GetLabelF(GraphSearchConstants::kYCoordinate);
+		}
+	}
+}
+
+void CSRGraph::Build(Map *m)
+{
+	int w = m->GetMapWidth(), h = m->GetMapHeight();
+	std::vector<uint32_t> cellToNode(w*h, 0xFFFFFFFF);
+	xs.resize(0);
+	ys.resize(0);
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			if ((m->GetTerrainType(x, y)>>terrainBits) != (kGround>>terrainBits))
+				continue;
+			cellToNode[y*w+x] = xs.size();
+			xs.push_back(x);
+			ys.push_back(y);
+		}
+	}
+	auto open = [&](int x, int y) {
+		return x >= 0 && x < w && y >= 0 && y < h && cellToNode[y*w+x] != 0xFFFFFFFF;
+	};
+	std::vector<arc> arcs;
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			if (!open(x, y))
+				continue;
+			uint32_t from = cellToNode[y*w+x];
+			for (int dy = -1; dy <= 1; dy++)
+			{
+				for (int dx = -1; dx <= 1; dx++)
+				{
+					if ((dx == 0 && dy == 0) || !open(x+dx, y+dy))
+						continue;
+					if (dx != 0 && dy != 0 && !(open(x+dx, y) && open(x, y+dy)))
+						continue;
+					arcs.push_back({from, cellToNode[(y+dy)*w+x+dx],
+						(dx != 0 && dy != 0)?GraphSearchConstants::kDiagonalEdgeCost:GraphSearchConstants::kStraightEdgeCost});
+				}
+			}
+		}
+	}
+	BuildFromArcs(xs.size(), arcs);
+}
+
+bool CSRGraph::LoadDIMACS(const char *graphFile, const char *coordinateFile)
+{
+	FILE *f = fopen(graphFile, "r");
+	if (f == 0)
+	{
+		printf("Error: could not open '%s'\n", graphFile);
+		return false;
+	}
+	std::vector<arc> arcs;
+	uint32_t numNodes = 0;
+	char line[256];
+	while (fgets(line, 256, f) != 0)
+	{
+		if (line[0] == 'a')
+		{
+			char *next;
+			uint32_t from = strtoul(line+1, &next, 10);
+			uint32_t to = strtoul(next, &next, 10);
+			double weight = strtod(next, &next);
+			if (from == 0 || to == 0)
+				continue;
+			numNodes = std::max(numNodes, std::max(from, to));
+			arcs.push_back({from-1, to-1, weight});
+		}
+		else if (line[0] == 'p')
+		{
+			unsigned long n, m;
+			if (2 == sscanf(line, "p sp %lu %lu", &n, &m))
+			{
+				numNodes = std::max(numNodes, (uint32_t)n);
+				arcs.reserve(m);
+			}
+		}
+	}
+	fclose(f);
+	BuildFromArcs(numNodes, arcs);
+
+	xs.resize(0);
+	ys.resize(0);
+	if (coordinateFile == 0)
+		return true;
+	f = fopen(coordinateFile, "r");
+	if (f == 0)
+	{
+		printf("Error: could not open '%s'\n", coordinateFile);
+		return false;
+	}
+	xs.resize(numNodes);
+	ys.resize(numNodes);
+	while (fgets(line, 256, f) != 0)
+	{
+		if (line[0] != 'v')
+			continue;
+		char *next;
+		uint32_t id = strtoul(line+1, &next, 10);
+		double x = strtod(next, &next);
+		double y = strtod(next, &next);
+		if (id == 0 || id > numNodes)
+			continue;
+		xs[id-1] = x;
+		ys[id-1] = y;
+	}
+	fclose(f);
+	return true;
+}
+
+uint64_t CSRGraph::FindEdge(uint32_t from, uint32_t to) const
+{
+	auto begin = targets.begin()+first[from];
+	auto end = targets.begin()+first[from+1];
+	auto i = std::lower_bound(begin, end, to);
+	if (i == end || *i != to)
+		return kNoEdge;
+	return i-targets.begin();
+}
+
+uint64_t CSRGraph::GetMemoryUsage() const
+{
+	return first.size()*sizeof(uint64_t)+targets.size()*sizeof(uint32_t)+
+	weights.size()*sizeof(double)+(xs.size()+ys.size())*sizeof(float);
+}
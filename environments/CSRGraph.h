@@ -0,0 +1,76 @@
+/*
+ *  CSRGraph.h
+ *  hog2
+ *
+ *  An immutable graph in compressed sparse row (CSR) form.
+ *
+ *  The outgoing edges of node n are edges GetFirstEdge(n) up to (but not
+ *  including) GetFirstEdge(n+1); each edge has a target and a weight, and
+ *  the edges of a node are sorted by target. The whole graph lives in a
+ *  handful of contiguous arrays, so graphs with millions of nodes load
+ *  without per-node or per-edge allocations and successor generation is
+ *  a linear scan.
+ *
+ *  Graphs can be copied from a Graph, read from DIMACS shortest path
+ *  files (.gr and optionally .co) or built from the passable cells of a
+ *  Map. Parallel edges are merged, keeping the cheapest.
+ *
+ */
+
+#ifndef CSRGRAPH_H
+#define CSRGRAPH_H
+
+#include <stdint.h>
+#include <vector>
+#include "Graph.h"
+#include "Map.h"
+
+class CSRGraph {
+public:
+	CSRGraph();
+	/** Copies g; undirected graphs store every edge in both directions */
+	void Build(Graph *g, bool directed);
+	/**
+	 * One node per ground cell, numbered row by row as in
+	 * GraphSearchConstants::GetGraph. Cells are 8-connected; diagonal moves
+	 * need both adjacent cardinal cells to be open.
+	 */
+	void Build(Map *m);
+	/**
+	 * Reads a DIMACS .gr file (and a .co file with coordinates if given).
+	 * DIMACS node ids start at 1; node i in the file becomes node i-1.
+	 */
+	bool LoadDIMACS(const char *graphFile, const char *coordinateFile = 0);
+
+	uint32_t GetNumNodes() const { return (first.size() == 0)?0:first.size()-1; }
+	uint64_t GetNumEdges() const { return targets.size(); }
+	uint64_t GetFirstEdge(uint32_t n) const { return first[n]; }
+	uint32_t GetNumEdges(uint32_t n) const { return first[n+1]-first[n]; }
+	uint32_t GetTarget(uint64_t e) const { return targets[e]; }
+	double GetWeight(uint64_t e) const { return weights[e]; }
+	/** Edge index from -> to, or kNoEdge */
+	uint64_t FindEdge(uint32_t from, uint32_t to) const;
+	double GetMinWeight() const { return minWeight; }
+
+	bool HasCoordinates() const { return xs.size() != 0; }
+	float GetX(uint32_t n) const { return xs[n]; }
+	float GetY(uint32_t n) const { return ys[n]; }
+
+	uint64_t GetMemoryUsage() const;
+
+	static const uint64_t kNoEdge = ~0ull;
+private:
+	struct arc {
+		uint32_t from, to;
+		double weight;
+	};
+	void BuildFromArcs(uint32_t numNodes, std::vector<arc> &arcs);
+
+	std::vector<uint64_t> first;
+	std::vector<uint32_t> targets;
+	std::vector<double> weights;
+	std::vector<float> xs, ys;
+	double minWeight;
+};
+
+#endif
@@ -0,0 +1,143 @@
+/*
+ *  CSRGraphEnvironment.cpp
+ *  hog2
+ *
+ *  Search environment over an immutable CSRGraph.
+ *
+ */
+
+#include "CSRGraphEnvironment.h"
+#include <float.h>
+#include <math.h>
+#include "GLUtil.h"
+
+CSRGraphEnvironment::CSRGraphEnvironment(const CSRGraph *graph)
+:g(graph), hWeight(0), minX(0), minY(0), scale(1)
+{
+	if (!g->HasCoordinates() || g->GetNumNodes() == 0)
+		return;
+	double maxX = -DBL_MAX, maxY = -DBL_MAX;
+	minX = DBL_MAX;
+	minY = DBL_MAX;
+	for (uint32_t x = 0; x < g->GetNumNodes(); x++)
+	{
+		minX = std::min(minX, (double)g->GetX(x));
+		maxX = std::max(maxX, (double)g->GetX(x));
+		minY = std::min(minY, (double)g->GetY(x));
+		maxY = std::max(maxY, (double)g->GetY(x));
+	}
+	scale = std::max(maxX-minX, maxY-minY);
+	if (scale == 0)
+		scale = 1;
+}
+
+void CSRGraphEnvironment::GetSuccessors(const graphState &stateID, std::vector<graphState> &neighbors) const
+{
+	neighbors.resize(0);
+	uint64_t last = g->GetFirstEdge(stateID+1);
+	for (uint64_t e = g->GetFirstEdge(stateID); e < last; e++)
+		neighbors.push_back(g->GetTarget(e));
+}
+
+void CSRGraphEnvironment::GetActions(const graphState &stateID, std::vector<graphMove> &actions) const
+{
+	actions.resize(0);
+	uint64_t last = g->GetFirstEdge(stateID+1);
+	for (uint64_t e = g->GetFirstEdge(stateID); e < last; e++)
+		actions.push_back(graphMove(stateID, g->GetTarget(e)));
+}
+
+void CSRGraphEnvironment::ApplyAction(graphState &s, graphMove a) const
+{
+	assert(s == a.from);
+	s = a.to;
+}
+
+bool CSRGraphEnvironment::InvertAction(graphMove &a) const
+{
+	uint32_t tmp = a.from;
+	a.from = a.to;
+	a.to = tmp;
+	return g->FindEdge(a.from, a.to) != CSRGraph::kNoEdge;
+}
+
+double CSRGraphEnvironment::HCost(const graphState &state1, const graphState &state2) const
+{
+	if (state1 == state2)
+		return 0;
+	if (hWeight > 0 && g->HasCoordinates())
+	{
+		double dx = g->GetX(state1)-g->GetX(state2);
+		double dy = g->GetY(state1)-g->GetY(state2);
+		return std::max(hWeight*sqrt(dx*dx+dy*dy), g->GetMinWeight());
+	}
+	return g->GetMinWeight();
+}
+
+double CSRGraphEnvironment::GCost(const graphState &state1, const graphState &state2) const
+{
+	uint64_t e = g->FindEdge(state1, state2);
+	assert(e != CSRGraph::kNoEdge);
+	return g->GetWeight(e);
+}
+
+double CSRGraphEnvironment::GCost(const graphState &, const graphMove &move) const
+{
+	return GCost(move.from, move.to);
+}
+
+void CSRGraphEnvironment::GetGLCoordinate(uint32_t n, GLdouble &x, GLdouble &y) const
+{
+	x = (g->GetX(n)-minX)/scale*2-1;
+	y = (g->GetY(n)-minY)/scale*2-1;
+}
+
+void CSRGraphEnvironment::OpenGLDraw() const
+{
+	if (!g->HasCoordinates())
+		return;
+	GLfloat r, gr, b, t;
+	GetColor(r, gr, b, t);
+	glColor4f(r, gr, b, t);
+	glBegin(GL_LINES);
+	for (uint32_t n = 0; n < g->GetNumNodes(); n++)
+	{
+		GLdouble x1, y1, x2, y2;
+		GetGLCoordinate(n, x1, y1);
+		for (uint64_t e = g->GetFirstEdge(n); e < g->GetFirstEdge(n+1); e++)
+		{
+			GetGLCoordinate(g->GetTarget(e), x2, y2);
+			glVertex3f(x1, y1, 0);
+			glVertex3f(x2, y2, 0);
+		}
+	}
+	glEnd();
+}
+
+void CSRGraphEnvironment::OpenGLDraw(const graphState &s) const
+{
+	if (!g->HasCoordinates())
+		return;
+	GLfloat r, gr, b, t;
+	GetColor(r, gr, b, t);
+	glColor4f(r, gr, b, t);
+	GLdouble x, y;
+	GetGLCoordinate(s, x, y);
+	DrawSquare(x, y, -0.002, 0.4/sqrt((double)g->GetNumNodes()));
+}
+
+void CSRGraphEnvironment::GLDrawLine(const graphState &from, const graphState &to) const
+{
+	if (!g->HasCoordinates())
+		return;
+	GLfloat r, gr, b, t;
+	GetColor(r, gr, b, t);
+	glColor4f(r, gr, b, t);
+	GLdouble x1, y1, x2, y2;
+	GetGLCoordinate(from, x1, y1);
+	GetGLCoordinate(to, x2, y2);
+	glBegin(GL_LINES);
+	glVertex3f(x1, y1, -0.001);
+	glVertex3f(x2, y2, -0.001);
+	glEnd();
+}
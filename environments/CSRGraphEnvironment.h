@@ -0,0 +1,59 @@
+/*
+ *  CSRGraphEnvironment.h
+ *  hog2
+ *
+ *  Search environment over an immutable CSRGraph. States and moves are
+ *  the same as in GraphEnvironment, so searches written for one work on
+ *  the other.
+ *
+ *  Graphs are directed; build the CSRGraph from an undirected Graph to
+ *  get both directions of each edge. The heuristic is the straight-line
+ *  distance between node coordinates times a weight (0 by default, which
+ *  uses the cheapest edge cost instead).
+ *
+ */
+
+#ifndef CSRGRAPHENVIRONMENT_H
+#define CSRGRAPHENVIRONMENT_H
+
+#include "SearchEnvironment.h"
+#include "GraphEnvironment.h"
+#include "CSRGraph.h"
+
+class CSRGraphEnvironment : public SearchEnvironment<graphState, graphMove> {
+public:
+	CSRGraphEnvironment(const CSRGraph *g);
+	void GetSuccessors(const graphState &stateID, std::vector<graphState> &neighbors) const;
+	int GetNumSuccessors(const graphState &stateID) const { return g->GetNumEdges(stateID); }
+	void GetActions(const graphState &stateID, std::vector<graphMove> &actions) const;
+	graphMove GetAction(const graphState &s1, const graphState &s2) const { return graphMove(s1, s2); }
+	void ApplyAction(graphState &s, graphMove a) const;
+	bool InvertAction(graphMove &a) const;
+
+	/** Admissible if no edge is cheaper than weight times the distance between its endpoints */
+	void SetHeuristicWeight(double w) { hWeight = w; }
+	double HCost(const graphState &state1, const graphState &state2) const;
+	double GCost(const graphState &state1, const graphState &state2) const;
+	double GCost(const graphState &state1, const graphMove &move) const;
+	bool GoalTest(const graphState &state, const graphState &goal) const { return state == goal; }
+	uint64_t GetMaxHash() const { return g->GetNumNodes(); }
+	uint64_t GetStateHash(const graphState &state) const { return state; }
+	void GetStateFromHash(uint64_t hash, graphState &s) const { s = hash; }
+	uint64_t GetActionHash(graphMove act) const { return (uint64_t(act.from)<<32)|act.to; }
+
+	void OpenGLDraw() const;
+	void OpenGLDraw(const graphState &s) const;
+	void OpenGLDraw(const graphState &, const graphMove &) const {}
+	void GLDrawLine(const graphState &x, const graphState &y) const;
+
+	const CSRGraph *GetGraph() const { return g; }
+private:
+	void GetGLCoordinate(uint32_t n, GLdouble &x, GLdouble &y) const;
+
+	const CSRGraph *g;
+	double hWeight;
+	// maps node coordinates into [-1, 1] for drawing
+	double minX, minY, scale;
+};
+
+#endif
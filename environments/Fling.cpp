@@ -848,7 +848,7 @@ void Fling::GLLabelState(const FlingBoard&b, const char *text) const
 }
 
 
-int64_t Fling::getMaxSinglePlayerRank(int spots, int numPieces)
+int64_t Fling::getMaxSinglePlayerRank(int spots, int numPieces) const
 {
 	return binomial(spots, numPieces);
 }
@@ -885,7 +885,7 @@ int64_t Fling::getMaxSinglePlayerRank2(int spots, int numPieces, int64_t firstIn
 	return binomial(NUM_SPOTS-i,NUM_PIECES-2);
 }
 
-int64_t Fling::rankPlayer(FlingBoard &s)
+int64_t Fling::rankPlayer(const FlingBoard &s) const
 {
 	int NUM_SPOTS = s.width*s.height;
 	int NUM_PIECES = (int)s.locs.size();
@@ -959,7 +959,7 @@ void Fling::rankPlayerRemaining(FlingBoard &s, int64_t &index2)
 
 
 // returns true if it is a valid unranking given existing pieces
-bool Fling::unrankPlayer(int64_t theRank, int pieces, FlingBoard &s)
+bool Fling::unrankPlayer(int64_t theRank, int pieces, FlingBoard &s) const
 {
 	int NUM_SPOTS = s.width*s.height;
 	int NUM_PIECES = pieces;
@@ -1020,7 +1020,7 @@ bool Fling::unrankPlayer(int64_t theRank, int pieces, FlingBoard &s)
 //	}
 //}
 //
-int64_t Fling::binomialSum(unsigned int n1, unsigned int n2, unsigned int k)
+int64_t Fling::binomialSum(unsigned int n1, unsigned int n2, unsigned int k) const
 {
 	//	static std::vector<std::vector<int64_t> > sums;
 	//assert(theSums[k*(NUM_SPOTS+1)+n1]-theSums[k*(NUM_SPOTS+1)+n2] == sums[k][n1]-sums[k][n2]);
@@ -1032,7 +1032,7 @@ int64_t Fling::binomialSum(unsigned int n1, unsigned int n2, unsigned int k)
 	//return sums[k][n1]-sums[k][n2];
 }
 
-const int maxPieces = 14;
+const int Fling::kMaxPieces;
 
 void Fling::initBinomial()
 {
@@ -1040,7 +1040,7 @@ void Fling::initBinomial()
 	{
 		for (int x = 0; x <= 56; x++)
 		{
-			for (int y = 0; y <= maxPieces; y++)
+			for (int y = 0; y <= kMaxPieces; y++)
 			{
 				binomials.push_back(bi(x, y));
 			}
@@ -1048,13 +1048,13 @@ void Fling::initBinomial()
 	}
 }
 
-int64_t Fling::binomial(unsigned int n, unsigned int k)
+int64_t Fling::binomial(unsigned int n, unsigned int k) const
 {
 	//assert(bi(n, k) == binomials[n*(1+NUM_PLAYERS*NUM_PIECES)+k]);
-	return binomials[n*(1+maxPieces)+k];
+	return binomials[n*(1+kMaxPieces)+k];
 }
 
-int64_t Fling::bi(unsigned int n, unsigned int k)
+int64_t Fling::bi(unsigned int n, unsigned int k) const
 {
 	int64_t num = 1;
 	const unsigned int bound = (n - k);
@@ -7,6 +7,9 @@
  *
  */
 
+#ifndef FLING_H
+#define FLING_H
+
 #include <iostream>
 #include "SearchEnvironment.h"
 
@@ -137,6 +140,8 @@ static bool operator==(const FlingMove &l1, const FlingMove &l2) {
 class Fling : public SearchEnvironment<FlingBoard, FlingMove> {
 public:
 	Fling();
+	/** The largest piece count the ranking functions support */
+	static const int kMaxPieces = 14;
 	
 	virtual void GetSuccessors(const FlingBoard &nodeID, std::vector<FlingBoard> &neighbors) const;
 	virtual void GetActions(const FlingBoard &nodeID, std::vector<FlingMove> &actions) const;
@@ -166,21 +171,21 @@ public:
 	
 	bool GetXYFromPoint(const FlingBoard &b, point3d loc, int &x, int &y) const;
 	
-	int64_t getMaxSinglePlayerRank(int spots, int numPieces);
+	int64_t getMaxSinglePlayerRank(int spots, int numPieces) const;
 	int64_t getMaxSinglePlayerRank2(int spots, int numPieces);
 	int64_t getMaxSinglePlayerRank2(int spots, int numPieces, int64_t firstIndex);
-	int64_t rankPlayer(FlingBoard &s);
+	int64_t rankPlayer(const FlingBoard &s) const;
 	void rankPlayer(FlingBoard &s, int64_t &index1, int64_t &index2);
 	void rankPlayerFirstTwo(FlingBoard &s, int64_t &index1);
 	void rankPlayerRemaining(FlingBoard &s, int64_t &index2);
 	// returns true if it is a valid unranking given existing pieces
-	bool unrankPlayer(int64_t theRank, int pieces, FlingBoard &s);
+	bool unrankPlayer(int64_t theRank, int pieces, FlingBoard &s) const;
 
 //	void initBinomialSums();
-	int64_t binomialSum(unsigned int n1, unsigned int n2, unsigned int k);
+	int64_t binomialSum(unsigned int n1, unsigned int n2, unsigned int k) const;
 	void initBinomial();
-	int64_t binomial(unsigned int n, unsigned int k);
-	int64_t bi(unsigned int n, unsigned int k);
+	int64_t binomial(unsigned int n, unsigned int k) const;
+	int64_t bi(unsigned int n, unsigned int k) const;
 
 	
 	virtual void OpenGLDraw() const {}
@@ -199,3 +204,5 @@ private:
 	std::vector<int64_t> binomials;
 
 };
+
+#endif
@@ -0,0 +1,182 @@
+//
+//  FlingSolver.cpp
+//  hog2
+//
+//  Layered retrograde solver for Fling on the standard 7x8 board.
+//
+
+#include "FlingSolver.h"
+#include <stdio.h>
+#include <thread>
+#include <algorithm>
+#include "Timer.h"
+
+FlingSolver::FlingSolver(const char *filePrefix)
+:prefix(filePrefix)
+{
+	// boards with 0 or 1 pieces are never looked up
+	tables.resize(2, 0);
+}
+
+FlingSolver::~FlingSolver()
+{
+	for (unsigned int x = 0; x < tables.size(); x++)
+		delete tables[x];
+}
+
+void FlingSolver::GetFileName(int pieces, std::string &name) const
+{
+	char fname[255];
+	sprintf(fname, "%s-%d.dat", prefix.c_str(), pieces);
+	name = fname;
+}
+
+/** Only finished tables have their final name, so any file of the right size is complete */
+bool FlingSolver::TableExists(int pieces) const
+{
+	std::string name;
+	GetFileName(pieces, name);
+	FILE *file = fopen(name.c_str(), "r");
+	if (file == 0)
+		return false;
+	fseek(file, 0, SEEK_END);
+	uint64_t bytes = ftell(file);
+	fclose(file);
+	return (bytes >= (GetNumStates(pieces)+7)/8);
+}
+
+int FlingSolver::LoadTables(int maxPieces)
+{
+	if (maxPieces > Fling::kMaxPieces)
+	{
+		printf("Error: Fling can only rank boards with up to %d pieces\n", Fling::kMaxPieces);
+		maxPieces = Fling::kMaxPieces;
+	}
+	std::string name;
+	for (int x = (int)tables.size(); x <= maxPieces; x++)
+	{
+		if (!TableExists(x))
+			break;
+		GetFileName(x, name);
+		tables.push_back(new BitVector(GetNumStates(x), name.c_str(), false));
+	}
+	return GetMaxPieces();
+}
+
+void FlingSolver::BuildTables(int maxPieces, int numThreads)
+{
+	if (maxPieces > Fling::kMaxPieces)
+	{
+		printf("Error: Fling can only rank boards with up to %d pieces\n", Fling::kMaxPieces);
+		maxPieces = Fling::kMaxPieces;
+	}
+	LoadTables(maxPieces);
+	for (int x = (int)tables.size(); x <= maxPieces; x++)
+	{
+		BuildLayer(x, numThreads);
+	}
+}
+
+void FlingSolver::BuildLayer(int pieces, int numThreads)
+{
+	assert(pieces == (int)tables.size());
+	uint64_t numStates = GetNumStates(pieces);
+	std::string name, tmpName;
+	GetFileName(pieces, name);
+	tmpName = name+".tmp";
+	printf("Building %d piece table; %llu entries\n", pieces, (unsigned long long)numStates);
+	tables.push_back(new BitVector(numStates, tmpName.c_str(), true));
+
+	Timer t;
+	t.StartTimer();
+	SharedQueue<std::pair<uint64_t, uint64_t> > workQueue(numThreads*20);
+	SharedQueue<uint64_t> resultQueue;
+	std::vector<std::thread*> threads(numThreads);
+	for (int x = 0; x < numThreads; x++)
+	{
+		threads[x] = new std::thread(&FlingSolver::ThreadWorker, this, pieces, &workQueue, &resultQueue);
+	}
+	for (uint64_t x = 0; x < numStates; x += kChunkSize)
+	{
+		workQueue.WaitAdd({x, std::min(numStates, x+kChunkSize)});
+	}
+	for (int x = 0; x < numThreads; x++)
+	{
+		workQueue.WaitAdd({0,0});
+	}
+	for (int x = 0; x < numThreads; x++)
+	{
+		threads[x]->join();
+		delete threads[x];
+		threads[x] = 0;
+	}
+	uint64_t solvable = 0, val;
+	while (resultQueue.Remove(val))
+	{
+		solvable += val;
+	}
+	// the table is complete; unmap it and move it into place
+	delete tables[pieces];
+	if (rename(tmpName.c_str(), name.c_str()) != 0)
+		printf("Error: unable to rename '%s' to '%s'\n", tmpName.c_str(), name.c_str());
+	tables[pieces] = new BitVector(numStates, name.c_str(), false);
+	printf("%llu of %llu are solvable (%3.1f%%); %3.2f sec elapsed\n", (unsigned long long)solvable,
+		   (unsigned long long)numStates, 100.0*solvable/numStates, t.EndTimer());
+}
+
+/**
+ * Each work item is a range of ranks in the layer being built. Ranges
+ * start on byte boundaries, so threads never write to the same byte and
+ * the table can be updated without locking. The previous layer is
+ * complete and only read.
+ */
+void FlingSolver::ThreadWorker(int pieces, SharedQueue<std::pair<uint64_t, uint64_t> > *work,
+							   SharedQueue<uint64_t> *results)
+{
+	std::pair<uint64_t, uint64_t> p;
+	std::vector<FlingMove> acts;
+	FlingBoard currState, next;
+	BitVector *table = tables[pieces];
+	uint64_t count = 0;
+	while (true)
+	{
+		work->WaitRemove(p);
+		if (p.first == p.second)
+		{
+			break;
+		}
+		for (uint64_t rank = p.first; rank < p.second; rank++)
+		{
+			f.unrankPlayer(rank, pieces, currState);
+			f.GetActions(currState, acts);
+			for (unsigned int x = 0; x < acts.size(); x++)
+			{
+				f.GetNextState(currState, acts[x], next);
+				if (IsSolvable(next))
+				{
+					table->SetTrue(rank);
+					count++;
+					break;
+				}
+			}
+		}
+	}
+	results->Add(count);
+}
+
+bool FlingSolver::IsSolvable(const FlingBoard &b) const
+{
+	int pieces = b.NumPieces();
+	if (pieces <= 1)
+		return pieces == 1;
+	assert(pieces <= GetMaxPieces());
+	return tables[pieces]->Get(f.rankPlayer(b));
+}
+
+uint64_t FlingSolver::GetNumSolvable(int pieces)
+{
+	if (pieces <= 1)
+		return (pieces == 1)?kBoardSize:0;
+	assert(pieces <= GetMaxPieces());
+	return tables[pieces]->GetNumSetBits();
+}
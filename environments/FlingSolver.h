@@ -0,0 +1,58 @@
+//
+//  FlingSolver.h
+//  hog2
+//
+//  Layered retrograde solver for Fling on the standard 7x8 board.
+//
+//  Every Fling move removes exactly one piece, so the state space is
+//  layered by piece count. A board with n pieces is solvable if any move
+//  leads to a solvable board with n-1 pieces; a single piece is solved.
+//  Each layer is stored as a 1-bit-per-state table indexed by the
+//  combinatorial ranking in Fling::rankPlayer, memory-mapped from disk
+//  (prefix-<n>.dat), so queries are O(1) once the tables are built.
+//  A layer is built in prefix-<n>.dat.tmp and only renamed when it is
+//  finished, so an interrupted build is never loaded. The ranking covers
+//  up to Fling::kMaxPieces pieces.
+//
+
+#ifndef FLINGSOLVER_H
+#define FLINGSOLVER_H
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include "Fling.h"
+#include "BitVector.h"
+#include "SharedQueue.h"
+
+class FlingSolver {
+public:
+	FlingSolver(const char *filePrefix = "fling");
+	~FlingSolver();
+	/** Builds all tables from 2 up to maxPieces pieces, reusing any layers already on disk */
+	void BuildTables(int maxPieces, int numThreads);
+	/** Maps previously built tables; returns the largest piece count loaded */
+	int LoadTables(int maxPieces);
+	/** Returns true if the board can be reduced to a single piece. */
+	bool IsSolvable(const FlingBoard &b) const;
+	/** Returns true if the board has few enough pieces to be looked up */
+	bool CanLookup(const FlingBoard &b) const { return b.NumPieces() <= GetMaxPieces(); }
+	int GetMaxPieces() const { return (int)tables.size()-1; }
+	uint64_t GetNumStates(int pieces) const { return f.getMaxSinglePlayerRank(kBoardSize, pieces); }
+	uint64_t GetNumSolvable(int pieces);
+private:
+	static const int kBoardSize = 56;
+	static const uint64_t kChunkSize = 1ull<<16; // must be a multiple of 8 so chunks don't share bytes
+
+	void GetFileName(int pieces, std::string &name) const;
+	bool TableExists(int pieces) const;
+	void BuildLayer(int pieces, int numThreads);
+	void ThreadWorker(int pieces, SharedQueue<std::pair<uint64_t, uint64_t> > *work,
+					  SharedQueue<uint64_t> *results);
+
+	Fling f;
+	std::string prefix;
+	std::vector<BitVector*> tables;
+};
+
+#endif
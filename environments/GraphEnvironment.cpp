@@ -11,9 +11,13 @@
 #include "GLUtil.h"
 #include "Heap.h"
 #include "FloydWarshall.h"
+#include "CSRGraph.h"
+#include <queue>
 
 using namespace GraphSearchConstants;
 
+const uint16_t GraphDistanceHeuristic::kPackedInfinity;
+
 //int GraphMapInconsistentHeuristic::hmode=2;
 //int GraphMapInconsistentHeuristic::HN=10;
 //double GraphMapPerfectHeuristic::prob=0.5;
@@ -1100,6 +1104,32 @@ void GraphDistanceHeuristic::OpenGLDraw() const
 double GraphDistanceHeuristic::HCost(const graphState &state1, const graphState &state2) const
 {
 	double val = 0;
+	if (packedRows && !table.IsLoaded())
+	{
+		uint32_t diff = PackedDifference(state1, state2);
+		// distances were rounded down, so differences can be one step too large
+		if (!packedExact && diff > 0)
+			diff--;
+		return diff*packedScale;
+	}
+	if (table.IsLoaded())
+	{
+		for (unsigned int i = 0; i < table.GetNumRows(); i++)
+		{
+			uint32_t h1 = table.Get(i, state1), h2 = table.Get(i, state2);
+			// unreachable states are -1 in heuristics
+			double hval = ((h1 == DistanceTable::kInfinity)?-1.0:h1*table.GetScale())-
+				((h2 == DistanceTable::kInfinity)?-1.0:h2*table.GetScale());
+			if (hval < 0)
+				hval = -hval;
+			if (fgreater(hval,val))
+				val = hval;
+		}
+		// as in the packed case, rounded distances can differ by one unit too many
+		if (!table.IsExact() && val > 0)
+			val = std::max(val-table.GetScale(), 0.0);
+		return val;
+	}
 	for (unsigned int i = 0; i < heuristics.size(); i++)
 	{
 		double hval = heuristics[i][state1]-heuristics[i][state2];
@@ -1113,6 +1143,18 @@ double GraphDistanceHeuristic::HCost(const graphState &state1, const graphState
 
 void GraphDistanceHeuristic::ChooseStartGoal(graphState &start, graphState &goal)
 {
+	if (packedRows)
+	{
+		uint32_t minStart = kPackedInfinity, minGoal = kPackedInfinity;
+		for (unsigned int x = 0; x < locations.size(); x++)
+		{
+			minStart = std::min(minStart, (uint32_t)packedRows[start*packedStride+x]);
+			minGoal = std::min(minGoal, (uint32_t)packedRows[goal*packedStride+x]);
+		}
+		if (minStart < minGoal)
+			std::swap(start, goal);
+		return;
+	}
 	if (heuristics.size() == 0)
 		return;
 	double minStart=-1, minGoal=-1;
@@ -1152,12 +1194,74 @@ void GraphDistanceHeuristic::AddHeuristic(node *n)
 
 void GraphDistanceHeuristic::AddHeuristic(std::vector<double> &values, graphState location)
 {
+	// HCost only reads the file once heuristics are loaded
+	assert(!table.IsLoaded());
+	if (packedRows)
+	{
+		AddPackedHeuristics(std::vector<std::vector<double> >(1, values));
+		locations.push_back(location);
+		return;
+	}
 	heuristics.push_back(values);
 	locations.push_back(location);
 }
 
 
 
+/*
+ * One row per heuristic with the distance to every node; the extra last
+ * column holds the location of the heuristic.
+ */
+bool GraphDistanceHeuristic::SaveHeuristics(const char *filename, double scale)
+{
+	// packed values are already multiples of packedScale, rounded down
+	// unless packedExact, so they are stored as they are
+	DistanceTableWriter w(filename, GetNumHeuristics(), g->GetNumNodes()+1, packedRows?packedScale:scale);
+	if (!w.IsOpen())
+		return false;
+	if (packedRows)
+	{
+		if (!packedExact)
+			w.SetRounded();
+		for (unsigned int x = 0; x < locations.size(); x++)
+		{
+			for (int y = 0; y < g->GetNumNodes(); y++)
+			{
+				uint16_t v = packedRows[y*packedStride+x];
+				w.Add((v == kPackedInfinity)?DistanceTable::kInfinity:v);
+			}
+			w.Add(locations[x]);
+		}
+		return w.Close();
+	}
+	for (unsigned int x = 0; x < heuristics.size(); x++)
+	{
+		for (unsigned int y = 0; y < heuristics[x].size(); y++)
+			w.AddDistance(heuristics[x][y]);
+		w.Add(locations[x]);
+	}
+	return w.Close();
+}
+
+bool GraphDistanceHeuristic::LoadHeuristics(const char *filename)
+{
+	if (!table.Load(filename))
+		return false;
+	if (table.GetNumColumns() != g->GetNumNodes()+1)
+	{
+		printf("Error: '%s' has heuristics for %llu nodes; graph has %d\n", filename,
+			   (unsigned long long)table.GetNumColumns()-1, g->GetNumNodes());
+		table.Close();
+		return false;
+	}
+	std::vector<uint16_t>().swap(packed);
+	packedRows = 0;
+	locations.resize(0);
+	for (unsigned int x = 0; x < table.GetNumRows(); x++)
+		locations.push_back(table.Get(x, g->GetNumNodes()));
+	return true;
+}
+
 void GraphDistanceHeuristic::GetOptimalDistances(node *n, std::vector<double> &values)
 {
 	values.resize(g->GetNumNodes());
@@ -1422,6 +1526,289 @@ node *GraphDistanceHeuristic::FindFarNode(node *n)
 }
 
 
+void GraphDistanceHeuristic::BuildHeuristics(int count, int numThreads)
+{
+	heuristics.resize(0);
+	locations.resize(0);
+	std::vector<uint16_t>().swap(packed);
+	packedRows = 0;
+	packedStride = 0;
+	if (table.IsLoaded())
+		table.Close();
+	if (numThreads < 1)
+		numThreads = 1;
+	int n = g->GetNumNodes();
+	if (n == 0 || count <= 0)
+		return;
+
+	CSRGraph csr;
+	csr.Build(g, false);
+	std::vector<double> minDist(n, -1.0);
+	std::vector<graphState> batch;
+	std::vector<std::vector<double> > rows;
+	std::vector<std::thread*> threads;
+	while ((int)locations.size() < count)
+	{
+		int batchSize = std::min(numThreads, count-(int)locations.size());
+		batch.resize(0);
+		if (placement == kRandomPlacement)
+		{
+			for (int x = 0; x < batchSize; x++)
+				batch.push_back(g->GetRandomNode()->GetNum());
+		}
+		else if (locations.size() == 0)
+		{
+			// farthest node from a spread of nodes, as in FindFarNode
+			std::vector<graphState> seeds;
+			for (int x = 0; x < 10; x++)
+				seeds.push_back((graphState)x*n/10);
+			std::vector<double> dist;
+			GetDistances(&csr, seeds, &dist, 0);
+			batch.push_back(std::max_element(dist.begin(), dist.end())-dist.begin());
+		}
+		else if (placement == kFarPlacement)
+		{
+			SelectFarPivots(csr, minDist, batchSize, batch);
+		}
+		else {
+			SelectAvoidPivots(csr, batchSize, batch);
+		}
+		// tiny graphs may run out of useful pivots
+		if (batch.size() == 0)
+			batch.push_back(g->GetRandomNode()->GetNum());
+
+		rows.resize(batch.size());
+		threads.resize(batch.size());
+		for (unsigned int x = 0; x < batch.size(); x++)
+			threads[x] = new std::thread(GetDistances, &csr, std::vector<graphState>(1, batch[x]), &rows[x],
+										 (std::vector<uint32_t> *)0);
+		for (unsigned int x = 0; x < batch.size(); x++)
+		{
+			threads[x]->join();
+			delete threads[x];
+		}
+		for (unsigned int x = 0; x < rows.size(); x++)
+			for (int y = 0; y < n; y++)
+				if (rows[x][y] >= 0 && (minDist[y] < 0 || rows[x][y] < minDist[y]))
+					minDist[y] = rows[x][y];
+		AddPackedHeuristics(rows);
+		locations.insert(locations.end(), batch.begin(), batch.end());
+	}
+}
+
+/*
+ * Multi-source Dijkstra; unreachable nodes get -1 like GetOptimalDistances.
+ */
+void GraphDistanceHeuristic::GetDistances(const CSRGraph *csr, std::vector<graphState> from,
+										  std::vector<double> *values, std::vector<uint32_t> *parents)
+{
+	typedef std::pair<double, uint32_t> entry;
+	std::priority_queue<entry, std::vector<entry>, std::greater<entry> > open;
+	values->assign(csr->GetNumNodes(), -1.0);
+	if (parents)
+		parents->assign(csr->GetNumNodes(), 0xFFFFFFFF);
+	std::vector<double> best(csr->GetNumNodes(), DBL_MAX);
+	for (graphState s : from)
+	{
+		best[s] = 0;
+		open.push({0, s});
+	}
+	while (!open.empty())
+	{
+		entry next = open.top();
+		open.pop();
+		if ((*values)[next.second] >= 0)
+			continue;
+		(*values)[next.second] = next.first;
+		for (uint64_t e = csr->GetFirstEdge(next.second); e < csr->GetFirstEdge(next.second+1); e++)
+		{
+			uint32_t to = csr->GetTarget(e);
+			double cost = next.first+csr->GetWeight(e);
+			if ((*values)[to] < 0 && cost < best[to])
+			{
+				best[to] = cost;
+				if (parents)
+					(*parents)[to] = next.second;
+				open.push({cost, to});
+			}
+		}
+	}
+}
+
+/*
+ * Farthest point placement: each pivot is the node farthest from all
+ * earlier pivots. Distances to pivots of the current batch aren't known
+ * yet, so they are estimated with the heuristics built so far.
+ */
+void GraphDistanceHeuristic::SelectFarPivots(const CSRGraph &csr, const std::vector<double> &minDist,
+											 int count, std::vector<graphState> &batch) const
+{
+	for (int k = 0; k < count; k++)
+	{
+		double bestValue = 0;
+		int64_t best = -1;
+		for (uint32_t v = 0; v < csr.GetNumNodes(); v++)
+		{
+			double value = minDist[v];
+			if (!fgreater(value, bestValue))
+				continue;
+			for (graphState p : batch)
+				value = std::min(value, GraphDistanceHeuristic::HCost(v, p));
+			if (fgreater(value, bestValue))
+			{
+				bestValue = value;
+				best = v;
+			}
+		}
+		if (best == -1)
+			return;
+		batch.push_back(best);
+	}
+}
+
+/*
+ * Avoid placement (see FindAvoidNode): grow a shortest path tree from a
+ * random root, weight each node by how far the heuristic is from the true
+ * distance to the root, and pick a leaf below the heaviest subtree that
+ * holds no pivot. Each pivot in the batch removes its subtree from the
+ * next choice.
+ */
+void GraphDistanceHeuristic::SelectAvoidPivots(const CSRGraph &csr, int count, std::vector<graphState> &batch) const
+{
+	uint32_t n = csr.GetNumNodes();
+	graphState root = g->GetRandomNode()->GetNum();
+	std::vector<double> dist, nodeWeight(n), subtree(n);
+	std::vector<uint32_t> parents;
+	GetDistances(&csr, std::vector<graphState>(1, root), &dist, &parents);
+
+	// children of each node in the tree, and all nodes deepest first
+	std::vector<uint32_t> firstChild(n+1, 0), children, order;
+	for (uint32_t v = 0; v < n; v++)
+	{
+		if (dist[v] < 0)
+			continue;
+		order.push_back(v);
+		if (parents[v] != 0xFFFFFFFF)
+			firstChild[parents[v]+1]++;
+		nodeWeight[v] = fabs(dist[v]-GraphDistanceHeuristic::HCost(root, v));
+	}
+	for (uint32_t v = 0; v < n; v++)
+		firstChild[v+1] += firstChild[v];
+	children.resize(firstChild[n]);
+	std::vector<uint32_t> next(firstChild.begin(), firstChild.end()-1);
+	for (uint32_t v : order)
+		if (parents[v] != 0xFFFFFFFF)
+			children[next[parents[v]]++] = v;
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return dist[a] > dist[b]; });
+
+	std::vector<bool> isPivot(n, false);
+	for (graphState l : locations)
+		isPivot[l] = true;
+	for (int k = 0; k < count; k++)
+	{
+		// a subtree holding a pivot has size 0
+		for (uint32_t v : order)
+		{
+			bool covered = isPivot[v];
+			double size = nodeWeight[v];
+			for (uint32_t c = firstChild[v]; c < firstChild[v+1]; c++)
+			{
+				if (subtree[children[c]] == 0)
+					covered = true;
+				size += subtree[children[c]];
+			}
+			subtree[v] = covered?0:size;
+		}
+		uint32_t best = root;
+		for (uint32_t v : order)
+			if (fless(subtree[best], subtree[v]))
+				best = v;
+		if (subtree[best] == 0)
+			return;
+		// follow the heaviest child down to a leaf
+		while (firstChild[best] != firstChild[best+1])
+		{
+			uint32_t heaviest = children[firstChild[best]];
+			for (uint32_t c = firstChild[best]; c < firstChild[best+1]; c++)
+				if (fless(subtree[heaviest], subtree[children[c]]))
+					heaviest = children[c];
+			best = heaviest;
+		}
+		batch.push_back(best);
+		isPivot[best] = true;
+	}
+}
+
+/*
+ * Appends one column per row of values. The scale is fixed by the first
+ * batch: no distance in a connected graph is more than twice the distance
+ * from a pivot to the node farthest from it. Larger values are clamped,
+ * which keeps differences admissible.
+ */
+void GraphDistanceHeuristic::AddPackedHeuristics(const std::vector<std::vector<double> > &values)
+{
+	int n = g->GetNumNodes();
+	uint32_t oldCount = locations.size();
+	uint32_t newCount = oldCount+values.size();
+	if (oldCount == 0)
+	{
+		double maxDist = 0;
+		for (const auto &row : values)
+			for (double d : row)
+				maxDist = std::max(maxDist, d);
+		bool integer = true;
+		for (int x = 0; x < g->GetNumEdges() && integer; x++)
+			integer = (g->GetEdge(x)->GetWeight() == floor(g->GetEdge(x)->GetWeight()));
+		packedExact = integer && 2*maxDist < kPackedInfinity;
+		packedScale = (packedExact || maxDist == 0)?1.0:2*maxDist/(kPackedInfinity-1);
+	}
+	uint32_t stride = std::max(packedStride, 8u);
+	while (stride < newCount)
+		stride *= 2;
+	if (stride != packedStride)
+	{
+		// 32 extra entries so the rows can start on a 64-byte boundary
+		std::vector<uint16_t> larger((uint64_t)n*stride+32, 0);
+		uint16_t *rows = larger.data()+(((64-((uintptr_t)larger.data()&63))&63)/sizeof(uint16_t));
+		for (int y = 0; y < n; y++)
+			for (uint32_t x = 0; x < oldCount; x++)
+				rows[(uint64_t)y*stride+x] = packedRows[(uint64_t)y*packedStride+x];
+		packed.swap(larger);
+		packedRows = rows;
+		packedStride = stride;
+	}
+	for (unsigned int x = 0; x < values.size(); x++)
+	{
+		for (int y = 0; y < n; y++)
+		{
+			double v = values[x][y];
+			uint16_t q;
+			if (v < 0)
+				q = kPackedInfinity;
+			else
+				q = (uint16_t)std::min(floor(v/packedScale+1e-9), (double)(kPackedInfinity-1));
+			packedRows[(uint64_t)y*packedStride+oldCount+x] = q;
+		}
+	}
+}
+
+/*
+ * Largest difference over all pivots. Unused columns are 0 in every row;
+ * the loop has no branches so it compiles to vector max instructions.
+ */
+uint32_t GraphDistanceHeuristic::PackedDifference(graphState state1, graphState state2) const
+{
+	const uint16_t *a = packedRows+(uint64_t)state1*packedStride;
+	const uint16_t *b = packedRows+(uint64_t)state2*packedStride;
+	uint32_t best = 0;
+	for (uint32_t x = 0; x < packedStride; x++)
+	{
+		uint32_t diff = (a[x] > b[x])?(a[x]-b[x]):(b[x]-a[x]);
+		best = (diff > best)?diff:best;
+	}
+	return best;
+}
+
 //GraphMapInconsistentHeuristic::GraphMapInconsistentHeuristic(Map *map, Graph *graph)
 //:m(map), g(graph)
 //{
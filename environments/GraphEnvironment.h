@@ -13,11 +13,13 @@
 #include <stdint.h>
 #include <ext/hash_map>
 #include <iostream>
+#include <thread>
 #include "SearchEnvironment.h"
 #include "UnitSimulation.h"
 #include "Graph.h"
 #include "GraphAbstraction.h"
 #include "GLUtil.h"
+#include "DistanceTable.h"
 
 #ifndef UINT32_MAX
 #define UINT32_MAX        4294967295U
@@ -27,6 +29,7 @@
 #endif
 
 typedef unsigned long graphState;
+class CSRGraph;
 
 class graphMove {
 public:
@@ -155,17 +158,21 @@ private:
 
 class GraphMapPerfectHeuristic : public GraphHeuristic {
 public:
-	GraphMapPerfectHeuristic(Map *map, Graph *graph):m(map), g(graph)
+	GraphMapPerfectHeuristic(Map *map, Graph *graph):m(map), g(graph), table(0)
 	{
 		prob = 0.5;
 		fillProbTable();
 	}
 	Graph *GetGraph() { return g; }
 	void SetProbability(double p) { prob = p; }
+	/** Use exact distances (one row per node, e.g. from FloydWarshall) instead of octile distances */
+	void SetDistanceTable(const DistanceTable *t) { table = t; }
 	double HCost(const graphState &state1, const graphState &state2) const
 	{ // warning: in this implementation HCost(s1,s2) != HCost(s2,s1)
 
 		if (probTable[int(state1)]) {
+			if (table)
+				return table->GetDistance(state1, state2);
 			int x1 = g->GetNode(state1)->GetLabelL(GraphSearchConstants::kMapX);
 			int y1 = g->GetNode(state1)->GetLabelL(GraphSearchConstants::kMapY);
 			int x2 = g->GetNode(state2)->GetLabelL(GraphSearchConstants::kMapX);
@@ -206,6 +213,7 @@ private:
 	Map *m;
 	Graph *g;
 	bool* probTable;
+	const DistanceTable *table;
 };
 
 enum placementScheme {
@@ -216,11 +224,29 @@ enum placementScheme {
 
 class GraphDistanceHeuristic : public GraphHeuristic {
 public:
-	GraphDistanceHeuristic(Graph *graph) :g(graph) { placement = kRandomPlacement; }
+	GraphDistanceHeuristic(Graph *graph)
+	:g(graph), packedRows(0), packedStride(0), packedScale(1), packedExact(true) { placement = kRandomPlacement; }
 	~GraphDistanceHeuristic() {}
 	virtual double HCost(const graphState &state1, const graphState &state2) const;
 	void AddHeuristic(node *n = 0);
-	int GetNumHeuristics() { return heuristics.size(); }
+	/**
+	 * Replaces the heuristics with count new ones, placed by the current
+	 * placement scheme. The Dijkstra searches from up to numThreads pivots
+	 * run at once; pivots in the same batch are spread apart using the
+	 * heuristics of the earlier batches. Distances are stored 16 bits per
+	 * pivot with all pivots of a node together, so HCost reads one short row.
+	 * Later calls to AddHeuristic add to these packed heuristics.
+	 */
+	void BuildHeuristics(int count, int numThreads = std::thread::hardware_concurrency());
+	int GetNumHeuristics() { return table.IsLoaded()?table.GetNumRows():(packed.size()?locations.size():heuristics.size()); }
+	/**
+	 * Writes the heuristics as a DistanceTable; the scale should divide all
+	 * edge costs. Heuristics from BuildHeuristics are written at their own
+	 * scale instead, and marked as rounded if they were.
+	 */
+	bool SaveHeuristics(const char *filename, double scale = 1.0);
+	/** Maps heuristics written by SaveHeuristics; HCost then reads them from the file */
+	bool LoadHeuristics(const char *filename);
 	void SetPlacement(placementScheme s) { placement = s; }
 	Graph *GetGraph() { return g; }
 	void ChooseStartGoal(graphState &start, graphState &goal);
@@ -234,11 +260,29 @@ protected:
 						std::vector<double> &weight);
 	void ComputeSizes(node *n, std::vector<double> &dist,
 					  std::vector<double> &weight, std::vector<double> &sizes);
+	// BuildHeuristics
+	static void GetDistances(const CSRGraph *csr, std::vector<graphState> from, std::vector<double> *values,
+							 std::vector<uint32_t> *parents);
+	void SelectFarPivots(const CSRGraph &csr, const std::vector<double> &minDist,
+						 int count, std::vector<graphState> &batch) const;
+	void SelectAvoidPivots(const CSRGraph &csr, int count, std::vector<graphState> &batch) const;
+	void AddPackedHeuristics(const std::vector<std::vector<double> > &values);
+	uint32_t PackedDifference(graphState state1, graphState state2) const;
 		
 	placementScheme placement;
 	Graph *g;
 	std::vector<std::vector<double> > heuristics;
 	std::vector<graphState> locations;
+	DistanceTable table;
+	// node-major heuristics from BuildHeuristics: packedStride values per
+	// node, each the distance divided by packedScale (kPackedInfinity if
+	// unreachable); rows start on a 64-byte boundary
+	std::vector<uint16_t> packed;
+	uint16_t *packedRows;
+	uint32_t packedStride;
+	double packedScale;
+	bool packedExact; // no rounding: every distance is a multiple of packedScale
+	static const uint16_t kPackedInfinity = 0xFFFF;
 
 	// for avoid node computation
 	std::vector<double> dist;
@@ -14,6 +14,62 @@
 
 using namespace Graphics2D;
 
+/*
+ * Successors of a ground cell for every 3x3 window returned by
+ * Map::GetGroundWindow, in the same order as the CanStep-based code in
+ * GetSuccessors and GetActions.
+ */
+namespace {
+	const int kCenterBit = 0x10;
+	const int kFourConnectedMask = 0xBA; // N, W, E, S and the center
+
+	struct NeighborList {
+		uint8_t count;
+		int8_t dx[8], dy[8];
+		uint8_t dir[8];
+	};
+
+	class NeighborTable {
+	public:
+		NeighborTable()
+		{
+			for (int w = 0; w < 512; w++)
+			{
+				NeighborList &n = entry[w];
+				n.count = 0;
+				bool down = Bit(w, 0, 1), up = Bit(w, 0, -1);
+				if (down)
+					Add(n, 0, 1, kS);
+				if (up)
+					Add(n, 0, -1, kN);
+				if (Bit(w, -1, 0))
+				{
+					if (up && Bit(w, -1, -1))
+						Add(n, -1, -1, kNW);
+					if (down && Bit(w, -1, 1))
+						Add(n, -1, 1, kSW);
+					Add(n, -1, 0, kW);
+				}
+				if (Bit(w, 1, 0))
+				{
+					if (up && Bit(w, 1, -1))
+						Add(n, 1, -1, kNE);
+					if (down && Bit(w, 1, 1))
+						Add(n, 1, 1, kSE);
+					Add(n, 1, 0, kE);
+				}
+			}
+		}
+		NeighborList entry[512];
+	private:
+		static bool Bit(int w, int dx, int dy) { return (w>>(3*(dy+1)+dx+1))&1; }
+		static void Add(NeighborList &n, int dx, int dy, tDirection dir)
+		{ n.dx[n.count] = dx; n.dy[n.count] = dy; n.dir[n.count] = dir; n.count++; }
+	};
+
+	const NeighborTable neighborTable;
+}
+
 MapEnvironment::MapEnvironment(Map *_m, bool useOccupancy)
 {
 	DIAGONAL_COST = ROOT_TWO;
@@ -55,6 +111,20 @@ void MapEnvironment::SetGraphHeuristic(GraphHeuristic *gh)
 
 void MapEnvironment::GetSuccessors(const xyLoc &loc, std::vector<xyLoc> &neighbors) const
 {
+	// fast path for ground cells on octile maps
+	int window = map->GetGroundWindow(loc.x, loc.y);
+	if (window&kCenterBit)
+	{
+		const NeighborList &n = neighborTable.entry[fourConnected?(window&kFourConnectedMask):window];
+		neighbors.resize(n.count);
+		for (int x = 0; x < n.count; x++)
+		{
+			neighbors[x].x = loc.x+n.dx[x];
+			neighbors[x].y = loc.y+n.dy[x];
+		}
+		return;
+	}
+
 	neighbors.resize(0);
 	bool up=false, down=false;
 	// 
@@ -351,6 +421,15 @@ bool MapEnvironment::GetNext8Successor(const xyLoc &currOpenNode, const xyLoc &g
 
 void MapEnvironment::GetActions(const xyLoc &loc, std::vector<tDirection> &actions) const
 {
+	int window = map->GetGroundWindow(loc.x, loc.y);
+	if (window&kCenterBit)
+	{
+		const NeighborList &n = neighborTable.entry[fourConnected?(window&kFourConnectedMask):window];
+		for (int x = 0; x < n.count; x++)
+			actions.push_back((tDirection)n.dir[x]);
+		return;
+	}
+
 	bool up=false, down=false;
 	if ((map->CanStep(loc.x, loc.y, loc.x, loc.y+1)))
 	{
@@ -8,6 +8,9 @@
  */
 
 #include "Map3DGrid.h"
+#include <algorithm>
+#include <math.h>
+#include "FPUtil.h"
 
 int gSectorSize = 16;
 //double gInvSectorSize = 1/16;
@@ -443,7 +446,103 @@ bool SectorData::RemovePoint(int x, int y, int z)
 	return false;
 }
 
+int SectorData::GetEntrance(int region, int offset) const
+{
+	uint16_t key = (region<<8)|offset;
+	std::vector<uint16_t>::const_iterator i = std::lower_bound(entrances.begin(), entrances.end(), key);
+	if ((i == entrances.end()) || (*i != key))
+		return -1;
+	return i-entrances.begin();
+}
+
+uint16_t SectorData::GetDistance(int entrance1, int entrance2) const
+{
+	if (entrance1 == entrance2)
+		return 0;
+	if (entrance1 > entrance2)
+		std::swap(entrance1, entrance2);
+	int n = entrances.size();
+	return distances[entrance1*(2*n-entrance1-1)/2+(entrance2-entrance1-1)];
+}
+
+static double GetSectorPathCost(uint16_t packed)
+{
+	return (packed>>8)+(packed&0xFF)*M_SQRT2;
+}
+
+/**
+ * Dijkstra over the points of one sector, in all of its regions. Point
+ * (region, offset) is cell region*gSectorSize*gSectorSize+offset. Every
+ * thread building tables has its own.
+ */
+class Map3DGrid::SectorSearch {
+public:
+	SectorSearch() :expanded(0) {}
+	/** A* to target, or Dijkstra to every point if target is -1 */
+	void Run(const Map3DGrid *m, int sector, int source, int target = -1);
+	bool Reached(int cell) const { return openClosed.Closed(cell); }
+	double GetCost(int cell) const { return openClosed.Lookat(cell).g; }
+	int GetParent(int cell) const { return openClosed.Lookat(cell).parent; }
+	/** (cardinal moves<<8)|diagonal moves, or kNoSectorPath if either doesn't fit */
+	uint16_t GetPackedCost(int cell) const
+	{
+		const Cell &c = openClosed.Lookat(cell);
+		if ((c.cardinal > 0xFF) || (c.diagonal > 0xFF))
+			return kNoSectorPath;
+		return (c.cardinal<<8)|c.diagonal;
+	}
+	uint64_t expanded;
+private:
+	struct MoveCounts {
+		uint16_t cardinal, diagonal;
+	};
+	typedef IndexedOpenClosed<MoveCounts>::Cell Cell;
+	IndexedOpenClosed<MoveCounts> openClosed;
+	std::vector<state3d> neighbors;
+};
+
+void Map3DGrid::SectorSearch::Run(const Map3DGrid *m, int sector, int source, int target)
+{
+	int cellsPerRegion = gSectorSize*gSectorSize;
+	openClosed.Reset(m->sectors[sector].regions.size()*cellsPerRegion);
+	// with a target this is A*, with the octile distance to the target as heuristic
+	int targetOffset = target%cellsPerRegion;
+	auto h = [&](int offset) {
+		if (target == -1)
+			return 0.0;
+		return m->OctileDistance(offset%gSectorSize, offset/gSectorSize, targetOffset%gSectorSize, targetOffset/gSectorSize);
+	};
+	openClosed.Relax(source, 0, h(source%cellsPerRegion), source);
+	Cell &s = openClosed.Lookup(source);
+	s.cardinal = s.diagonal = 0;
+	uint32_t next;
+	while (openClosed.Pop(next))
+	{
+		openClosed.Close(next);
+		expanded++;
+		if ((int)next == target)
+			return;
+		const Cell &c = openClosed.Lookat(next);
+		int offset = next%cellsPerRegion;
+		m->GetSuccessors(state3d(sector, next/cellsPerRegion, offset), neighbors);
+		for (unsigned int x = 0; x < neighbors.size(); x++)
+		{
+			if (neighbors[x].GetSector() != sector)
+				continue;
+			bool diagonal = ((neighbors[x].GetOffset()%gSectorSize) != (offset%gSectorSize)) &&
+				((neighbors[x].GetOffset()/gSectorSize) != (offset/gSectorSize));
+			int which = neighbors[x].GetRegion()*cellsPerRegion+neighbors[x].GetOffset();
+			if (!openClosed.Relax(which, c.g+(diagonal?M_SQRT2:1.0), h(neighbors[x].GetOffset()), next))
+				continue;
+			Cell &n = openClosed.Lookup(which);
+			n.cardinal = c.cardinal+(diagonal?0:1);
+			n.diagonal = c.diagonal+(diagonal?1:0);
+		}
+	}
+}
+
 Map3DGrid::Map3DGrid(Map *map, int theSectorSize)
+:startSearch(new SectorSearch()), goalSearch(new SectorSearch()), nodesExpanded(0)
 {
 	drawGrid = false;
 	mWidth = map->GetMapWidth();
@@ -457,7 +556,7 @@ Map3DGrid::Map3DGrid(Map *map, int theSectorSize)
 }
 
 Map3DGrid::Map3DGrid(int width, int height, int theSectorSize)
-:mWidth(width), mHeight(height)
+:mWidth(width), mHeight(height), startSearch(new SectorSearch()), goalSearch(new SectorSearch()), nodesExpanded(0)
 {
 	drawGrid = false;
 	gSectorSize = theSectorSize;
@@ -466,6 +565,12 @@ Map3DGrid::Map3DGrid(int width, int height, int theSectorSize)
 	sectors.resize(mXSectors*mYSectors);
 }
 
+Map3DGrid::~Map3DGrid()
+{
+	delete startSearch;
+	delete goalSearch;
+}
+
 
 void Map3DGrid::AddMap(Map *map, int elevation)
 {
@@ -830,14 +935,15 @@ void Map3DGrid::ApplyAction(state3d &s, action3d a) const
 
 double Map3DGrid::HCost(const state3d &node1, const state3d &node2) const
 {
-	assert(false);
-	return 1;
+	int x1, y1, x2, y2;
+	GetXYFromState(node1, x1, y1);
+	GetXYFromState(node2, x2, y2);
+	return OctileDistance(x1, y1, x2, y2);
 }
 
 double Map3DGrid::GCost(const state3d &node1, const state3d &node2) const
 {
-	assert(false);
-	return 1;
+	return HCost(node1, node2);
 }
 
 double Map3DGrid::GCost(const state3d &node, const action3d &act) const
@@ -854,8 +960,7 @@ bool Map3DGrid::GoalTest(const state3d &node, const state3d &goal) const
 
 uint64_t Map3DGrid::GetStateHash(const state3d &node) const
 {
-	assert(false);
-	return 0;
+	return ((uint64_t)node.sector<<16)|(node.region<<8)|node.offset;
 }
 
 uint64_t Map3DGrid::GetActionHash(action3d act) const
@@ -872,6 +977,7 @@ bool Map3DGrid::AddPoint(int x, int y, int z)
 		return false;
 	if ((x < 0) || (y < 0))
 		return false;
+	InvalidateSectors(x, y);
 		
 	bool result = sectors[GetSector(x, y)].AddPoint(x, y, z);
 
@@ -1217,6 +1323,7 @@ int Map3DGrid::InternalRemovePoint(int x, int y, int z)
 	if (found[4] == -1)
 		return -1;
 	//assert(found[4] != -1);
+	InvalidateSectors(x, y);
 	
 	// connect horizontals
 	if (found[1] != -1)
@@ -1645,3 +1752,247 @@ int Map3DGrid::GetGridBytesUsed()
 	}
 	return mem;
 }
+
+int Map3DGrid::GetDistanceTableBytesUsed()
+{
+	int mem = firstEntrance.size()*sizeof(uint32_t)+entranceSector.size()*sizeof(uint16_t);
+	for (unsigned int x = 0; x < sectors.size(); x++)
+		mem += (sectors[x].entrances.size()+sectors[x].distances.size())*sizeof(uint16_t);
+	return mem;
+}
+
+double Map3DGrid::OctileDistance(int x1, int y1, int x2, int y2) const
+{
+	int dx = abs(x1-x2), dy = abs(y1-y2);
+	if (dx < dy)
+		return dx*M_SQRT2+(dy-dx);
+	return dy*M_SQRT2+(dx-dy);
+}
+
+/** Adding or removing (x, y) changes the edges of its neighbors, which may be in other sectors */
+void Map3DGrid::InvalidateSectors(int x, int y)
+{
+	for (int dx = -1; dx <= 1; dx++)
+	{
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			if ((x+dx >= 0) && (x+dx < mWidth) && (y+dy >= 0) && (y+dy < mHeight))
+				sectors[GetSector(x+dx, y+dy)].tableValid = false;
+		}
+	}
+}
+
+void Map3DGrid::BuildDistanceTable(int sector, SectorSearch *search)
+{
+	SectorData &s = sectors[sector];
+	int cellsPerRegion = gSectorSize*gSectorSize;
+	std::vector<state3d> succ;
+	s.entrances.resize(0);
+	for (unsigned int r = 0; r < s.regions.size(); r++)
+	{
+		for (int o = 0; o < cellsPerRegion; o++)
+		{
+			if (s.regions[r].grid.GetHeightOffset(o) == kUnpassableHeight)
+				continue;
+			GetSuccessors(state3d(sector, r, o), succ);
+			for (unsigned int x = 0; x < succ.size(); x++)
+			{
+				if (succ[x].GetSector() != sector)
+				{
+					s.entrances.push_back((r<<8)|o);
+					break;
+				}
+			}
+		}
+	}
+	int n = s.entrances.size();
+	s.distances.assign(n*(n-1)/2, kNoSectorPath);
+	for (int x = 0; x < n; x++)
+	{
+		search->Run(this, sector, (s.entrances[x]>>8)*cellsPerRegion+(s.entrances[x]&0xFF));
+		for (int y = x+1; y < n; y++)
+		{
+			int cell = (s.entrances[y]>>8)*cellsPerRegion+(s.entrances[y]&0xFF);
+			if (search->Reached(cell))
+				s.distances[x*(2*n-x-1)/2+(y-x-1)] = search->GetPackedCost(cell);
+		}
+	}
+	s.tableValid = true;
+}
+
+void Map3DGrid::TableWorker(std::vector<int> *dirty, std::atomic<size_t> *next)
+{
+	SectorSearch search;
+	for (size_t x = (*next)++; x < dirty->size(); x = (*next)++)
+		BuildDistanceTable((*dirty)[x], &search);
+}
+
+void Map3DGrid::UpdateDistanceTables(int numThreads)
+{
+	std::vector<int> dirty;
+	for (unsigned int x = 0; x < sectors.size(); x++)
+		if (!sectors[x].tableValid)
+			dirty.push_back(x);
+	if (dirty.size() == 0)
+		return;
+
+	// sectors only read the points of other sectors, so they can be built in any order
+	numThreads = std::min(std::max(numThreads, 1), (int)dirty.size());
+	std::atomic<size_t> next(0);
+	std::vector<std::thread*> threads(numThreads);
+	for (int x = 1; x < numThreads; x++)
+		threads[x] = new std::thread(&Map3DGrid::TableWorker, this, &dirty, &next);
+	TableWorker(&dirty, &next);
+	for (int x = 1; x < numThreads; x++)
+	{
+		threads[x]->join();
+		delete threads[x];
+	}
+
+	// number the entrances of every sector as nodes of the sector graph, plus one for the goal
+	firstEntrance.resize(sectors.size()+1);
+	entranceSector.resize(0);
+	firstEntrance[0] = 0;
+	for (unsigned int x = 0; x < sectors.size(); x++)
+	{
+		firstEntrance[x+1] = firstEntrance[x]+sectors[x].entrances.size();
+		entranceSector.resize(firstEntrance[x+1], x);
+	}
+	entranceX.resize(firstEntrance.back());
+	entranceY.resize(firstEntrance.back());
+	for (uint32_t t = 0; t < firstEntrance.back(); t++)
+	{
+		int x, y;
+		GetXYFromState(GetEntranceState(t), x, y);
+		entranceX[t] = x;
+		entranceY[t] = y;
+	}
+}
+
+state3d Map3DGrid::GetEntranceState(uint32_t which) const
+{
+	int sector = entranceSector[which];
+	uint16_t e = sectors[sector].entrances[which-firstEntrance[sector]];
+	return state3d(sector, e>>8, e&0xFF);
+}
+
+double Map3DGrid::GetPath(const state3d &from, const state3d &to, std::vector<state3d> &path)
+{
+	path.resize(0);
+	nodesExpanded = 0;
+	UpdateDistanceTables();
+	if (from == to)
+	{
+		path.push_back(from);
+		return 0;
+	}
+
+	// costs from the start and to the goal inside their own sectors
+	int cellsPerRegion = gSectorSize*gSectorSize;
+	int goalCell = to.GetRegion()*cellsPerRegion+to.GetOffset();
+	startSearch->expanded = goalSearch->expanded = 0;
+	startSearch->Run(this, from.GetSector(), from.GetRegion()*cellsPerRegion+from.GetOffset());
+	goalSearch->Run(this, to.GetSector(), goalCell);
+
+	// the goal is the node after the last entrance
+	const uint32_t kStart = UINT32_MAX;
+	uint32_t goal = firstEntrance.back();
+	openClosed.Reset(goal+1);
+	int goalX, goalY;
+	GetXYFromState(to, goalX, goalY);
+	const SectorData &startSector = sectors[from.GetSector()];
+	for (unsigned int e = 0; e < startSector.entrances.size(); e++)
+	{
+		int cell = (startSector.entrances[e]>>8)*cellsPerRegion+(startSector.entrances[e]&0xFF);
+		if (!startSearch->Reached(cell))
+			continue;
+		uint32_t which = firstEntrance[from.GetSector()]+e;
+		openClosed.Relax(which, startSearch->GetCost(cell),
+						 OctileDistance(entranceX[which], entranceY[which], goalX, goalY), kStart);
+	}
+	if ((from.GetSector() == to.GetSector()) && startSearch->Reached(goalCell))
+		openClosed.Relax(goal, startSearch->GetCost(goalCell), 0, kStart);
+
+	uint32_t next;
+	while (openClosed.Pop(next))
+	{
+		openClosed.Close(next);
+		nodesExpanded++;
+		if (next == goal)
+			break;
+
+		double g = openClosed.Lookat(next).g;
+		int sector = entranceSector[next];
+		const SectorData &s = sectors[sector];
+		int e = next-firstEntrance[sector];
+		state3d curr = GetEntranceState(next);
+		int currX = entranceX[next], currY = entranceY[next];
+		// to the other entrances of this sector
+		for (unsigned int f = 0; f < s.entrances.size(); f++)
+		{
+			uint16_t d = s.GetDistance(e, f);
+			if ((f == e) || (d == kNoSectorPath))
+				continue;
+			uint32_t which = firstEntrance[sector]+f;
+			openClosed.Relax(which, g+GetSectorPathCost(d),
+							 OctileDistance(entranceX[which], entranceY[which], goalX, goalY), next);
+		}
+		// into the neighboring sectors
+		GetSuccessors(curr, neighbors);
+		for (unsigned int t = 0; t < neighbors.size(); t++)
+		{
+			if (neighbors[t].GetSector() == sector)
+				continue;
+			int f = sectors[neighbors[t].GetSector()].GetEntrance(neighbors[t].GetRegion(), neighbors[t].GetOffset());
+			assert(f != -1);
+			uint32_t which = firstEntrance[neighbors[t].GetSector()]+f;
+			int x = entranceX[which], y = entranceY[which];
+			openClosed.Relax(which, g+OctileDistance(currX, currY, x, y), OctileDistance(x, y, goalX, goalY), next);
+		}
+		// to the goal
+		if (sector == to.GetSector())
+		{
+			int cell = curr.GetRegion()*cellsPerRegion+curr.GetOffset();
+			if (goalSearch->Reached(cell))
+				openClosed.Relax(goal, g+goalSearch->GetCost(cell), 0, next);
+		}
+	}
+	if (!openClosed.Closed(goal))
+	{
+		nodesExpanded += startSearch->expanded+goalSearch->expanded;
+		return -1;
+	}
+
+	std::vector<uint32_t> chain;
+	for (uint32_t t = openClosed.Lookat(goal).parent; t != kStart; t = openClosed.Lookat(t).parent)
+		chain.push_back(t);
+	path.push_back(from);
+	state3d prev = from;
+	for (int t = (int)chain.size()-1; t >= 0; t--)
+	{
+		state3d next = GetEntranceState(chain[t]);
+		// consecutive entrances in one sector are joined by a table entry
+		if (next.GetSector() == prev.GetSector())
+			RefineSegment(prev, next, path);
+		else
+			path.push_back(next);
+		prev = next;
+	}
+	RefineSegment(prev, to, path);
+	nodesExpanded += startSearch->expanded+goalSearch->expanded;
+	return openClosed.Lookat(goal).g;
+}
+
+/** Appends the points after from up to to; both must be in the same sector */
+void Map3DGrid::RefineSegment(const state3d &from, const state3d &to, std::vector<state3d> &path)
+{
+	int cellsPerRegion = gSectorSize*gSectorSize;
+	int source = from.GetRegion()*cellsPerRegion+from.GetOffset();
+	int target = to.GetRegion()*cellsPerRegion+to.GetOffset();
+	startSearch->Run(this, from.GetSector(), source, target);
+	assert(startSearch->Reached(target));
+	size_t first = path.size();
+	for (int t = target; t != source; t = startSearch->GetParent(t))
+		path.push_back(state3d(from.GetSector(), t/cellsPerRegion, t%cellsPerRegion));
+	std::reverse(path.begin()+first, path.end());
+}
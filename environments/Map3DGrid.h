@@ -15,9 +15,13 @@
 #include <stdlib.h>
 #include <iostream>
 #include <cassert>
+#include <vector>
+#include <thread>
+#include <atomic>
 #include "SearchEnvironment.h"
 #include "UnitSimulation.h"
 #include "ReservationProvider.h"
+#include "IndexedOpenClosed.h"
 #include "BitVector.h"
 #include "GraphEnvironment.h"
 
@@ -154,12 +158,24 @@ public:
 	GridData grid;
 };
 
+// entrances are (region<<8)|offset of every point with a move out of the
+// sector, in increasing order. distances holds the cost between each pair
+// of entrances inside the sector as (cardinal moves<<8)|diagonal moves,
+// upper triangle only, or kNoSectorPath.
+const uint16_t kNoSectorPath = 0xFFFF;
+
 class SectorData {
 public:
+	SectorData() :tableValid(false) {}
 	bool AddPoint(int x, int y, int z);
 	bool RemovePoint(int x, int y, int z);
+	int GetEntrance(int region, int offset) const;
+	uint16_t GetDistance(int entrance1, int entrance2) const;
 	// num regions implicit
 	std::vector<RegionData> regions;
+	std::vector<uint16_t> entrances;
+	std::vector<uint16_t> distances;
+	bool tableValid;
 };
 
 // either sector/region
@@ -201,11 +217,23 @@ class Map3DGrid : public SearchEnvironment<state3d, action3d> {
 public:
 	Map3DGrid(int width, int height, int theSectorSize);
 	Map3DGrid(Map *map, int theSectorSize);
+	~Map3DGrid();
+	Map3DGrid(const Map3DGrid &) = delete;
+	Map3DGrid &operator=(const Map3DGrid &) = delete;
 	int GetWidth() { return mWidth; }
 	int GetHeight() { return mHeight; }
 	void PrintStats();
 	int GetAbstractionBytesUsed();
 	int GetGridBytesUsed();
+	int GetDistanceTableBytesUsed();
+
+	/** Rebuilds the entrance distance tables of every sector changed since the last call */
+	void UpdateDistanceTables(int numThreads = std::thread::hardware_concurrency());
+	/** Returns the cost of the path between two points (-1 if there is none) and fills path
+	 * with the points along it. Only the start and goal sectors and the entrances of the
+	 * other sectors are searched; the path is then refined a sector at a time. */
+	double GetPath(const state3d &from, const state3d &to, std::vector<state3d> &path);
+	uint64_t GetNodesExpanded() const { return nodesExpanded; }
 
 	void AddMap(Map *map, int elevation);
 	void GetSuccessors(const state3d &nodeID, std::vector<state3d> &neighbors) const;
@@ -236,6 +264,14 @@ public:
 	bool GetDrawGrid() { return drawGrid; }
 	void GetPointFromCoordinate(point3d loc, int &px, int &py, int &pz) const;
 private:
+	class SectorSearch;
+	void BuildDistanceTable(int sector, SectorSearch *search);
+	void TableWorker(std::vector<int> *dirty, std::atomic<size_t> *next);
+	void InvalidateSectors(int x, int y);
+	double OctileDistance(int x1, int y1, int x2, int y2) const;
+	state3d GetEntranceState(uint32_t which) const;
+	void RefineSegment(const state3d &from, const state3d &to, std::vector<state3d> &path);
+
 	void AddEdge(state3d &from, state3d &to);
 	int AddGridEdge(state3d &from, state3d &to, bool local);
 	int AddSectorEdge(state3d &from, state3d &to);
@@ -261,6 +297,16 @@ private:
 	int mXSectors, mYSectors;
 	std::vector<SectorData> sectors;
 	bool drawGrid;
+
+	// entrance e of sector s is node firstEntrance[s]+e of the sector graph
+	std::vector<uint32_t> firstEntrance;
+	std::vector<uint16_t> entranceSector;
+	// location of every entrance, for the heuristic
+	std::vector<uint16_t> entranceX, entranceY;
+	IndexedOpenClosed<> openClosed;
+	SectorSearch *startSearch, *goalSearch;
+	std::vector<state3d> neighbors;
+	uint64_t nodesExpanded;
 };
 	
 #endif
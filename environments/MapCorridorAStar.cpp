@@ -0,0 +1,112 @@
+/*
+ *  MapCorridorAStar.cpp
+ *  hog2
+ *
+ *  A* on a MapEnvironment restricted to the cells under a chain of
+ *  abstract nodes.
+ *
+ */
+
+#include "MapCorridorAStar.h"
+#include <algorithm>
+#include "FPUtil.h"
+
+using namespace GraphAbstractionConstants;
+
+MapCorridorAStar::MapCorridorAStar()
+:minX(0), minY(0), width(0), height(0), wordsPerRow(0), corridorSize(0)
+{
+	nodesExpanded = nodesTouched = 0;
+}
+
+void MapCorridorAStar::SetCorridor(MapAbstraction *aMap, const std::vector<node *> &corridor)
+{
+	// collect the cells under every node and their bounding rectangle
+	corridorCells.resize(0);
+	int maxX = -1, maxY = -1;
+	minX = minY = INT32_MAX;
+	stack.assign(corridor.begin(), corridor.end());
+	while (stack.size() > 0)
+	{
+		node *n = stack.back();
+		stack.pop_back();
+		if (aMap->GetAbstractionLevel(n) == 0)
+		{
+			xyLoc l(n->GetLabelL(kFirstData), n->GetLabelL(kFirstData+1));
+			corridorCells.push_back(l);
+			minX = std::min(minX, (int)l.x);
+			minY = std::min(minY, (int)l.y);
+			maxX = std::max(maxX, (int)l.x);
+			maxY = std::max(maxY, (int)l.y);
+			continue;
+		}
+		for (long x = 0; x < aMap->GetNumChildren(n); x++)
+			stack.push_back(aMap->GetNthChild(n, x));
+	}
+	corridorSize = corridorCells.size();
+	if (corridorSize == 0)
+	{
+		minX = minY = 0;
+		width = height = wordsPerRow = 0;
+		mask.resize(0);
+		return;
+	}
+	width = maxX-minX+1;
+	height = maxY-minY+1;
+	wordsPerRow = (width+63)/64;
+	mask.assign((uint64_t)wordsPerRow*height, 0);
+	for (unsigned int x = 0; x < corridorCells.size(); x++)
+	{
+		int dx = corridorCells[x].x-minX;
+		mask[(corridorCells[x].y-minY)*wordsPerRow+dx/64] |= (1ull<<(dx%64));
+	}
+}
+
+void MapCorridorAStar::SetCorridor(MapAbstraction *aMap, path *abstractPath)
+{
+	std::vector<node *> corridor;
+	for (path *p = abstractPath; p; p = p->next)
+		corridor.push_back(p->n);
+	SetCorridor(aMap, corridor);
+}
+
+void MapCorridorAStar::GetPath(MapEnvironment *env, const xyLoc &from, const xyLoc &to, std::vector<xyLoc> &thePath)
+{
+	thePath.resize(0);
+	nodesExpanded = nodesTouched = 0;
+	openClosed.Reset((uint64_t)width*height);
+	if (!InCorridor(from) || !InCorridor(to))
+		return;
+
+	uint32_t start = GetIndex(from), goal = GetIndex(to);
+	openClosed.Relax(start, 0, env->HCost(from, to), start);
+	uint32_t next;
+	while (openClosed.Pop(next))
+	{
+		if (next == goal)
+		{
+			for (uint32_t x = goal; ; x = openClosed.Lookat(x).parent)
+			{
+				thePath.push_back(GetLoc(x));
+				if (openClosed.Lookat(x).parent == x)
+					break;
+			}
+			std::reverse(thePath.begin(), thePath.end());
+			return;
+		}
+		openClosed.Close(next);
+		nodesExpanded++;
+
+		xyLoc loc = GetLoc(next);
+		double g = openClosed.Lookat(next).g;
+		env->GetSuccessors(loc, neighbors);
+		for (unsigned int x = 0; x < neighbors.size(); x++)
+		{
+			if (!InCorridor(neighbors[x]))
+				continue;
+			nodesTouched++;
+			openClosed.Relax(GetIndex(neighbors[x]), g+env->GCost(loc, neighbors[x]),
+							 env->HCost(neighbors[x], to), next);
+		}
+	}
+}
@@ -0,0 +1,70 @@
+/*
+ *  MapCorridorAStar.h
+ *  hog2
+ *
+ *  A* on a MapEnvironment restricted to the cells under a chain of
+ *  abstract nodes.
+ *
+ *  corridorAStar keeps its corridor as a list of nodes and checks every
+ *  neighbor by finding its parent at the corridor level. Here the corridor
+ *  is flattened once, when it is set, into a bitmask over its bounding
+ *  rectangle. The search keeps g-costs and parents in an IndexedOpenClosed
+ *  over the same rectangle, so membership tests and lookups are direct
+ *  indexes.
+ *
+ *  Corridor nodes may come from any level of any MapAbstraction, and
+ *  levels can be mixed. The corridor is kept until it is set again.
+ *
+ */
+
+#ifndef MAPCORRIDORASTAR_H
+#define MAPCORRIDORASTAR_H
+
+#include <stdint.h>
+#include <vector>
+#include "Map2DEnvironment.h"
+#include "MapAbstraction.h"
+#include "Path.h"
+#include "IndexedOpenClosed.h"
+
+class MapCorridorAStar {
+public:
+	MapCorridorAStar();
+	/** The corridor is every cell under the given nodes */
+	void SetCorridor(MapAbstraction *aMap, const std::vector<node *> &corridor);
+	/** The corridor is every cell under the nodes of an abstract path */
+	void SetCorridor(MapAbstraction *aMap, path *abstractPath);
+	bool InCorridor(const xyLoc &l) const
+	{
+		if ((l.x < minX) || (l.y < minY) || (l.x >= minX+width) || (l.y >= minY+height))
+			return false;
+		return (mask[(l.y-minY)*wordsPerRow+(l.x-minX)/64]>>((l.x-minX)%64))&1;
+	}
+	/** Returns an empty path if to can't be reached inside the corridor */
+	void GetPath(MapEnvironment *env, const xyLoc &from, const xyLoc &to, std::vector<xyLoc> &thePath);
+	const char *GetName() { return "MapCorridorAStar"; }
+
+	/** Number of cells in the corridor */
+	uint64_t GetCorridorSize() const { return corridorSize; }
+	/** Number of cells in the bounding rectangle of the corridor */
+	uint64_t GetCorridorArea() const { return (uint64_t)width*height; }
+	uint64_t GetNodesExpanded() const { return nodesExpanded; }
+	uint64_t GetNodesTouched() const { return nodesTouched; }
+	uint64_t GetMemoryUsage() const
+	{ return mask.capacity()*sizeof(uint64_t)+openClosed.GetMemoryUsage(); }
+private:
+	uint32_t GetIndex(const xyLoc &l) const { return (l.y-minY)*width+(l.x-minX); }
+	xyLoc GetLoc(uint32_t index) const { return xyLoc(minX+index%width, minY+index/width); }
+
+	int minX, minY, width, height, wordsPerRow;
+	std::vector<uint64_t> mask;
+	std::vector<xyLoc> corridorCells;
+	std::vector<node *> stack;
+	uint64_t corridorSize;
+
+	IndexedOpenClosed<> openClosed;
+	std::vector<xyLoc> neighbors;
+	uint64_t nodesExpanded, nodesTouched;
+};
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ *  MapLineOfSight.cpp
+ *  hog2
+ *
+ *  Line-of-sight tests between cell centers on an octile Map.
+ *
+ */
+
+#include "MapLineOfSight.h"
+#include <algorithm>
+
+MapLineOfSight::MapLineOfSight(Map *m)
+:map(m)
+{
+	Build();
+}
+
+void MapLineOfSight::Build()
+{
+	width = map->GetMapWidth();
+	height = map->GetMapHeight();
+	wordsPerRow = (width+63)/64;
+	blocked.assign((uint64_t)wordsPerRow*height, 0);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			Update(x, y);
+}
+
+void MapLineOfSight::Update(int x, int y)
+{
+	uint64_t &word = blocked[y*wordsPerRow+(x>>6)];
+	if ((map->GetTerrainType(x, y)>>terrainBits) == (kGround>>terrainBits))
+		word &= ~(1ull<<(x&63));
+	else
+		word |= (1ull<<(x&63));
+}
+
+bool MapLineOfSight::HasLineOfSight(int x1, int y1, int x2, int y2) const
+{
+	if (!IsFree(x1, y1) || !IsFree(x2, y2))
+		return false;
+	if (y1 > y2)
+	{
+		std::swap(x1, x2);
+		std::swap(y1, y2);
+	}
+	if (y1 == y2)
+		return SpanFree(y1, std::min(x1, x2), std::max(x1, x2));
+
+	// Doubled coordinates, so cell centers are integers: the center of
+	// (x, y) is (2x+1, 2y+1) and row y covers heights 2y..2y+2. The
+	// segment is at width (X1*dy+(Y-Y1)*dx)/dy at height Y, so each run
+	// end is kept as a numerator over dy.
+	int64_t dx = 2*(int64_t)(x2-x1), dy = 2*(int64_t)(y2-y1);
+	int64_t X1 = 2*(int64_t)x1+1, Y1 = 2*(int64_t)y1+1, Y2 = 2*(int64_t)y2+1;
+	for (int y = y1; y <= y2; y++)
+	{
+		int64_t lo = std::max(2*(int64_t)y, Y1), hi = std::min(2*(int64_t)y+2, Y2);
+		int64_t a = X1*dy+(lo-Y1)*dx, b = X1*dy+(hi-Y1)*dx;
+		if (a > b)
+			std::swap(a, b);
+		// cells c where [2c, 2c+2] meets [a/dy, b/dy]; a >= dy, so a-1 >= 0
+		if (!SpanFree(y, (int)((a-1)/(2*dy)), (int)(b/(2*dy))))
+			return false;
+	}
+	return true;
+}
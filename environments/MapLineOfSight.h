@@ -0,0 +1,75 @@
+/*
+ *  MapLineOfSight.h
+ *  hog2
+ *
+ *  Line-of-sight tests between cell centers on an octile Map.
+ *
+ *  Blocked cells are kept as one bit per cell, packed into 64-bit words
+ *  row by row. A segment between two cell centers crosses each row it
+ *  passes through in a single run of cells, so the test computes that run
+ *  exactly (in integer arithmetic) and checks it against the row with
+ *  word masks, instead of stepping cell by cell.
+ *
+ *  The test is a supercover: every cell the segment touches, even at a
+ *  single corner, must be free. A segment passing exactly through a corner
+ *  is therefore blocked by either of the diagonal cells there, which is the
+ *  same rule MapEnvironment uses for diagonal moves, so every move it
+ *  allows has line of sight.
+ *
+ *  Only ground cells are free. Call Update after changing a tile of the
+ *  map, or Build after larger changes.
+ *
+ */
+
+#ifndef MAPLINEOFSIGHT_H
+#define MAPLINEOFSIGHT_H
+
+#include <stdint.h>
+#include <vector>
+#include "Map.h"
+#include "Map2DEnvironment.h"
+
+class MapLineOfSight {
+public:
+	MapLineOfSight(Map *m);
+	/** Rebuilds the bitmap from the whole map */
+	void Build();
+	/** Updates the bit for a single tile */
+	void Update(int x, int y);
+
+	bool IsFree(int x, int y) const
+	{
+		if ((x < 0) || (y < 0) || (x >= width) || (y >= height))
+			return false;
+		return ((blocked[y*wordsPerRow+(x>>6)]>>(x&63))&1) == 0;
+	}
+	/** True if the cells x1..x2 (inclusive, x1 <= x2) of row y are all free */
+	bool SpanFree(int y, int x1, int x2) const
+	{
+		const uint64_t *row = &blocked[y*wordsPerRow];
+		int w1 = x1>>6, w2 = x2>>6;
+		uint64_t first = ~0ull<<(x1&63), last = ~0ull>>(63-(x2&63));
+		if (w1 == w2)
+			return (row[w1]&first&last) == 0;
+		if (row[w1]&first)
+			return false;
+		for (int w = w1+1; w < w2; w++)
+			if (row[w])
+				return false;
+		return (row[w2]&last) == 0;
+	}
+	bool HasLineOfSight(int x1, int y1, int x2, int y2) const;
+	bool HasLineOfSight(const xyLoc &a, const xyLoc &b) const
+	{ return HasLineOfSight(a.x, a.y, b.x, b.y); }
+
+	Map *GetMap() const { return map; }
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+	uint64_t GetMemoryUsage() const { return blocked.capacity()*sizeof(uint64_t); }
+private:
+	Map *map;
+	int width, height, wordsPerRow;
+	std::vector<uint64_t> blocked;
+};
+
+#endif
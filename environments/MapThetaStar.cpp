@@ -0,0 +1,139 @@
+/*
+ *  MapThetaStar.cpp
+ *  hog2
+ *
+ *  Any-angle paths on an octile Map with Theta*.
+ *
+ */
+
+#include "MapThetaStar.h"
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+#include "FPUtil.h"
+
+static const int dx[8] = { 0, 0, -1, 1, -1, 1, -1, 1 };
+static const int dy[8] = { -1, 1, 0, 0, -1, -1, 1, 1 };
+
+MapThetaStar::MapThetaStar(Map *m)
+:los(m), lazy(true)
+{
+	nodesExpanded = nodesTouched = losChecks = 0;
+}
+
+double MapThetaStar::GetPathLength(const std::vector<xyLoc> &thePath)
+{
+	double length = 0;
+	for (unsigned int x = 1; x < thePath.size(); x++)
+	{
+		double dx = (double)thePath[x].x-thePath[x-1].x;
+		double dy = (double)thePath[x].y-thePath[x-1].y;
+		length += sqrt(dx*dx+dy*dy);
+	}
+	return length;
+}
+
+double MapThetaStar::Distance(uint32_t a, uint32_t b) const
+{
+	int w = los.GetWidth();
+	double dx = (double)(int)(a%w)-(int)(b%w);
+	double dy = (double)(int)(a/w)-(int)(b/w);
+	return sqrt(dx*dx+dy*dy);
+}
+
+bool MapThetaStar::CanMove(const xyLoc &l, int dir) const
+{
+	int nx = l.x+dx[dir], ny = l.y+dy[dir];
+	if (!los.IsFree(nx, ny))
+		return false;
+	// no cutting corners, as in MapEnvironment
+	if ((dx[dir] != 0) && (dy[dir] != 0))
+		return los.IsFree(nx, l.y) && los.IsFree(l.x, ny);
+	return true;
+}
+
+void MapThetaStar::GetPath(const xyLoc &from, const xyLoc &to, std::vector<xyLoc> &thePath)
+{
+	thePath.resize(0);
+	nodesExpanded = nodesTouched = losChecks = 0;
+	openClosed.Reset((uint64_t)los.GetWidth()*los.GetHeight());
+	if (!los.IsFree(from.x, from.y) || !los.IsFree(to.x, to.y))
+		return;
+
+	uint32_t start = GetIndex(from.x, from.y), goal = GetIndex(to.x, to.y);
+	openClosed.Relax(start, 0, Distance(start, goal), start);
+	uint32_t next;
+	while (openClosed.Pop(next))
+	{
+		IndexedOpenClosed<>::Cell &c = openClosed.Lookup(next);
+		xyLoc loc = GetLoc(next);
+		// a lazily assigned parent is checked before the cell is used
+		if (lazy && (c.parent != next))
+		{
+			losChecks++;
+			xyLoc parentLoc = GetLoc(c.parent);
+			if (!los.HasLineOfSight(parentLoc.x, parentLoc.y, loc.x, loc.y))
+			{
+				// the cell that generated us was expanded, so this always finds a parent
+				c.g = DBL_MAX;
+				for (int x = 0; x < 8; x++)
+				{
+					if (!CanMove(loc, x))
+						continue;
+					uint32_t which = GetIndex(loc.x+dx[x], loc.y+dy[x]);
+					if (!openClosed.Closed(which))
+						continue;
+					double g = openClosed.Lookat(which).g+Distance(which, next);
+					if (fless(g, c.g))
+					{
+						c.g = g;
+						c.parent = which;
+					}
+				}
+			}
+		}
+		if (next == goal)
+		{
+			for (uint32_t x = goal; ; x = openClosed.Lookat(x).parent)
+			{
+				thePath.push_back(GetLoc(x));
+				if (openClosed.Lookat(x).parent == x)
+					break;
+			}
+			std::reverse(thePath.begin(), thePath.end());
+			return;
+		}
+		openClosed.Close(next);
+		nodesExpanded++;
+
+		uint32_t parent = c.parent;
+		double g = c.g, parentG = openClosed.Lookat(parent).g;
+		xyLoc parentLoc = GetLoc(parent);
+		for (int x = 0; x < 8; x++)
+		{
+			if (!CanMove(loc, x))
+				continue;
+			int nx = loc.x+dx[x], ny = loc.y+dy[x];
+			nodesTouched++;
+			uint32_t which = GetIndex(nx, ny);
+			if (openClosed.Closed(which))
+				continue;
+
+			// connect straight to our parent if it can be seen; lazily,
+			// assume it can and check when the child is expanded
+			uint32_t childParent = next;
+			if (lazy)
+				childParent = parent;
+			else if (parent != next)
+			{
+				losChecks++;
+				if (los.HasLineOfSight(parentLoc.x, parentLoc.y, nx, ny))
+					childParent = parent;
+			}
+			if (childParent == parent)
+				openClosed.Relax(which, parentG+Distance(parent, which), Distance(which, goal), parent);
+			else
+				openClosed.Relax(which, g+Distance(next, which), Distance(which, goal), next);
+		}
+	}
+}
@@ -0,0 +1,70 @@
+/*
+ *  MapThetaStar.h
+ *  hog2
+ *
+ *  Any-angle paths on an octile Map with Theta*.
+ *
+ *  Theta* expands the same 8-connected grid as MapEnvironment, but when a
+ *  cell is reached it first tries to connect it straight to the parent of
+ *  the cell being expanded; if there is line of sight that parent becomes
+ *  its parent. Paths are returned as their corners only, and consecutive
+ *  corners can be any distance apart in any direction, so there is no
+ *  separate smoothing pass. Costs are Euclidean, as is the heuristic.
+ *
+ *  Theta* paths are never longer than the octile A* path (every grid move
+ *  has line of sight) and are usually within a fraction of a percent of
+ *  the true shortest any-angle path, but they aren't guaranteed optimal.
+ *
+ *  Lazy Theta* is used by default: a cell is given its grandparent as
+ *  parent without a test, and the line of sight is only checked when the
+ *  cell is expanded, falling back to its best expanded neighbor if it
+ *  fails. Many generated cells are never expanded, so this needs far fewer
+ *  tests for paths of about the same length.
+ *
+ *  Lines of sight are tested with a MapLineOfSight, which must be updated
+ *  through GetLineOfSight when the map changes. Per-cell search data is
+ *  kept in an IndexedOpenClosed over the whole map.
+ *
+ */
+
+#ifndef MAPTHETASTAR_H
+#define MAPTHETASTAR_H
+
+#include <stdint.h>
+#include <vector>
+#include "MapLineOfSight.h"
+#include "IndexedOpenClosed.h"
+
+class MapThetaStar {
+public:
+	MapThetaStar(Map *m);
+	/** Fills thePath with the corners of the path; empty if to can't be reached */
+	void GetPath(const xyLoc &from, const xyLoc &to, std::vector<xyLoc> &thePath);
+	const char *GetName() { return "MapThetaStar"; }
+
+	/** Euclidean length of a path of corners */
+	static double GetPathLength(const std::vector<xyLoc> &thePath);
+	MapLineOfSight &GetLineOfSight() { return los; }
+	/** Lazy Theta* (the default) only checks line of sight when a cell is expanded */
+	void SetLazy(bool l) { lazy = l; }
+	bool GetLazy() const { return lazy; }
+
+	uint64_t GetNodesExpanded() const { return nodesExpanded; }
+	uint64_t GetNodesTouched() const { return nodesTouched; }
+	uint64_t GetLineOfSightChecks() const { return losChecks; }
+	uint64_t GetMemoryUsage() const
+	{ return los.GetMemoryUsage()+openClosed.GetMemoryUsage(); }
+private:
+	uint32_t GetIndex(int x, int y) const { return y*los.GetWidth()+x; }
+	xyLoc GetLoc(uint32_t index) const { return xyLoc(index%los.GetWidth(), index/los.GetWidth()); }
+	double Distance(uint32_t a, uint32_t b) const;
+	/** True if MapEnvironment would allow the move from l in direction dir */
+	bool CanMove(const xyLoc &l, int dir) const;
+
+	MapLineOfSight los;
+	bool lazy;
+	IndexedOpenClosed<> openClosed;
+	uint64_t nodesExpanded, nodesTouched, losChecks;
+};
+
+#endif
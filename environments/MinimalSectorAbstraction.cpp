@@ -50,7 +50,7 @@ int sectorSize = 11;
  */
 
 MinimalSectorAbstraction::MinimalSectorAbstraction(Map *m, int theSectorSize)
-:map(m)
+:map(m), window(4), nodesExpanded(0)
 {
 	sectorSize = theSectorSize;
     numYSectors = ((map->GetMapHeight()+sectorSize-1)/sectorSize);
@@ -60,6 +60,14 @@ MinimalSectorAbstraction::MinimalSectorAbstraction(Map *m, int theSectorSize)
     sectors.resize(absSize);
     BuildAbstraction();
     optimizationIndex = (int)sectors.size();
+    abstractEnv = new MinimalSectorEnvironment(this);
+    corridor = new MinimalSectorCorridor(map, this);
+}
+
+MinimalSectorAbstraction::~MinimalSectorAbstraction()
+{
+    delete abstractEnv;
+    delete corridor;
 }
 
 /**
@@ -112,6 +120,7 @@ void MinimalSectorAbstraction::BuildAbstraction()
         edges += sectors[x].numEdges;
     }
     printf("%d regions and %d edges\n", nodes, edges);
+    BuildQueryCache();
     //OptimizeRegionLocations();
     ComputePotentialMemorySavings();
 }
@@ -635,7 +644,7 @@ void MinimalSectorAbstraction::GetNeighbors(unsigned int sector,
  * \return The sector in the particular direction
  */
 int MinimalSectorAbstraction::GetAdjacentSector(unsigned int sector,
-                                                int direction)
+                                                int direction) const
 {
     switch (direction) {
         case 0: return sector-numXSectors; // up
@@ -919,6 +928,7 @@ void MinimalSectorAbstraction::ResetAbstractCenter(int sector, int region)
 {
     uint8_t defaultCenter = GetAbstractLocation(areas[sector], region+1);
     memory[sectors[sector].memoryAddress+2*region] = defaultCenter;
+    UpdateRegionCenter(sector, region);
 }
 
 /**
@@ -968,7 +978,10 @@ void MinimalSectorAbstraction::MoveRegionCenter(int sector, int region)
     }
     printf("For %d:%d, error improved to %f at offset %d\n", sector, region, error, best);
     if (best != -1)
+    {
         memory[sectors[sector].memoryAddress+2*region] = best;
+        UpdateRegionCenter(sector, region);
+    }
 }
 
 /**
@@ -1072,3 +1085,249 @@ void MinimalSectorAbstraction::ComputePotentialMemorySavings()
     }
     printf("%d default sectors would save %d bytes\n", defaultSectors, (8+2)*defaultSectors);
 }
+
+/**
+ * MinimalSectorAbstraction::BuildQueryCache()
+ *
+ * \brief Unpack the region centers for use by GetPath()
+ *
+ * The compressed abstraction only stores the offset of each center within
+ * its sector, and finding a region's data means walking to the sector's
+ * address. For queries we keep the index of each sector's first region and
+ * the map location of every region center.
+ *
+ * \param none
+ * \return none
+ */
+void MinimalSectorAbstraction::BuildQueryCache()
+{
+    regionStart.resize(sectors.size()+1);
+    regionStart[0] = 0;
+    for (unsigned int x = 0; x < sectors.size(); x++)
+        regionStart[x+1] = regionStart[x]+sectors[x].numRegions;
+    centers.resize(regionStart[sectors.size()]);
+    for (unsigned int x = 0; x < sectors.size(); x++)
+        for (int y = 0; y < sectors[x].numRegions; y++)
+            UpdateRegionCenter(x, y);
+}
+
+/**
+ * MinimalSectorAbstraction::UpdateRegionCenter()
+ *
+ * \brief Copy a region center from the compressed data into the query cache
+ *
+ * \param sector The sector of the region
+ * \param region The region in the sector
+ * \return none
+ */
+void MinimalSectorAbstraction::UpdateRegionCenter(int sector, int region)
+{
+    unsigned int x, y;
+    GetXYLocation(sector, region, x, y);
+    centers[regionStart[sector]+region].x = x;
+    centers[regionStart[sector]+region].y = y;
+}
+
+/**
+ * MinimalSectorAbstraction::GetSuccessorRegions()
+ *
+ * \brief Decode the neighbors of a region from the compressed edges
+ *
+ * Like GetNeighbors(), but returns abstract states, (sector<<8)|region,
+ * so the result can be used directly by a search.
+ *
+ * \param s The region, as (sector<<8)|region
+ * \param neighbors On return contains the regions adjacent to s
+ * \return none
+ */
+void MinimalSectorAbstraction::GetSuccessorRegions(uint32_t s, std::vector<uint32_t> &neighbors) const
+{
+    neighbors.resize(0);
+    unsigned int sector = s>>8;
+    unsigned int region = s&0xFF;
+    const uint8_t *info = &memory[sectors[sector].memoryAddress];
+    int edgeStart = (region == 0)?0:info[(region-1)*2+1];
+    int edgeEnd = info[region*2+1];
+    const uint8_t *edges = info+2*sectors[sector].numRegions;
+    for (int x = edgeStart; x < edgeEnd; x++)
+    {
+#ifdef DIAG_MOVES
+        int direction = (edges[x]>>5)&0x7;
+        uint32_t to = edges[x]&0x1F;
+#else
+        int direction = (edges[x]>>6)&0x3;
+        uint32_t to = edges[x]&0x3F;
+#endif
+        neighbors.push_back((GetAdjacentSector(sector, direction)<<8)|to);
+    }
+}
+
+/**
+ * MinimalSectorAbstraction::GetPath()
+ *
+ * \brief Find a path using the compressed abstraction
+ *
+ * Plans a path on the region graph from the start region to the goal
+ * region, then refines it window regions at a time. Each refinement is
+ * an A* search from the end of the path so far to the center of the last
+ * region in the window (or the goal, in the last window), limited to the
+ * sectors of the regions in the window. Like PRA*, the path isn't optimal.
+ *
+ * \param start The start location
+ * \param goal The goal location
+ * \param path On return contains the path, or is empty if there is none
+ * \return none
+ */
+void MinimalSectorAbstraction::GetPath(const xyLoc &start, const xyLoc &goal, std::vector<xyLoc> &path)
+{
+    path.resize(0);
+    nodesExpanded = 0;
+    int startSector = GetSector(start.x, start.y);
+    int goalSector = GetSector(goal.x, goal.y);
+    if ((startSector == -1) || (goalSector == -1))
+        return;
+    int startRegion = GetRegion(start.x, start.y);
+    int goalRegion = GetRegion(goal.x, goal.y);
+    if ((startRegion == -1) || (goalRegion == -1))
+        return;
+
+    uint32_t from = (startSector<<8)|startRegion;
+    uint32_t to = (goalSector<<8)|goalRegion;
+    if (from == to)
+    {
+        abstractPath.assign(1, from);
+    }
+    else {
+        abstractSearch.GetPath(abstractEnv, from, to, abstractPath);
+        nodesExpanded += abstractSearch.GetNodesExpanded();
+        if (abstractPath.size() == 0)
+            return;
+    }
+
+    path.push_back(start);
+    xyLoc current = start;
+    unsigned int next = 0;
+    while (true)
+    {
+        unsigned int last = next+window;
+        if (last >= abstractPath.size())
+            last = abstractPath.size()-1;
+        corridor->ClearCorridor();
+        for (unsigned int x = next; x <= last; x++)
+            corridor->AddSector(abstractPath[x]>>8);
+        xyLoc target = goal;
+        if (last != abstractPath.size()-1)
+        {
+            const regionCenter &c = GetRegionCenter(abstractPath[last]);
+            target.x = c.x;
+            target.y = c.y;
+        }
+        corridorSearch.GetPath(corridor, current, target, segment);
+        nodesExpanded += corridorSearch.GetNodesExpanded();
+        if (segment.size() == 0)
+        {
+            path.resize(0);
+            return;
+        }
+        path.insert(path.end(), segment.begin()+1, segment.end());
+        if (last == abstractPath.size()-1)
+            break;
+        current = target;
+        next = last;
+    }
+}
+
+/**
+ * MinimalSectorAbstraction::PrintMemoryReport()
+ *
+ * \brief Print the memory used by the abstraction and the query cache
+ *
+ * \param none
+ * \return none
+ */
+void MinimalSectorAbstraction::PrintMemoryReport()
+{
+    double cells = map->GetMapWidth()*map->GetMapHeight();
+    printf("%d sectors, %d regions, %d map cells\n", (int)sectors.size(), (int)centers.size(), (int)cells);
+    printf("Abstraction: %d bytes (%1.4f bytes/cell)\n", GetAbstractionBytesUsed(), GetAbstractionBytesUsed()/cells);
+    printf("Query cache: %d bytes (%1.4f bytes/cell)\n", GetCacheBytesUsed(), GetCacheBytesUsed()/cells);
+}
+
+double MinimalSectorEnvironment::HCost(const uint32_t &s1, const uint32_t &s2) const
+{
+    const regionCenter &a = msa->GetRegionCenter(s1);
+    const regionCenter &b = msa->GetRegionCenter(s2);
+    double dx = (a.x > b.x)?(a.x-b.x):(b.x-a.x);
+    double dy = (a.y > b.y)?(a.y-b.y):(b.y-a.y);
+    if (dx > dy)
+        return dx-dy+dy*ROOT_TWO;
+    return dy-dx+dx*ROOT_TWO;
+}
+
+void MinimalSectorEnvironment::GetSuccessors(const uint32_t &s, std::vector<uint32_t> &neighbors) const
+{
+    msa->GetSuccessorRegions(s, neighbors);
+}
+
+void MinimalSectorEnvironment::GetActions(const uint32_t &s, std::vector<uint8_t> &actions) const
+{
+    std::vector<uint32_t> neighbors;
+    msa->GetSuccessorRegions(s, neighbors);
+    actions.resize(0);
+    for (unsigned int x = 0; x < neighbors.size(); x++)
+        actions.push_back(x);
+}
+
+uint8_t MinimalSectorEnvironment::GetAction(const uint32_t &s1, const uint32_t &s2) const
+{
+    std::vector<uint32_t> neighbors;
+    msa->GetSuccessorRegions(s1, neighbors);
+    for (unsigned int x = 0; x < neighbors.size(); x++)
+        if (neighbors[x] == s2)
+            return x;
+    assert(!"No edge between regions");
+    return 0;
+}
+
+void MinimalSectorEnvironment::ApplyAction(uint32_t &s, uint8_t a) const
+{
+    std::vector<uint32_t> neighbors;
+    msa->GetSuccessorRegions(s, neighbors);
+    assert(a < neighbors.size());
+    s = neighbors[a];
+}
+
+double MinimalSectorEnvironment::GCost(const uint32_t &s, const uint8_t &a) const
+{
+    uint32_t next = s;
+    ApplyAction(next, a);
+    return HCost(s, next);
+}
+
+MinimalSectorCorridor::MinimalSectorCorridor(Map *m, MinimalSectorAbstraction *msa)
+:MapEnvironment(m), msa(msa), generation(0)
+{
+    inCorridor.resize(msa->GetNumSectors());
+}
+
+void MinimalSectorCorridor::ClearCorridor()
+{
+    generation++;
+    if (generation == 0)
+    {
+        inCorridor.assign(inCorridor.size(), 0);
+        generation = 1;
+    }
+}
+
+void MinimalSectorCorridor::GetSuccessors(const xyLoc &s, std::vector<xyLoc> &neighbors) const
+{
+    MapEnvironment::GetSuccessors(s, neighbors);
+    unsigned int kept = 0;
+    for (unsigned int x = 0; x < neighbors.size(); x++)
+    {
+        if (inCorridor[msa->GetSector(neighbors[x].x, neighbors[x].y)] == generation)
+            neighbors[kept++] = neighbors[x];
+    }
+    neighbors.resize(kept);
+}
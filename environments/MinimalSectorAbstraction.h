@@ -35,6 +35,8 @@
 
 #include <vector>
 #include "Map.h"
+#include "Map2DEnvironment.h"
+#include "TemplateAStar.h"
 
 #ifndef MINIMALSECTORABSTRACTION_H
 #define MINIMALSECTORABSTRACTION_H
@@ -77,6 +79,62 @@ inline bool operator==(const tempEdgeData& x, const tempEdgeData& y)
   return ((x.to == y.to) && (x.from == y.from) && (x.direction == y.direction));
 }
 
+struct regionCenter {
+  uint16_t x, y;
+};
+
+class MinimalSectorAbstraction;
+
+/**
+ * MinimalSectorEnvironment
+ *
+ * \brief Search environment over the compressed sector graph
+ *
+ * States are (sector<<8)|region. Successors are decoded straight from the
+ * packed edge bytes, and costs are octile distances between the cached
+ * region centers. An action is the index of an edge in the region's edge list.
+ */
+class MinimalSectorEnvironment : public SearchEnvironment<uint32_t, uint8_t> {
+ public:
+  MinimalSectorEnvironment(const MinimalSectorAbstraction *msa) :msa(msa) {}
+  void GetSuccessors(const uint32_t &s, std::vector<uint32_t> &neighbors) const;
+  void GetActions(const uint32_t &s, std::vector<uint8_t> &actions) const;
+  uint8_t GetAction(const uint32_t &s1, const uint32_t &s2) const;
+  void ApplyAction(uint32_t &s, uint8_t a) const;
+  bool InvertAction(uint8_t &) const { return false; }
+  double HCost(const uint32_t &s1, const uint32_t &s2) const;
+  double GCost(const uint32_t &s1, const uint32_t &s2) const { return HCost(s1, s2); }
+  double GCost(const uint32_t &s, const uint8_t &a) const;
+  bool GoalTest(const uint32_t &s, const uint32_t &goal) const { return s == goal; }
+  uint64_t GetStateHash(const uint32_t &s) const { return s; }
+  uint64_t GetActionHash(uint8_t a) const { return a; }
+  void OpenGLDraw() const {}
+  void OpenGLDraw(const uint32_t &) const {}
+  void OpenGLDraw(const uint32_t &, const uint8_t &) const {}
+ private:
+  const MinimalSectorAbstraction *msa;
+};
+
+/**
+ * MinimalSectorCorridor
+ *
+ * \brief A MapEnvironment limited to a set of sectors
+ *
+ * Used to refine abstract paths; only successors inside the sectors added
+ * since the last ClearCorridor() are generated.
+ */
+class MinimalSectorCorridor : public MapEnvironment {
+ public:
+  MinimalSectorCorridor(Map *m, MinimalSectorAbstraction *msa);
+  void ClearCorridor();
+  void AddSector(int sector) { inCorridor[sector] = generation; }
+  void GetSuccessors(const xyLoc &s, std::vector<xyLoc> &neighbors) const;
+ private:
+  MinimalSectorAbstraction *msa;
+  std::vector<uint32_t> inCorridor;
+  uint32_t generation;
+};
+
 /**
 * MinimalSectorAbstraction
  *
@@ -87,10 +145,15 @@ inline bool operator==(const tempEdgeData& x, const tempEdgeData& y)
  * The abstraction is optimized to use relatively little memory.
  * This is the first version of the abstraction that I wrote.
  * The code could be a bit cleaner...but it works
+ *
+ * GetPath() plans on the compressed sector graph directly and then refines
+ * the abstract path a few regions at a time, with A* limited to the sectors
+ * of those regions.
  */
 class MinimalSectorAbstraction {
  public:
   MinimalSectorAbstraction(Map *map, int sectorSize);
+  ~MinimalSectorAbstraction();
   void OpenGLDraw();
   int GetSector(int x, int y);
   int GetRegion(int x, int y);
@@ -98,14 +161,32 @@ class MinimalSectorAbstraction {
                      unsigned int &x, unsigned int &y);
   void GetNeighbors(unsigned int sector, unsigned int region,
             std::vector<tempEdgeData> &edges);
-  int GetAdjacentSector(unsigned int sector, int direction);
+  int GetAdjacentSector(unsigned int sector, int direction) const;
 
   void OptimizeRegionLocations();
   void InitializeOptimization();
   bool PerformOneOptimizationStep();
 	int GetAbstractionBytesUsed() { return sectors.size()*4+memory.size(); }
+
+  void GetPath(const xyLoc &start, const xyLoc &goal, std::vector<xyLoc> &path);
+  /** Number of abstract regions each corridor search refines (default 4) */
+  void SetRefinementWindow(int regions) { window = (regions < 1)?1:regions; }
+  int GetRefinementWindow() const { return window; }
+  /** Nodes expanded by the abstract and corridor searches of the last GetPath */
+  uint64_t GetNodesExpanded() const { return nodesExpanded; }
+  /** Bytes of the region center and region index caches used by GetPath */
+  int GetCacheBytesUsed() const
+  { return (int)(regionStart.size()*sizeof(uint32_t)+centers.size()*sizeof(regionCenter)); }
+  void PrintMemoryReport();
+
+  int GetNumSectors() const { return (int)sectors.size(); }
+  void GetSuccessorRegions(uint32_t s, std::vector<uint32_t> &neighbors) const;
+  const regionCenter &GetRegionCenter(uint32_t s) const
+  { return centers[regionStart[s>>8]+(s&0xFF)]; }
  private:
   void BuildAbstraction();
+  void BuildQueryCache();
+  void UpdateRegionCenter(int sector, int region);
   void GetEdges(std::vector<std::vector<int> > &areas,
         int xSector, int ySector,
         std::vector<tempEdgeData> &edges);
@@ -144,6 +225,19 @@ class MinimalSectorAbstraction {
   std::vector<std::vector<int> > areas;
 
   int optimizationIndex;
+
+  // query cache: first region of each sector, and each region's center
+  std::vector<uint32_t> regionStart;
+  std::vector<regionCenter> centers;
+  int window;
+  uint64_t nodesExpanded;
+  // the searches keep their first environment as the heuristic, so these live as long as they do
+  MinimalSectorEnvironment *abstractEnv;
+  MinimalSectorCorridor *corridor;
+  TemplateAStar<uint32_t, uint8_t, MinimalSectorEnvironment> abstractSearch;
+  TemplateAStar<xyLoc, tDirection, MapEnvironment> corridorSearch;
+  std::vector<uint32_t> abstractPath;
+  std::vector<xyLoc> segment;
 };
 
 #endif
@@ -812,6 +812,12 @@ void RubiksCube::OpenGLDraw(const RubiksState&, const RubiksAction&) const
 
 int RubiksCube::Edge12PDBDist(const RubiksState &s)
 {
+	if (edge12 != 0)
+	{
+		int64_t r1, r2;
+		e.rankPlayer(s.edge, 0, r1, r2);
+		return edge12->Get(edge12Start[r1]+r2);
+	}
 	if (f == 0)
 		f = new DiskBitFile("/data/rubik/res/RC");
 	int64_t bucket;
@@ -820,6 +826,43 @@ int RubiksCube::Edge12PDBDist(const RubiksState &s)
 	return f->ReadFileDepth(data[bucket].bucketID, data[bucket].bucketOffset+offset);
 }
 
+// the table drops the alignment padding between the entries of data[x]
+bool RubiksCube::WriteEdge12PDB(const char *filename)
+{
+	if (f == 0)
+		f = new DiskBitFile("/data/rubik/res/RC");
+	uint64_t total = 0;
+	for (unsigned int x = 0; x < data.size(); x++)
+		total += data[x].numEntries;
+	DistanceTableWriter w(filename, 1, total);
+	for (unsigned int x = 0; x < data.size(); x++)
+	{
+		for (int64_t y = data[x].bucketOffset; y < data[x].bucketOffset+data[x].numEntries; y++)
+			w.Add(f->ReadFileDepth(data[x].bucketID, y));
+	}
+	return w.Close();
+}
+
+bool RubiksCube::LoadEdge12PDB(const char *filename)
+{
+	DistanceTable *t = new DistanceTable();
+	edge12Start.resize(data.size());
+	uint64_t total = 0;
+	for (unsigned int x = 0; x < data.size(); x++)
+	{
+		edge12Start[x] = total;
+		total += data[x].numEntries;
+	}
+	if (!t->Load(filename) || t->GetNumEntries() != total)
+	{
+		delete t;
+		return false;
+	}
+	delete edge12;
+	edge12 = t;
+	return true;
+}
+
 
 RubikPDB::RubikPDB(RubiksCube *e, const RubiksState &s, std::vector<int> distinctEdges, std::vector<int> distinctCorners)
 :PDBHeuristic(e), ePDB(&e->e, s.edge, distinctEdges), cPDB(&e->c, s.corner, distinctCorners), edges(distinctEdges), corners(distinctCorners)
@@ -19,6 +19,7 @@
 #include "RubiksCube7Edges.h"
 #include "FourBitArray.h"
 #include "DiskBitFile.h"
+#include "DistanceTable.h"
 #include "EnvUtil.h"
 #include "Bloom.h"
 #include "MinBloom.h"
@@ -106,6 +107,7 @@ public:
 //:f("/store/rubik/RC")
 	{
 		f = 0;
+		edge12 = 0;
 		pruneSuccessors = false;
 		minCompression = true;
 		bloomFilter = false;
@@ -124,7 +126,7 @@ public:
 //				moves[x].next = &moves[x+1];
 //		} moves[17].next = 0;
 	}
-	~RubiksCube() { /*delete depth8; delete depth9;*/ }
+	~RubiksCube() { delete edge12; /*delete depth8; delete depth9;*/ }
 	void SetPruneSuccessors(bool val) { pruneSuccessors = val; history.resize(0); }
 	virtual void GetSuccessors(const RubiksState &nodeID, std::vector<RubiksState> &neighbors) const;
 	virtual void GetActions(const RubiksState &nodeID, std::vector<RubiksAction> &actions) const;
@@ -141,6 +143,10 @@ public:
 	virtual double HCost(const RubiksState &node1, const RubiksState &node2) const;
 	virtual double HCost(const RubiksState &node1, const RubiksState &node2, double parentHCost) const;
 	int Edge12PDBDist(const RubiksState &s);
+	/** Converts the DiskBitFile 12-edge depths into a DistanceTable */
+	bool WriteEdge12PDB(const char *filename);
+	/** Makes Edge12PDBDist read from a table written by WriteEdge12PDB */
+	bool LoadEdge12PDB(const char *filename);
 	
 	/** Heuristic value between node and the stored goal. Asserts that the
 	 goal is stored **/
@@ -202,6 +208,8 @@ public:
 	
 	
 	DiskBitFile *f;
+	DistanceTable *edge12;
+	std::vector<int64_t> edge12Start; // table rank of the first entry of each bucket
 	std::vector<bucketInfo> data;
 	std::vector<bucketData> buckets;
 
@@ -0,0 +1,378 @@
+//
+//  BitmapBidirectionalBFS.h
+//  hog2
+//
+//  Unit-cost bidirectional BFS for domains with a perfect ranking.
+//
+//  Instead of hash tables, each direction stores 2 bits per state:
+//  0 means unseen, otherwise the value is (depth%3)+1. This is enough
+//  to walk back to the start/goal when extracting the path. The states
+//  of the current layer are kept in a separate bitmap (1 bit per state),
+//  since codes repeat every three layers.
+//
+//  Worker threads read and set codes with atomic word operations; a state
+//  belongs to the thread whose fetch_or finds its code still 0.
+//
+//  Requirements on the environment:
+//   * GetStateHash is a perfect ranking into [0, numStates)
+//   * GetStateFromHash(uint64_t, state &) inverts the ranking
+//   * all actions are invertible (the state space is undirected), since
+//     the backward search uses the same actions as the forward search.
+//  GetActions/GetNextState must be safe to call from multiple threads.
+//
+
+#ifndef BITMAPBIDIRECTIONALBFS_H
+#define BITMAPBIDIRECTIONALBFS_H
+
+#include <cassert>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+#include <algorithm>
+#include "SharedQueue.h"
+#include "Timer.h"
+
+template <class state, class action, class environment>
+class BitmapBidirectionalBFS {
+public:
+	BitmapBidirectionalBFS(int threads = 1) :numThreads(threads), verbose(false) {}
+	virtual ~BitmapBidirectionalBFS() {}
+	/** numStates is the size of the ranking; if 0, env->GetMaxHash() is used */
+	void GetPath(environment *env, const state &from, const state &to,
+				 std::vector<state> &thePath, uint64_t numStates = 0);
+	/** Returns the distance between from and to, or -1 if they aren't connected */
+	int GetDistance(environment *env, const state &from, const state &to, uint64_t numStates = 0);
+
+	void SetNumThreads(int threads) { numThreads = threads; }
+	void SetVerbose(bool v) { verbose = v; }
+	uint64_t GetNodesExpanded() { return nodesExpanded; }
+	uint64_t GetNodesTouched() { return nodesTouched; }
+	/** Memory used by the bitmaps in bytes */
+	uint64_t GetMemoryUsage()
+	{ return sizeof(uint64_t)*(forward.size()+backward.size()+forwardLayer.size()+backwardLayer.size()+nextLayer.size()); }
+private:
+	static const uint64_t chunkSize = 1024; // must be a multiple of 64
+	static const uint64_t kLowBits = 0x5555555555555555ull;
+
+	bool DoSearch(environment *env, const state &from, const state &to, uint64_t numStates);
+	uint64_t ExpandLayer(environment *env, std::vector<uint64_t> &bits, std::vector<uint64_t> &layer,
+						 std::vector<bool> &chunks, int depth);
+	bool FindIntersection(const std::vector<uint64_t> &layer, const std::vector<bool> &chunks,
+						  const std::vector<uint64_t> &other);
+	void ExtractHalfPath(environment *env, const std::vector<uint64_t> &bits, int depth,
+						 std::vector<state> &halfPath);
+	void ThreadWorker(environment *env, int nextCode, std::vector<uint64_t> *bits,
+					  const std::vector<uint64_t> *layer,
+					  SharedQueue<std::pair<uint64_t, uint64_t> > *work,
+					  SharedQueue<uint64_t> *results);
+
+	static int Code(int depth) { return (depth%3)+1; }
+	static int GetCode(const std::vector<uint64_t> &bits, uint64_t rank)
+	{ return (__atomic_load_n(&bits[rank>>5], __ATOMIC_RELAXED)>>((rank&0x1F)<<1))&0x3; }
+	static void SetCode(std::vector<uint64_t> &bits, uint64_t rank, int code)
+	{ bits[rank>>5] |= (uint64_t(code)<<((rank&0x1F)<<1)); }
+	/** Sets the code of an unseen state; returns false if it was already seen */
+	static bool ClaimCode(std::vector<uint64_t> &bits, uint64_t rank, int code)
+	{
+		int shift = (rank&0x1F)<<1;
+		uint64_t old = __atomic_fetch_or(&bits[rank>>5], uint64_t(code)<<shift, __ATOMIC_RELAXED);
+		return ((old>>shift)&0x3) == 0;
+	}
+	static void AddToLayer(std::vector<uint64_t> &layer, uint64_t rank)
+	{ __atomic_fetch_or(&layer[rank>>6], 1ull<<(rank&0x3F), __ATOMIC_RELAXED); }
+	/** One bit (the low bit of each field) set for every non-zero entry in w */
+	static uint64_t MatchSeen(uint64_t w)
+	{ return (w|(w>>1))&kLowBits; }
+	/** Moves bit i of x to bit 2i, lining layer bits up with the code fields */
+	static uint64_t Spread(uint64_t x)
+	{
+		x &= 0xFFFFFFFFull;
+		x = (x|(x<<16))&0x0000FFFF0000FFFFull;
+		x = (x|(x<<8))&0x00FF00FF00FF00FFull;
+		x = (x|(x<<4))&0x0F0F0F0F0F0F0F0Full;
+		x = (x|(x<<2))&0x3333333333333333ull;
+		return (x|(x<<1))&kLowBits;
+	}
+
+	int numThreads;
+	bool verbose;
+	uint64_t nodesExpanded, nodesTouched;
+	uint64_t totalStates;
+	std::vector<uint64_t> forward, backward;
+	// states of the current layer of each search, 1 bit per state
+	std::vector<uint64_t> forwardLayer, backwardLayer, nextLayer;
+	int forwardDepth, backwardDepth;
+	uint64_t middle;
+	std::mutex countLock;
+};
+
+template <class state, class action, class environment>
+void BitmapBidirectionalBFS<state, action, environment>::GetPath(environment *env, const state &from, const state &to,
+																 std::vector<state> &thePath, uint64_t numStates)
+{
+	thePath.resize(0);
+	if (!DoSearch(env, from, to, numStates))
+		return;
+	std::vector<state> backwardPart;
+	ExtractHalfPath(env, forward, forwardDepth, thePath);
+	std::reverse(thePath.begin(), thePath.end());
+	ExtractHalfPath(env, backward, backwardDepth, backwardPart);
+	thePath.insert(thePath.end(), backwardPart.begin()+1, backwardPart.end());
+}
+
+template <class state, class action, class environment>
+int BitmapBidirectionalBFS<state, action, environment>::GetDistance(environment *env, const state &from, const state &to,
+																	uint64_t numStates)
+{
+	if (!DoSearch(env, from, to, numStates))
+		return -1;
+	return forwardDepth+backwardDepth;
+}
+
+template <class state, class action, class environment>
+bool BitmapBidirectionalBFS<state, action, environment>::DoSearch(environment *env, const state &from, const state &to,
+																  uint64_t numStates)
+{
+	nodesExpanded = nodesTouched = 0;
+	totalStates = (numStates == 0)?env->GetMaxHash():numStates;
+	assert(totalStates > 0);
+
+	forward.assign((totalStates+31)/32, 0);
+	backward.assign((totalStates+31)/32, 0);
+	forwardLayer.assign((totalStates+63)/64, 0);
+	backwardLayer.assign((totalStates+63)/64, 0);
+	uint64_t numChunks = (totalStates+chunkSize-1)/chunkSize;
+	std::vector<bool> forwardChunks(numChunks), backwardChunks(numChunks);
+
+	uint64_t startRank = env->GetStateHash(from);
+	uint64_t goalRank = env->GetStateHash(to);
+	SetCode(forward, startRank, Code(0));
+	SetCode(backward, goalRank, Code(0));
+	AddToLayer(forwardLayer, startRank);
+	AddToLayer(backwardLayer, goalRank);
+	forwardChunks[startRank/chunkSize] = true;
+	backwardChunks[goalRank/chunkSize] = true;
+	forwardDepth = backwardDepth = 0;
+	if (startRank == goalRank)
+	{
+		middle = startRank;
+		return true;
+	}
+
+	uint64_t forwardSize = 1, backwardSize = 1;
+	Timer t;
+	t.StartTimer();
+	while (forwardSize > 0 && backwardSize > 0)
+	{
+		// always expand the smaller frontier
+		if (forwardSize <= backwardSize)
+		{
+			forwardSize = ExpandLayer(env, forward, forwardLayer, forwardChunks, forwardDepth);
+			forwardDepth++;
+			if (verbose)
+				printf("Forward depth %d: %llu new states; %1.2fs elapsed\n", forwardDepth,
+					   (unsigned long long)forwardSize, t.EndTimer());
+			if (FindIntersection(forwardLayer, forwardChunks, backward))
+				return true;
+		}
+		else {
+			backwardSize = ExpandLayer(env, backward, backwardLayer, backwardChunks, backwardDepth);
+			backwardDepth++;
+			if (verbose)
+				printf("Backward depth %d: %llu new states; %1.2fs elapsed\n", backwardDepth,
+					   (unsigned long long)backwardSize, t.EndTimer());
+			if (FindIntersection(backwardLayer, backwardChunks, forward))
+				return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Expands the states in layer (all at the given depth), setting the codes
+ * of new states in bits. On return layer holds the new states and chunks
+ * flags the chunks that contain any of them. Returns the number of states
+ * in the new layer.
+ */
+template <class state, class action, class environment>
+uint64_t BitmapBidirectionalBFS<state, action, environment>::ExpandLayer(environment *env, std::vector<uint64_t> &bits,
+																		 std::vector<uint64_t> &layer,
+																		 std::vector<bool> &chunks, int depth)
+{
+	SharedQueue<std::pair<uint64_t, uint64_t> > workQueue(numThreads*20);
+	SharedQueue<uint64_t> resultQueue;
+	std::vector<std::thread*> threads(numThreads);
+	nextLayer.assign(layer.size(), 0);
+
+	for (int x = 0; x < numThreads; x++)
+	{
+		threads[x] = new std::thread(&BitmapBidirectionalBFS<state, action, environment>::ThreadWorker,
+									 this, env, Code(depth+1), &bits, &layer, &workQueue, &resultQueue);
+	}
+	for (uint64_t x = 0; x < totalStates; x += chunkSize)
+	{
+		if (chunks[x/chunkSize])
+		{
+			workQueue.WaitAdd({x, std::min(totalStates, x+chunkSize)});
+		}
+	}
+	for (int x = 0; x < numThreads; x++)
+	{
+		workQueue.WaitAdd({0,0});
+	}
+	for (int x = 0; x < numThreads; x++)
+	{
+		threads[x]->join();
+		delete threads[x];
+		threads[x] = 0;
+	}
+	uint64_t total = 0, val;
+	while (resultQueue.Remove(val))
+	{
+		total += val;
+	}
+
+	layer.swap(nextLayer);
+	for (uint64_t c = 0; c < chunks.size(); c++)
+	{
+		chunks[c] = false;
+		uint64_t last = std::min((uint64_t)layer.size(), (c+1)*chunkSize/64);
+		for (uint64_t w = c*chunkSize/64; w < last; w++)
+		{
+			if (layer[w])
+			{
+				chunks[c] = true;
+				break;
+			}
+		}
+	}
+	return total;
+}
+
+/**
+ * Each work item is a chunk of ranks. The current layer is only read, so
+ * the states to expand are found without synchronization; new states are
+ * claimed with an atomic fetch_or on their code, so each is counted and
+ * added to the next layer exactly once.
+ */
+template <class state, class action, class environment>
+void BitmapBidirectionalBFS<state, action, environment>::ThreadWorker(environment *env, int nextCode,
+																	  std::vector<uint64_t> *bits,
+																	  const std::vector<uint64_t> *layer,
+																	  SharedQueue<std::pair<uint64_t, uint64_t> > *work,
+																	  SharedQueue<uint64_t> *results)
+{
+	std::pair<uint64_t, uint64_t> p;
+	std::vector<action> acts;
+	state s, t;
+	uint64_t count = 0, expanded = 0, touched = 0;
+	while (true)
+	{
+		work->WaitRemove(p);
+		if (p.first == p.second)
+		{
+			break;
+		}
+		// chunks are aligned to words, so scan a word (64 states) at a time
+		for (uint64_t w = p.first/64; w < (p.second+63)/64; w++)
+		{
+			uint64_t members = (*layer)[w];
+			while (members)
+			{
+				uint64_t rank = w*64+__builtin_ctzll(members);
+				members &= members-1;
+				env->GetStateFromHash(rank, s);
+				env->GetActions(s, acts);
+				expanded++;
+				for (unsigned int y = 0; y < acts.size(); y++)
+				{
+					env->GetNextState(s, acts[y], t);
+					touched++;
+					uint64_t nextRank = env->GetStateHash(t);
+					if (GetCode(*bits, nextRank) != 0)
+						continue;
+					if (ClaimCode(*bits, nextRank, nextCode))
+					{
+						AddToLayer(nextLayer, nextRank);
+						count++;
+					}
+				}
+			}
+		}
+	}
+	results->Add(count);
+	countLock.lock();
+	nodesExpanded += expanded;
+	nodesTouched += touched;
+	countLock.unlock();
+}
+
+/**
+ * ANDs the newly generated layer against everything seen by the other
+ * search. Since the layers are generated level-synchronously, any state
+ * in the intersection is at the maximum depth of the other search.
+ */
+template <class state, class action, class environment>
+bool BitmapBidirectionalBFS<state, action, environment>::FindIntersection(const std::vector<uint64_t> &layer,
+																		  const std::vector<bool> &chunks,
+																		  const std::vector<uint64_t> &other)
+{
+	for (uint64_t c = 0; c < chunks.size(); c++)
+	{
+		if (!chunks[c])
+			continue;
+		uint64_t last = std::min((uint64_t)layer.size(), (c+1)*chunkSize/64);
+		for (uint64_t w = c*chunkSize/64; w < last; w++)
+		{
+			if (layer[w] == 0)
+				continue;
+			// each layer word covers two words of codes
+			for (int half = 0; half < 2 && 2*w+half < other.size(); half++)
+			{
+				uint64_t both = Spread(layer[w]>>(32*half))&MatchSeen(other[2*w+half]);
+				if (both)
+				{
+					middle = (2*w+half)*32+(__builtin_ctzll(both)>>1);
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+/**
+ * Walks from the middle state back to depth 0 following neighbors whose
+ * stored depth is one less than the current state. The result starts at
+ * the middle state.
+ */
+template <class state, class action, class environment>
+void BitmapBidirectionalBFS<state, action, environment>::ExtractHalfPath(environment *env, const std::vector<uint64_t> &bits,
+																		 int depth, std::vector<state> &halfPath)
+{
+	std::vector<action> acts;
+	state s, t;
+	env->GetStateFromHash(middle, s);
+	halfPath.resize(0);
+	halfPath.push_back(s);
+	for (int d = depth; d > 0; d--)
+	{
+		env->GetActions(s, acts);
+		bool found = false;
+		for (unsigned int y = 0; y < acts.size(); y++)
+		{
+			env->GetNextState(s, acts[y], t);
+			if (GetCode(bits, env->GetStateHash(t)) == Code(d-1))
+			{
+				found = true;
+				break;
+			}
+		}
+		assert(found);
+		s = t;
+		halfPath.push_back(s);
+	}
+}
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ *  TemplateFringeSearch.h
+ *  hog2
+ *
+ *  Fringe search over any SearchEnvironment.
+ *
+ *  Fringe search visits the fringe in order, expanding every node whose
+ *  f-cost is within the current limit and skipping the others, and then
+ *  raises the limit to the smallest f-cost that was skipped. Children are
+ *  inserted right after the node being expanded, so they are visited in
+ *  the same pass. There are no heap operations, which makes it fast on
+ *  grid maps where many nodes share an f-cost.
+ *
+ *  Nodes live in a dense table indexed by GetStateHash, so the environment
+ *  needs a perfect hash below GetMaxHash (as MapEnvironment and
+ *  CanonicalGrid have). The fringe is a doubly-linked list threaded through
+ *  the table, and a generation counter marks which entries belong to the
+ *  current search, so the table is only allocated when GetMaxHash changes.
+ *
+ */
+
+#ifndef TEMPLATEFRINGESEARCH_H
+#define TEMPLATEFRINGESEARCH_H
+
+#include <stdint.h>
+#include <float.h>
+#include <vector>
+#include <algorithm>
+#include "FPUtil.h"
+#include "GenericSearchAlgorithm.h"
+
+template <class state, class action, class environment>
+class TemplateFringeSearch : public GenericSearchAlgorithm<state,action,environment> {
+public:
+	TemplateFringeSearch() :env(0), theHeuristic(0), generation(0), head(kNone) { ResetNodeCount(); }
+	virtual ~TemplateFringeSearch() {}
+	void GetPath(environment *env, const state& from, const state& to, std::vector<state> &thePath);
+	void GetPath(environment *env, const state& from, const state& to, std::vector<action> &thePath);
+	virtual const char *GetName() { return "TemplateFringeSearch"; }
+
+	/** Use h instead of the environment's HCost */
+	void SetHeuristic(Heuristic<state> *h) { theHeuristic = h; }
+	void ResetNodeCount() { nodesExpanded = nodesTouched = 0; iterations = 0; }
+	uint64_t GetNodesExpanded() const { return nodesExpanded; }
+	uint64_t GetNodesTouched() const { return nodesTouched; }
+	/** Number of times the f-cost limit was raised in the last search */
+	uint64_t GetNumIterations() const { return iterations; }
+	uint64_t GetMemoryUsage() const { return table.capacity()*sizeof(FringeNode); }
+	void LogFinalStats(StatCollection *) {}
+private:
+	static const uint64_t kNone = UINT64_MAX;
+	struct FringeNode {
+		FringeNode() :stamp(0), onFringe(false) {}
+		state data;
+		double g, h;
+		uint64_t parent;
+		uint64_t prev, next;
+		uint32_t stamp;
+		bool onFringe;
+	};
+	double HCost(const state &s) const
+	{ return theHeuristic?theHeuristic->HCost(s, goal):env->HCost(s, goal); }
+	void Initialize(environment *e, const state &to);
+	void InsertAfter(uint64_t where, uint64_t which);
+	void Unlink(uint64_t which);
+	void ExtractPath(uint64_t which, std::vector<state> &thePath);
+
+	environment *env;
+	Heuristic<state> *theHeuristic;
+	state goal;
+	std::vector<FringeNode> table;
+	std::vector<state> neighbors;
+	uint32_t generation;
+	uint64_t head;
+	uint64_t nodesExpanded, nodesTouched, iterations;
+};
+
+template <class state, class action, class environment>
+const uint64_t TemplateFringeSearch<state,action,environment>::kNone;
+
+template <class state, class action, class environment>
+void TemplateFringeSearch<state,action,environment>::GetPath(environment *e, const state& from, const state& to,
+															 std::vector<state> &thePath)
+{
+	thePath.resize(0);
+	Initialize(e, to);
+
+	uint64_t start = env->GetStateHash(from);
+	FringeNode &s = table[start];
+	s.stamp = generation;
+	s.data = from;
+	s.g = 0;
+	s.h = HCost(from);
+	s.parent = start;
+	InsertAfter(kNone, start);
+
+	double limit = s.h;
+	while (head != kNone)
+	{
+		double nextLimit = DBL_MAX;
+		uint64_t curr = head;
+		while (curr != kNone)
+		{
+			FringeNode &n = table[curr];
+			double f = n.g+n.h;
+			if (fgreater(f, limit))
+			{
+				nextLimit = std::min(nextLimit, f);
+				curr = n.next;
+				continue;
+			}
+			if (env->GoalTest(n.data, goal))
+			{
+				ExtractPath(curr, thePath);
+				return;
+			}
+
+			nodesExpanded++;
+			env->GetSuccessors(n.data, neighbors);
+			// children go right after curr, in the order they were generated
+			uint64_t last = curr;
+			for (unsigned int x = 0; x < neighbors.size(); x++)
+			{
+				nodesTouched++;
+				uint64_t which = env->GetStateHash(neighbors[x]);
+				double g = n.g+env->GCost(n.data, neighbors[x]);
+				FringeNode &child = table[which];
+				if (child.stamp == generation)
+				{
+					if (!fless(g, child.g))
+						continue;
+					if (child.onFringe)
+					{
+						if (which == last)
+							last = child.prev;
+						Unlink(which);
+					}
+				}
+				else {
+					child.stamp = generation;
+					child.h = HCost(neighbors[x]);
+				}
+				child.data = neighbors[x];
+				child.g = g;
+				child.parent = curr;
+				InsertAfter(last, which);
+				last = which;
+			}
+			uint64_t next = n.next;
+			Unlink(curr);
+			curr = next;
+		}
+		limit = nextLimit;
+		iterations++;
+	}
+}
+
+template <class state, class action, class environment>
+void TemplateFringeSearch<state,action,environment>::GetPath(environment *e, const state& from, const state& to,
+															 std::vector<action> &thePath)
+{
+	std::vector<state> thePathStates;
+	GetPath(e, from, to, thePathStates);
+	thePath.resize(0);
+	for (unsigned int x = 1; x < thePathStates.size(); x++)
+		thePath.push_back(e->GetAction(thePathStates[x-1], thePathStates[x]));
+}
+
+template <class state, class action, class environment>
+void TemplateFringeSearch<state,action,environment>::Initialize(environment *e, const state &to)
+{
+	env = e;
+	goal = to;
+	ResetNodeCount();
+	head = kNone;
+	if (table.size() != env->GetMaxHash())
+	{
+		table.assign(env->GetMaxHash(), FringeNode());
+		generation = 0;
+	}
+	generation++;
+	if (generation == 0)
+	{
+		for (unsigned int x = 0; x < table.size(); x++)
+			table[x].stamp = 0;
+		generation = 1;
+	}
+}
+
+/** Inserts which after where, or at the front when where is kNone */
+template <class state, class action, class environment>
+void TemplateFringeSearch<state,action,environment>::InsertAfter(uint64_t where, uint64_t which)
+{
+	FringeNode &n = table[which];
+	n.onFringe = true;
+	n.prev = where;
+	n.next = (where == kNone)?head:table[where].next;
+	if (where == kNone)
+		head = which;
+	else
+		table[where].next = which;
+	if (n.next != kNone)
+		table[n.next].prev = which;
+}
+
+template <class state, class action, class environment>
+void TemplateFringeSearch<state,action,environment>::Unlink(uint64_t which)
+{
+	FringeNode &n = table[which];
+	n.onFringe = false;
+	if (n.prev == kNone)
+		head = n.next;
+	else
+		table[n.prev].next = n.next;
+	if (n.next != kNone)
+		table[n.next].prev = n.prev;
+}
+
+template <class state, class action, class environment>
+void TemplateFringeSearch<state,action,environment>::ExtractPath(uint64_t which, std::vector<state> &thePath)
+{
+	thePath.push_back(table[which].data);
+	while (table[which].parent != which)
+	{
+		which = table[which].parent;
+		thePath.push_back(table[which].data);
+	}
+	std::reverse(thePath.begin(), thePath.end());
+}
+
+#endif
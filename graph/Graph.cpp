@@ -609,7 +609,7 @@ void edge::SetLabelL(unsigned int index, long val)
 }
 
 
-unsigned node::uniqueIDCounter = 0;
+std::atomic<unsigned int> node::uniqueIDCounter(0);
 
 node::node(const char *n)
 :label(), _edgesOutgoing(), _edgesIncoming(), _allEdges()
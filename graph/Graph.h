@@ -24,6 +24,7 @@
 #define GRAPH_H
 
 #include <limits.h>
+#include <atomic>
 #include <vector>
 #include <list>
 #include <iostream>
@@ -145,6 +146,7 @@ public:
 	void SetLabelL(unsigned int index, long val);
 	inline double GetLabelF(unsigned int index) const { if (index < label.size()) return label[index].fval; return MAXINT; }
 	inline long GetLabelL(unsigned int index) const { if (index < label.size()) return label[index].lval; return MAXINT; }
+	unsigned int GetNumLabels() const { return (unsigned int)label.size(); }
 	
 	double GetWeight() { return GetLabelF(kEdgeWeight); }
 	void setWeight(double val) { SetLabelF(kEdgeWeight, val); }
@@ -226,6 +228,7 @@ public:
 	inline long GetLabelL(unsigned int index) const {
 		if (index < label.size()) return label[index].lval; return MAXINT;
 	}
+	unsigned int GetNumLabels() const { return (unsigned int)label.size(); }
 	
 	// set/get marked edge for each node (limit 1)
 	void markEdge(edge *e) { markedEdge = e; }
@@ -244,7 +247,8 @@ private:
 	int keyLabel;
 	
 	int uniqueID;
-	static unsigned int uniqueIDCounter;
+	// nodes can be created on several threads, e.g. by BatchRefinement
+	static std::atomic<unsigned int> uniqueIDCounter;
 };
 
 std::ostream& operator <<(std::ostream & out, const Graph &_Graph);
@@ -0,0 +1,557 @@
+/*
+ *  ContractionHierarchy.cpp
+ *  hog2
+ *
+ *  Contraction hierarchies for fast exact shortest path queries.
+ *
+ */
+
+#include "ContractionHierarchy.h"
+#include <string.h>
+#include <assert.h>
+#include <algorithm>
+#include "FPUtil.h"
+#include "Timer.h"
+
+// witness searches give up (and add the shortcut) after settling this many nodes
+static const int kWitnessSettleLimit = 500;
+static const char kMagic[8] = {'H', 'O', 'G', 'C', 'H', '0', '0', '2'};
+
+const uint32_t ContractionHierarchy::kNoNode;
+
+ContractionHierarchy::ContractionHierarchy()
+:numShortcuts(0), numGraphEdges(0), graphHash(0), queryStamp(0), meeting(kNoNode), nodesExpanded(0)
+{
+}
+
+void ContractionHierarchy::AddArc(uint32_t from, uint32_t to, uint32_t middle, double weight)
+{
+	// keep only the cheapest arc between two nodes
+	for (auto &a : out[from])
+	{
+		if (a.node == to)
+		{
+			if (weight < a.weight)
+			{
+				a.weight = weight;
+				a.middle = middle;
+				for (auto &b : in[to])
+				{
+					if (b.node == from)
+					{
+						b.weight = weight;
+						b.middle = middle;
+					}
+				}
+			}
+			return;
+		}
+	}
+	out[from].push_back(arc(to, middle, weight));
+	in[to].push_back(arc(from, middle, weight));
+}
+
+void ContractionHierarchy::FindShortcuts(uint32_t v, witnessData &data, std::vector<shortcut> &result) const
+{
+	result.resize(0);
+	for (const auto &i : in[v])
+	{
+		double limit = -1;
+		for (const auto &o : out[v])
+			if (o.node != i.node)
+				limit = std::max(limit, i.weight+o.weight);
+		if (limit < 0)
+			continue;
+
+		// Dijkstra from i.node avoiding v and the other nodes being
+		// contracted this round, up to the longest path through v
+		data.currStamp++;
+		data.stamp[i.node] = data.currStamp;
+		data.dist[i.node] = 0;
+		while (!data.open.empty())
+			data.open.pop();
+		data.open.push({0, i.node});
+		int settled = 0;
+		while (!data.open.empty() && settled < kWitnessSettleLimit)
+		{
+			auto next = data.open.top();
+			data.open.pop();
+			if (next.first > data.dist[next.second])
+				continue;
+			if (next.first > limit)
+				break;
+			settled++;
+			for (const auto &a : out[next.second])
+			{
+				if (a.node == v || selected[a.node])
+					continue;
+				double cost = next.first+a.weight;
+				if (data.stamp[a.node] != data.currStamp || cost < data.dist[a.node])
+				{
+					data.stamp[a.node] = data.currStamp;
+					data.dist[a.node] = cost;
+					data.open.push({cost, a.node});
+				}
+			}
+		}
+		for (const auto &o : out[v])
+		{
+			if (o.node == i.node)
+				continue;
+			double through = i.weight+o.weight;
+			if (data.stamp[o.node] == data.currStamp && !fgreater(data.dist[o.node], through))
+				continue;
+			result.push_back({i.node, o.node, v, through});
+		}
+	}
+}
+
+void ContractionHierarchy::Worker(SharedQueue<std::pair<uint64_t, uint64_t> > *work, const std::vector<uint32_t> *nodes,
+								  std::vector<std::vector<shortcut> > *shortcuts, witnessData *data)
+{
+	std::pair<uint64_t, uint64_t> item;
+	std::vector<shortcut> tmp;
+	while (true)
+	{
+		work->WaitRemove(item);
+		if (item.first == item.second)
+			break;
+		for (uint64_t x = item.first; x < item.second; x++)
+		{
+			uint32_t v = (*nodes)[x];
+			if (shortcuts != 0) // contract
+			{
+				FindShortcuts(v, *data, (*shortcuts)[x]);
+			}
+			else { // update priority
+				FindShortcuts(v, *data, tmp);
+				priority[v] = (int)tmp.size()-(int)(in[v].size()+out[v].size())+deletedNeighbors[v];
+			}
+		}
+	}
+}
+
+void ContractionHierarchy::RunWorkers(const std::vector<uint32_t> &nodes, std::vector<std::vector<shortcut> > *shortcuts,
+									  std::vector<witnessData> &data)
+{
+	int numThreads = data.size();
+	SharedQueue<std::pair<uint64_t, uint64_t> > workQueue(numThreads*20);
+	std::vector<std::thread*> threads(numThreads);
+	for (int x = 0; x < numThreads; x++)
+		threads[x] = new std::thread(&ContractionHierarchy::Worker, this, &workQueue, &nodes, shortcuts, &data[x]);
+	const uint64_t chunkSize = 256;
+	for (uint64_t x = 0; x < nodes.size(); x += chunkSize)
+		workQueue.WaitAdd({x, std::min((uint64_t)nodes.size(), x+chunkSize)});
+	for (int x = 0; x < numThreads; x++)
+		workQueue.WaitAdd({0, 0});
+	for (int x = 0; x < numThreads; x++)
+	{
+		threads[x]->join();
+		delete threads[x];
+		threads[x] = 0;
+	}
+}
+
+bool ContractionHierarchy::Before(uint32_t a, uint32_t b) const
+{
+	if (priority[a] != priority[b])
+		return priority[a] < priority[b];
+	// break ties pseudo-randomly so that uniform regions still give large
+	// independent sets
+	uint32_t ha = a*2654435761u, hb = b*2654435761u;
+	if (ha != hb)
+		return ha < hb;
+	return a < b;
+}
+
+void ContractionHierarchy::Build(Graph *g, bool directed, int numThreads)
+{
+	if (numThreads < 1)
+		numThreads = 1;
+	Timer t;
+	t.StartTimer();
+	uint32_t n = g->GetNumNodes();
+	numGraphEdges = g->GetNumEdges();
+	graphHash = GetGraphHash(g, directed);
+	out.assign(n, std::vector<arc>());
+	in.assign(n, std::vector<arc>());
+	for (int x = 0; x < g->GetNumEdges(); x++)
+	{
+		edge *e = g->GetEdge(x);
+		if (e->getFrom() == e->getTo())
+			continue;
+		AddArc(e->getFrom(), e->getTo(), kNoNode, e->GetWeight());
+		if (!directed)
+			AddArc(e->getTo(), e->getFrom(), kNoNode, e->GetWeight());
+	}
+	priority.assign(n, 0);
+	deletedNeighbors.assign(n, 0);
+	contracted.assign(n, false);
+	selected.assign(n, false);
+	rank.assign(n, 0);
+	std::vector<witnessData> data(numThreads);
+	for (auto &d : data)
+	{
+		d.dist.resize(n);
+		d.stamp.assign(n, 0);
+		d.currStamp = 0;
+	}
+
+	std::vector<uint32_t> remaining(n), dirty, round;
+	for (uint32_t x = 0; x < n; x++)
+		remaining[x] = x;
+	RunWorkers(remaining, 0, data);
+
+	std::vector<std::vector<arc> > up(n), down(n);
+	std::vector<std::vector<shortcut> > shortcuts;
+	uint32_t nextRank = 0;
+	numShortcuts = 0;
+	int rounds = 0;
+	while (remaining.size() > 0)
+	{
+		// nodes that come before all of their neighbors
+		round.resize(0);
+		for (uint32_t v : remaining)
+		{
+			bool best = true;
+			for (const auto &a : out[v])
+				if (Before(a.node, v)) { best = false; break; }
+			if (best)
+				for (const auto &a : in[v])
+					if (Before(a.node, v)) { best = false; break; }
+			if (best)
+			{
+				round.push_back(v);
+				selected[v] = true;
+			}
+		}
+
+		shortcuts.resize(round.size());
+		RunWorkers(round, &shortcuts, data);
+
+		dirty.resize(0);
+		for (uint64_t x = 0; x < round.size(); x++)
+		{
+			uint32_t v = round[x];
+			rank[v] = nextRank++;
+			up[v] = out[v];
+			down[v] = in[v];
+			for (const auto &a : out[v])
+			{
+				auto &l = in[a.node];
+				for (uint64_t y = 0; y < l.size(); y++)
+					if (l[y].node == v) { l[y] = l.back(); l.pop_back(); break; }
+				deletedNeighbors[a.node]++;
+				dirty.push_back(a.node);
+			}
+			for (const auto &a : in[v])
+			{
+				auto &l = out[a.node];
+				for (uint64_t y = 0; y < l.size(); y++)
+					if (l[y].node == v) { l[y] = l.back(); l.pop_back(); break; }
+				deletedNeighbors[a.node]++;
+				dirty.push_back(a.node);
+			}
+			std::vector<arc>().swap(out[v]);
+			std::vector<arc>().swap(in[v]);
+			for (const auto &s : shortcuts[x])
+				AddArc(s.from, s.to, s.middle, s.weight);
+			numShortcuts += shortcuts[x].size();
+			contracted[v] = true;
+			selected[v] = false;
+		}
+		remaining.erase(std::remove_if(remaining.begin(), remaining.end(),
+									   [this](uint32_t v) { return contracted[v]; }), remaining.end());
+		std::sort(dirty.begin(), dirty.end());
+		dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+		RunWorkers(dirty, 0, data);
+		rounds++;
+	}
+
+	// flatten into CSR form
+	upFirst.assign(n+1, 0);
+	downFirst.assign(n+1, 0);
+	upEdges.resize(0);
+	downEdges.resize(0);
+	for (uint32_t v = 0; v < n; v++)
+	{
+		upFirst[v] = upEdges.size();
+		upEdges.insert(upEdges.end(), up[v].begin(), up[v].end());
+		downFirst[v] = downEdges.size();
+		downEdges.insert(downEdges.end(), down[v].begin(), down[v].end());
+	}
+	upFirst[n] = upEdges.size();
+	downFirst[n] = downEdges.size();
+	std::vector<std::vector<arc> >().swap(out);
+	std::vector<std::vector<arc> >().swap(in);
+	printf("Contracted %u nodes in %d rounds (%1.2fs); %llu shortcuts, %llu upward edges\n", n, rounds,
+		   t.EndTimer(), (unsigned long long)numShortcuts, (unsigned long long)GetNumUpwardEdges());
+}
+
+const ContractionHierarchy::arc *ContractionHierarchy::FindArc(const std::vector<uint64_t> &first,
+															 const std::vector<arc> &edges,
+															 uint32_t at, uint32_t other) const
+{
+	for (uint64_t x = first[at]; x < first[at+1]; x++)
+		if (edges[x].node == other)
+			return &edges[x];
+	return 0;
+}
+
+bool ContractionHierarchy::ValidArcs(const std::vector<uint64_t> &first, const std::vector<arc> &edges) const
+{
+	uint64_t n = rank.size();
+	if ((first[0] != 0) || (first[n] != edges.size()))
+		return false;
+	for (uint64_t x = 0; x < n; x++)
+		if (first[x] > first[x+1])
+			return false;
+	for (const arc &a : edges)
+		if ((a.node >= n) || ((a.middle >= n) && (a.middle != kNoNode)))
+			return false;
+	return true;
+}
+
+double ContractionHierarchy::Search(uint32_t from, uint32_t to)
+{
+	uint32_t n = rank.size();
+	if (forwardDist.size() != n)
+	{
+		forwardDist.resize(n);
+		backwardDist.resize(n);
+		forwardParent.resize(n);
+		backwardParent.resize(n);
+		forwardArc.resize(n);
+		backwardArc.resize(n);
+		forwardStamp.assign(n, 0);
+		backwardStamp.assign(n, 0);
+		queryStamp = 0;
+	}
+	queryStamp++;
+	nodesExpanded = 0;
+	meeting = kNoNode;
+	if (from >= n || to >= n)
+		return DBL_MAX;
+
+	typedef std::pair<double, uint32_t> entry;
+	std::priority_queue<entry, std::vector<entry>, std::greater<entry> > forward, backward;
+	forwardStamp[from] = queryStamp;
+	forwardDist[from] = 0;
+	forwardParent[from] = kNoNode;
+	forward.push({0, from});
+	backwardStamp[to] = queryStamp;
+	backwardDist[to] = 0;
+	backwardParent[to] = kNoNode;
+	backward.push({0, to});
+
+	double best = DBL_MAX;
+	bool forwardTurn = true;
+	while (true)
+	{
+		bool forwardOpen = !forward.empty() && forward.top().first < best;
+		bool backwardOpen = !backward.empty() && backward.top().first < best;
+		if (!forwardOpen && !backwardOpen)
+			break;
+		if (!forwardOpen) forwardTurn = false;
+		if (!backwardOpen) forwardTurn = true;
+
+		// the two directions only differ in which arrays they use
+		auto &open = forwardTurn?forward:backward;
+		std::vector<double> &dist = forwardTurn?forwardDist:backwardDist;
+		std::vector<uint32_t> &stamp = forwardTurn?forwardStamp:backwardStamp;
+		std::vector<uint32_t> &parent = forwardTurn?forwardParent:backwardParent;
+		std::vector<const arc *> &parentArc = forwardTurn?forwardArc:backwardArc;
+		const std::vector<double> &otherDist = forwardTurn?backwardDist:forwardDist;
+		const std::vector<uint32_t> &otherStamp = forwardTurn?backwardStamp:forwardStamp;
+		const std::vector<uint64_t> &first = forwardTurn?upFirst:downFirst;
+		const std::vector<arc> &edges = forwardTurn?upEdges:downEdges;
+		forwardTurn = !forwardTurn;
+
+		entry next = open.top();
+		open.pop();
+		if (next.first > dist[next.second])
+			continue;
+		nodesExpanded++;
+		if (otherStamp[next.second] == queryStamp && next.first+otherDist[next.second] < best)
+		{
+			best = next.first+otherDist[next.second];
+			meeting = next.second;
+		}
+		for (uint64_t x = first[next.second]; x < first[next.second+1]; x++)
+		{
+			const arc &a = edges[x];
+			double cost = next.first+a.weight;
+			if (stamp[a.node] != queryStamp || cost < dist[a.node])
+			{
+				stamp[a.node] = queryStamp;
+				dist[a.node] = cost;
+				parent[a.node] = next.second;
+				parentArc[a.node] = &a;
+				open.push({cost, a.node});
+			}
+		}
+	}
+	return best;
+}
+
+double ContractionHierarchy::GetDistance(graphState from, graphState to)
+{
+	return Search(from, to);
+}
+
+void ContractionHierarchy::Unpack(uint32_t from, uint32_t to, uint32_t middle, std::vector<graphState> &path) const
+{
+	// appends the nodes after from up to and including to
+	if (middle == kNoNode)
+	{
+		path.push_back(to);
+		return;
+	}
+	// the skipped node is below both ends: from->middle is an upward edge
+	// into middle and middle->to is an upward edge out of middle
+	const arc *first = FindArc(downFirst, downEdges, middle, from);
+	const arc *second = FindArc(upFirst, upEdges, middle, to);
+	assert(first != 0 && second != 0);
+	Unpack(from, middle, first->middle, path);
+	Unpack(middle, to, second->middle, path);
+}
+
+bool ContractionHierarchy::GetPath(graphState from, graphState to, std::vector<graphState> &path)
+{
+	path.resize(0);
+	if (Search(from, to) == DBL_MAX)
+		return false;
+	std::vector<uint32_t> forwardNodes;
+	for (uint32_t v = meeting; v != kNoNode; v = forwardParent[v])
+		forwardNodes.push_back(v);
+	std::reverse(forwardNodes.begin(), forwardNodes.end());
+	path.push_back(from);
+	for (uint64_t x = 1; x < forwardNodes.size(); x++)
+		Unpack(forwardNodes[x-1], forwardNodes[x], forwardArc[forwardNodes[x]]->middle, path);
+	// backward parents lead from the meeting node towards the goal
+	for (uint32_t v = meeting; backwardParent[v] != kNoNode; v = backwardParent[v])
+		Unpack(v, backwardParent[v], backwardArc[v]->middle, path);
+	return true;
+}
+
+uint64_t ContractionHierarchy::GetMemoryUsage() const
+{
+	return rank.size()*sizeof(uint32_t)+(upFirst.size()+downFirst.size())*sizeof(uint64_t)+
+	(upEdges.size()+downEdges.size())*sizeof(arc);
+}
+
+uint64_t ContractionHierarchy::GetGraphHash(Graph *g, bool directed)
+{
+	// FNV-1a, as in Map::GetMapHash
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](uint64_t value) {
+		for (int x = 0; x < 8; x++)
+		{
+			hash ^= (value>>(8*x))&0xFF;
+			hash *= 1099511628211ull;
+		}
+	};
+	add(directed);
+	add(g->GetNumNodes());
+	for (int x = 0; x < g->GetNumEdges(); x++)
+	{
+		edge *e = g->GetEdge(x);
+		double w = e->GetWeight();
+		uint64_t bits;
+		memcpy(&bits, &w, sizeof(bits));
+		add(e->getFrom());
+		add(e->getTo());
+		add(bits);
+	}
+	return hash;
+}
+
+bool ContractionHierarchy::Save(const char *filename) const
+{
+	FILE *f = fopen(filename, "w");
+	if (f == 0)
+	{
+		printf("Error: unable to open '%s' for writing\n", filename);
+		return false;
+	}
+	uint64_t sizes[6] = { rank.size(), upEdges.size(), downEdges.size(), numShortcuts, numGraphEdges, graphHash };
+	bool ok = (fwrite(kMagic, 1, 8, f) == 8) && (fwrite(sizes, sizeof(uint64_t), 6, f) == 6) &&
+	(fwrite(rank.data(), sizeof(uint32_t), rank.size(), f) == rank.size()) &&
+	(fwrite(upFirst.data(), sizeof(uint64_t), upFirst.size(), f) == upFirst.size()) &&
+	(fwrite(downFirst.data(), sizeof(uint64_t), downFirst.size(), f) == downFirst.size()) &&
+	(fwrite(upEdges.data(), sizeof(arc), upEdges.size(), f) == upEdges.size()) &&
+	(fwrite(downEdges.data(), sizeof(arc), downEdges.size(), f) == downEdges.size());
+	fclose(f);
+	if (!ok)
+		printf("Error writing contraction hierarchy to '%s'\n", filename);
+	return ok;
+}
+
+bool ContractionHierarchy::Load(const char *filename, Graph *g, bool directed)
+{
+	FILE *f = fopen(filename, "r");
+	if (f == 0)
+		return false;
+	char magic[8];
+	uint64_t sizes[6];
+	bool ok = (fread(magic, 1, 8, f) == 8) && (memcmp(magic, kMagic, 8) == 0) &&
+	(fread(sizes, sizeof(uint64_t), 6, f) == 6);
+	// the hash is only computed once the counts match
+	bool otherGraph = ok && ((sizes[0] != (uint64_t)g->GetNumNodes()) || (sizes[4] != (uint64_t)g->GetNumEdges()) ||
+							 (sizes[5] != GetGraphHash(g, directed)));
+	if (otherGraph)
+		ok = false;
+	if (ok)
+	{
+		// the sizes must account for the whole file before anything is allocated
+		fseek(f, 0, SEEK_END);
+		uint64_t bytes = ftell(f);
+		fseek(f, 8+sizeof(sizes), SEEK_SET);
+		uint64_t fixed = 8+sizeof(sizes)+sizes[0]*sizeof(uint32_t)+2*(sizes[0]+1)*sizeof(uint64_t);
+		ok = (fixed <= bytes) && (sizes[1] <= (bytes-fixed)/sizeof(arc)) && (sizes[2] <= (bytes-fixed)/sizeof(arc)) &&
+		(fixed+(sizes[1]+sizes[2])*sizeof(arc) == bytes) && (sizes[3] <= sizes[1]+sizes[2]);
+	}
+	if (ok)
+	{
+		numGraphEdges = sizes[4];
+		graphHash = sizes[5];
+		rank.resize(sizes[0]);
+		upFirst.resize(sizes[0]+1);
+		downFirst.resize(sizes[0]+1);
+		upEdges.resize(sizes[1]);
+		downEdges.resize(sizes[2]);
+		numShortcuts = sizes[3];
+		ok = (fread(rank.data(), sizeof(uint32_t), rank.size(), f) == rank.size()) &&
+		(fread(upFirst.data(), sizeof(uint64_t), upFirst.size(), f) == upFirst.size()) &&
+		(fread(downFirst.data(), sizeof(uint64_t), downFirst.size(), f) == downFirst.size()) &&
+		(fread(upEdges.data(), sizeof(arc), upEdges.size(), f) == upEdges.size()) &&
+		(fread(downEdges.data(), sizeof(arc), downEdges.size(), f) == downEdges.size());
+	}
+	fclose(f);
+	if (ok)
+	{
+		// every node has a distinct rank
+		std::vector<bool> used(rank.size());
+		for (uint64_t x = 0; ok && x < rank.size(); x++)
+		{
+			ok = (rank[x] < rank.size()) && !used[rank[x]];
+			if (ok)
+				used[rank[x]] = true;
+		}
+		ok = ok && ValidArcs(upFirst, upEdges) && ValidArcs(downFirst, downEdges);
+	}
+	if (!ok)
+	{
+		if (otherGraph)
+			printf("Error: '%s' was built for a different graph\n", filename);
+		else
+			printf("Error: '%s' is not a contraction hierarchy\n", filename);
+		rank.clear();
+		upFirst.clear();
+		downFirst.clear();
+		upEdges.clear();
+		downEdges.clear();
+	}
+	forwardDist.clear();
+	return ok;
+}
@@ -0,0 +1,114 @@
+/*
+ *  ContractionHierarchy.h
+ *  hog2
+ *
+ *  Contraction hierarchies for fast exact shortest path queries on large
+ *  static graphs such as road networks.
+ *
+ *  Nodes are contracted one at a time, cheapest first by edge difference
+ *  (shortcuts added minus edges removed) plus the number of contracted
+ *  neighbors. A shortcut u->w is added around node v unless a bounded
+ *  witness search finds a path from u to w without v that is no longer.
+ *  Each round contracts an independent set of nodes (each cheaper than
+ *  all of its neighbors), so witness searches and priority updates for
+ *  the round run in parallel.
+ *
+ *  The result is stored as two flat (CSR) graphs: upward edges out of
+ *  each node, and upward edges into each node. A query runs Dijkstra
+ *  upward from the start on the first and upward from the goal on the
+ *  second; shortcuts on the resulting path are unpacked recursively.
+ *
+ */
+
+#ifndef CONTRACTIONHIERARCHY_H
+#define CONTRACTIONHIERARCHY_H
+
+#include "GraphEnvironment.h"
+#include "SharedQueue.h"
+#include <vector>
+#include <thread>
+#include <queue>
+#include <float.h>
+
+class ContractionHierarchy {
+public:
+	ContractionHierarchy();
+	/** Contracts g; if directed is false every edge can be used in both directions */
+	void Build(Graph *g, bool directed, int numThreads = std::thread::hardware_concurrency());
+	/** The file records the node and edge counts and GetGraphHash of the graph it was built for */
+	bool Save(const char *filename) const;
+	/** Returns false, leaving the hierarchy empty, if the file wasn't saved for g */
+	bool Load(const char *filename, Graph *g, bool directed);
+	/** Checksum of the edges and weights of g, as contracted by Build */
+	static uint64_t GetGraphHash(Graph *g, bool directed);
+
+	/** Shortest path cost; DBL_MAX if there is no path */
+	double GetDistance(graphState from, graphState to);
+	/** Shortest path with shortcuts unpacked; returns false if there is none */
+	bool GetPath(graphState from, graphState to, std::vector<graphState> &path);
+
+	uint64_t GetNumNodes() const { return rank.size(); }
+	uint64_t GetNumUpwardEdges() const { return upEdges.size()+downEdges.size(); }
+	uint64_t GetNumShortcuts() const { return numShortcuts; }
+	uint64_t GetNodesExpanded() const { return nodesExpanded; }
+	uint64_t GetMemoryUsage() const;
+
+	static const uint32_t kNoNode = 0xFFFFFFFF;
+private:
+	struct arc {
+		arc() {}
+		arc(uint32_t n, uint32_t m, double w) :node(n), middle(m), weight(w) {}
+		uint32_t node;
+		uint32_t middle; // contracted node the shortcut skips; kNoNode for original edges
+		double weight;
+	};
+	// contraction state, only used while building
+	struct witnessData {
+		std::vector<double> dist;
+		std::vector<uint32_t> stamp;
+		uint32_t currStamp;
+		std::priority_queue<std::pair<double, uint32_t>, std::vector<std::pair<double, uint32_t> >,
+			std::greater<std::pair<double, uint32_t> > > open;
+	};
+	struct shortcut {
+		uint32_t from, to, middle;
+		double weight;
+	};
+	void AddArc(uint32_t from, uint32_t to, uint32_t middle, double weight);
+	void FindShortcuts(uint32_t v, witnessData &data, std::vector<shortcut> &result) const;
+	void Worker(SharedQueue<std::pair<uint64_t, uint64_t> > *work, const std::vector<uint32_t> *nodes,
+				std::vector<std::vector<shortcut> > *shortcuts, witnessData *data);
+	void RunWorkers(const std::vector<uint32_t> &nodes, std::vector<std::vector<shortcut> > *shortcuts,
+					std::vector<witnessData> &data);
+	bool Before(uint32_t a, uint32_t b) const;
+	const arc *FindArc(const std::vector<uint64_t> &first, const std::vector<arc> &edges,
+					   uint32_t at, uint32_t other) const;
+	/** first is an index into edges for every node, and the arcs only name nodes of the hierarchy */
+	bool ValidArcs(const std::vector<uint64_t> &first, const std::vector<arc> &edges) const;
+	void Unpack(uint32_t from, uint32_t to, uint32_t middle, std::vector<graphState> &path) const;
+	double Search(uint32_t from, uint32_t to);
+
+	std::vector<std::vector<arc> > out, in;
+	std::vector<int> priority, deletedNeighbors;
+	std::vector<bool> contracted, selected;
+
+	// the hierarchy: rank of each node, upward edges out of each node
+	// (upEdges) and upward edges into each node (downEdges, stored at the
+	// lower node with the higher node as the source)
+	std::vector<uint32_t> rank;
+	std::vector<uint64_t> upFirst, downFirst;
+	std::vector<arc> upEdges, downEdges;
+	uint64_t numShortcuts;
+	// the graph the hierarchy was built for
+	uint64_t numGraphEdges, graphHash;
+
+	// query state
+	std::vector<double> forwardDist, backwardDist;
+	std::vector<uint32_t> forwardParent, backwardParent, forwardStamp, backwardStamp;
+	std::vector<const arc *> forwardArc, backwardArc;
+	uint32_t queryStamp;
+	uint32_t meeting;
+	uint64_t nodesExpanded;
+};
+
+#endif
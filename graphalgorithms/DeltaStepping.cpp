@@ -0,0 +1,266 @@
+/*
+ *  DeltaStepping.cpp
+ *  hog2
+ *
+ *  Parallel single-source shortest paths by delta-stepping.
+ *
+ */
+
+#include "DeltaStepping.h"
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <float.h>
+#include <math.h>
+
+const uint32_t DeltaStepping::kMaxBuckets;
+
+class DeltaStepping::Barrier {
+public:
+	Barrier(int count) :count(count), waiting(0), generation(0) {}
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lock(m);
+		uint64_t gen = generation;
+		if (++waiting == count)
+		{
+			waiting = 0;
+			generation++;
+			cv.notify_all();
+			return;
+		}
+		cv.wait(lock, [this, gen] { return gen != generation; });
+	}
+private:
+	std::mutex m;
+	std::condition_variable cv;
+	int count, waiting;
+	uint64_t generation;
+};
+
+DeltaStepping::DeltaStepping(Graph *g, bool directed, double d, int threads)
+:numThreads(std::max(threads, 1))
+{
+	csr.Build(g, directed);
+	maxWeight = 0;
+	for (uint64_t e = 0; e < csr.GetNumEdges(); e++)
+		maxWeight = std::max(maxWeight, csr.GetWeight(e));
+	dist = new std::atomic<double>[csr.GetNumNodes()];
+	lightStamp = new std::atomic<uint32_t>[csr.GetNumNodes()];
+	heavyStamp = new std::atomic<uint32_t>[csr.GetNumNodes()];
+	// narrower buckets than the lightest edge only add synchronization
+	if (d <= 0 && csr.GetNumNodes() > 0 && csr.GetNumEdges() > 0)
+		d = std::max(maxWeight/((double)csr.GetNumEdges()/csr.GetNumNodes()), csr.GetMinWeight());
+	SetDelta(d);
+	buckets.resize(numThreads);
+	frontiers.resize(numThreads);
+	settled.resize(numThreads);
+	nextBucket.resize(numThreads);
+	firstBucket.resize(numThreads);
+}
+
+DeltaStepping::~DeltaStepping()
+{
+	delete [] dist;
+	delete [] lightStamp;
+	delete [] heavyStamp;
+}
+
+void DeltaStepping::SetDelta(double d)
+{
+	delta = (d > 0)?d:1.0;
+	// live tentative distances never span more than maxWeight past the
+	// current bucket, so the buckets can be reused cyclically as long as
+	// there are maxWeight/delta+2 of them; delta is raised to keep that
+	// number bounded
+	delta = std::max(delta, maxWeight/kMaxBuckets);
+	numBuckets = (uint32_t)(floor(maxWeight/delta)+2);
+}
+
+void DeltaStepping::Relax(int id, uint32_t node, double cost)
+{
+	double old = dist[node].load(std::memory_order_relaxed);
+	while (cost < old)
+	{
+		if (dist[node].compare_exchange_weak(old, cost))
+		{
+			uint64_t b = (uint64_t)(cost/delta);
+			buckets[id][b%numBuckets].push_back(node);
+			firstBucket[id] = std::min(firstBucket[id], b);
+			return;
+		}
+	}
+}
+
+void DeltaStepping::GetDistances(graphState from, std::vector<double> &distances)
+{
+	uint32_t n = csr.GetNumNodes();
+	for (uint32_t x = 0; x < n; x++)
+	{
+		dist[x].store(DBL_MAX, std::memory_order_relaxed);
+		lightStamp[x].store(0, std::memory_order_relaxed);
+		heavyStamp[x].store(0, std::memory_order_relaxed);
+	}
+	for (int x = 0; x < numThreads; x++)
+	{
+		buckets[x].assign(numBuckets, std::vector<uint32_t>());
+		frontiers[x].resize(0);
+		settled[x].resize(0);
+		firstBucket[x] = UINT64_MAX;
+	}
+	distances.assign(n, DBL_MAX);
+	if (from >= n)
+		return;
+	Relax(0, from, 0);
+
+	Barrier barrier(numThreads);
+	std::vector<std::thread*> threads(numThreads);
+	for (int x = 1; x < numThreads; x++)
+		threads[x] = new std::thread(&DeltaStepping::Worker, this, x, &barrier);
+	Worker(0, &barrier);
+	for (int x = 1; x < numThreads; x++)
+	{
+		threads[x]->join();
+		delete threads[x];
+	}
+	for (uint32_t x = 0; x < n; x++)
+		distances[x] = dist[x].load(std::memory_order_relaxed);
+}
+
+void DeltaStepping::Worker(int id, Barrier *barrier)
+{
+	uint64_t current = 0;
+	// same sequence of values in every thread
+	uint32_t round = 0, phase = 0;
+	while (true)
+	{
+		nextBucket[id] = UINT64_MAX;
+		// with up to kMaxBuckets buckets, rescanning the empty ones every
+		// phase would cost more than the search
+		for (uint64_t b = std::max(current, firstBucket[id]); b < current+numBuckets; b++)
+		{
+			if (buckets[id][b%numBuckets].size() > 0)
+			{
+				nextBucket[id] = b;
+				break;
+			}
+		}
+		firstBucket[id] = nextBucket[id];
+		barrier->Wait();
+		current = UINT64_MAX;
+		for (int x = 0; x < numThreads; x++)
+			current = std::min(current, nextBucket[x]);
+		if (current == UINT64_MAX)
+			break;
+		phase++;
+
+		// light edges, until no node enters the current bucket
+		while (true)
+		{
+			frontiers[id].resize(0);
+			frontiers[id].swap(buckets[id][current%numBuckets]);
+			barrier->Wait();
+			uint64_t total = 0;
+			for (int x = 0; x < numThreads; x++)
+				total += frontiers[x].size();
+			if (total == 0)
+				break;
+			round++;
+			uint64_t index = 0;
+			for (int x = 0; x < numThreads; x++)
+			{
+				const std::vector<uint32_t> &f = frontiers[x];
+				// items id, id+numThreads, ... of all frontiers together
+				uint64_t start = (index%numThreads <= (uint64_t)id)?(id-index%numThreads):(numThreads-index%numThreads+id);
+				for (uint64_t y = start; y < f.size(); y += numThreads)
+				{
+					uint32_t v = f[y];
+					double d = dist[v].load(std::memory_order_relaxed);
+					if ((uint64_t)(d/delta) != current)
+						continue;
+					if (lightStamp[v].exchange(round) == round)
+						continue;
+					settled[id].push_back(v);
+					for (uint64_t e = csr.GetFirstEdge(v); e < csr.GetFirstEdge(v+1); e++)
+						if (csr.GetWeight(e) <= delta)
+							Relax(id, csr.GetTarget(e), d+csr.GetWeight(e));
+				}
+				index += f.size();
+			}
+			barrier->Wait();
+		}
+
+		// heavy edges from every node settled in this bucket
+		for (uint32_t v : settled[id])
+		{
+			if (heavyStamp[v].exchange(phase) == phase)
+				continue;
+			double d = dist[v].load(std::memory_order_relaxed);
+			for (uint64_t e = csr.GetFirstEdge(v); e < csr.GetFirstEdge(v+1); e++)
+				if (csr.GetWeight(e) > delta)
+					Relax(id, csr.GetTarget(e), d+csr.GetWeight(e));
+		}
+		settled[id].resize(0);
+		barrier->Wait();
+	}
+}
+
+void DeltaStepping::GetAllPairs(DistanceMatrix &m)
+{
+	uint32_t n = csr.GetNumNodes();
+	m.Resize(n, DBL_MAX);
+	SharedQueue<std::pair<uint64_t, uint64_t> > workQueue(numThreads*20);
+	std::vector<std::thread*> threads(numThreads);
+	for (int x = 0; x < numThreads; x++)
+		threads[x] = new std::thread(&DeltaStepping::AllPairsWorker, this, &workQueue, &m);
+	for (uint64_t x = 0; x < n; x += DistanceMatrix::kBlockSize)
+		workQueue.WaitAdd({x, std::min((uint64_t)n, x+DistanceMatrix::kBlockSize)});
+	for (int x = 0; x < numThreads; x++)
+		workQueue.WaitAdd({0, 0});
+	for (int x = 0; x < numThreads; x++)
+	{
+		threads[x]->join();
+		delete threads[x];
+	}
+}
+
+void DeltaStepping::AllPairsWorker(SharedQueue<std::pair<uint64_t, uint64_t> > *work, DistanceMatrix *m)
+{
+	typedef std::pair<double, uint32_t> entry;
+	std::priority_queue<entry, std::vector<entry>, std::greater<entry> > open;
+	std::vector<double> costs(csr.GetNumNodes());
+	std::vector<bool> closed(csr.GetNumNodes());
+	std::pair<uint64_t, uint64_t> item;
+	while (true)
+	{
+		work->WaitRemove(item);
+		if (item.first == item.second)
+			break;
+		for (uint64_t from = item.first; from < item.second; from++)
+		{
+			std::fill(costs.begin(), costs.end(), DBL_MAX);
+			std::fill(closed.begin(), closed.end(), false);
+			costs[from] = 0;
+			open.push({0, from});
+			while (!open.empty())
+			{
+				entry next = open.top();
+				open.pop();
+				if (closed[next.second])
+					continue;
+				closed[next.second] = true;
+				m->Set(from, next.second, next.first);
+				for (uint64_t e = csr.GetFirstEdge(next.second); e < csr.GetFirstEdge(next.second+1); e++)
+				{
+					uint32_t to = csr.GetTarget(e);
+					double cost = next.first+csr.GetWeight(e);
+					if (cost < costs[to])
+					{
+						costs[to] = cost;
+						open.push({cost, to});
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,73 @@
+/*
+ *  DeltaStepping.h
+ *  hog2
+ *
+ *  Parallel single-source shortest paths by delta-stepping, and parallel
+ *  all-pairs shortest paths for sparse graphs.
+ *
+ *  Delta-stepping keeps tentative distances in buckets of width delta and
+ *  settles one bucket at a time. Within a bucket, light edges (weight <=
+ *  delta) are relaxed in rounds until the bucket stops changing; heavy
+ *  edges are relaxed once afterwards. Every thread inserts into its own
+ *  buckets; the nodes of the current bucket are then shared out evenly
+ *  for the next round, and distances are updated with compare-and-swap.
+ *
+ *  All-pairs runs one Dijkstra search per source instead, with sources
+ *  split over threads in bands of DistanceMatrix::kBlockSize. For sparse
+ *  graphs this is much cheaper than FloydWarshall.
+ *
+ */
+
+#ifndef DELTASTEPPING_H
+#define DELTASTEPPING_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "GraphEnvironment.h"
+#include "CSRGraph.h"
+#include "SharedQueue.h"
+#include "DistanceMatrix.h"
+
+class DeltaStepping {
+public:
+	/** A delta of 0 uses the largest edge weight divided by the average degree (at least the smallest weight) */
+	DeltaStepping(Graph *g, bool directed, double delta = 0, int numThreads = std::thread::hardware_concurrency());
+	~DeltaStepping();
+	DeltaStepping(const DeltaStepping &) = delete;
+	DeltaStepping &operator=(const DeltaStepping &) = delete;
+
+	/** Deltas below maxWeight/kMaxBuckets are raised to it */
+	void SetDelta(double d);
+	double GetDelta() const { return delta; }
+
+	/** distances[x] is the cost from -> x; DBL_MAX if x can't be reached */
+	void GetDistances(graphState from, std::vector<double> &distances);
+	/** Fills m with the cost between every pair of nodes; DBL_MAX if there is no path */
+	void GetAllPairs(DistanceMatrix &m);
+	const CSRGraph &GetGraph() const { return csr; }
+	static const uint32_t kMaxBuckets = 1000000;
+private:
+	class Barrier;
+	void Worker(int id, Barrier *barrier);
+	void Relax(int id, uint32_t node, double cost);
+	void AllPairsWorker(SharedQueue<std::pair<uint64_t, uint64_t> > *work, DistanceMatrix *m);
+
+	CSRGraph csr;
+	double delta;
+	double maxWeight;
+	int numThreads;
+	uint32_t numBuckets;
+
+	// search state, shared by the threads of one GetDistances call
+	std::atomic<double> *dist;
+	std::atomic<uint32_t> *lightStamp, *heavyStamp;
+	// buckets[thread][absolute bucket % numBuckets]
+	std::vector<std::vector<std::vector<uint32_t> > > buckets;
+	std::vector<std::vector<uint32_t> > frontiers, settled;
+	std::vector<uint64_t> nextBucket;
+	// no bucket of the thread below this is in use; UINT64_MAX if all are empty
+	std::vector<uint64_t> firstBucket;
+};
+
+#endif
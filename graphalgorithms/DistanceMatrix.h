@@ -0,0 +1,63 @@
+/*
+ *  DistanceMatrix.h
+ *  hog2
+ *
+ *  Dense all-pairs distance matrix stored in square tiles.
+ *
+ *  Entry (from, to) lives in tile (from/kBlockSize, to/kBlockSize); each
+ *  tile is kBlockSize x kBlockSize contiguous values. Rows of one band of
+ *  kBlockSize sources fill their own tiles, so threads writing different
+ *  bands never share cache lines, and blocked algorithms work on whole
+ *  tiles at a time. The size is padded to a multiple of kBlockSize.
+ *
+ */
+
+#ifndef DISTANCEMATRIX_H
+#define DISTANCEMATRIX_H
+
+#include <stdint.h>
+#include <vector>
+
+class DistanceMatrix {
+public:
+	static const uint32_t kBlockSize = 64;
+	DistanceMatrix() :n(0), blocks(0) {}
+	/** Every entry, including the padding, is set to value */
+	void Resize(uint32_t numNodes, double value)
+	{
+		n = numNodes;
+		blocks = (n+kBlockSize-1)/kBlockSize;
+		data.assign((uint64_t)blocks*blocks*kBlockSize*kBlockSize, value);
+	}
+	uint32_t GetNumNodes() const { return n; }
+	uint32_t GetNumBlocks() const { return blocks; }
+	double Get(uint32_t from, uint32_t to) const { return data[Index(from, to)]; }
+	void Set(uint32_t from, uint32_t to, double value) { data[Index(from, to)] = value; }
+	/** Tile (row, col) in blocks; kBlockSize rows of kBlockSize values */
+	double *GetBlock(uint32_t row, uint32_t col)
+	{ return &data[((uint64_t)row*blocks+col)*kBlockSize*kBlockSize]; }
+	/** Copies into nested vectors, replacing entries >= infinity with infinity */
+	void CopyTo(std::vector<std::vector<double> > &lengths, double infinity) const
+	{
+		lengths.resize(n);
+		for (uint32_t x = 0; x < n; x++)
+		{
+			lengths[x].resize(n);
+			for (uint32_t y = 0; y < n; y++)
+			{
+				double v = Get(x, y);
+				lengths[x][y] = (v < infinity)?v:infinity;
+			}
+		}
+	}
+private:
+	uint64_t Index(uint32_t from, uint32_t to) const
+	{
+		return ((uint64_t)(from/kBlockSize)*blocks+to/kBlockSize)*kBlockSize*kBlockSize+
+		(from%kBlockSize)*kBlockSize+to%kBlockSize;
+	}
+	uint32_t n, blocks;
+	std::vector<double> data;
+};
+
+#endif
@@ -8,45 +8,118 @@
  */
 
 #include "FloydWarshall.h"
+#include <algorithm>
 
-//1 /* Assume a function edgeCost(i,j) which returns the cost of the edge from i to j
-// 2    (infinity if there is none).
-// 3    Also assume that n is the number of vertices and edgeCost(i,i)=0
-// 4 */
-//5
-//6 int path[][];
-//7 /* A 2-dimensional matrix. At each step in the algorithm, path[i][j] is the shortest path
-// 8    from i to j using intermediate vertices (1..k-1).  Each path[i][j] is initialized to
-// 9    edgeCost(i,j).
-// 10 */
-//11
-void FloydWarshall(Graph *g, std::vector<std::vector<double> > &lengths)
+static const double kNoPath = 1e10;
+static const uint32_t B = DistanceMatrix::kBlockSize;
+
+/*
+ * c[i][j] = min(c[i][j], a[i][k]+b[k][j]) with k outermost, which is
+ * Floyd-Warshall order when the tiles overlap (the diagonal tile, and the
+ * tiles in its row and column).
+ */
+static void UpdateDependentTile(double *c, const double *a, const double *b)
+{
+	for (uint32_t k = 0; k < B; k++)
+	{
+		for (uint32_t i = 0; i < B; i++)
+		{
+			double aik = a[i*B+k];
+			double *ci = c+i*B;
+			const double *bk = b+k*B;
+			for (uint32_t j = 0; j < B; j++)
+				ci[j] = std::min(ci[j], aik+bk[j]);
+		}
+	}
+}
+
+/*
+ * Same update for a tile that overlaps neither a nor b. The inner loop is
+ * a min-plus row operation on contiguous values that the compiler turns
+ * into vector instructions.
+ */
+static void UpdateIndependentTile(double * __restrict c, const double * __restrict a, const double * __restrict b)
 {
-	lengths.resize(0);
-	lengths.resize(g->GetNumNodes());
-	for (int x = 0; x < g->GetNumNodes(); x++)
+	for (uint32_t i = 0; i < B; i++)
 	{
-		lengths[x].resize(g->GetNumNodes());
-		for (int i = 0; i < g->GetNumNodes(); i++)
-			lengths[x][i] = 1e10;
+		double * __restrict ci = c+i*B;
+		for (uint32_t k = 0; k < B; k++)
+		{
+			double aik = a[i*B+k];
+			const double * __restrict bk = b+k*B;
+			for (uint32_t j = 0; j < B; j++)
+				ci[j] = std::min(ci[j], aik+bk[j]);
+		}
 	}
+}
 
+static void UpdateTiles(DistanceMatrix *m, uint32_t k, const std::vector<std::pair<uint32_t, uint32_t> > *tiles,
+						uint32_t first, uint32_t step, bool dependent)
+{
+	for (uint32_t x = first; x < tiles->size(); x += step)
+	{
+		uint32_t row = (*tiles)[x].first, col = (*tiles)[x].second;
+		if (dependent)
+			UpdateDependentTile(m->GetBlock(row, col), m->GetBlock(row, k), m->GetBlock(k, col));
+		else
+			UpdateIndependentTile(m->GetBlock(row, col), m->GetBlock(row, k), m->GetBlock(k, col));
+	}
+}
+
+static void UpdateTilesParallel(DistanceMatrix &m, uint32_t k, const std::vector<std::pair<uint32_t, uint32_t> > &tiles,
+								int numThreads, bool dependent)
+{
+	numThreads = std::max(1, std::min(numThreads, (int)tiles.size()));
+	std::vector<std::thread*> threads(numThreads);
+	for (int x = 1; x < numThreads; x++)
+		threads[x] = new std::thread(UpdateTiles, &m, k, &tiles, x, numThreads, dependent);
+	UpdateTiles(&m, k, &tiles, 0, numThreads, dependent);
+	for (int x = 1; x < numThreads; x++)
+	{
+		threads[x]->join();
+		delete threads[x];
+	}
+}
+
+void FloydWarshall(Graph *g, DistanceMatrix &lengths, int numThreads)
+{
+	lengths.Resize(g->GetNumNodes(), kNoPath);
 	for (int x = 0; x < g->GetNumEdges(); x++)
 	{
 		edge *e = g->GetEdge(x);
-		lengths[e->getFrom()][e->getTo()] = e->GetWeight();
-		lengths[e->getTo()][e->getFrom()] = e->GetWeight();
+		lengths.Set(e->getFrom(), e->getTo(), e->GetWeight());
+		lengths.Set(e->getTo(), e->getFrom(), e->GetWeight());
 	}
-	
-	for (int x = 0; x < g->GetNumNodes(); x++)
+
+	uint32_t blocks = lengths.GetNumBlocks();
+	std::vector<std::pair<uint32_t, uint32_t> > line, rest;
+	for (uint32_t k = 0; k < blocks; k++)
 	{
-		for (int i = 0; i < g->GetNumNodes(); i++)
+		// 1. the diagonal tile on its own
+		UpdateDependentTile(lengths.GetBlock(k, k), lengths.GetBlock(k, k), lengths.GetBlock(k, k));
+		// 2. the rest of row and column k, which only depend on the diagonal tile
+		line.resize(0);
+		for (uint32_t x = 0; x < blocks; x++)
 		{
-			for (int j = 0; j < g->GetNumNodes(); j++)
-			{
-				lengths[i][j] = std::min(lengths[i][j], lengths[i][x]+lengths[x][j]);
-			}
+			if (x == k)
+				continue;
+			line.push_back({k, x});
+			line.push_back({x, k});
 		}
+		UpdateTilesParallel(lengths, k, line, numThreads, true);
+		// 3. all other tiles, from row and column k
+		rest.resize(0);
+		for (uint32_t x = 0; x < blocks; x++)
+			for (uint32_t y = 0; y < blocks; y++)
+				if (x != k && y != k)
+					rest.push_back({x, y});
+		UpdateTilesParallel(lengths, k, rest, numThreads, false);
 	}
 }
 
+void FloydWarshall(Graph *g, std::vector<std::vector<double> > &lengths)
+{
+	DistanceMatrix m;
+	FloydWarshall(g, m);
+	m.CopyTo(lengths, kNoPath);
+}
@@ -11,8 +11,20 @@
 #define FLOYDWARSHALL_H
 
 #include "Graph.h"
+#include "DistanceMatrix.h"
 #include <vector>
+#include <thread>
 
+/**
+ * All-pairs shortest paths with edges usable in both directions. Pairs
+ * without a path are 1e10; the diagonal holds the shortest cycle through
+ * each node.
+ */
 void FloydWarshall(Graph *g, std::vector<std::vector<double> > &lengths);
+/**
+ * Same, into a tiled matrix: tiles along the diagonal are solved in turn
+ * and the tiles they affect are updated in parallel.
+ */
+void FloydWarshall(Graph *g, DistanceMatrix &lengths, int numThreads = std::thread::hardware_concurrency());
 
 #endif
@@ -0,0 +1,358 @@
+//
+//  BitboardJPS.cpp
+//  hog2 glut
+//
+//  Jump Point Search with bitboard scans for straight jumps.
+//
+
+#include "BitboardJPS.h"
+#include <algorithm>
+#include "FPUtil.h"
+
+// Finds the first position >= start on a line that is blocked, is the goal,
+// or has a forced neighbor when moving towards higher positions. A cell has
+// a forced neighbor on a side if the side cell is open but the side cell
+// one step back is blocked. Returns -1 if the line is blocked first.
+static int ScanForward(const uint64_t *line, const uint64_t *side1, const uint64_t *side2,
+					   int numWords, int start, int goal)
+{
+	for (int word = start>>6; word < numWords; word++)
+	{
+		uint64_t back1 = (side1[word]<<1)|((word > 0)?(side1[word-1]>>63):0);
+		uint64_t back2 = (side2[word]<<1)|((word > 0)?(side2[word-1]>>63):0);
+		uint64_t stop = (side1[word]&~back1)|(side2[word]&~back2)|~line[word];
+		if ((goal>>6) == word)
+			stop |= 1ull<<(goal&63);
+		if (word == (start>>6))
+			stop &= (~0ull)<<(start&63);
+		if (stop)
+		{
+			int bit = __builtin_ctzll(stop);
+			if (((line[word]>>bit)&1) == 0)
+				return -1;
+			return word*64+bit;
+		}
+	}
+	return -1;
+}
+
+// Same as ScanForward, moving towards lower positions
+static int ScanBackward(const uint64_t *line, const uint64_t *side1, const uint64_t *side2,
+						int numWords, int start, int goal)
+{
+	for (int word = start>>6; word >= 0; word--)
+	{
+		uint64_t back1 = (side1[word]>>1)|((word+1 < numWords)?(side1[word+1]<<63):0);
+		uint64_t back2 = (side2[word]>>1)|((word+1 < numWords)?(side2[word+1]<<63):0);
+		uint64_t stop = (side1[word]&~back1)|(side2[word]&~back2)|~line[word];
+		if (goal >= 0 && (goal>>6) == word)
+			stop |= 1ull<<(goal&63);
+		if (word == (start>>6))
+			stop &= (~0ull)>>(63-(start&63));
+		if (stop)
+		{
+			int bit = 63-__builtin_clzll(stop);
+			if (((line[word]>>bit)&1) == 0)
+				return -1;
+			return word*64+bit;
+		}
+	}
+	return -1;
+}
+
+BitboardJPS::BitboardJPS(Map *m)
+:map(m), env(0), nodesExpanded(0), nodesTouched(0), weight(1.0)
+{
+	UpdateMap();
+}
+
+void BitboardJPS::UpdateMap()
+{
+	w = map->GetMapWidth();
+	h = map->GetMapHeight();
+	rowWords = (w+2+63)/64;
+	colWords = (h+2+63)/64;
+	rows.assign((h+2)*rowWords, 0);
+	cols.assign((w+2)*colWords, 0);
+	for (int y = 0; y < h; y++)
+		for (int x = 0; x < w; x++)
+			if ((map->GetTerrainType(x, y)>>terrainBits) == (kGround>>terrainBits))
+				SetPassable(x, y);
+}
+
+void BitboardJPS::SetPassable(int x, int y)
+{
+	rows[(y+1)*rowWords+((x+1)>>6)] |= 1ull<<((x+1)&63);
+	cols[(x+1)*colWords+((y+1)>>6)] |= 1ull<<((y+1)&63);
+}
+
+double BitboardJPS::HCost(int x1, int y1, int x2, int y2) const
+{
+	int dx = abs(x1-x2);
+	int dy = abs(y1-y2);
+	return std::max(dx, dy)+(ROOT_TWO-1)*std::min(dx, dy);
+}
+
+bool BitboardJPS::InitializeSearch(MapEnvironment *env, const xyLoc& from, const xyLoc& to, std::vector<xyLoc> &thePath)
+{
+	nodesExpanded = nodesTouched = 0;
+	thePath.resize(0);
+	this->env = env;
+	this->to = to;
+	openClosedList.Reset(w*h);
+	if (!Passable(from.x, from.y) || !Passable(to.x, to.y))
+		return false;
+	xyLocParent f;
+	f.loc = from;
+	f.parent = 0xFF;
+	openClosedList.AddOpenNode(f, from.y*w+from.x, 0, weight*HCost(from.x, from.y, to.x, to.y));
+	if (from == to)
+	{
+		thePath.push_back(from);
+		return false;
+	}
+	return true;
+}
+
+bool BitboardJPS::DoSingleSearchStep(std::vector<xyLoc> &thePath)
+{
+	if (openClosedList.OpenSize() == 0)
+		return true;
+
+	nodesExpanded++;
+	uint64_t next = openClosedList.Close();
+	xyLocParent nextState = openClosedList.Lookat(next).data;
+	if (nextState.loc == to)
+	{
+		thePath.resize(0);
+		ExtractPathToStartFromID(next, thePath);
+		std::reverse(thePath.begin(), thePath.end());
+		return true;
+	}
+
+	successors.resize(0);
+	GetJPSSuccessors(nextState.loc.x, nextState.loc.y, nextState.parent);
+	nodesTouched += successors.size();
+	double g = openClosedList.Lookat(next).g;
+	for (const auto &s : successors)
+	{
+		uint64_t theID;
+		uint64_t hash = s.s.loc.y*w+s.s.loc.x;
+		switch (openClosedList.Lookup(hash, theID))
+		{
+			case kClosedList:
+				break;
+			case kNotFound:
+				openClosedList.AddOpenNode(s.s, hash, g+s.cost,
+										   weight*HCost(s.s.loc.x, s.s.loc.y, to.x, to.y), next);
+				break;
+			case kOpenList:
+				if (fless(g+s.cost, openClosedList.Lookup(theID).g))
+				{
+					openClosedList.Lookup(theID).parentID = next;
+					openClosedList.Lookup(theID).g = g+s.cost;
+					openClosedList.Lookup(theID).data.parent = s.s.parent;
+					openClosedList.KeyChanged(theID);
+				}
+				break;
+		}
+	}
+	return false;
+}
+
+void BitboardJPS::GetJPSSuccessors(int x, int y, uint8_t parent)
+{
+	// Same expansion rules as JPS: the parent bits are the directions to
+	// continue in, and a diagonal is only taken if both of its cardinal
+	// directions are allowed and open.
+	bool n1 = false, s1 = false, e1 = false, w1 = false;
+	if ((parent&kN) && Passable(x, y-1))
+	{
+		n1 = true;
+		StraightJump(x, y, kN, 0);
+	}
+	if ((parent&kW) && Passable(x-1, y))
+	{
+		w1 = true;
+		StraightJump(x, y, kW, 0);
+	}
+	if ((parent&kS) && Passable(x, y+1))
+	{
+		s1 = true;
+		StraightJump(x, y, kS, 0);
+	}
+	if ((parent&kE) && Passable(x+1, y))
+	{
+		e1 = true;
+		StraightJump(x, y, kE, 0);
+	}
+	if (n1 && w1 && Passable(x-1, y-1))
+		DiagonalJump(x-1, y-1, kNW, ROOT_TWO);
+	if (n1 && e1 && Passable(x+1, y-1))
+		DiagonalJump(x+1, y-1, kNE, ROOT_TWO);
+	if (s1 && w1 && Passable(x-1, y+1))
+		DiagonalJump(x-1, y+1, kSW, ROOT_TWO);
+	if (s1 && e1 && Passable(x+1, y+1))
+		DiagonalJump(x+1, y+1, kSE, ROOT_TWO);
+}
+
+void BitboardJPS::StraightJump(int x, int y, tDirection dir, double cost)
+{
+	// all positions here include the border, so cell x is at x+1
+	int px = x+1, py = y+1;
+	int pos;
+	switch (dir)
+	{
+		case kE:
+		case kW:
+		{
+			const uint64_t *line = &rows[py*rowWords];
+			int goal = (to.y == y)?(to.x+1):-1;
+			if (dir == kE)
+				pos = ScanForward(line, line-rowWords, line+rowWords, rowWords, px+1, goal);
+			else
+				pos = ScanBackward(line, line-rowWords, line+rowWords, rowWords, px-1, goal);
+			if (pos == -1)
+				return;
+			int jx = pos-1;
+			uint8_t next = 0;
+			if (!(jx == to.x && y == to.y))
+			{
+				int back = (dir == kE)?jx-1:jx+1;
+				next = dir;
+				if (Passable(jx, y-1) && !Passable(back, y-1))
+					next |= kN;
+				if (Passable(jx, y+1) && !Passable(back, y+1))
+					next |= kS;
+			}
+			successors.push_back(jpsSuccessor(jx, y, next, cost+abs(jx-x)));
+			break;
+		}
+		case kN:
+		case kS:
+		{
+			const uint64_t *line = &cols[px*colWords];
+			int goal = (to.x == x)?(to.y+1):-1;
+			if (dir == kS)
+				pos = ScanForward(line, line-colWords, line+colWords, colWords, py+1, goal);
+			else
+				pos = ScanBackward(line, line-colWords, line+colWords, colWords, py-1, goal);
+			if (pos == -1)
+				return;
+			int jy = pos-1;
+			uint8_t next = 0;
+			if (!(x == to.x && jy == to.y))
+			{
+				int back = (dir == kS)?jy-1:jy+1;
+				next = dir;
+				if (Passable(x-1, jy) && !Passable(x-1, back))
+					next |= kW;
+				if (Passable(x+1, jy) && !Passable(x+1, back))
+					next |= kE;
+			}
+			successors.push_back(jpsSuccessor(x, jy, next, cost+abs(jy-y)));
+			break;
+		}
+		default:
+			assert(!"BitboardJPS: straight jump in a diagonal direction");
+	}
+}
+
+void BitboardJPS::DiagonalJump(int x, int y, tDirection dir, double cost)
+{
+	int dx = (dir&kE)?1:-1;
+	int dy = (dir&kS)?1:-1;
+	tDirection vertical = tDirection(dir&(kN|kS));
+	tDirection horizontal = tDirection(dir&(kE|kW));
+	while (true)
+	{
+		nodesTouched++;
+		if (x == to.x && y == to.y)
+		{
+			successors.push_back(jpsSuccessor(x, y, 0, cost));
+			return;
+		}
+		bool v = Passable(x, y+dy);
+		bool hz = Passable(x+dx, y);
+		if (v)
+			StraightJump(x, y, vertical, cost);
+		if (hz)
+			StraightJump(x, y, horizontal, cost);
+		if (!(v && hz && Passable(x+dx, y+dy)))
+			return;
+		x += dx;
+		y += dy;
+		cost += ROOT_TWO;
+	}
+}
+
+void BitboardJPS::ExtractPathToStartFromID(uint64_t node, std::vector<xyLoc> &thePath)
+{
+	do {
+		thePath.push_back(openClosedList.Lookup(node).data.loc);
+		node = openClosedList.Lookup(node).parentID;
+	} while (openClosedList.Lookup(node).parentID != node);
+	thePath.push_back(openClosedList.Lookup(node).data.loc);
+}
+
+void BitboardJPS::GetPath(MapEnvironment *env, const xyLoc &from, const xyLoc &to, std::vector<xyLoc> &path)
+{
+	if (InitializeSearch(env, from, to, path) == false)
+		return;
+	while (DoSingleSearchStep(path) == false)
+	{}
+}
+
+void BitboardJPS::GetPath(MapEnvironment *env, const xyLoc &from, const xyLoc &to, std::vector<tDirection> &path)
+{
+	std::vector<xyLoc> points;
+	GetPath(env, from, to, points);
+	path.resize(0);
+	// jump point paths move diagonally first and then straight between points
+	for (unsigned int x = 1; x < points.size(); x++)
+	{
+		xyLoc curr = points[x-1];
+		while (curr != points[x])
+		{
+			int dir = 0;
+			if (curr.x < points[x].x) { dir |= kE; curr.x++; }
+			else if (curr.x > points[x].x) { dir |= kW; curr.x--; }
+			if (curr.y < points[x].y) { dir |= kS; curr.y++; }
+			else if (curr.y > points[x].y) { dir |= kN; curr.y--; }
+			path.push_back(tDirection(dir));
+		}
+	}
+}
+
+void BitboardJPS::GetPath(CanonicalGrid::CanonicalGrid *, const CanonicalGrid::xyLoc &from,
+						  const CanonicalGrid::xyLoc &to, std::vector<CanonicalGrid::xyLoc> &path)
+{
+	std::vector<xyLoc> points;
+	GetPath((MapEnvironment*)0, xyLoc(from.x, from.y), xyLoc(to.x, to.y), points);
+	path.resize(0);
+	for (const auto &p : points)
+		path.push_back(CanonicalGrid::xyLoc(p.x, p.y));
+}
+
+void BitboardJPS::LogFinalStats(StatCollection *)
+{
+}
+
+void BitboardJPS::OpenGLDraw() const
+{
+	if (env == 0 || openClosedList.size() == 0)
+		return;
+	for (unsigned int x = 0; x < openClosedList.size(); x++)
+	{
+		const auto &data = openClosedList.Lookat(x);
+		if (data.round != openClosedList.GetRound())
+			continue;
+		env->SetColor(0.0, 0.0, 0.0);
+		env->GLDrawLine(data.data.loc, openClosedList.Lookat(data.parentID).data.loc);
+		if (data.where == kOpenList)
+			env->SetColor(0.0, 1.0, 0.0);
+		else
+			env->SetColor(1.0, 0.0, 0.0);
+		env->OpenGLDraw(data.data.loc);
+	}
+}
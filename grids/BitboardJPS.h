@@ -0,0 +1,78 @@
+//
+//  BitboardJPS.h
+//  hog2 glut
+//
+//  Jump Point Search where straight jumps are found with 64-bit scans over
+//  passability bitboards instead of stepping one cell at a time.
+//
+//  The map is stored twice, once row-major (for east/west jumps) and once
+//  column-major (for north/south jumps), with a blocked border of one cell
+//  so that scans never need bounds checks. A straight jump loads one word
+//  of the line being scanned and of the two neighboring lines, marks the
+//  cells with a forced neighbor, and finds the first jump point or wall
+//  with ctz/clz. Diagonal moves still step cell by cell, running the two
+//  straight scans at each step.
+//
+//  Movement follows MapEnvironment on octile maps: cells in the ground
+//  terrain category are passable and diagonal moves need both adjacent
+//  cardinal cells to be open. The search only needs the map, so it can be
+//  used with MapEnvironment or CanonicalGrid. The bitboards are built when
+//  the object is constructed; call UpdateMap() after changing the map.
+//
+
+#ifndef BitboardJPS_h
+#define BitboardJPS_h
+
+#include <stdio.h>
+#include <vector>
+#include "JPS.h"
+#include "CanonicalGrid.h"
+
+class BitboardJPS : public GenericSearchAlgorithm<xyLoc, tDirection, MapEnvironment>
+{
+public:
+	BitboardJPS(Map *m);
+	void UpdateMap();
+	void GetPath(MapEnvironment *env, const xyLoc &from, const xyLoc &to, std::vector<xyLoc> &path);
+	void GetPath(MapEnvironment *env, const xyLoc &from, const xyLoc &to, std::vector<tDirection> &path);
+	void GetPath(CanonicalGrid::CanonicalGrid *env, const CanonicalGrid::xyLoc &from,
+				 const CanonicalGrid::xyLoc &to, std::vector<CanonicalGrid::xyLoc> &path);
+
+	/** env is only used for drawing and may be null */
+	bool InitializeSearch(MapEnvironment *env, const xyLoc& from, const xyLoc& to, std::vector<xyLoc> &thePath);
+	bool DoSingleSearchStep(std::vector<xyLoc> &thePath);
+
+	const char *GetName() { return "BitboardJPS"; }
+	uint64_t GetNodesExpanded() const { return nodesExpanded; }
+	uint64_t GetNodesTouched() const { return nodesTouched; }
+	uint64_t GetNumOpenItems() const { return openClosedList.OpenSize(); }
+	xyLoc GetOpenItem(int which) const { return openClosedList.Lookat(openClosedList.GetOpenItem(which)).data.loc; }
+	void SetWeight(double val) { weight = val; }
+	void LogFinalStats(StatCollection *stats);
+	void OpenGLDraw() const;
+	void OpenGLDraw(const MapEnvironment *env) const {}
+private:
+	void GetJPSSuccessors(int x, int y, uint8_t parent);
+	void StraightJump(int x, int y, tDirection dir, double cost);
+	void DiagonalJump(int x, int y, tDirection dir, double cost);
+	bool Passable(int x, int y) const
+	{ return (rows[(y+1)*rowWords+((x+1)>>6)]>>((x+1)&63))&1; }
+	void SetPassable(int x, int y);
+	double HCost(int x1, int y1, int x2, int y2) const;
+	void ExtractPathToStartFromID(uint64_t node, std::vector<xyLoc> &thePath);
+
+	Map *map;
+	int w, h;
+	// (w+2)x(h+2) cells including the blocked border
+	int rowWords, colWords;
+	std::vector<uint64_t> rows, cols;
+
+	IndexOpenClosed<xyLocParent> openClosedList;
+	std::vector<jpsSuccessor> successors;
+	MapEnvironment *env;
+	xyLoc to;
+	uint64_t nodesExpanded, nodesTouched;
+	double weight;
+};
+
+#endif /* BitboardJPS_h */
@@ -0,0 +1,372 @@
+//
+//  JPSPlus.cpp
+//  hog2 glut
+//
+//  JPS+: Jump Point Search with precomputed jump distances.
+//
+
+#include "JPSPlus.h"
+#include <string.h>
+#include <algorithm>
+#include "FPUtil.h"
+#include "MMapUtil.h"
+
+namespace {
+	// direction 0 is north, continuing clockwise
+	const int kDX[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+	const int kDY[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+	const uint8_t kBits[8] = { kN, kNE, kE, kSE, kS, kSW, kW, kNW };
+
+	struct JPSPlusHeader {
+		char magic[8];
+		uint64_t mapHash;
+		uint32_t width, height;
+	};
+	const char kMagic[8] = {'H', 'O', 'G', 'J', 'P', 'S', 'P', '1'};
+}
+
+JPSPlus::JPSPlus(Map *m, const char *cacheDirectory)
+:map(m), table(0), mem(0), memSize(0), fd(-1), env(0), nodesExpanded(0), nodesTouched(0), weight(1.0)
+{
+	UpdateMap(cacheDirectory);
+}
+
+JPSPlus::~JPSPlus()
+{
+	CloseTable();
+}
+
+void JPSPlus::CloseTable()
+{
+	if (mem != 0)
+		CloseMMap(mem, memSize, fd);
+	mem = 0;
+	memSize = 0;
+	table = 0;
+	builtTable.clear();
+}
+
+void JPSPlus::UpdateMap(const char *cacheDirectory)
+{
+	CloseTable();
+	w = map->GetMapWidth();
+	h = map->GetMapHeight();
+	passable.assign(w*h, false);
+	for (int y = 0; y < h; y++)
+		for (int x = 0; x < w; x++)
+			passable[y*w+x] = ((map->GetTerrainType(x, y)>>terrainBits) == (kGround>>terrainBits));
+
+	if (cacheDirectory != 0 && Load(GetCacheFileName(cacheDirectory).c_str()))
+		return;
+	BuildTable();
+	if (cacheDirectory != 0)
+		Save(GetCacheFileName(cacheDirectory).c_str());
+}
+
+std::string JPSPlus::GetCacheFileName(const char *cacheDirectory) const
+{
+	char name[32];
+	sprintf(name, "jpsplus-%016llx.dat", (unsigned long long)map->GetMapHash());
+	std::string result = cacheDirectory;
+	if (result.size() > 0 && result.back() != '/')
+		result += '/';
+	return result+name;
+}
+
+void JPSPlus::BuildTable()
+{
+	builtTable.assign(w*h*8, 0);
+	int16_t *t = &builtTable[0];
+	// Straight directions first, since diagonal jump points are defined by
+	// them. Cells are visited so that the next cell in the direction is
+	// always done already.
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (int which = pass; which < 8; which += 2)
+		{
+			int dx = kDX[which], dy = kDY[which];
+			for (int iy = 0; iy < h; iy++)
+			{
+				int y = (dy > 0)?(h-1-iy):iy;
+				for (int ix = 0; ix < w; ix++)
+				{
+					int x = (dx > 0)?(w-1-ix):ix;
+					int nx = x+dx, ny = y+dy;
+					int16_t &d = t[(y*w+x)*8+which];
+					bool jumpPoint;
+					if (which%2 == 0)
+					{
+						if (!Passable(nx, ny))
+							continue;
+						// a side cell that is open but was blocked one step back
+						jumpPoint = (Passable(nx-dy, ny+dx) && !Passable(nx-dy-dx, ny+dx-dy)) ||
+						(Passable(nx+dy, ny-dx) && !Passable(nx+dy-dx, ny-dx-dy));
+					}
+					else {
+						if (!Passable(nx, y) || !Passable(x, ny) || !Passable(nx, ny))
+							continue;
+						// a straight jump from the next cell finds a jump point
+						jumpPoint = (t[(ny*w+nx)*8+(which+7)%8] > 0) || (t[(ny*w+nx)*8+(which+1)%8] > 0);
+					}
+					if (jumpPoint)
+					{
+						d = 1;
+					}
+					else {
+						int16_t next = t[(ny*w+nx)*8+which];
+						d = (next > 0)?(next+1):(next-1);
+					}
+				}
+			}
+		}
+	}
+	table = t;
+}
+
+bool JPSPlus::Save(const char *filename) const
+{
+	FILE *f = fopen(filename, "w");
+	if (f == 0)
+	{
+		printf("Error: unable to open '%s' for writing\n", filename);
+		return false;
+	}
+	JPSPlusHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kMagic, 8);
+	header.mapHash = map->GetMapHash();
+	header.width = w;
+	header.height = h;
+	bool ok = (fwrite(&header, sizeof(header), 1, f) == 1) &&
+	(fwrite(table, sizeof(int16_t), w*h*8, f) == (size_t)w*h*8);
+	fclose(f);
+	if (!ok)
+		printf("Error writing JPS+ table to '%s'\n", filename);
+	return ok;
+}
+
+bool JPSPlus::Load(const char *filename)
+{
+	FILE *f = fopen(filename, "r");
+	if (f == 0)
+		return false;
+	fclose(f);
+
+	uint8_t *newMem;
+	uint64_t newSize;
+	int newFD;
+	newMem = GetReadOnlyMMAP(filename, newSize, newFD);
+	if (newMem == 0)
+		return false;
+	JPSPlusHeader header;
+	if (newSize >= sizeof(header))
+		memcpy(&header, newMem, sizeof(header));
+	if (newSize != sizeof(header)+sizeof(int16_t)*w*h*8 || memcmp(header.magic, kMagic, 8) != 0 ||
+		header.width != (uint32_t)w || header.height != (uint32_t)h || header.mapHash != map->GetMapHash())
+	{
+		printf("Error: '%s' is not a JPS+ table for this map\n", filename);
+		CloseMMap(newMem, newSize, newFD);
+		return false;
+	}
+	CloseTable();
+	mem = newMem;
+	memSize = newSize;
+	fd = newFD;
+	table = (const int16_t *)(mem+sizeof(header));
+	return true;
+}
+
+double JPSPlus::HCost(int x1, int y1, int x2, int y2) const
+{
+	int dx = abs(x1-x2);
+	int dy = abs(y1-y2);
+	return std::max(dx, dy)+(ROOT_TWO-1)*std::min(dx, dy);
+}
+
+bool JPSPlus::InitializeSearch(MapEnvironment *env, const xyLoc& from, const xyLoc& to, std::vector<xyLoc> &thePath)
+{
+	nodesExpanded = nodesTouched = 0;
+	thePath.resize(0);
+	this->env = env;
+	this->to = to;
+	openClosedList.Reset(w*h);
+	if (!Passable(from.x, from.y) || !Passable(to.x, to.y))
+		return false;
+	xyLocParent f;
+	f.loc = from;
+	f.parent = 0xFF;
+	openClosedList.AddOpenNode(f, from.y*w+from.x, 0, weight*HCost(from.x, from.y, to.x, to.y));
+	if (from == to)
+	{
+		thePath.push_back(from);
+		return false;
+	}
+	return true;
+}
+
+bool JPSPlus::DoSingleSearchStep(std::vector<xyLoc> &thePath)
+{
+	if (openClosedList.OpenSize() == 0)
+		return true;
+
+	nodesExpanded++;
+	uint64_t next = openClosedList.Close();
+	xyLocParent nextState = openClosedList.Lookat(next).data;
+	if (nextState.loc == to)
+	{
+		thePath.resize(0);
+		ExtractPathToStartFromID(next, thePath);
+		std::reverse(thePath.begin(), thePath.end());
+		return true;
+	}
+
+	successors.resize(0);
+	GetJPSSuccessors(nextState.loc.x, nextState.loc.y, nextState.parent);
+	nodesTouched += successors.size();
+	double g = openClosedList.Lookat(next).g;
+	for (const auto &s : successors)
+	{
+		uint64_t theID;
+		uint64_t hash = s.s.loc.y*w+s.s.loc.x;
+		switch (openClosedList.Lookup(hash, theID))
+		{
+			case kClosedList:
+				break;
+			case kNotFound:
+				openClosedList.AddOpenNode(s.s, hash, g+s.cost,
+										   weight*HCost(s.s.loc.x, s.s.loc.y, to.x, to.y), next);
+				break;
+			case kOpenList:
+				if (fless(g+s.cost, openClosedList.Lookup(theID).g))
+				{
+					openClosedList.Lookup(theID).parentID = next;
+					openClosedList.Lookup(theID).g = g+s.cost;
+					openClosedList.Lookup(theID).data.parent = s.s.parent;
+					openClosedList.KeyChanged(theID);
+				}
+				break;
+		}
+	}
+	return false;
+}
+
+void JPSPlus::GetJPSSuccessors(int x, int y, uint8_t parent)
+{
+	const int16_t *d = &table[(y*w+x)*8];
+	bool open[8] = { false };
+	for (int which = 0; which < 8; which += 2)
+	{
+		if (!(parent&kBits[which]) || d[which] == 0)
+			continue;
+		open[which] = true;
+		int dx = kDX[which], dy = kDY[which];
+		int dist = abs(d[which]);
+		// steps to the goal if it is ahead on this line
+		int toGoal = (dx == 0)?((to.x == x)?(to.y-y)*dy:0):((to.y == y)?(to.x-x)*dx:0);
+		if (toGoal > 0 && toGoal <= dist)
+		{
+			successors.push_back(jpsSuccessor(to.x, to.y, 0, toGoal));
+			continue;
+		}
+		if (d[which] < 0)
+			continue;
+		int jx = x+dx*dist, jy = y+dy*dist;
+		uint8_t next = kBits[which];
+		// forced neighbors on either side of the jump point
+		if (Passable(jx-dy, jy+dx) && !Passable(jx-dy-dx, jy+dx-dy))
+			next |= kBits[(which+2)%8];
+		if (Passable(jx+dy, jy-dx) && !Passable(jx+dy-dx, jy-dx-dy))
+			next |= kBits[(which+6)%8];
+		successors.push_back(jpsSuccessor(jx, jy, next, dist));
+	}
+	for (int which = 1; which < 8; which += 2)
+	{
+		if (!open[(which+7)%8] || !open[(which+1)%8] || d[which] == 0)
+			continue;
+		int dx = kDX[which], dy = kDY[which];
+		int dist = abs(d[which]);
+		// the goal is in this quadrant and its row or column can be reached diagonally
+		if ((to.x-x)*dx > 0 && (to.y-y)*dy > 0)
+		{
+			int steps = std::min((to.x-x)*dx, (to.y-y)*dy);
+			if (steps <= dist)
+			{
+				successors.push_back(jpsSuccessor(x+dx*steps, y+dy*steps, kBits[which], steps*ROOT_TWO));
+				continue;
+			}
+		}
+		if (d[which] > 0)
+			successors.push_back(jpsSuccessor(x+dx*dist, y+dy*dist, kBits[which], dist*ROOT_TWO));
+	}
+}
+
+void JPSPlus::ExtractPathToStartFromID(uint64_t node, std::vector<xyLoc> &thePath)
+{
+	do {
+		thePath.push_back(openClosedList.Lookup(node).data.loc);
+		node = openClosedList.Lookup(node).parentID;
+	} while (openClosedList.Lookup(node).parentID != node);
+	thePath.push_back(openClosedList.Lookup(node).data.loc);
+}
+
+void JPSPlus::GetPath(MapEnvironment *env, const xyLoc &from, const xyLoc &to, std::vector<xyLoc> &path)
+{
+	if (InitializeSearch(env, from, to, path) == false)
+		return;
+	while (DoSingleSearchStep(path) == false)
+	{}
+}
+
+void JPSPlus::GetPath(MapEnvironment *env, const xyLoc &from, const xyLoc &to, std::vector<tDirection> &path)
+{
+	std::vector<xyLoc> points;
+	GetPath(env, from, to, points);
+	path.resize(0);
+	// consecutive jump points are on a straight or diagonal line
+	for (unsigned int x = 1; x < points.size(); x++)
+	{
+		xyLoc curr = points[x-1];
+		while (curr != points[x])
+		{
+			int dir = 0;
+			if (curr.x < points[x].x) { dir |= kE; curr.x++; }
+			else if (curr.x > points[x].x) { dir |= kW; curr.x--; }
+			if (curr.y < points[x].y) { dir |= kS; curr.y++; }
+			else if (curr.y > points[x].y) { dir |= kN; curr.y--; }
+			path.push_back(tDirection(dir));
+		}
+	}
+}
+
+void JPSPlus::GetPath(CanonicalGrid::CanonicalGrid *, const CanonicalGrid::xyLoc &from,
+					  const CanonicalGrid::xyLoc &to, std::vector<CanonicalGrid::xyLoc> &path)
+{
+	std::vector<xyLoc> points;
+	GetPath((MapEnvironment*)0, xyLoc(from.x, from.y), xyLoc(to.x, to.y), points);
+	path.resize(0);
+	for (const auto &p : points)
+		path.push_back(CanonicalGrid::xyLoc(p.x, p.y));
+}
+
+void JPSPlus::LogFinalStats(StatCollection *)
+{
+}
+
+void JPSPlus::OpenGLDraw() const
+{
+	if (env == 0 || openClosedList.size() == 0)
+		return;
+	for (unsigned int x = 0; x < openClosedList.size(); x++)
+	{
+		const auto &data = openClosedList.Lookat(x);
+		if (data.round != openClosedList.GetRound())
+			continue;
+		env->SetColor(0.0, 0.0, 0.0);
+		env->GLDrawLine(data.data.loc, openClosedList.Lookat(data.parentID).data.loc);
+		if (data.where == kOpenList)
+			env->SetColor(0.0, 1.0, 0.0);
+		else
+			env->SetColor(1.0, 0.0, 0.0);
+		env->OpenGLDraw(data.data.loc);
+	}
+}
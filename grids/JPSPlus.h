@@ -0,0 +1,97 @@
+//
+//  JPSPlus.h
+//  hog2 glut
+//
+//  JPS+: Jump Point Search with precomputed jump distances.
+//
+//  For every cell and each of the 8 directions the table stores how far
+//  the next jump point is (a positive value) or how many steps can be
+//  taken before hitting a wall (zero or a negative value). Searches then
+//  make every jump with a single table lookup, checking only whether the
+//  goal lies on the jump.
+//
+//  Movement and jump points follow BitboardJPS and CanonicalDijkstra (gJPS):
+//  cells in the ground terrain category are passable and diagonal moves
+//  need both adjacent cardinal cells to be open.
+//
+//  Building the table is linear in the size of the map. When a cache
+//  directory is given, tables are stored there in files named after the
+//  map hash and are memory mapped on later runs, so processes using the
+//  same map share one copy.
+//
+
+#ifndef JPSPlus_h
+#define JPSPlus_h
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include "JPS.h"
+#include "CanonicalGrid.h"
+
+class JPSPlus : public GenericSearchAlgorithm<xyLoc, tDirection, MapEnvironment>
+{
+public:
+	/** Loads the table from cacheDirectory if possible; otherwise builds it (and saves it there) */
+	JPSPlus(Map *m, const char *cacheDirectory = 0);
+	~JPSPlus();
+	JPSPlus(const JPSPlus &) = delete;
+	JPSPlus &operator=(const JPSPlus &) = delete;
+	/** Rebuilds the table after the map changed */
+	void UpdateMap(const char *cacheDirectory = 0);
+	bool Save(const char *filename) const;
+	bool Load(const char *filename);
+	/** Name of the table file for the map in the cache directory */
+	std::string GetCacheFileName(const char *cacheDirectory) const;
+
+	/**
+	 * Jump distance from (x, y) in direction which (0 = N, clockwise to 7 = NW).
+	 * d > 0: the next jump point is d steps away; d <= 0: -d steps are possible.
+	 */
+	int16_t GetJumpDistance(int x, int y, int which) const { return table[(y*w+x)*8+which]; }
+
+	void GetPath(MapEnvironment *env, const xyLoc &from, const xyLoc &to, std::vector<xyLoc> &path);
+	void GetPath(MapEnvironment *env, const xyLoc &from, const xyLoc &to, std::vector<tDirection> &path);
+	void GetPath(CanonicalGrid::CanonicalGrid *env, const CanonicalGrid::xyLoc &from,
+				 const CanonicalGrid::xyLoc &to, std::vector<CanonicalGrid::xyLoc> &path);
+
+	/** env is only used for drawing and may be null */
+	bool InitializeSearch(MapEnvironment *env, const xyLoc& from, const xyLoc& to, std::vector<xyLoc> &thePath);
+	bool DoSingleSearchStep(std::vector<xyLoc> &thePath);
+
+	const char *GetName() { return "JPS+"; }
+	uint64_t GetNodesExpanded() const { return nodesExpanded; }
+	uint64_t GetNodesTouched() const { return nodesTouched; }
+	uint64_t GetNumOpenItems() const { return openClosedList.OpenSize(); }
+	void SetWeight(double val) { weight = val; }
+	void LogFinalStats(StatCollection *stats);
+	void OpenGLDraw() const;
+	void OpenGLDraw(const MapEnvironment *env) const {}
+private:
+	void BuildTable();
+	void GetJPSSuccessors(int x, int y, uint8_t parent);
+	bool Passable(int x, int y) const
+	{ return x >= 0 && x < w && y >= 0 && y < h && passable[y*w+x]; }
+	double HCost(int x1, int y1, int x2, int y2) const;
+	void ExtractPathToStartFromID(uint64_t node, std::vector<xyLoc> &thePath);
+	void CloseTable();
+
+	Map *map;
+	int w, h;
+	std::vector<bool> passable;
+	// points either into builtTable or into a mapped file
+	const int16_t *table;
+	std::vector<int16_t> builtTable;
+	uint8_t *mem;
+	uint64_t memSize;
+	int fd;
+
+	IndexOpenClosed<xyLocParent> openClosedList;
+	std::vector<jpsSuccessor> successors;
+	MapEnvironment *env;
+	xyLoc to;
+	uint64_t nodesExpanded, nodesTouched;
+	double weight;
+};
+
+#endif /* JPSPlus_h */
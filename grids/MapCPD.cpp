@@ -0,0 +1,347 @@
+//
+//  MapCPD.cpp
+//  hog2 glut
+//
+//  Compressed path database (CPD) for grid maps.
+//
+
+#include "MapCPD.h"
+#include <string.h>
+#include <float.h>
+#include <queue>
+#include <algorithm>
+#include "FPUtil.h"
+#include "MMapUtil.h"
+#include "Timer.h"
+
+namespace {
+	// move 0 is north, continuing clockwise; kNoMove for the source itself
+	// and for unreachable targets
+	const int kDX[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+	const int kDY[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+	const tDirection kMoves[8] = { kN, kNE, kE, kSE, kS, kSW, kW, kNW };
+	const uint8_t kNoMove = 8;
+
+	struct CPDHeader {
+		char magic[8];
+		uint64_t mapHash;
+		uint32_t width, height;
+		uint64_t numNodes;
+		uint64_t numRuns;
+	};
+	const char kMagic[8] = {'H', 'O', 'G', 'C', 'P', 'D', '0', '1'};
+
+	uint64_t Align8(uint64_t offset) { return (offset+7)&~7ull; }
+}
+
+const uint32_t MapCPD::kNoNode;
+
+MapCPD::MapCPD(Map *m)
+:map(m), w(m->GetMapWidth()), h(m->GetMapHeight()), numNodes(0),
+cellToNode(0), nodeToCell(0), rowStart(0), runs(0), mem(0), memSize(0), fd(-1)
+{
+}
+
+MapCPD::~MapCPD()
+{
+	Close();
+}
+
+void MapCPD::Close()
+{
+	if (mem != 0)
+		CloseMMap(mem, memSize, fd);
+	mem = 0;
+	memSize = 0;
+	cellToNode = nodeToCell = 0;
+	rowStart = 0;
+	runs = 0;
+	numNodes = 0;
+	builtCellToNode.clear();
+	builtNodeToCell.clear();
+	builtRowStart.clear();
+	builtRuns.clear();
+}
+
+bool MapCPD::Passable(int x, int y) const
+{
+	if (x < 0 || x >= w || y < 0 || y >= h)
+		return false;
+	return (map->GetTerrainType(x, y)>>terrainBits) == (kGround>>terrainBits);
+}
+
+bool MapCPD::CanMove(int x, int y, int which) const
+{
+	int dx = kDX[which], dy = kDY[which];
+	if (!Passable(x+dx, y+dy))
+		return false;
+	if (dx != 0 && dy != 0)
+		return Passable(x+dx, y) && Passable(x, y+dy);
+	return true;
+}
+
+void MapCPD::OrderNodes()
+{
+	// depth-first preorder, so that nearby cells get nearby numbers
+	builtCellToNode.assign(w*h, kNoNode);
+	builtNodeToCell.resize(0);
+	std::vector<uint32_t> stack;
+	for (int start = 0; start < w*h; start++)
+	{
+		if (builtCellToNode[start] != kNoNode || !Passable(start%w, start/w))
+			continue;
+		stack.push_back(start);
+		while (stack.size() > 0)
+		{
+			uint32_t cell = stack.back();
+			stack.pop_back();
+			if (builtCellToNode[cell] != kNoNode)
+				continue;
+			builtCellToNode[cell] = builtNodeToCell.size();
+			builtNodeToCell.push_back(cell);
+			int x = cell%w, y = cell/w;
+			for (int which = 7; which >= 0; which--)
+			{
+				uint32_t next = (y+kDY[which])*w+x+kDX[which];
+				if (CanMove(x, y, which) && builtCellToNode[next] == kNoNode)
+					stack.push_back(next);
+			}
+		}
+	}
+	numNodes = builtNodeToCell.size();
+}
+
+void MapCPD::GetNeighbors(std::vector<uint32_t> &neighbors) const
+{
+	neighbors.assign(numNodes*8, kNoNode);
+	for (uint64_t node = 0; node < numNodes; node++)
+	{
+		int x = nodeToCell[node]%w, y = nodeToCell[node]/w;
+		for (int which = 0; which < 8; which++)
+			if (CanMove(x, y, which))
+				neighbors[node*8+which] = cellToNode[(y+kDY[which])*w+x+kDX[which]];
+	}
+}
+
+void MapCPD::Build(int numThreads)
+{
+	Close();
+	if (numThreads < 1)
+		numThreads = 1;
+	Timer t;
+	t.StartTimer();
+	OrderNodes();
+	cellToNode = builtCellToNode.data();
+	nodeToCell = builtNodeToCell.data();
+	std::vector<uint32_t> neighbors;
+	GetNeighbors(neighbors);
+
+	std::vector<std::vector<uint32_t> > rows(numNodes);
+	SharedQueue<std::pair<uint64_t, uint64_t> > workQueue(numThreads*20);
+	std::vector<std::thread*> threads(numThreads);
+	printf("Building CPD for %llu nodes with %d threads\n", (unsigned long long)numNodes, numThreads);
+	for (int x = 0; x < numThreads; x++)
+		threads[x] = new std::thread(&MapCPD::BuildWorker, this, &workQueue, &neighbors, &rows);
+	const uint64_t chunkSize = 64;
+	for (uint64_t x = 0; x < numNodes; x += chunkSize)
+		workQueue.WaitAdd({x, std::min(numNodes, x+chunkSize)});
+	for (int x = 0; x < numThreads; x++)
+		workQueue.WaitAdd({0, 0});
+	for (int x = 0; x < numThreads; x++)
+	{
+		threads[x]->join();
+		delete threads[x];
+		threads[x] = 0;
+	}
+
+	builtRowStart.resize(numNodes+1);
+	builtRowStart[0] = 0;
+	for (uint64_t x = 0; x < numNodes; x++)
+		builtRowStart[x+1] = builtRowStart[x]+rows[x].size();
+	builtRuns.resize(builtRowStart[numNodes]);
+	for (uint64_t x = 0; x < numNodes; x++)
+	{
+		std::copy(rows[x].begin(), rows[x].end(), builtRuns.begin()+builtRowStart[x]);
+		std::vector<uint32_t>().swap(rows[x]);
+	}
+	rowStart = builtRowStart.data();
+	runs = builtRuns.data();
+	printf("CPD built in %1.2fs: %llu runs (%1.2f per node)\n", t.EndTimer(),
+		   (unsigned long long)GetNumRuns(), numNodes?double(GetNumRuns())/numNodes:0.0);
+}
+
+void MapCPD::BuildWorker(SharedQueue<std::pair<uint64_t, uint64_t> > *work,
+						 const std::vector<uint32_t> *neighbors,
+						 std::vector<std::vector<uint32_t> > *rows)
+{
+	typedef std::pair<double, uint32_t> entry;
+	std::vector<double> dist(numNodes);
+	std::vector<uint8_t> moves(numNodes);
+	std::priority_queue<entry, std::vector<entry>, std::greater<entry> > open;
+	std::pair<uint64_t, uint64_t> item;
+	while (true)
+	{
+		work->WaitRemove(item);
+		if (item.first == item.second)
+			break;
+		for (uint64_t source = item.first; source < item.second; source++)
+		{
+			std::fill(dist.begin(), dist.end(), DBL_MAX);
+			std::fill(moves.begin(), moves.end(), kNoMove);
+			dist[source] = 0;
+			open.push(entry(0, source));
+			while (!open.empty())
+			{
+				entry next = open.top();
+				open.pop();
+				if (next.first > dist[next.second])
+					continue;
+				const uint32_t *n = &(*neighbors)[next.second*8];
+				for (int which = 0; which < 8; which++)
+				{
+					if (n[which] == kNoNode)
+						continue;
+					double cost = next.first+((which&1)?ROOT_TWO:1.0);
+					if (fless(cost, dist[n[which]]))
+					{
+						dist[n[which]] = cost;
+						moves[n[which]] = (next.second == source)?which:moves[next.second];
+						open.push(entry(cost, n[which]));
+					}
+				}
+			}
+			// the source's own entry is never looked up; copying a neighbor
+			// saves a run
+			if (numNodes > 1)
+				moves[source] = moves[(source > 0)?(source-1):1];
+			CompressRow(moves, (*rows)[source]);
+		}
+	}
+}
+
+void MapCPD::CompressRow(const std::vector<uint8_t> &moves, std::vector<uint32_t> &row) const
+{
+	row.resize(0);
+	for (uint64_t x = 0; x < moves.size(); x++)
+	{
+		if (x == 0 || moves[x] != moves[x-1])
+			row.push_back((x<<4)|moves[x]);
+	}
+	row.shrink_to_fit();
+}
+
+tDirection MapCPD::GetFirstMove(const xyLoc &from, const xyLoc &to) const
+{
+	if (!IsReady() || from.x >= w || from.y >= h || to.x >= w || to.y >= h)
+		return kStay;
+	uint32_t source = cellToNode[from.y*w+from.x];
+	uint32_t target = cellToNode[to.y*w+to.x];
+	if (source == kNoNode || target == kNoNode || source == target)
+		return kStay;
+	// last run starting at or before the target
+	const uint32_t *begin = runs+rowStart[source], *end = runs+rowStart[source+1];
+	const uint32_t *run = std::upper_bound(begin, end, (target<<4)|0xF)-1;
+	uint8_t move = (*run)&0xF;
+	if (move == kNoMove)
+		return kStay;
+	return kMoves[move];
+}
+
+bool MapCPD::GetPath(const xyLoc &from, const xyLoc &to, std::vector<xyLoc> &path) const
+{
+	path.resize(0);
+	path.push_back(from);
+	xyLoc curr = from;
+	while (curr != to)
+	{
+		tDirection move = GetFirstMove(curr, to);
+		if (move == kStay || path.size() > numNodes)
+		{
+			path.resize(0);
+			return false;
+		}
+		if (move&kE) curr.x++;
+		if (move&kW) curr.x--;
+		if (move&kS) curr.y++;
+		if (move&kN) curr.y--;
+		path.push_back(curr);
+	}
+	return true;
+}
+
+uint64_t MapCPD::GetMemoryUsage() const
+{
+	if (mem != 0)
+		return memSize;
+	return builtCellToNode.size()*sizeof(uint32_t)+builtNodeToCell.size()*sizeof(uint32_t)+
+	builtRowStart.size()*sizeof(uint64_t)+builtRuns.size()*sizeof(uint32_t);
+}
+
+bool MapCPD::Save(const char *filename) const
+{
+	if (!IsReady())
+		return false;
+	FILE *f = fopen(filename, "w");
+	if (f == 0)
+	{
+		printf("Error: unable to open '%s' for writing\n", filename);
+		return false;
+	}
+	CPDHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kMagic, 8);
+	header.mapHash = map->GetMapHash();
+	header.width = w;
+	header.height = h;
+	header.numNodes = numNodes;
+	header.numRuns = GetNumRuns();
+	uint64_t padding = 0;
+	uint64_t offset = sizeof(header)+sizeof(uint32_t)*(w*h+numNodes);
+	bool ok = (fwrite(&header, sizeof(header), 1, f) == 1) &&
+	(fwrite(cellToNode, sizeof(uint32_t), w*h, f) == (size_t)w*h) &&
+	(fwrite(nodeToCell, sizeof(uint32_t), numNodes, f) == numNodes) &&
+	(fwrite(&padding, 1, Align8(offset)-offset, f) == Align8(offset)-offset) &&
+	(fwrite(rowStart, sizeof(uint64_t), numNodes+1, f) == numNodes+1) &&
+	(header.numRuns == 0 || fwrite(runs, sizeof(uint32_t), header.numRuns, f) == header.numRuns);
+	fclose(f);
+	if (!ok)
+		printf("Error writing CPD to '%s'\n", filename);
+	return ok;
+}
+
+bool MapCPD::Load(const char *filename)
+{
+	FILE *f = fopen(filename, "r");
+	if (f == 0)
+		return false;
+	fclose(f);
+
+	Close();
+	mem = GetReadOnlyMMAP(filename, memSize, fd);
+	if (mem == 0)
+		return false;
+	CPDHeader header;
+	bool ok = memSize >= sizeof(header);
+	if (ok)
+	{
+		memcpy(&header, mem, sizeof(header));
+		uint64_t offset = Align8(sizeof(header)+sizeof(uint32_t)*(w*h+header.numNodes));
+		ok = memcmp(header.magic, kMagic, 8) == 0 && header.width == (uint32_t)w &&
+		header.height == (uint32_t)h && header.mapHash == map->GetMapHash() &&
+		memSize == offset+sizeof(uint64_t)*(header.numNodes+1)+sizeof(uint32_t)*header.numRuns;
+		if (ok)
+		{
+			numNodes = header.numNodes;
+			cellToNode = (const uint32_t *)(mem+sizeof(header));
+			nodeToCell = cellToNode+w*h;
+			rowStart = (const uint64_t *)(mem+offset);
+			runs = (const uint32_t *)(rowStart+numNodes+1);
+		}
+	}
+	if (!ok)
+	{
+		printf("Error: '%s' is not a CPD for this map\n", filename);
+		Close();
+	}
+	return ok;
+}
@@ -0,0 +1,86 @@
+//
+//  MapCPD.h
+//  hog2 glut
+//
+//  Compressed path database (CPD) for grid maps.
+//
+//  For every pair of cells the database stores the first move of an
+//  optimal path between them, so a full path is extracted one move at a
+//  time with no search. The table has one row per source cell, built with
+//  a Dijkstra search from that cell; sources are spread over threads.
+//
+//  Cells are numbered in depth-first order before building, so cells
+//  that are close on the map get close numbers. First moves then form
+//  long runs along each row, and each row is stored run-length encoded;
+//  a lookup is a binary search in the row of the current cell.
+//
+//  Movement follows the other grid searches (JPS, BitboardJPS, JPSPlus):
+//  cells in the ground terrain category are passable and diagonal moves
+//  need both adjacent cardinal cells to be open.
+//
+//  Saved databases are memory mapped when loaded, so several processes
+//  querying the same map share the pages.
+//
+
+#ifndef MapCPD_h
+#define MapCPD_h
+
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include "Map2DEnvironment.h"
+#include "SharedQueue.h"
+
+class MapCPD {
+public:
+	MapCPD(Map *m);
+	~MapCPD();
+	MapCPD(const MapCPD &) = delete;
+	MapCPD &operator=(const MapCPD &) = delete;
+
+	void Build(int numThreads = std::thread::hardware_concurrency());
+	bool Save(const char *filename) const;
+	/** Maps a database built for this map; returns false if it is missing or stale */
+	bool Load(const char *filename);
+	bool IsReady() const { return rowStart != 0; }
+
+	/** First move of an optimal path; kStay if from == to or to cannot be reached */
+	tDirection GetFirstMove(const xyLoc &from, const xyLoc &to) const;
+	/** Extracts the path with one lookup per move; returns false if there is none */
+	bool GetPath(const xyLoc &from, const xyLoc &to, std::vector<xyLoc> &path) const;
+
+	uint64_t GetNumNodes() const { return numNodes; }
+	uint64_t GetNumRuns() const { return (rowStart == 0)?0:rowStart[numNodes]; }
+	uint64_t GetMemoryUsage() const;
+
+	static const uint32_t kNoNode = 0xFFFFFFFF;
+private:
+	void OrderNodes();
+	void GetNeighbors(std::vector<uint32_t> &neighbors) const;
+	void BuildWorker(SharedQueue<std::pair<uint64_t, uint64_t> > *work,
+					 const std::vector<uint32_t> *neighbors,
+					 std::vector<std::vector<uint32_t> > *rows);
+	void CompressRow(const std::vector<uint8_t> &moves, std::vector<uint32_t> &row) const;
+	bool Passable(int x, int y) const;
+	bool CanMove(int x, int y, int which) const;
+	void Close();
+
+	Map *map;
+	int w, h;
+	uint64_t numNodes;
+	// cell (y*w+x) to node number and back; kNoNode for blocked cells
+	const uint32_t *cellToNode;
+	const uint32_t *nodeToCell;
+	// runs of row i are runs[rowStart[i]..rowStart[i+1]); each run is
+	// (first target node<<4)|move
+	const uint64_t *rowStart;
+	const uint32_t *runs;
+	// storage after Build(); after Load() the pointers go into the mapped file
+	std::vector<uint32_t> builtCellToNode, builtNodeToCell, builtRuns;
+	std::vector<uint64_t> builtRowStart;
+	uint8_t *mem;
+	uint64_t memSize;
+	int fd;
+};
+
+#endif /* MapCPD_h */
@@ -43,6 +43,8 @@ SearchUnit::SearchUnit(int _x, int _y, AbsMapUnit *_target, SearchAlgorithm *alg
 	nodesExpanded = 0;
 	nodesTouched = 0;
 	targetTime = 0;
+	batch = 0;
+	pendingFrom = pendingTo = 0;
 }
 
 //SearchUnit::SearchUnit(int _x, int _y, unit *_target, spreadExecSearchAlgorithm *alg)
@@ -99,6 +101,8 @@ SearchUnit::~SearchUnit()
 	if (spread_cache)
 		delete spread_cache;
 	spread_cache = 0;
+	if (pendingPath.valid())
+		delete pendingPath.get();
 }
 
 bool SearchUnit::getCachedMove(tDirection &dir)
@@ -184,16 +188,30 @@ bool SearchUnit::makeMove(MapProvider *mp, reservationProvider *rp, AbsMapSimula
 				targetTime = simInfo->GetSimulationTime();
 		}
 		onTarget = true;
-//		return kStay;
+		// a path to ourselves has a single node, which isn't a move
+		return false;
 	}
 	else
 		onTarget = false;
 //	if (verbose)
 //		printf("SU %p: Getting new path\n", this);
-	path *p;
-	p = algorithm->GetPath(aMap, from, to, rp);
-	nodesExpanded+=algorithm->GetNodesExpanded();
-	nodesTouched+=algorithm->GetNodesTouched();
+	path *p = 0;
+	if (pendingPath.valid())
+	{
+		p = pendingPath.get();
+		// the target may have moved since the search was started
+		if ((pendingFrom != from) || (pendingTo != to))
+		{
+			delete p;
+			p = 0;
+		}
+	}
+	if (p == 0)
+	{
+		p = algorithm->GetPath(aMap, from, to, rp);
+		nodesExpanded+=algorithm->GetNodesExpanded();
+		nodesTouched+=algorithm->GetNodesTouched();
+	}
 
 	// returning an empty path means there is no path between the start and goal
 	if (p == NULL)
@@ -234,6 +252,21 @@ bool SearchUnit::makeMove(MapProvider *mp, reservationProvider *rp, AbsMapSimula
 	return true;
 }
 
+void SearchUnit::startMove(MapProvider *mp, AbsMapSimulationInfo *)
+{
+	if ((batch == 0) || (target == 0) || s_algorithm || (moves.size() > 0) || pendingPath.valid())
+		return;
+	Map *map = mp->GetMap();
+	MapAbstraction *aMap = mp->GetMapAbstraction();
+	xyLoc l;
+	target->GetLocation(l);
+	Graph *g0 = aMap->GetAbstractGraph(0);
+	pendingFrom = g0->GetNode(map->GetNodeNum(loc.x, loc.y));
+	pendingTo = g0->GetNode(map->GetNodeNum(l.x, l.y));
+	if (pendingFrom != pendingTo)
+		pendingPath = batch->Add(aMap, pendingFrom, pendingTo);
+}
+
 void SearchUnit::addPathToCache(path *p)
 {
 	// we are at the last move; abort recursion
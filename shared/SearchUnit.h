@@ -28,7 +28,9 @@
 #include "Map.h"
 #include "SearchAlgorithm.h"
 #include "SpreadExecSearchAlgorithm.h"
+#include "BatchRefinement.h"
 #include "AbsMapUnit.h"
+#include <future>
 
 #ifndef SearchUnit_H
 #define SearchUnit_H
@@ -56,6 +58,13 @@ public:
 	virtual bool MakeMove(AbsMapEnvironment *ame, OccupancyInterface<xyLoc,tDirection> *, AbsMapSimulationInfo *si, tDirection &dir)
 		{ return makeMove(ame->GetMapAbstraction(), 0, si,dir); }
 	virtual bool makeMove(MapProvider *, reservationProvider *, AbsMapSimulationInfo *simInfo, tDirection &dir); 
+	/** Starts the next path search on batch, so the searches of all units moving this timestep run concurrently */
+	virtual void StartMove(AbsMapEnvironment *ame, AbsMapSimulationInfo *si)
+		{ startMove(ame->GetMapAbstraction(), si); }
+	/** Must get the same MapProvider as the following makeMove, or the search is wasted */
+	virtual void startMove(MapProvider *, AbsMapSimulationInfo *si);
+	/** Plan with batch instead of algorithm; batch must outlive the unit */
+	void SetBatchRefinement(BatchRefinement *b) { batch = b; }
 	
 	void UpdateLocation(AbsMapEnvironment *, xyLoc &l, bool success, AbsMapSimulationInfo *si) { updateLocation(l.x, l.y, success, si); }
 	virtual void updateLocation(int _x, int _y, bool, AbsMapSimulationInfo *);
@@ -74,6 +83,10 @@ protected:
 	spreadExecSearchAlgorithm *s_algorithm;
 	path *spread_cache;
 
+	BatchRefinement *batch;
+	std::future<path *> pendingPath;
+	node *pendingFrom, *pendingTo;
+
 	AbsMapUnit *target;
 
 	double targetTime;
@@ -30,11 +30,12 @@
 #include "UnitGroup.h"
 #include "MapCliqueAbstraction.h"
 #include "MapFlatAbstraction.h"
+#include "SearchUnit.h"
 
 using namespace GraphAbstractionConstants;
 
 SharedAMapGroup::SharedAMapGroup(MapProvider *mp)
-:aMap(0), seen(0)
+:aMap(0), pathCache(0), seen(0)
 {
 	visRadius = 2;
 	sawNewLand = true;
@@ -45,16 +46,60 @@ SharedAMapGroup::SharedAMapGroup(MapProvider *mp)
 	map = new Map(m->GetMapWidth(), m->GetMapHeight());
 	aMap = new MapCliqueAbstraction(map);
 	//aMap = new MapFlatAbstraction(map);
+	pathCache = new AbstractPathCache(aMap);
 	seen = new BitVector(m->GetMapWidth() * m->GetMapHeight());
 	
 }
 
 SharedAMapGroup::~SharedAMapGroup()
 {
+	delete pathCache;
 	delete aMap;
 	delete seen;
 }
 
+void SharedAMapGroup::AddUnit(Unit<xyLoc, tDirection, AbsMapEnvironment> *u)
+{
+	AbsMapUnitGroup::AddUnit(u);
+	praStar *pra = GetPRAStar(u);
+	if (pra)
+		pra->setSharedCache(pathCache);
+}
+
+void SharedAMapGroup::RemoveUnit(Unit<xyLoc, tDirection, AbsMapEnvironment> *u)
+{
+	// the cache is deleted with the group
+	praStar *pra = GetPRAStar(u);
+	if (pra)
+		pra->setSharedCache(0);
+	AbsMapUnitGroup::RemoveUnit(u);
+}
+
+praStar *SharedAMapGroup::GetPRAStar(Unit<xyLoc, tDirection, AbsMapEnvironment> *u)
+{
+	SearchUnit *su = dynamic_cast<SearchUnit *>(u);
+	if (su == 0)
+		return 0;
+	return dynamic_cast<praStar *>(su->getAlgorithm());
+}
+
+bool SharedAMapGroup::MakeMove(Unit<xyLoc, tDirection, AbsMapEnvironment> *u, AbsMapEnvironment *e, AbsMapSimulationInfo *si, tDirection &dir)
+{
+	SearchUnit *su = dynamic_cast<SearchUnit *>(u);
+	if (su == 0)
+		return AbsMapUnitGroup::MakeMove(u, e, si, dir);
+	return su->makeMove(this, 0, si, dir);
+}
+
+void SharedAMapGroup::StartMove(Unit<xyLoc, tDirection, AbsMapEnvironment> *u, AbsMapEnvironment *e, AbsMapSimulationInfo *si)
+{
+	SearchUnit *su = dynamic_cast<SearchUnit *>(u);
+	if (su == 0)
+		AbsMapUnitGroup::StartMove(u, e, si);
+	else
+		su->startMove(this, si);
+}
+
 //void SharedAMapGroup::updateLocation(BaseAbsMapUnit *u, MapProvider *mp, int _x, int _y, bool success, AbsMapSimulationInfo *simInfo)
 void SharedAMapGroup::UpdateLocation(Unit<xyLoc, tDirection, AbsMapEnvironment> *u, AbsMapEnvironment *mp, xyLoc &loc, bool success, AbsMapSimulationInfo *si)
 {
@@ -164,6 +209,7 @@ void SharedAMapGroup::LogStats(StatCollection *stats)
 		newTileCountPerTrial += newTileCount;
 		newTileCount = 0;
 	}
+	pathCache->LogStats(stats, GetName());
 	//fprintf(f,"%8.2f", (float)newTileCount);
 }
 
@@ -34,6 +34,8 @@
 #include "UnitGroup.h"
 #include "AbsMapUnitGroup.h"
 #include "MapProvider.h"
+#include "AbstractPathCache.h"
+#include "PRAStar.h"
 
 /**
  * A group which incrementally builds a map of the world as the units in the group
@@ -49,6 +51,15 @@ public:
 	virtual Map *GetMap() const;
 	virtual MapAbstraction *GetMapAbstraction();
 	virtual int GetNewTileCount() { return newTileCountPerTrial; }
+	/** Abstract paths shared by the units searching in the group's abstraction (see praStar::setSharedCache) */
+	AbstractPathCache *GetPathCache() { return pathCache; }
+	
+	/** praStar units in the group get the group's path cache */
+	virtual void AddUnit(Unit<xyLoc, tDirection, AbsMapEnvironment> *u);
+	virtual void RemoveUnit(Unit<xyLoc, tDirection, AbsMapEnvironment> *u);
+	/** search units plan on the group's map, so they share its abstraction and path cache */
+	virtual bool MakeMove(Unit<xyLoc, tDirection, AbsMapEnvironment> *u, AbsMapEnvironment *e, AbsMapSimulationInfo *si, tDirection &dir);
+	virtual void StartMove(Unit<xyLoc, tDirection, AbsMapEnvironment> *u, AbsMapEnvironment *e, AbsMapSimulationInfo *si);
 	
 	/** reset the location of a given unit */
 	void UpdateLocation(Unit<xyLoc, tDirection, AbsMapEnvironment> *u, AbsMapEnvironment *, xyLoc &loc, bool success, AbsMapSimulationInfo *);
@@ -70,8 +81,10 @@ public:
 	
 protected:
 	//void setUnitSimulation(unitSimulation *_us, Map *m);
+	praStar *GetPRAStar(Unit<xyLoc, tDirection, AbsMapEnvironment> *u);
 
 	MapAbstraction *aMap;
+	AbstractPathCache *pathCache;
 	Map *map;
 	BitVector *seen;
 	int visRadius;
@@ -42,6 +42,8 @@ public:
 	virtual ~Unit() { SetUnitGroup(0); }
 	virtual const char *GetName() = 0;
 	virtual bool MakeMove(environment *, OccupancyInterface<state,action> *, SimulationInfo<state,action,environment> *, action& a) = 0;
+	/** Called for every unit about to move, before any of them moves, so units can start planning concurrently */
+	virtual void StartMove(environment *, SimulationInfo<state,action,environment> *) {}
 	virtual void UpdateLocation(environment *, state &, bool success, SimulationInfo<state,action,environment> *) = 0;
 	virtual void GetLocation(state &) = 0;
 	virtual void OpenGLDraw(const environment *, const SimulationInfo<state,action,environment> *) const = 0;
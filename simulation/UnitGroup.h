@@ -50,6 +50,12 @@ public:
 	
 	virtual const char *GetName() { return "defaultUnitGroup"; }
 	
+	/** Groups that change what MakeMove plans on should start the move on the same thing */
+	virtual void StartMove(Unit<state, action, environment> *u, environment *e, SimulationInfo<state,action,environment> *si)
+	{
+		u->StartMove(e, si);
+	}
+
 	virtual bool MakeMove(Unit<state, action, environment> *u, environment *e, SimulationInfo<state,action,environment> *si, action& a)
 	{
 		return (u->MakeMove(e, e->GetOccupancyInfo(), si,a));
@@ -60,7 +66,7 @@ public:
 		u->UpdateLocation(e, loc, success, si);
 	}
 	
-	void AddUnit(Unit<state, action, environment> *u)
+	virtual void AddUnit(Unit<state, action, environment> *u)
 	{
 		// Check if we already have this unit
 		for (unsigned int x = 0; x < members.size(); x++)
@@ -83,7 +89,7 @@ public:
    }
 
 
-	void RemoveUnit(Unit<state, action, environment> *u)
+	virtual void RemoveUnit(Unit<state, action, environment> *u)
 	{
 		for (unsigned int x = 0; x < members.size(); x++)
 		{
@@ -357,6 +357,11 @@ void UnitSimulation<state, action, environment>::DoPreTimestepCalc()
 template<class state, class action, class environment>
 void UnitSimulation<state, action, environment>::DoTimestepCalc(double timeStep)
 {
+	for (unsigned int x = 0; x < units.size(); x++)
+	{
+		if (currTime >= units[x]->nextTime)
+			units[x]->agent->GetUnitGroup()->StartMove(units[x]->agent, env, this);
+	}
 	for (unsigned int x = 0; x < units.size(); x++)
 	{
 		currentActor = x;
@@ -0,0 +1,289 @@
+//
+//  DistanceTable.cpp
+//  hog2
+//
+//  Common on-disk format for exact distance tables.
+//
+
+#include "DistanceTable.h"
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <cassert>
+#include <algorithm>
+#include "MMapUtil.h"
+
+static const char kMagic[8] = {'H', 'O', 'G', 'D', 'I', 'S', 'T', '1'};
+
+const uint32_t DistanceTable::kInfinity;
+const int DistanceTable::kChunkBits;
+const uint64_t DistanceTable::kChunkSize;
+const uint32_t DistanceTable::kVersion;
+const uint32_t DistanceTable::kRoundedFlag;
+
+DistanceTable::DistanceTable()
+:mem(0), memSize(0), fd(-1), rows(0), columns(0), scale(1.0), exact(true), index(0)
+{
+}
+
+DistanceTable::~DistanceTable()
+{
+	Close();
+}
+
+bool DistanceTable::Load(const char *filename)
+{
+	Close();
+	mem = GetReadOnlyMMAP(filename, memSize, fd);
+	if (mem == 0)
+		return false;
+	Header h;
+	if (memSize < sizeof(Header))
+	{
+		printf("Error: '%s' is too small to be a distance table\n", filename);
+		Close();
+		return false;
+	}
+	memcpy(&h, mem, sizeof(Header));
+	uint64_t numChunks = (h.rows*h.columns+kChunkSize-1)/kChunkSize;
+	if (memcmp(h.magic, kMagic, 8) != 0 || h.chunkBits != kChunkBits || h.version != kVersion ||
+		h.indexOffset+numChunks*sizeof(ChunkInfo) > memSize)
+	{
+		printf("Error: '%s' is not a valid distance table\n", filename);
+		Close();
+		return false;
+	}
+	rows = h.rows;
+	columns = h.columns;
+	scale = h.scale;
+	exact = (h.flags&kRoundedFlag) == 0;
+	index = (const ChunkInfo *)(mem+h.indexOffset);
+	return true;
+}
+
+void DistanceTable::Close()
+{
+	if (mem != 0)
+		CloseMMap(mem, memSize, fd);
+	mem = 0;
+	memSize = 0;
+	index = 0;
+	rows = columns = 0;
+}
+
+uint32_t DistanceTable::Decode(const ChunkInfo &c, uint64_t which) const
+{
+	if (c.bits == 0)
+		return c.base;
+	const uint64_t *words = (const uint64_t *)(mem+c.offset);
+	uint64_t bit = which*c.bits;
+	uint64_t word = bit>>6;
+	int shift = bit&63;
+	uint64_t value = words[word]>>shift;
+	if (shift+c.bits > 64)
+		value |= words[word+1]<<(64-shift);
+	value &= (1ull<<c.bits)-1;
+	if (c.hasInfinity && value == (1ull<<c.bits)-1)
+		return kInfinity;
+	return c.base+(uint32_t)value;
+}
+
+uint32_t DistanceTable::Get(uint64_t rank) const
+{
+	assert(rank < GetNumEntries());
+	return Decode(index[rank>>kChunkBits], rank&(kChunkSize-1));
+}
+
+double DistanceTable::GetDistance(uint64_t rank) const
+{
+	uint32_t v = Get(rank);
+	if (v == kInfinity)
+		return DBL_MAX;
+	return v*scale;
+}
+
+void DistanceTable::Get(const uint64_t *ranks, uint64_t count, uint32_t *values) const
+{
+	// touch the index entries first and then the data, so that page faults
+	// and cache misses for the whole batch overlap
+	for (uint64_t x = 0; x < count; x++)
+		__builtin_prefetch(&index[ranks[x]>>kChunkBits]);
+	for (uint64_t x = 0; x < count; x++)
+	{
+		const ChunkInfo &c = index[ranks[x]>>kChunkBits];
+		if (c.bits != 0)
+			__builtin_prefetch(mem+c.offset+(((ranks[x]&(kChunkSize-1))*c.bits)>>3));
+	}
+	for (uint64_t x = 0; x < count; x++)
+		values[x] = Get(ranks[x]);
+}
+
+void DistanceTable::GetDistances(const uint64_t *ranks, uint64_t count, double *values) const
+{
+	std::vector<uint32_t> raw(count);
+	Get(ranks, count, &raw[0]);
+	for (uint64_t x = 0; x < count; x++)
+		values[x] = (raw[x] == kInfinity)?DBL_MAX:raw[x]*scale;
+}
+
+void DistanceTable::GetRange(uint64_t first, uint64_t count, uint32_t *values) const
+{
+	assert(first+count <= GetNumEntries());
+	uint64_t x = 0;
+	while (x < count)
+	{
+		uint64_t rank = first+x;
+		const ChunkInfo &c = index[rank>>kChunkBits];
+		uint64_t end = std::min(count, x+kChunkSize-(rank&(kChunkSize-1)));
+		if (c.bits == 0)
+		{
+			std::fill(values+x, values+end, c.base);
+			x = end;
+			continue;
+		}
+		for (; x < end; x++)
+			values[x] = Decode(c, (first+x)&(kChunkSize-1));
+	}
+}
+
+DistanceTableWriter::DistanceTableWriter(const char *filename, uint64_t rows, uint64_t columns, double scale)
+:written(0), offset(sizeof(DistanceTable::Header)), error(false)
+{
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kMagic, 8);
+	header.rows = rows;
+	header.columns = columns;
+	header.scale = scale;
+	header.chunkBits = DistanceTable::kChunkBits;
+	header.version = DistanceTable::kVersion;
+
+	file = fopen(filename, "w+");
+	if (file == 0)
+	{
+		printf("Error: unable to open '%s' for writing\n", filename);
+		return;
+	}
+	// the header is rewritten with the index offset in Close()
+	if (fwrite(&header, sizeof(header), 1, file) != 1)
+		error = true;
+}
+
+DistanceTableWriter::~DistanceTableWriter()
+{
+	Close();
+}
+
+void DistanceTableWriter::Add(uint32_t value)
+{
+	assert(written < header.rows*header.columns);
+	chunk.push_back(value);
+	written++;
+	if (chunk.size() == DistanceTable::kChunkSize)
+		FlushChunk();
+}
+
+void DistanceTableWriter::AddDistance(double distance)
+{
+	double v = floor(distance/header.scale+1e-9);
+	if (distance == DBL_MAX || distance < 0 || v >= DistanceTable::kInfinity)
+	{
+		Add(DistanceTable::kInfinity);
+		return;
+	}
+	if (distance/header.scale-v > 1e-6)
+		header.flags |= DistanceTable::kRoundedFlag;
+	Add((uint32_t)v);
+}
+
+void DistanceTableWriter::FlushChunk()
+{
+	if (chunk.size() == 0)
+		return;
+	DistanceTable::ChunkInfo c;
+	memset(&c, 0, sizeof(c));
+	c.offset = offset;
+
+	uint32_t minVal = DistanceTable::kInfinity, maxVal = 0;
+	for (unsigned int x = 0; x < chunk.size(); x++)
+	{
+		if (chunk[x] == DistanceTable::kInfinity)
+		{
+			c.hasInfinity = 1;
+			continue;
+		}
+		minVal = std::min(minVal, chunk[x]);
+		maxVal = std::max(maxVal, chunk[x]);
+	}
+	if (minVal == DistanceTable::kInfinity) // everything unreachable
+	{
+		c.base = DistanceTable::kInfinity;
+		c.hasInfinity = 0;
+	}
+	else {
+		c.base = minVal;
+		// with unreachable entries the largest code is reserved for them
+		uint64_t largest = (uint64_t)(maxVal-minVal)+c.hasInfinity;
+		while ((1ull<<c.bits)-1 < largest)
+			c.bits++;
+		if (c.bits == 0)
+			c.hasInfinity = 0;
+	}
+
+	if (c.bits != 0)
+	{
+		packed.assign((chunk.size()*c.bits+63)/64, 0);
+		uint64_t infCode = (1ull<<c.bits)-1;
+		for (unsigned int x = 0; x < chunk.size(); x++)
+		{
+			uint64_t code = (chunk[x] == DistanceTable::kInfinity)?infCode:(chunk[x]-minVal);
+			uint64_t bit = (uint64_t)x*c.bits;
+			int shift = bit&63;
+			packed[bit>>6] |= code<<shift;
+			if (shift+c.bits > 64)
+				packed[(bit>>6)+1] |= code>>(64-shift);
+		}
+		if (file != 0 && fwrite(&packed[0], sizeof(uint64_t), packed.size(), file) != packed.size())
+			error = true;
+		offset += packed.size()*sizeof(uint64_t);
+	}
+	index.push_back(c);
+	chunk.clear();
+}
+
+bool DistanceTableWriter::Close()
+{
+	if (file == 0)
+		return false;
+	if (written != header.rows*header.columns)
+	{
+		printf("Error: distance table got %llu of %llu entries\n", (unsigned long long)written,
+			   (unsigned long long)(header.rows*header.columns));
+		error = true;
+	}
+	FlushChunk();
+	header.indexOffset = offset;
+	if (index.size() > 0 &&
+		fwrite(&index[0], sizeof(DistanceTable::ChunkInfo), index.size(), file) != index.size())
+		error = true;
+	fseek(file, 0, SEEK_SET);
+	if (fwrite(&header, sizeof(header), 1, file) != 1)
+		error = true;
+	fclose(file);
+	file = 0;
+	return !error;
+}
+
+bool DistanceTableWriter::Write(const char *filename, const std::vector<std::vector<double> > &distances, double scale)
+{
+	uint64_t columns = (distances.size() > 0)?distances[0].size():0;
+	DistanceTableWriter w(filename, distances.size(), columns, scale);
+	if (!w.IsOpen())
+		return false;
+	for (unsigned int x = 0; x < distances.size(); x++)
+	{
+		assert(distances[x].size() == columns);
+		for (unsigned int y = 0; y < columns; y++)
+			w.AddDistance(distances[x][y]);
+	}
+	return w.Close();
+}
@@ -0,0 +1,131 @@
+//
+//  DistanceTable.h
+//  hog2
+//
+//  Common on-disk format for exact distance tables (pattern database
+//  depths, differential heuristics, all-pairs distances).
+//
+//  A table has rows x columns entries, addressed either by rank or by
+//  (row, column) = (rank / columns, rank % columns). Distances are stored
+//  as integer multiples of a scale factor; non-integer distances are
+//  rounded down, so every stored distance is at most the true one. The
+//  difference of two rounded entries can still be one unit too large, so
+//  differential heuristics read from a table that isn't IsExact() must
+//  subtract one unit to stay admissible.
+//
+//  Entries are compressed in chunks of 2^kChunkBits: each chunk stores
+//  its minimum value and the differences to it in the fewest bits that
+//  hold them. A small index after the data has one entry per chunk.
+//  Tables are memory mapped read-only, so only the pages that are used
+//  get loaded and processes that map the same file share them.
+//
+
+#ifndef DISTANCETABLE_H
+#define DISTANCETABLE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+class DistanceTable {
+public:
+	DistanceTable();
+	~DistanceTable();
+	DistanceTable(const DistanceTable &) = delete;
+	DistanceTable &operator=(const DistanceTable &) = delete;
+	/** Maps a table file; returns false if it is missing or not a distance table */
+	bool Load(const char *filename);
+	void Close();
+	bool IsLoaded() const { return mem != 0; }
+
+	uint64_t GetNumEntries() const { return rows*columns; }
+	uint64_t GetNumRows() const { return rows; }
+	uint64_t GetNumColumns() const { return columns; }
+	double GetScale() const { return scale; }
+	/** True if no distance was rounded when the table was written */
+	bool IsExact() const { return exact; }
+	uint64_t GetFileSize() const { return memSize; }
+
+	/** Stored value of an entry (distance/scale); kInfinity if it is unreachable */
+	uint32_t Get(uint64_t rank) const;
+	uint32_t Get(uint64_t row, uint64_t column) const { return Get(row*columns+column); }
+	/** Distance of an entry; DBL_MAX if it is unreachable */
+	double GetDistance(uint64_t rank) const;
+	double GetDistance(uint64_t row, uint64_t column) const { return GetDistance(row*columns+column); }
+
+	/** Batched lookup; all index and data reads are issued before the values are decoded */
+	void Get(const uint64_t *ranks, uint64_t count, uint32_t *values) const;
+	void GetDistances(const uint64_t *ranks, uint64_t count, double *values) const;
+	/** Decodes count consecutive entries starting at rank first */
+	void GetRange(uint64_t first, uint64_t count, uint32_t *values) const;
+
+	static const uint32_t kInfinity = 0xFFFFFFFF;
+	static const int kChunkBits = 12;
+	static const uint64_t kChunkSize = 1ull<<kChunkBits;
+private:
+	friend class DistanceTableWriter;
+	struct Header {
+		char magic[8];
+		uint64_t rows, columns;
+		double scale;
+		uint64_t indexOffset;
+		uint32_t chunkBits;
+		uint32_t version;
+		uint32_t flags;
+		uint32_t unused;
+	};
+	static const uint32_t kVersion = 2;
+	static const uint32_t kRoundedFlag = 0x1;
+	struct ChunkInfo {
+		uint64_t offset; // byte offset of the packed data
+		uint32_t base; // smallest value in the chunk
+		uint8_t bits; // bits per value; 0 if all values equal base
+		uint8_t hasInfinity; // the largest code stands for kInfinity
+		uint16_t unused;
+	};
+	uint32_t Decode(const ChunkInfo &c, uint64_t which) const;
+
+	uint8_t *mem;
+	uint64_t memSize;
+	int fd;
+	uint64_t rows, columns;
+	double scale;
+	bool exact;
+	const ChunkInfo *index;
+};
+
+/**
+ * Writes a distance table entry by entry in rank order. The file is only
+ * complete (and loadable) after Close().
+ */
+class DistanceTableWriter {
+public:
+	DistanceTableWriter(const char *filename, uint64_t rows, uint64_t columns, double scale = 1.0);
+	~DistanceTableWriter();
+	bool IsOpen() const { return file != 0; }
+	void Add(uint32_t value);
+	/**
+	 * Stores a distance rounded down to a multiple of the scale. DBL_MAX and
+	 * negative distances (used as "unreachable" by some callers) are stored
+	 * as kInfinity. If any distance is rounded the table isn't IsExact().
+	 */
+	void AddDistance(double distance);
+	/** Marks the table as not IsExact(), for values rounded before they were added */
+	void SetRounded() { header.flags |= DistanceTable::kRoundedFlag; }
+	/** Writes the last chunk and the index; returns false on errors */
+	bool Close();
+
+	/** Writes one row per vector, e.g. the results of FloydWarshall */
+	static bool Write(const char *filename, const std::vector<std::vector<double> > &distances, double scale = 1.0);
+private:
+	void FlushChunk();
+	FILE *file;
+	DistanceTable::Header header;
+	std::vector<DistanceTable::ChunkInfo> index;
+	std::vector<uint32_t> chunk;
+	std::vector<uint64_t> packed;
+	uint64_t written, offset;
+	bool error;
+};
+
+#endif
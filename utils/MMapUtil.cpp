@@ -81,6 +81,26 @@ uint8_t *GetMMAP(const char *filename, uint64_t mapSize, int &fd, bool zero)
 	return memblock;
 }
 
+uint8_t *GetReadOnlyMMAP(const char *filename, uint64_t &mapSize, int &fd)
+{
+	struct stat sb;
+	if ((fd = open(filename, O_RDONLY)) == -1)
+	{
+		perror("open");
+		return 0;
+	}
+	fstat(fd, &sb);
+	mapSize = sb.st_size;
+	uint8_t *memblock = (uint8_t *)mmap(NULL, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+	if (memblock == MAP_FAILED)
+	{
+		perror("mmap");
+		close(fd);
+		return 0;
+	}
+	return memblock;
+}
+
 void CloseMMap(uint8_t *mem, uint64_t mapSizeBytes, int fd)
 {
 	if (munmap(mem, mapSizeBytes) != 0)
@@ -11,5 +11,7 @@
 
 uint8_t *GetMMAP(const char *filename, uint64_t mapSizeBytes, int &fd, bool zero = false);
 void CloseMMap(uint8_t *mem, uint64_t mapSizeBytes, int fd);
+// Maps an entire existing file read-only; returns 0 on failure
+uint8_t *GetReadOnlyMMAP(const char *filename, uint64_t &mapSizeBytes, int &fd);
 
 #endif
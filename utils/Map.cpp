@@ -104,6 +104,7 @@ Map::Map(long _width, long _height)
 	dList = 0;
 	updated = true;
 	revision = 0;
+	BuildGroundBits();
 	//	numAbstractions = 1;
 	//	pathgraph = 0;
 }
@@ -133,6 +134,7 @@ Map::Map(Map *m)
 	for (int x = 0; x < width; x++)
 		for (int y = 0; y < height; y++)
 			land[x][y] = m->land[x][y];
+	BuildGroundBits();
 }
 
 /** 
@@ -215,6 +217,7 @@ void Map::Scale(long newWidth, long newHeight)
 	revision++;
 	updated = true;
 	map_name[0] = 0;
+	BuildGroundBits();
 }
 
 void Map::Trim()
@@ -254,6 +257,7 @@ void Map::Trim()
 	revision++;
 	updated = true;
 	map_name[0] = 0;
+	BuildGroundBits();
 }
 
 
@@ -291,6 +295,8 @@ void Map::Load(const char *filename)
 		dList = 0;
 		updated = true;
 		map_name[0] = 0;
+		groundBits.resize(0);
+		BuildGroundBits();
 	}
 }
 
@@ -307,6 +313,9 @@ void Map::Load(FILE *f)
 		land = 0;
 	}
 	
+	// rebuilt once the map is loaded
+	groundBits.resize(0);
+
 	char format[32];
 	// ADD ERROR HANDLING HERE
 	int num = fscanf(f, "type %s\nheight %d\nwidth %d\nmap\n", format, &height, &width);
@@ -319,15 +328,18 @@ void Map::Load(FILE *f)
 			loadOctileCorner(f, height, width);
 		else if (strcmp(format, "raw") == 0)
 			loadRaw(f, height, width);
+		BuildGroundBits();
 		return;
 	}
 	if (tryLoadRollingStone(f))
 	{
+		BuildGroundBits();
 		return;
 	}
 	if (tryDragonAge(f))
 	{
 		//Trim();
+		BuildGroundBits();
 		return;
 	}
 
@@ -342,6 +354,7 @@ void Map::Load(FILE *f)
 		dList = 0;
 		updated = true;
 		map_name[0] = 0;
+		BuildGroundBits();
 	}
 }
 
@@ -983,6 +996,31 @@ const char *Map::GetMapName()
 	return map_name;
 }
 
+uint64_t Map::GetMapHash() const
+{
+	// FNV-1a over the size, splits and the terrain on both sides of each tile
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](uint64_t value) {
+		for (int x = 0; x < 8; x++)
+		{
+			hash ^= (value>>(8*x))&0xFF;
+			hash *= 1099511628211ull;
+		}
+	};
+	add(width);
+	add(height);
+	for (long y = 0; y < height; y++)
+	{
+		for (long x = 0; x < width; x++)
+		{
+			add(land[x][y].split);
+			add(land[x][y].tile1.type);
+			add(land[x][y].tile2.type);
+		}
+	}
+	return hash;
+}
+
 /** 
 * Return the tile at location x, y.
 *
@@ -1128,6 +1166,58 @@ void Map::SetTerrainType(long x, long y, tTerrain type, tSplitSide split)
 			land[x][y].tile2.type = type;
 			break;
 	}
+	UpdateGroundBit(x, y);
+	for (unsigned int t = 0; t < listeners.size(); t++)
+		listeners[t]->TileChanged(this, x, y);
+}
+
+void Map::AddChangeListener(MapChangeListener *l)
+{
+	for (unsigned int t = 0; t < listeners.size(); t++)
+		if (listeners[t] == l)
+			return;
+	listeners.push_back(l);
+}
+
+void Map::RemoveChangeListener(MapChangeListener *l)
+{
+	for (unsigned int t = 0; t < listeners.size(); t++)
+	{
+		if (listeners[t] == l)
+		{
+			listeners.erase(listeners.begin()+t);
+			return;
+		}
+	}
+}
+
+/**
+ * Rebuilds the bitmap behind GetGroundWindow. Rows are padded with a
+ * border of empty cells and a spare byte, so that windows never need
+ * bounds checks.
+ */
+void Map::BuildGroundBits()
+{
+	groundBits.resize(0);
+	if (mapType != kOctile)
+		return;
+	groundStride = (width+2+7)/8+1;
+	groundBits.resize(groundStride*(height+2));
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			UpdateGroundBit(x, y);
+}
+
+void Map::UpdateGroundBit(long x, long y)
+{
+	// empty while loading; rebuilt afterwards
+	if (groundBits.size() == 0)
+		return;
+	long bit = (y+1)*groundStride*8+(x+1);
+	if ((GetTerrainType(x, y)>>terrainBits) == (kGround>>terrainBits))
+		groundBits[bit>>3] |= (1<<(bit&7));
+	else
+		groundBits[bit>>3] &= ~(1<<(bit&7));
 }
 
 /** 
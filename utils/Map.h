@@ -35,6 +35,7 @@ static const double ONE_OVER_ROOT_TWO = 1.0/ROOT_TWO;//0.707106781f;
 #include <unistd.h>
 #include <iostream>
 #include <stdint.h>
+#include <vector>
 
 #include "GLUtil.h"
 //#include "Graph.h"
@@ -137,6 +138,19 @@ enum tMapType {
 	kRaw
 };
 
+class Map;
+
+/**
+ * Interface for data kept in step with the terrain of a map. Listeners
+ * registered with Map::AddChangeListener are called after each tile whose
+ * terrain type is set.
+ */
+class MapChangeListener {
+public:
+	virtual ~MapChangeListener() {}
+	virtual void TileChanged(Map *m, long x, long y) = 0;
+};
+
 /*
  *
  * All the set/get functions should be fairly obvious, with the following
@@ -171,6 +185,8 @@ public:
 	void Save(FILE *f);
 	Map *Clone() { return new Map(this); }
 	const char *GetMapName();
+	/** 64-bit hash of the map size and terrain, for keying data computed from the map */
+	uint64_t GetMapHash() const;
 	void Print(int scale = 1);
 	/** return the width of the map */
 	inline long GetMapWidth() const { return width; }
@@ -218,6 +234,23 @@ public:
 	bool AdjacentCorners(long x, long y, tCorner corner) const;
 	// returns whether we can step between two locations or not
 	bool CanStep(long x1, long y1, long x2, long y2) const;
+	/**
+	 * Returns the 3x3 neighborhood of (x, y) in the ground category as
+	 * bit 3*(dy+1)+(dx+1) for each offset dx, dy in -1..1. For octile maps
+	 * CanStep from a ground cell is true exactly for the set bits; other
+	 * maps always return 0. x and y must be on the map.
+	 */
+	inline int GetGroundWindow(long x, long y) const
+	{
+		if (groundBits.size() == 0)
+			return 0;
+		// cell (x, y) is stored at (x+1, y+1), so the window starts at bit x of row y
+		const uint8_t *row = &groundBits[y*groundStride+(x>>3)];
+		int shift = x&7;
+		return (((row[0]|(row[1]<<8))>>shift)&0x7)|
+			((((row[groundStride]|(row[groundStride+1]<<8))>>shift)&0x7)<<3)|
+			((((row[2*groundStride]|(row[2*groundStride+1]<<8))>>shift)&0x7)<<6);
+	}
 	
 	void OpenGLDraw(tDisplay how = kPolygons) const;
 	bool GetOpenGLCoord(int _x, int _y, GLdouble &x, GLdouble &y, GLdouble &z, GLdouble &radius) const;
@@ -237,6 +270,9 @@ public:
 	int GetNodeNum(int x, int y, tCorner c = kNone);
 	void SetNodeNum(int num, int x, int y, tCorner c = kNone);
 	int GetRevision() { return revision; }
+	/** Listeners are not owned by the map, and are not copied with it */
+	void AddChangeListener(MapChangeListener *l);
+	void RemoveChangeListener(MapChangeListener *l);
 private:
 	void loadRaw(FILE *f, int height, int width);
 	void loadOctile(FILE *f, int height, int width);
@@ -248,6 +284,8 @@ private:
 	bool isLegalStone(char c);
 	void paintRoomInside(int x, int y);
 	void drawLandQuickly() const;
+	void BuildGroundBits();
+	void UpdateGroundBit(long x, long y);
 	int width, height;
 	Tile **land;
 	bool drawLand;
@@ -258,6 +296,11 @@ private:
 	char map_name[128];
 	tMapType mapType;
 	tTileset tileSet;
+	// 1 bit per cell in the ground category, with a border of empty cells;
+	// only kept for octile maps
+	std::vector<uint8_t> groundBits;
+	long groundStride;
+	std::vector<MapChangeListener *> listeners;
 };
 
 #endif
@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <algorithm>
+#include "MMapUtil.h"
 
 /**
  * This class supports compact n-bit arrays. For (1 <= n <= 64). 
@@ -38,15 +39,25 @@ public:
 	bool Read(FILE *);
 	bool Write(const char *);
 	bool Read(const char *);
+	/** Maps an array written by Write() read-only, starting at the given
+	 * byte offset in the file. The data is used in place, so Set() must
+	 * not be called on a mapped array. */
+	bool MMap(const char *, uint64_t fileOffset = 0);
+	/** Number of bytes used by Write() */
+	uint64_t GetFileSize() const { return 2*sizeof(uint64_t)+memorySize*sizeof(uint64_t); }
 private:
+	void FreeMemory();
 	uint64_t *mem;
 	uint64_t entries;
 	uint64_t memorySize;
+	uint8_t *mappedMem; // non-null if mem points into a mapped file
+	uint64_t mappedBytes;
+	int mappedFD;
 };
 
 template <uint64_t numBits>
 NBitArray<numBits>::NBitArray(uint64_t numEntries)
-:entries(numEntries), memorySize(((entries*numBits+63)/64))
+:entries(numEntries), memorySize(((entries*numBits+63)/64)), mappedMem(0)
 {
 	static_assert(numBits >= 1 && numBits <= 64, "numBits out of bounds!");
 
@@ -55,7 +66,7 @@ NBitArray<numBits>::NBitArray(uint64_t numEntries)
 
 template <uint64_t numBits>
 NBitArray<numBits>::NBitArray(const char *file)
-:mem(0)
+:mem(0), mappedMem(0)
 {
 	static_assert(numBits >= 1 && numBits <= 64, "numBits out of bounds!");
 	Read(file);
@@ -63,6 +74,7 @@ NBitArray<numBits>::NBitArray(const char *file)
 
 template <uint64_t numBits>
 NBitArray<numBits>::NBitArray(const NBitArray &copyMe)
+:mappedMem(0)
 {
 	entries = copyMe.entries;
 	memorySize = copyMe.memorySize;
@@ -74,7 +86,21 @@ NBitArray<numBits>::NBitArray(const NBitArray &copyMe)
 template <uint64_t numBits>
 NBitArray<numBits>::~NBitArray()
 {
-	delete [] mem;
+	FreeMemory();
+}
+
+template <uint64_t numBits>
+void NBitArray<numBits>::FreeMemory()
+{
+	if (mappedMem)
+	{
+		CloseMMap(mappedMem, mappedBytes, mappedFD);
+		mappedMem = 0;
+	}
+	else {
+		delete [] mem;
+	}
+	mem = 0;
 }
 
 template <uint64_t numBits>
@@ -82,7 +108,7 @@ NBitArray<numBits> &NBitArray<numBits>::operator=(const NBitArray &copyMe)
 {
 	if (this == &copyMe)
 		return *this;
-	delete mem;
+	FreeMemory();
 	entries = copyMe.entries;
 	memorySize = copyMe.memorySize;
 	mem = new uint64_t[memorySize];
@@ -107,7 +133,7 @@ void NBitArray<numBits>::Resize(uint64_t newMaxEntries)
 {
 	entries = newMaxEntries;
 	memorySize = ((entries*numBits+63)/64);
-	delete [] mem;
+	FreeMemory();
 	mem = new uint64_t[memorySize];
 }
 
@@ -141,7 +167,7 @@ bool NBitArray<numBits>::Read(FILE *f)
 	{
 		entries = e1;
 		memorySize = m1;
-		delete [] mem;
+		FreeMemory();
 		mem = new uint64_t[memorySize];
 		success = success&&(fread(mem, sizeof(uint64_t), memorySize, f) == memorySize);
 	}
@@ -176,6 +202,34 @@ bool NBitArray<numBits>::Read(const char *file)
 	return result;
 }
 
+template <uint64_t numBits>
+bool NBitArray<numBits>::MMap(const char *file, uint64_t fileOffset)
+{
+	uint64_t bytes;
+	int fd;
+	uint8_t *m = GetReadOnlyMMAP(file, bytes, fd);
+	if (m == 0)
+		return false;
+	uint64_t *header = (uint64_t*)(m+fileOffset);
+	// compare counts rather than byte sizes, which a corrupt header could overflow
+	if (fileOffset%sizeof(uint64_t) != 0 || fileOffset > bytes || bytes-fileOffset < 2*sizeof(uint64_t) ||
+		header[1] > (bytes-fileOffset-2*sizeof(uint64_t))/sizeof(uint64_t) ||
+		header[0] > header[1]*64/numBits)
+	{
+		printf("Invalid NBitArray file or offset (%s)\n", file);
+		CloseMMap(m, bytes, fd);
+		return false;
+	}
+	FreeMemory();
+	entries = header[0];
+	memorySize = header[1];
+	mem = header+2;
+	mappedMem = m;
+	mappedBytes = bytes;
+	mappedFD = fd;
+	return true;
+}
+
 template <uint64_t numBits>
 uint64_t NBitArray<numBits>::Get(uint64_t index) const
 {